@@ -0,0 +1,94 @@
+#ifndef ACF_H
+#define ACF_H
+
+/**
+ * @file acf.h
+ * @brief Heart rate from the autocorrelation of the pulse wave
+ *
+ * The IR pulse wave of ppg.h, band-passed and decimated to PPG_OUTPUT_HZ, is
+ * kept over a sliding window of ACF_WINDOW samples. Every ACF_STEP samples
+ * its autocorrelation is computed over the lags of 250 to 30 bpm, unbiased
+ * (each lag divided by the number of products) and normalised by the lag 0.
+ * The period is the first local maximum within ACF_HARMONIC_PERCENT of the
+ * highest one, so that a multiple of the period is not taken for it, refined
+ * between the lags by the vertex of the parabola through its neighbours.
+ *
+ * The height of that maximum, the periodicity of the wave, is the confidence
+ * of the estimate: unlike the hub algorithm, it needs no settling time once
+ * the window holds the pulse.
+ *
+ * All buffers are in acf_t, the window is stored twice so that the last
+ * ACF_WINDOW samples are always contiguous. Integer arithmetic only.
+ */
+
+#include "ppg.h"
+
+/**
+ * @brief Samples in the window, 5.12 s, a power of two
+ */
+#define ACF_WINDOW (128U)
+
+/**
+ * @brief Samples between two estimates, 1 s
+ */
+#define ACF_STEP (PPG_OUTPUT_HZ)
+
+/**
+ * @brief Lags searched, samples: 250 to 30 bpm
+ */
+#define ACF_MIN_LAG (PPG_OUTPUT_HZ * 60U / 250U)
+#define ACF_MAX_LAG (PPG_OUTPUT_HZ * 60U / 30U)
+
+/**
+ * @brief A shorter lag is taken for the period when its peak is at least
+ *        this share of the highest, percent
+ */
+#define ACF_HARMONIC_PERCENT (85U)
+
+/**
+ * @brief One in the Q15 format of the correlations
+ */
+#define ACF_ONE (1L << 15)
+
+typedef struct acf {
+    int16_t window[2U * ACF_WINDOW];            // each sample at i and i + ACF_WINDOW
+    uint16_t head;                              // oldest sample of the window
+    uint16_t filled;                            // samples in the window
+    uint16_t sinceEstimate;                     // samples since the last estimate
+    int16_t correlation[ACF_MAX_LAG + 2U];      // of the last estimate, Q15 of the lag 0
+    uint16_t heartRate;                         // last estimate, 0.1 bpm, 0 if there is none
+    uint8_t periodicity;                        // correlation at the period, percent
+    uint32_t estimates;                         // estimates computed
+} acf_t;
+
+/**
+ * @brief Clears the window and the estimate
+ *
+ * @param acf estimator to initialise
+ */
+void acf_init(acf_t *acf);
+
+/**
+ * @brief Adds a processed sample, estimates every ACF_STEP samples once the
+ *        window is full
+ *
+ * @param acf estimator
+ * @param sample sample at PPG_OUTPUT_HZ
+ * @return 1 when the sample ends an estimate, in acf->heartRate (0 if the
+ *         wave has no period in range) and acf->periodicity, 0 otherwise
+ */
+uint8_t acf_add(acf_t *acf, const ppg_sample_t *sample);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the estimator on a synthetic pulse wave and prints its cycles
+ *        per estimate and its share of the CPU on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void acf_profile(void);
+
+#endif
+
+#endif // ACF_H
@@ -0,0 +1,106 @@
+#ifndef ALARM_H
+#define ALARM_H
+
+/**
+ * @file alarm.h
+ * @brief Threshold alarms evaluated on every sample
+ *
+ * Each channel watches one reading against its rule: the alarm is raised once
+ * the samples are beyond the threshold for the minimum duration, and cleared
+ * once they are back within it by the hysteresis for as long. Samples with a
+ * confidence under the one of the rule are skipped: they neither raise nor
+ * clear, and do not break a run either.
+ *
+ * Raising and clearing queue an event, popped by the application to notify
+ * the outputs; when the queue is full the event is counted as dropped, the
+ * state of the channel is still updated. Constant time per sample.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Readings watched
+ */
+#define ALARM_CHANNELS (2U)
+
+/**
+ * @brief Events the queue holds, must be a power of two
+ */
+#define ALARM_QUEUE_SIZE (8U)
+
+typedef enum alarm_channel_id {
+    ALARM_LOW_OXY = 0x00U, // SpO2 under the threshold
+    ALARM_HIGH_HR          // heart rate above the threshold
+} alarm_channel_id_t;
+
+typedef struct alarm_rule {
+    uint16_t threshold;     // raised beyond it, in the unit of the samples
+    uint16_t hysteresis;    // cleared once back within the threshold by this much
+    uint8_t above;          // 1 raised above the threshold, 0 under it
+    uint8_t minConfidence;  // samples with less are skipped, %
+    uint16_t minDurationMs; // time beyond the threshold, or back within it, to change state
+} alarm_rule_t;
+
+typedef struct alarm_event {
+    uint8_t channel;    // alarm_channel_id_t
+    uint8_t raised;     // 1 raised, 0 cleared
+    uint16_t value;     // sample that changed the state
+    uint32_t timestamp; // of that sample, us
+} alarm_event_t;
+
+typedef struct alarm_channel {
+    alarm_rule_t rule;
+    uint32_t minSamples; // minDurationMs at the sample rate, at least 1
+    uint32_t run;        // consecutive samples towards the other state
+    uint8_t active;      // raised
+    uint32_t raised;     // times raised since alarm_init
+} alarm_channel_t;
+
+typedef struct alarm {
+    alarm_channel_t channels[ALARM_CHANNELS];
+    alarm_event_t queue[ALARM_QUEUE_SIZE];
+    uint32_t head;    // next event to pop
+    uint32_t count;   // events queued
+    uint32_t dropped; // events lost on a full queue
+} alarm_t;
+
+/**
+ * @brief Clears the channels and the queue
+ *
+ * @param alarm engine to initialise
+ * @param rules rule of each channel, indexed by alarm_channel_id_t
+ * @param sampleRateHz rate of the samples, for the minimum durations
+ */
+void alarm_init(alarm_t *alarm, const alarm_rule_t rules[ALARM_CHANNELS], uint16_t sampleRateHz);
+
+/**
+ * @brief Evaluates a sample of a channel
+ *
+ * @param alarm engine
+ * @param channel alarm_channel_id_t
+ * @param value sample
+ * @param confidence of the sample, %, 0 to skip it
+ * @param timestamp of the sample, us, carried by the event
+ * @return 1 if the alarm was raised or cleared, 0 otherwise
+ */
+uint8_t alarm_add(alarm_t *alarm, uint8_t channel, uint16_t value, uint8_t confidence, uint32_t timestamp);
+
+/**
+ * @brief Takes the oldest event of the queue
+ *
+ * @param alarm engine
+ * @param event filled with the event
+ * @return 1 if an event was taken, 0 if the queue is empty
+ */
+uint8_t alarm_pop(alarm_t *alarm, alarm_event_t *event);
+
+/**
+ * @brief State of a channel
+ *
+ * @param alarm engine
+ * @param channel alarm_channel_id_t
+ * @return 1 if raised, 0 otherwise
+ */
+uint8_t alarm_active(const alarm_t *alarm, uint8_t channel);
+
+#endif // ALARM_H
@@ -0,0 +1,127 @@
+#ifndef BEAT_H
+#define BEAT_H
+
+/**
+ * @file beat.h
+ * @brief Systolic peaks of the PPG and the RR intervals between them
+ *
+ * The detector runs on the IR pulse wave of ppg.h, band-passed and decimated
+ * to PPG_OUTPUT_HZ whatever the sample rate of the sensor: its cost per raw
+ * sample is that of the chain. A peak is a local maximum of the wave:
+ *
+ * - above an adaptive threshold, half the average height of the last peaks;
+ *   the average decays while no beat is found, down to BEAT_MIN_AMPLITUDE
+ * - BEAT_REFRACTORY_MS or more after the previous peak
+ *
+ * and is timed between the samples by the vertex of the parabola through the
+ * maximum and its two neighbours. Its time is counted in samples since
+ * beat_init, so the read jitter of the hub FIFO does not reach the intervals.
+ *
+ * An interval off the running mean by more than BEAT_RR_TOLERANCE percent is
+ * taken for a missed or extra beat and dropped, unless BEAT_OUTLIER_RUN of
+ * them follow each other: the rate changed, the mean starts over. The others
+ * are queued in a ring of BEAT_RR_SIZE intervals, the oldest is overwritten
+ * when it is full.
+ */
+
+#include "ppg.h"
+
+/**
+ * @brief Time between two processed samples, us
+ */
+#define BEAT_SAMPLE_US (1000000UL / PPG_OUTPUT_HZ)
+
+/**
+ * @brief No peak within this time after a peak, ms: up to 200 bpm
+ */
+#define BEAT_REFRACTORY_MS (300U)
+
+/**
+ * @brief Longest interval, ms: down to 30 bpm; a longer gap starts over
+ */
+#define BEAT_MAX_RR_MS (2000U)
+
+/**
+ * @brief Lowest threshold, 2^-PPG_GAIN_BITS counts
+ */
+#define BEAT_MIN_AMPLITUDE (64)
+
+/**
+ * @brief Largest deviation of an interval from the running mean, percent
+ */
+#define BEAT_RR_TOLERANCE (25U)
+
+/**
+ * @brief Outlying intervals in a row taken for a change of rate
+ */
+#define BEAT_OUTLIER_RUN (3U)
+
+/**
+ * @brief Intervals in the ring, a power of two
+ */
+#define BEAT_RR_SIZE (16U)
+
+typedef struct beat_rr {
+    uint32_t timestamp; // peak ending the interval, us since beat_init
+    uint16_t interval;  // ms
+    uint16_t amplitude; // peak ending the interval over the trough before it, 2^-PPG_GAIN_BITS counts
+    uint8_t successive; // the interval before it was queued too
+} beat_rr_t;
+
+typedef struct beat {
+    uint32_t samples;     // processed samples since beat_init
+    int16_t previous[2];  // the two samples before the current one, oldest first
+    int32_t amplitude;    // average height of the last peaks
+    int16_t trough;       // lowest sample since the last peak
+    uint32_t lastPeakUs;  // time of the last peak
+    uint32_t sincePeak;   // samples since the last peak, saturated
+    uint8_t havePeak;     // lastPeakUs is set
+    uint8_t queued;       // the interval ending at the last peak was queued
+    uint16_t meanRr;      // running mean of the intervals, ms, 0 until the first
+    uint8_t outliers;     // outlying intervals in a row
+    uint32_t peaks;       // peaks detected
+    uint32_t rejected;    // intervals dropped as outliers
+    uint32_t lost;        // intervals overwritten in the ring
+    beat_rr_t ring[BEAT_RR_SIZE];
+    uint8_t head;         // next interval to pop
+    uint8_t count;        // intervals in the ring
+} beat_t;
+
+/**
+ * @brief Clears the detector, its time starts over
+ *
+ * @param beat detector to initialise
+ */
+void beat_init(beat_t *beat);
+
+/**
+ * @brief Adds a processed sample
+ *
+ * @param beat detector
+ * @param sample sample at PPG_OUTPUT_HZ, the next after the previous call
+ * @return 1 when an interval was queued, 0 otherwise
+ */
+uint8_t beat_add(beat_t *beat, const ppg_sample_t *sample);
+
+/**
+ * @brief Takes the oldest interval out of the ring
+ *
+ * @param beat detector
+ * @param rr the interval
+ * @return 1 if there was one, 0 if the ring is empty
+ */
+uint8_t beat_pop(beat_t *beat, beat_rr_t *rr);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the detector on a minute of synthetic pulse wave and prints its
+ *        cycles per processed sample and per beat on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void beat_profile(void);
+
+#endif
+
+#endif // BEAT_H
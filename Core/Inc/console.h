@@ -0,0 +1,59 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/**
+ * @file console.h
+ * @brief Single-character debug commands received on USART2
+ *
+ * The character is received in interrupt mode and the command is executed by
+ * console_poll in thread context, so commands may print with blocking calls.
+ *
+ * USART2 does not receive in STOP mode: a character arriving then only wakes
+ * the core, through EXTI line 3, and is lost. The application keeps the core
+ * out of STOP for CONSOLE_AWAKE_TIME afterwards, so the command typed again
+ * is received.
+ *
+ * Commands:
+ * - 'p': dump the profiling statistics
+ * - 'r': clear the profiling statistics
+ * - 'g': profile the PPG processing chain at each sensor sample rate,
+ *        the local SpO2, the beat detector, the autocorrelation heart rate,
+ *        the respiration rate, the motion detector and the live tracker
+ * - 't': dump the event trace
+ * - 'i': dump the I2C transcript
+ * - 'e': print the time spent in each power state
+ * - 'c': switch to the other clock profile and print it
+ */
+
+#include "main.h"
+
+/**
+ * @brief EXTI line of the console RX pin, PA3
+ */
+#define CONSOLE_WAKE_Pin GPIO_PIN_3
+
+/**
+ * @brief Time the core stays out of STOP after activity on the console, ms
+ */
+#define CONSOLE_AWAKE_TIME (30000U)
+
+/**
+ * @brief Starts the reception of the first command
+ */
+void console_start(void);
+
+/**
+ * @brief Executes the pending command, if any
+ *
+ * Must be called from thread context.
+ */
+void console_poll(void);
+
+/**
+ * @brief Forward of HAL_UART_RxCpltCallback
+ *
+ * @param huart UART the reception completed on
+ */
+void console_rx_complete(UART_HandleTypeDef *huart);
+
+#endif // CONSOLE_H
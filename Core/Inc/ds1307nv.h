@@ -0,0 +1,90 @@
+#ifndef DS1307NV_H
+#define DS1307NV_H
+
+/**
+ * @file ds1307nv.h
+ * @brief Typed key/value store in the DS1307 battery-backed RAM
+ *
+ * Every key has a fixed slot in the RAM holding its value followed by a CRC-8.
+ * The whole RAM is read in a single burst by ds1307nv_load and kept in a shadow
+ * copy; each ds1307nv_set writes back its own slot in a single burst.
+ */
+
+#include <stdint.h>
+
+#include "ds1307rtc.h"
+
+/**
+ * @brief Bump when the layout or the value types change: stale slots then fail
+ *        the CRC check and read as missing
+ */
+#define NV_LAYOUT_VERSION 0x03U
+
+/**
+ * @brief Value stored under NV_CLOCK_SET once the clock has been set
+ */
+#define NV_CLOCK_SET_MARKER 0xA5U
+
+typedef enum nv_key {
+    NV_CLOCK_SET = 0x00U, // uint8_t, NV_CLOCK_SET_MARKER when the clock is valid
+    NV_BOOT_COUNT,        // uint32_t, number of boots
+    NV_SENSOR_CONFIG,     // nv_sensor_config_t, last-known-good sensor hub configuration
+    NV_SESSION,           // nv_session_t, summary of the last session
+    NV_KEY_COUNT
+} nv_key_t;
+
+typedef struct nv_sensor_config {
+    uint8_t mode;          // algorithm mode, MODE_ONE or MODE_TWO
+    uint8_t outputMode;    // OUTPUT_MODE_WRITE_BYTE value
+    uint8_t fifoThreshold; // samples before the MFIO interrupt
+    uint8_t sampleRate;    // algorithm samples read back after configuration
+} nv_sensor_config_t;
+
+typedef struct nv_session {
+    uint8_t year;
+    uint8_t month;
+    uint8_t date;
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t seconds;
+    uint16_t heartRate; // 0.1 bpm
+    uint16_t samples;
+    uint16_t resultMs; // from the start of the measure to the report
+    uint8_t oxygen;
+    uint8_t confidence;
+    uint8_t outcome; // MachineState the session ended in
+    uint8_t reserved;
+    uint16_t respiration; // 0.1 breaths/min, 0 if not measured
+    uint16_t perfusion;   // 0.01 %, mean over the beats of the measure
+} nv_session_t;
+
+/**
+ * @brief Reads the whole battery-backed RAM into the shadow copy
+ *
+ * @return DS1307_OK on success, DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307nv_load(void);
+
+/**
+ * @brief Reads a value from the shadow copy
+ *
+ * @param key key to read
+ * @param value receiver of the value
+ * @param size size of the receiver, must match the type of the key
+ * @return DS1307_OK if the value is valid, DS1307_ERR if the key is missing,
+ *         corrupted or the size does not match
+ */
+int8_t ds1307nv_get(nv_key_t key, void *value, uint8_t size);
+
+/**
+ * @brief Stores a value
+ *
+ * @param key key to write
+ * @param value value to store
+ * @param size size of the value, must match the type of the key
+ * @return DS1307_OK on success, DS1307_ERR if the size does not match,
+ *         DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307nv_set(nv_key_t key, const void *value, uint8_t size);
+
+#endif // DS1307NV_H
@@ -9,6 +9,15 @@
 #define DS1307_ERR		(-1)
 #define DS1307_IC2_ERR	(-2)
 
+/* Milliseconds allowed for a single bus transaction with the RTC */
+#define DS1307_TIMEOUT	(10U)
+
+/* Size of the battery-backed RAM following the control register */
+#define DS1307_RAM_SIZE	(56U)
+
+/* Interval between two reads of the time registers when SQW is not used */
+#define DS1307_SYNC_PERIOD	(1000U)
+
 
 struct date_time_s
 {
@@ -29,7 +38,71 @@ int8_t ds1307rtc_get_date_time(date_time_t* datetime);
 
 int8_t ds1307rtc_set_date_time(const date_time_t* datetime);
 
+/**
+ * @brief Reads a block of the battery-backed RAM in a single burst
+ *
+ * @param offset first byte to read, 0 is the first byte after the control register
+ * @param data receiver buffer
+ * @param size number of bytes to read
+ * @return DS1307_OK on success, DS1307_ERR if the block exceeds the RAM,
+ *         DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307rtc_read_ram(uint8_t offset, uint8_t* data, uint8_t size);
+
+/**
+ * @brief Writes a block of the battery-backed RAM in a single burst
+ *
+ * @param offset first byte to write, 0 is the first byte after the control register
+ * @param data bytes to write
+ * @param size number of bytes to write
+ * @return DS1307_OK on success, DS1307_ERR if the block exceeds the RAM,
+ *         DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307rtc_write_ram(uint8_t offset, const uint8_t* data, uint8_t size);
+
+/**
+ * @brief Enables or disables the 1 Hz square wave output
+ *
+ * When enabled, the falling edge of SQW marks the seconds boundary and the
+ * cached time base is latched on it (see ds1307rtc_sqw_edge).
+ *
+ * @param enable 0 to disable, any other value to enable
+ * @return DS1307_OK on success, DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307rtc_enable_sqw(uint8_t enable);
+
+/**
+ * @brief Reads the time registers once and refreshes the cached time base
+ *
+ * @return DS1307_OK on success, DS1307_IC2_ERR on bus error
+ */
+int8_t ds1307rtc_sync(void);
+
+/**
+ * @brief Keeps the cached time base up to date
+ *
+ * Must be called from thread context. Reads the chip at most once per second,
+ * either after a SQW edge or every DS1307_SYNC_PERIOD milliseconds.
+ */
+void ds1307rtc_poll(void);
+
+/**
+ * @brief Notifies a falling edge on the SQW line
+ *
+ * Meant to be called from the EXTI callback: it only records the tick.
+ */
+void ds1307rtc_sqw_edge(void);
 
+/**
+ * @brief Current date and time from the cached time base
+ *
+ * No bus transaction is performed: the sub-second part is interpolated from
+ * HAL_GetTick. Safe to call from interrupt context.
+ *
+ * @param datetime receiver of the current date and time
+ * @param millis receiver of the milliseconds within the second, may be NULL
+ */
+void ds1307rtc_now(date_time_t* datetime, uint16_t* millis);
 
 
 #endif /* INC_DS1307RTC_H_ */
@@ -0,0 +1,76 @@
+#ifndef HAMPEL_H
+#define HAMPEL_H
+
+/**
+ * @file hampel.h
+ * @brief Streaming Hampel identifier: outlier rejection on a sliding median
+ *
+ * A sample is an outlier when it deviates from the median of the previous
+ * HAMPEL_WINDOW samples by more than HAMPEL_THRESHOLD times their median
+ * absolute deviation (MAD), scaled to a standard deviation, and by more than
+ * a floor that keeps a steady series, whose MAD is 0, from rejecting every
+ * change.
+ *
+ * The window is kept sorted as it slides: each sample replaces the oldest one
+ * with a single shift between their positions, and the MAD is found by
+ * walking outwards from the median. Both cost at most HAMPEL_WINDOW steps,
+ * whatever the number of samples.
+ *
+ * Every sample enters the window, outliers included: a lasting change of
+ * level is accepted once it fills half the window. Nothing is rejected until
+ * the window is full.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Samples the median is taken on, odd
+ */
+#define HAMPEL_WINDOW (9U)
+
+/**
+ * @brief Rejection threshold in MADs, x1000: 3 standard deviations of a
+ *        normal distribution, 1.4826 MAD each
+ */
+#define HAMPEL_THRESHOLD (4448U)
+
+typedef struct hampel {
+    uint16_t window[HAMPEL_WINDOW]; // samples in arrival order, circular
+    uint16_t sorted[HAMPEL_WINDOW]; // the same samples in ascending order
+    uint8_t count;                  // samples in the window
+    uint8_t oldest;                 // index of the oldest sample in window
+    uint16_t floor;                 // smallest deviation rejected
+    uint32_t checked;               // samples checked against a full window
+    uint32_t rejected;              // outliers among them
+} hampel_t;
+
+_Static_assert((HAMPEL_WINDOW % 2U) == 1U, "HAMPEL_WINDOW must be odd");
+
+/**
+ * @brief Empties the window and clears the counters
+ *
+ * @param filter filter to initialise
+ * @param floor smallest deviation from the median that is rejected, in the
+ *        unit of the samples
+ */
+void hampel_init(hampel_t *filter, uint16_t floor);
+
+/**
+ * @brief Checks a sample against the window, then adds it to the window
+ *
+ * @param filter filter to update
+ * @param value sample
+ * @return 1 if the sample is an outlier, 0 otherwise
+ */
+uint8_t hampel_add(hampel_t *filter, uint16_t value);
+
+/**
+ * @brief Median of the window
+ *
+ * @param filter filter
+ * @return median, the lower one of the two middle samples while the window
+ *         fills with an even count, 0 if it is empty
+ */
+uint16_t hampel_median(const hampel_t *filter);
+
+#endif // HAMPEL_H
@@ -0,0 +1,80 @@
+#ifndef HRV_H
+#define HRV_H
+
+/**
+ * @file hrv.h
+ * @brief Heart rate variability of a series of RR intervals
+ *
+ * Each interval updates the metrics in constant time and memory:
+ *
+ * - SDNN, standard deviation of the intervals, from the Welford statistics
+ *   of stats.h
+ * - RMSSD, root mean square of the successive differences
+ * - pNN50, share of the successive differences over HRV_NN50_MS
+ *
+ * A difference is taken only between intervals that follow each other, see
+ * beat_rr_t.successive: a dropped interval does not make a false one.
+ */
+
+#include "beat.h"
+#include "stats.h"
+
+/**
+ * @brief Successive difference counted by pNN50, ms
+ */
+#define HRV_NN50_MS (50U)
+
+/**
+ * @brief Intervals under which the metrics are not given: with fewer, one
+ *        difference moves pNN50 by 7% or more and SDNN misses the slow swings
+ */
+#define HRV_MIN_INTERVALS (16U)
+
+typedef struct hrv {
+    stats_t intervals;    // intervals, ms
+    uint64_t diffSquares; // sum of the squared successive differences, ms^2
+    uint32_t diffs;       // successive differences
+    uint32_t nn50;        // successive differences over HRV_NN50_MS
+    uint16_t previous;    // last interval, ms
+} hrv_t;
+
+/**
+ * @brief Clears the metrics
+ *
+ * @param hrv metrics to clear
+ */
+void hrv_reset(hrv_t *hrv);
+
+/**
+ * @brief Records an interval
+ *
+ * @param hrv metrics to update
+ * @param rr interval as popped from the beat detector
+ */
+void hrv_add(hrv_t *hrv, const beat_rr_t *rr);
+
+/**
+ * @brief Standard deviation of the intervals
+ *
+ * @param hrv metrics
+ * @return SDNN in ms, rounded, 0 with less than 2 intervals
+ */
+uint16_t hrv_sdnn(const hrv_t *hrv);
+
+/**
+ * @brief Root mean square of the successive differences
+ *
+ * @param hrv metrics
+ * @return RMSSD in ms, rounded, 0 without a difference
+ */
+uint16_t hrv_rmssd(const hrv_t *hrv);
+
+/**
+ * @brief Share of the successive differences over HRV_NN50_MS
+ *
+ * @param hrv metrics
+ * @return pNN50 in per mille, 0 without a difference
+ */
+uint16_t hrv_pnn50(const hrv_t *hrv);
+
+#endif // HRV_H
@@ -0,0 +1,31 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+/**
+ * @file i2cbus.h
+ * @brief Blocking I2C transfers shared by the device drivers
+ *
+ * Thin wrappers of the HAL blocking transfers with the same parameters and
+ * return values. Every transfer is recorded in the event trace with the
+ * device address, so bus activity can be attributed to each device, and in
+ * the I2C transcript when it is enabled (see i2crec.h).
+ */
+
+#include "main.h"
+
+HAL_StatusTypeDef i2cbus_master_transmit(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data,
+                                         uint16_t size, uint32_t timeout);
+
+HAL_StatusTypeDef i2cbus_master_receive(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data,
+                                        uint16_t size, uint32_t timeout);
+
+HAL_StatusTypeDef i2cbus_mem_write(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                   uint16_t memAddressSize, uint8_t *data, uint16_t size, uint32_t timeout);
+
+HAL_StatusTypeDef i2cbus_mem_read(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                  uint16_t memAddressSize, uint8_t *data, uint16_t size, uint32_t timeout);
+
+HAL_StatusTypeDef i2cbus_is_device_ready(I2C_HandleTypeDef *hi2c, uint16_t address, uint32_t trials,
+                                         uint32_t timeout);
+
+#endif // I2CBUS_H
@@ -0,0 +1,83 @@
+#ifndef I2CREC_H
+#define I2CREC_H
+
+/**
+ * @file i2crec.h
+ * @brief Transcript of the I2C transfers for bit-exact replay on host
+ *
+ * When compiled with I2C_RECORD defined, every i2cbus transfer is stored in a
+ * RAM ring with its timestamp, device address, operation, HAL status and
+ * bytes: the bytes sent for writes, the bytes received for reads. When the
+ * ring is full the oldest transfers are overwritten.
+ *
+ * The ring is dumped on USART2 as text lines, the host runner replays a
+ * captured dump against the drivers (project_work_sim --replay).
+ */
+
+#include <stdint.h>
+
+#include "main.h"
+
+#ifdef I2C_RECORD
+#define I2CREC_ENABLED 1
+#else
+#define I2CREC_ENABLED 0
+#endif
+
+/**
+ * @brief Size of the ring in bytes, must be a power of two
+ *
+ * Each transfer takes 12 bytes plus its data.
+ */
+#ifndef I2CREC_SIZE
+#define I2CREC_SIZE (8192U)
+#endif
+
+typedef enum i2crec_op {
+    I2CREC_TRANSMIT = 0x00U, // i2cbus_master_transmit
+    I2CREC_RECEIVE,          // i2cbus_master_receive
+    I2CREC_MEM_WRITE,        // i2cbus_mem_write
+    I2CREC_MEM_READ,         // i2cbus_mem_read
+    I2CREC_READY             // i2cbus_is_device_ready, no data
+} i2crec_op_t;
+
+#if I2CREC_ENABLED
+
+/**
+ * @brief Records a completed transfer
+ *
+ * Safe to call from interrupt context, interrupts are masked while the
+ * transfer is copied. Transfers recorded while a dump is in progress are
+ * dropped.
+ *
+ * @param op operation
+ * @param address 8-bit device address as passed to the HAL
+ * @param memAddress register address, mem operations only
+ * @param memAddressSize I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT, mem operations only
+ * @param status HAL status of the transfer
+ * @param data bytes sent or received
+ * @param size number of bytes
+ * @param timestamp usclock_now at the start of the transfer
+ */
+void i2crec_record(i2crec_op_t op, uint16_t address, uint16_t memAddress, uint16_t memAddressSize,
+                   HAL_StatusTypeDef status, const uint8_t *data, uint16_t size, uint32_t timestamp);
+
+/**
+ * @brief Prints the content of the ring on USART2, oldest transfer first
+ *
+ * Blocking, call it from thread context only. The format is a header line
+ * "i2crec <transfers> <lost>", one line per transfer
+ * "<timestamp> <op> <address> <memAddress> <memAddressSize> <status> <bytes>"
+ * with the numbers in decimal and the bytes in hexadecimal without
+ * separators ("-" when there are none), and a final "i2crec end" line.
+ */
+void i2crec_dump(void);
+
+#else
+
+#define i2crec_record(op, address, memAddress, memAddressSize, status, data, size, timestamp) ((void)(timestamp))
+#define i2crec_dump() ((void)0)
+
+#endif // I2CREC_ENABLED
+
+#endif // I2CREC_H
@@ -31,7 +31,7 @@ extern "C" {
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "trace.h"
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
@@ -56,11 +56,16 @@ typedef struct MachineData {
 /* USER CODE BEGIN EC */
 #define MAX_MEASURE_TIME 30U // seconds
 #define EXERCISE_TIME 20U    // seconds
-#define TIME_RATIO 100U      // counts per second (timer here has resolution 10ms)
-#define PAUSE_TIME 5U
+#define PAUSE_TIME 5U        // seconds
 #define OPT_MEASURES 100U
 
-#define PRINT(str) (void)HAL_UART_Transmit(&huart2, (const uint8_t *)str, strlen(str), HAL_MAX_DELAY)
+#define PRINT(str)                                                                         \
+    do {                                                                                   \
+        uint16_t printLen = (uint16_t)strlen(str);                                         \
+        trace_record(TRACE_UART_BEGIN, 0U, printLen);                                      \
+        (void)HAL_UART_Transmit(&huart2, (const uint8_t *)(str), printLen, HAL_MAX_DELAY); \
+        trace_record(TRACE_UART_END, 0U, printLen);                                        \
+    } while (0)
 
 /**
  * @brief minimum observable values for oxygenation
@@ -91,12 +96,88 @@ typedef struct MachineData {
  * 0x02EE corresponds to 75 bpm (LSB = 0.1 bpm)
  */
 #define HIGH_HR_THRES 0x02EEU
-#define MIN_UNCERT_THRES 0.1 // 1 = 100%
+/**
+ * @brief Largest uncertainty of an accepted measure
+ *
+ * Half the range of the heart rate and of the oxygenation samples, relative
+ * to their mean. 0x64 corresponds to 10% (LSB = 0.1%)
+ */
+#define MAX_UNCERT_THRES 0x64U
+
+/**
+ * @brief Smallest deviations from the median of the recent samples rejected
+ *        as outliers, see hampel.h
+ *
+ * 0x0032 corresponds to 5 bpm (LSB = 0.1 bpm), 0x02 to 2% oxygenation
+ */
+#define OUTLIER_HR_FLOOR 0x0032U
+#define OUTLIER_OXY_FLOOR 0x02U
+
+/**
+ * @brief Early stop of the measure
+ *
+ * The measure ends before MAX_MEASURE_TIME, and is accepted with less than
+ * OPT_MEASURES good samples, once it has CONVERGE_MIN_MEASURES of them and the
+ * 95% confidence intervals of the mean heart rate and oxygenation are at most
+ * these widths wide.
+ * 0x0014 corresponds to 2 bpm (LSB = 0.1 bpm), 0x01 to 1% oxygenation
+ *
+ * The hub reports are running averages over CONVERGE_WINDOW ms of signal:
+ * the intervals count one independent sample per window, see
+ * stats_std_error_correlated.
+ */
+#define CONVERGE_HR_WIDTH 0x0014U
+#define CONVERGE_OXY_WIDTH 0x01U
+#define CONVERGE_MIN_MEASURES 50U
+#define CONVERGE_WINDOW 2000U // ms
+
+/**
+ * @brief Hub confidence under which the heart rate of a sample is taken from
+ *        the autocorrelation of the pulse wave, see acf.h, when its
+ *        periodicity is at least as high
+ *
+ * 0x32 corresponds to 50% (LSB = 1%)
+ */
+#define FALLBACK_CONFIDENCE 0x32U
+/**
+ * @brief Breathing pace of the exercise, 0.1 breaths/min
+ *
+ * The LED paces PACE_PERCENT of the breathing rate measured on the PPG,
+ * within PACE_MIN and PACE_MAX; PACE_MAX while there is no rate
+ */
+#define PACE_MIN 60U
+#define PACE_MAX 120U
+#define PACE_PERCENT 75U
+/**
+ * @brief Live readout of the measure, see tracker.h
+ *
+ * Drift between two hub reports and noise of a report at 100% confidence, of
+ * the heart rate and of the oxygenation, as variances in Q8 of their LSB
+ * squared: 0.05 bpm and 0.13% of drift, 2 bpm and 2% of noise. The readout
+ * is shown and printed every LIVE_PERIOD ms.
+ */
+#define TRACK_HR_DRIFT 64U
+#define TRACK_HR_NOISE 102400U
+#define TRACK_OXY_DRIFT 4U
+#define TRACK_OXY_NOISE 1024U
+#define LIVE_PERIOD 1000U // ms
+/**
+ * @brief Alarms of the measure and of the exercise, see alarm.h
+ *
+ * Raised on SpO2 under LOW_OXY_THRES and on a heart rate above HIGH_HR_THRES,
+ * cleared 1% and 3 bpm back within them (LSB = 0.1 bpm). Hub reports with a
+ * confidence under ALARM_CONFIDENCE (LSB = 1%) are skipped; a change takes
+ * ALARM_MIN_DURATION ms of reports, two at the 100 Hz of the hub.
+ */
+#define ALARM_OXY_HYST 0x01U
+#define ALARM_HR_HYST 0x001EU
+#define ALARM_CONFIDENCE 0x32U
+#define ALARM_MIN_DURATION 20U // ms
 /* USER CODE END EC */
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
-#define __EXPIRED(t, timeout) ((t) == ((timeout) * TIME_RATIO))
+
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
@@ -114,6 +195,9 @@ void Error_Handler(void);
 #define LED_GPIO_Port GPIOA
 #define ERROR_Pin GPIO_PIN_7
 #define ERROR_GPIO_Port GPIOA
+#define SQW_Pin GPIO_PIN_15
+#define SQW_GPIO_Port GPIOB
+#define SQW_EXTI_IRQn EXTI15_10_IRQn
 
 /* USER CODE BEGIN Private defines */
 
@@ -33,6 +33,7 @@
 #define MAXFAST_ARRAY_SIZE 6 // Number of bytes....
 #define MAXFAST_EXTENDED_DATA 5
 #define MAX30101_LED_ARRAY 12 // 4 values of 24 bit (3 byte) LED values
+#define ACCEL_ARRAY 6         // X, Y and Z of 16 bit (2 byte) accelerometer values
 
 #define SET_FORMAT 0x00
 #define READ_FORMAT 0x01         // Index Byte under Family Byte: READ_OUTPUT_MODE (0x11)
@@ -56,6 +57,8 @@ typedef struct bioData {
     int8_t extStatus;    // --
     uint8_t reserveOne;  // --
     uint8_t resserveTwo; // -- Algorithm Mode 2 ^^
+    int16_t accel[3];    // X, Y, Z, LSB = 1 mg, 0 without the accelerometer
+    uint32_t timestamp;  // usclock_now when the FIFO read completed, us
 
 } bioData;
 
@@ -326,6 +329,7 @@ typedef struct MAX32664_Handle {
     uint32_t _writeCoefArr[3];
     uint8_t _userSelectedMode;
     uint8_t _sampleRate;
+    uint8_t _accelEnabled;
     uint8_t readsBuffer[READ_BUF_SIZE];
 } MAX32664_Handle;
 
@@ -344,6 +348,15 @@ void MAX32664_Init(MAX32664_Handle *handle, I2C_HandleTypeDef *hi2c, GPIO_Line *
 // which mode the IC is in.
 uint8_t MAX32664_Begin(MAX32664_Handle *handle);
 
+// Family Bytes: READ_DEVICE_MODE (0x02), READ_OUTPUT_MODE (0x11), READ_SENSOR_MODE (0x45)
+// The following function takes over a sensor hub that kept running while the
+// host restarted. No reset pulse is generated: the hub must answer in
+// application mode, with the given output format and the MAX30101 enabled.
+// On success the handle is set up as if MAX32664_ConfigBpm(mode) had been
+// called and SB_SUCCESS is returned, otherwise the hub has to be started again
+// with MAX32664_Begin. The accelerometer is used if the hub reports it enabled.
+uint8_t MAX32664_Resume(MAX32664_Handle *handle, uint8_t mode, uint8_t outputType, uint8_t sampleRate);
+
 // Family Byte: READ_DEVICE_MODE (0x02) Index Byte: 0x00, Write Byte: 0x00
 // The following function puts the MAX32664 into bootloader mode. To place the MAX32664 into
 // bootloader mode, the MFIO pin must be pulled LOW while the board is held
@@ -401,6 +414,14 @@ bioData MAX32664_ReadSensor(MAX32664_Handle *handle);
 // above into a single function call.
 bioData MAX32664_ReadSensorBpm(MAX32664_Handle *handle);
 
+// Family Byte: READ_DATA_OUTPUT (0x12), Index Bytes: NUM_SAMPLES (0x00), READ_DATA (0x01)
+// This function empties the FIFO in the SENSOR_AND_ALGORITHM output mode set by
+// MAX32664_ConfigSensorBpm: up to maxSamples samples are decoded into samples,
+// oldest first, each with the LED values and the algorithm report. The FIFO is
+// read in as many transfers as READ_BUF_SIZE requires. It returns the number of
+// samples read, 0 on a communication error.
+uint8_t MAX32664_ReadSensorBpmSamples(MAX32664_Handle *handle, bioData samples[], uint8_t maxSamples);
+
 // This function modifies the pulse width of the MAX30101 LEDs. All of the LEDs
 // are modified to the same width. This will affect the number of samples that
 // can be collected and will also affect the ADC resolution.
@@ -473,6 +494,14 @@ uint8_t MAX32664_ReadMAX30101State(MAX32664_Handle *handle);
 // This function enables the ACCELEROMETER.
 uint8_t MAX32664_AccelControl(MAX32664_Handle *handle, uint8_t);
 
+// Family Bytes: READ_ATTRIBUTES_AFE (0x42), ENABLE_SENSOR (0x44), Index Byte:
+// ACCELEROMETER (0x04)
+// This function enables the accelerometer if the hub has one, which SparkFun's
+// product does not: its X, Y and Z then follow the LED values in the sensor
+// data of every sample. Call it before the MAX30101 is enabled, the samples
+// already in the FIFO are without them. Returns SB_SUCCESS once enabled.
+uint8_t MAX32664_ConfigAccel(MAX32664_Handle *handle);
+
 // Family Byte: OUTPUT_MODE (0x10), Index Byte: SET_FORMAT (0x00),
 // Write Byte : outputType (Parameter values in OUTPUT_MODE_WRITE_BYTE)
 uint8_t MAX32664_SetOutputMode(MAX32664_Handle *handle, uint8_t);
@@ -608,10 +637,9 @@ uint8_t MAX32664_ReadAlgoSamples(MAX32664_Handle *handle);
 
 // Family Byte: READ_ALGORITHM_CONFIG (0x51), Index Byte:
 // READ_MAX_FAST_COEF (0x02), Write Byte: READ_MAX_FAST_COEF_ID (0x0B)
-// This function reads the maximum age for the wrist heart rate monitor
-// (WHRM) algorithm. It returns three uint32_t integers that are
-// multiplied by 100,000.
-// INCOMPLETE
+// This function reads the three SpO2 calibration coefficients of the
+// MaximFast algorithm, SpO2 = a R^2 + b R + c. They are returned as written by
+// MAX32664_SetMaximFastCoef, multiplied by 100,000.
 uint8_t MAX32664_ReadMaximFastCoef(MAX32664_Handle *handle, int32_t coefArr[3]);
 
 // Family Byte: ENABLE_ALGORITHM (0x52), Index Byte:
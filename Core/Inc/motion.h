@@ -0,0 +1,105 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+/**
+ * @file motion.h
+ * @brief Activity of the hand from the accelerometer of the sensor hub
+ *
+ * Each axis is high-passed by subtracting its exponential mean over
+ * 2^MOTION_MEAN_SHIFT samples, which follows gravity as the hand turns
+ * slowly. The activity is the exponential mean, over 2^MOTION_ACTIVITY_SHIFT
+ * samples, of the sum of the absolute high-passed axes.
+ *
+ * The hand is moving from the sample the activity rises above MOTION_ON_MG
+ * until it falls under MOTION_OFF_MG. The samples stay gated MOTION_HOLD_MS
+ * longer, while the artifact rings out of the PPG filters and the beat
+ * detector.
+ *
+ * The time constants are in samples, set for the 100 Hz of the hub; the hold
+ * follows its actual rate. Constant time per sample, integer arithmetic only.
+ */
+
+#include <stdint.h>
+
+#include "prof.h"
+
+/**
+ * @brief Time constant of the gravity estimate, samples, log2
+ */
+#define MOTION_MEAN_SHIFT (6U)
+
+/**
+ * @brief Time constant of the activity, samples, log2
+ */
+#define MOTION_ACTIVITY_SHIFT (3U)
+
+/**
+ * @brief Activity that starts a motion, mg
+ */
+#define MOTION_ON_MG (100U)
+
+/**
+ * @brief Activity under which a motion ends, mg
+ */
+#define MOTION_OFF_MG (50U)
+
+/**
+ * @brief Samples stay gated this long after a motion, ms
+ */
+#define MOTION_HOLD_MS (2000U)
+
+/**
+ * @brief Fractional bits of the means
+ */
+#define MOTION_FRACTION_BITS (8U)
+
+typedef struct motion {
+    int32_t mean[3];      // gravity on each axis, Q8 mg
+    uint32_t activity;    // Q8 mg
+    uint32_t holdSamples; // MOTION_HOLD_MS at the sample rate
+    uint32_t hold;        // samples left to gate after the motion ended
+    uint8_t primed;       // the means are set
+    uint8_t moving;       // activity above the thresholds, with hysteresis
+    uint32_t motions;     // motions started
+    uint16_t peak;        // highest activity since motion_init, mg
+} motion_t;
+
+/**
+ * @brief Clears the detector
+ *
+ * @param motion detector to initialise
+ * @param sampleRateHz rate of the samples, for the hold time
+ */
+void motion_init(motion_t *motion, uint16_t sampleRateHz);
+
+/**
+ * @brief Adds an accelerometer sample
+ *
+ * @param motion detector
+ * @param accel X, Y, Z, mg
+ * @return 1 if the sample is to be gated: moving or within MOTION_HOLD_MS of
+ *         a motion, 0 otherwise
+ */
+uint8_t motion_add(motion_t *motion, const int16_t accel[3]);
+
+/**
+ * @brief Activity of the last sample
+ *
+ * @param motion detector
+ * @return mg
+ */
+uint16_t motion_activity(const motion_t *motion);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the detector on a minute of synthetic accelerometer samples
+ *        and prints its cycles per sample on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void motion_profile(void);
+
+#endif
+
+#endif // MOTION_H
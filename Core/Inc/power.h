@@ -0,0 +1,105 @@
+#ifndef POWER_H
+#define POWER_H
+
+/**
+ * @file power.h
+ * @brief Tickless idle: SLEEP or STOP mode until the next deadline
+ *
+ * The scheduler calls power_idle when it has nothing to execute. SysTick is
+ * suspended for the whole idle period, the HAL tick is advanced on wake-up
+ * by the time spent asleep.
+ *
+ * - SLEEP (WFI): the clocks keep running, the core wakes at the alarm of the
+ *   microsecond clock (usclock.h) or at any interrupt.
+ * - STOP: every clock but LSI is stopped, TIM5 included. The RTC wake-up
+ *   timer wakes the core shortly before the deadline, an EXTI line (user
+ *   button, DS1307 SQW, console RX) earlier. The time spent in STOP is read
+ *   from the RTC calendar and added to the microsecond clock and to the tick.
+ *
+ * STOP is used when it is allowed by the application, the deadline is at
+ * least POWER_STOP_MIN_US ahead, nobody asked to stay awake and the LSI has
+ * been calibrated: LSI is only specified within 17-47 kHz, its frequency is
+ * measured against TIM5 over every second the core spends out of STOP.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Shortest idle period spent in STOP, shorter ones are spent in SLEEP
+ */
+#define POWER_STOP_MIN_US (5000U)
+
+/**
+ * @brief Time from the RTC wake-up to the execution of the first instruction,
+ *        the wake-up timer is set this much before the deadline
+ */
+#define POWER_STOP_WAKEUP_US (300U)
+
+/**
+ * @brief Length of the window the LSI frequency is measured on
+ */
+#define POWER_CALIBRATION_US (1000000U)
+
+typedef enum power_state {
+    POWER_RUN = 0x00U,
+    POWER_SLEEP,
+    POWER_STOP,
+    POWER_STATES
+} power_state_t;
+
+typedef struct power_stats {
+    uint64_t time[POWER_STATES]; // us spent in each state since power_init
+    uint32_t stops;              // STOP periods
+    uint32_t lsiHz;              // measured LSI frequency, 0 until calibrated
+} power_stats_t;
+
+/**
+ * @brief Starts the accounting and the calibration of LSI
+ *
+ * Call after usclock_start and MX_RTC_Init.
+ */
+void power_init(void);
+
+/**
+ * @brief Allows or forbids STOP mode
+ *
+ * Peripherals running on their own (PWM, transfers in progress) stop with
+ * the clocks: forbid STOP while they are needed.
+ *
+ * @param allow non-zero to allow STOP
+ */
+void power_allow_stop(uint8_t allow);
+
+/**
+ * @brief Keeps the core out of STOP for a while, SLEEP is still used
+ *
+ * Safe to call from interrupt context.
+ *
+ * @param ms time from now, less than 2^31 us
+ */
+void power_stay_awake(uint32_t ms);
+
+/**
+ * @brief Sleeps until the next interrupt, in the deepest mode allowed
+ *
+ * Called with interrupts masked: the core still wakes up on a pending
+ * interrupt, which is executed once the caller unmasks them, after the clocks
+ * have been compensated.
+ *
+ * @param idleUs time to the next deadline, us, UINT32_MAX if there is none
+ */
+void power_idle(uint32_t idleUs);
+
+/**
+ * @brief Time spent in each power state up to now
+ *
+ * @param stats filled with the statistics
+ */
+void power_get_stats(power_stats_t *stats);
+
+/**
+ * @brief Prints the fraction of time spent in each power state on the console
+ */
+void power_report(void);
+
+#endif // POWER_H
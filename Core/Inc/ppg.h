@@ -0,0 +1,123 @@
+#ifndef PPG_H
+#define PPG_H
+
+/**
+ * @file ppg.h
+ * @brief Fixed-point processing of the raw PPG samples of the MAX30101
+ *
+ * The IR and red LED counts read from the hub in the SENSOR_AND_ALGORITHM
+ * output mode, at any rate of MAX32664_SetSampleRate, are turned into a
+ * band-passed pulse wave at PPG_OUTPUT_HZ and the DC level it rides on:
+ *
+ * 1. decimation to PPG_RATE_HZ by a boxcar average: one addition per input
+ *    sample, the only stage whose cost follows the sample rate; its nulls at
+ *    the multiples of 50 Hz reject the mains flicker of ambient light
+ * 2. DC removal: the DC is tracked by an exponential average with a time
+ *    constant of 2^PPG_DC_SHIFT samples, 1.28 s; the AC is the difference,
+ *    scaled by 2^PPG_GAIN_BITS. A difference out of the 15-bit range is a
+ *    change of contact: the DC is set to the new level instead
+ * 3. band-pass, a cascade of two Butterworth biquads in direct form I: a
+ *    low-pass at 5 Hz on 16-bit samples with Q14 coefficients, then a
+ *    high-pass at 0.5 Hz on 32-bit samples with Q30 coefficients
+ * 4. decimation by 2 to PPG_OUTPUT_HZ, aliases are attenuated by 19 dB
+ *    or more by the low-pass
+ *
+ * The biquads run on blocks of PPG_BLOCK samples. The low-pass packs its
+ * samples in pairs, two multiply-accumulates per SMLAD; they are saturated
+ * to 15 bits, so its 32-bit accumulator cannot overflow. The high-pass, whose
+ * poles would amplify the rounding of 16-bit samples, accumulates on 64 bits.
+ */
+
+#include "main.h"
+#include "prof.h"
+
+/**
+ * @brief Rate of the biquad cascade, Hz
+ */
+#define PPG_RATE_HZ (50U)
+
+/**
+ * @brief Rate of the processed samples, Hz
+ */
+#define PPG_OUTPUT_HZ (25U)
+
+/**
+ * @brief The AC is in units of 2^-PPG_GAIN_BITS ADC counts
+ */
+#define PPG_GAIN_BITS (2U)
+
+/**
+ * @brief Time constant of the DC tracker, in samples at PPG_RATE_HZ, log2
+ */
+#define PPG_DC_SHIFT (6U)
+
+/**
+ * @brief Samples at PPG_RATE_HZ filtered at a time
+ */
+#define PPG_BLOCK (16U)
+
+typedef struct ppg_raw {
+    uint32_t ir;  // IR LED, ADC counts
+    uint32_t red; // red LED, ADC counts
+} ppg_raw_t;
+
+typedef struct ppg_sample {
+    int16_t ir;     // band-passed IR, 2^-PPG_GAIN_BITS counts
+    int16_t red;    // band-passed red, 2^-PPG_GAIN_BITS counts
+    uint32_t irDc;  // DC of the IR, counts
+    uint32_t redDc; // DC of the red, counts
+} ppg_sample_t;
+
+typedef struct ppg_channel {
+    uint32_t sum;        // raw samples of the boxcar being summed
+    uint32_t dc;         // DC, 2^-(PPG_GAIN_BITS + PPG_DC_SHIFT) counts
+    uint32_t lowPass[2]; // x[n-1] | x[n-2] << 16, y[n-1] | y[n-2] << 16
+    int32_t highPass[4]; // x[n-1], x[n-2], y[n-1], y[n-2], 2^-16 samples
+} ppg_channel_t;
+
+typedef struct ppg {
+    uint16_t boxcar; // input samples per sample at PPG_RATE_HZ
+    uint16_t summed; // input samples in the boxcar being summed
+    uint8_t primed;  // DC initialised from the first sample
+    uint8_t skip;    // the next filtered sample is dropped by the decimation
+    ppg_channel_t ir;
+    ppg_channel_t red;
+} ppg_t;
+
+/**
+ * @brief Sets up the chain for a sample rate and clears its state
+ *
+ * @param ppg chain to initialise
+ * @param sampleRate input sample rate, one of the rates of
+ *        MAX32664_SetSampleRate, Hz
+ * @return HAL_ERROR if the sample rate is not supported
+ */
+HAL_StatusTypeDef ppg_init(ppg_t *ppg, uint16_t sampleRate);
+
+/**
+ * @brief Processes a block of raw samples
+ *
+ * The input may be split in blocks of any length, the result is the same.
+ *
+ * @param ppg chain
+ * @param in raw samples at the rate given to ppg_init
+ * @param count number of raw samples
+ * @param out processed samples at PPG_OUTPUT_HZ, room for
+ *        count * PPG_OUTPUT_HZ / sample rate + 1 of them
+ * @return number of processed samples written
+ */
+uint16_t ppg_process(ppg_t *ppg, const ppg_raw_t *in, uint16_t count, ppg_sample_t *out);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the chain on a synthetic pulse wave at each supported rate and
+ *        prints the cycles per input sample on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void ppg_profile(void);
+
+#endif
+
+#endif // PPG_H
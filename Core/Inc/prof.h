@@ -0,0 +1,111 @@
+#ifndef PROF_H
+#define PROF_H
+
+/**
+ * @file prof.h
+ * @brief Cycle-accurate profiling of code regions on the DWT cycle counter
+ *
+ * A region is delimited by PROF_BEGIN and PROF_END in the same scope. Each
+ * execution is accumulated in the statistics of the region: count, min, max,
+ * total and a log2 histogram where bucket k counts durations in
+ * [2^k, 2^(k+1)) cycles.
+ *
+ * Profiling is compiled in DEBUG builds only, in release builds the macros
+ * expand to nothing and the region costs no cycles.
+ */
+
+#include <stdint.h>
+
+#ifdef DEBUG
+#define PROF_ENABLED 1
+#else
+#define PROF_ENABLED 0
+#endif
+
+/**
+ * @brief Number of buckets of the histograms, the last one collects every
+ *        duration from 2^(PROF_BUCKETS - 1) cycles
+ */
+#define PROF_BUCKETS (24U)
+
+typedef enum prof_region {
+    PROF_READ_BPM = 0x00U, // MAX32664_ReadBpm
+    PROF_OLED_UPDATE,      // ssd1306_UpdateScreen
+    PROF_OLED_CHAR,        // ssd1306_WriteChar
+    PROF_REPORT,           // end of measure report
+    PROF_DISPATCH,         // execution of a scheduler event
+    PROF_TIMERS,           // timing wheel update, expired timers included
+    PROF_STATS,            // statistics update of a good sample
+    PROF_REGION_COUNT
+} prof_region_t;
+
+#if PROF_ENABLED
+
+#include "main.h"
+
+#define PROF_BEGIN(region) const uint32_t prof_start_##region = DWT->CYCCNT
+#define PROF_END(region) prof_record((region), DWT->CYCCNT - prof_start_##region)
+
+/**
+ * @brief Enables the DWT cycle counter and clears the statistics
+ */
+void prof_init(void);
+
+/**
+ * @brief Accumulates one execution of a region
+ *
+ * Safe to call from interrupt context.
+ *
+ * @param region profiled region
+ * @param cycles duration of the execution
+ */
+void prof_record(prof_region_t region, uint32_t cycles);
+
+/**
+ * @brief Clears the statistics of every region
+ */
+void prof_reset(void);
+
+/**
+ * @brief Prints the statistics of every region on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void prof_dump(void);
+
+/**
+ * @brief Peak of the pulse wave given by prof_pulse
+ */
+#define PROF_PULSE_AC (4000)
+
+/**
+ * @brief Triangle wave, the synthetic input of the *_profile functions
+ *
+ * @param i sample
+ * @param period samples per cycle
+ * @param amplitude peak: the wave rises from -amplitude at the start of a
+ *        cycle to amplitude at its middle, and falls back
+ * @return sample i of the wave
+ */
+int32_t prof_triangle(uint32_t i, uint32_t period, int32_t amplitude);
+
+/**
+ * @brief Processed pulse wave at 72 bpm, PROF_PULSE_AC peak
+ *
+ * @param i sample at PPG_OUTPUT_HZ
+ * @return AC of the IR channel of sample i
+ */
+int16_t prof_pulse(uint32_t i);
+
+#else
+
+#define PROF_BEGIN(region) ((void)0)
+#define PROF_END(region) ((void)0)
+
+#define prof_init() ((void)0)
+#define prof_reset() ((void)0)
+#define prof_dump() ((void)0)
+
+#endif // PROF_ENABLED
+
+#endif // PROF_H
@@ -0,0 +1,129 @@
+#ifndef RESP_H
+#define RESP_H
+
+/**
+ * @file resp.h
+ * @brief Respiration rate and perfusion index from the pulse wave
+ *
+ * Breathing modulates the PPG in two ways, each followed by a channel:
+ *
+ * - baseline wander: the IR DC of ppg.h, averaged over each beat so that
+ *   the cardiac ripple of the DC tracker cancels out
+ * - amplitude modulation: the height of each beat over the trough before it
+ *
+ * Both are decimated to one value per beat of beat.h, taken at the time of
+ * its peak. A channel removes its slow trend with an exponential mean of
+ * 2^RESP_TREND_SHIFT beats and times the rising crossings of that mean, with
+ * a hysteresis of half the mean absolute deviation, interpolated between the
+ * beats. Breath periods between RESP_MIN_PERIOD_MS and RESP_MAX_PERIOD_MS are
+ * averaged; the rate is the mean of the channels with RESP_MIN_BREATHS or
+ * more of them. The breaths must be at least three beats long to be seen.
+ *
+ * The perfusion index of a beat is its height over the DC, AC/DC in percent.
+ *
+ * Constant time per sample and per beat, no buffer, integer arithmetic only.
+ */
+
+#include "beat.h"
+
+/**
+ * @brief Time constant of the trend of a channel, beats, log2
+ */
+#define RESP_TREND_SHIFT (3U)
+
+/**
+ * @brief Shortest breath, ms: up to 40 breaths/min
+ */
+#define RESP_MIN_PERIOD_MS (1500U)
+
+/**
+ * @brief Longest breath, ms: down to 6 breaths/min; a longer one starts over
+ */
+#define RESP_MAX_PERIOD_MS (10000U)
+
+/**
+ * @brief Breaths a channel must have timed before its rate is used
+ */
+#define RESP_MIN_BREATHS (2U)
+
+/**
+ * @brief Fractional bits of the channel values
+ */
+#define RESP_FRACTION_BITS (8U)
+
+typedef struct resp_channel {
+    int32_t trend;        // slow mean of the values, Q8
+    int32_t deviation;    // mean absolute deviation from the trend, Q8
+    int32_t previous;     // last value minus the trend, Q8
+    uint32_t previousUs;  // time of the last value
+    uint32_t crossingUs;  // time of the last rising crossing
+    uint16_t periodMs;    // running mean of the breaths, 0 until the first
+    uint8_t primed;       // the trend is set
+    uint8_t armed;        // fell under the hysteresis since the last crossing
+    uint8_t haveCrossing; // crossingUs is set
+    uint32_t breaths;     // breaths timed
+} resp_channel_t;
+
+typedef struct resp {
+    resp_channel_t wander;    // IR DC averaged over each beat, counts
+    resp_channel_t amplitude; // beat heights, 2^-PPG_GAIN_BITS counts
+    uint32_t dcSum;           // IR DC summed since the last beat, counts
+    uint16_t dcSamples;       // samples in dcSum
+    uint32_t dc;              // last IR DC, counts
+    uint16_t perfusion;       // of the last beat, 0.01 %
+} resp_t;
+
+/**
+ * @brief Clears both channels
+ *
+ * @param resp estimator to initialise
+ */
+void resp_init(resp_t *resp);
+
+/**
+ * @brief Adds a processed sample to the baseline of the beat in progress
+ *
+ * @param resp estimator
+ * @param sample sample at PPG_OUTPUT_HZ
+ */
+void resp_add(resp_t *resp, const ppg_sample_t *sample);
+
+/**
+ * @brief Ends a beat: adds its baseline and its height to the channels
+ *
+ * @param resp estimator
+ * @param rr interval ending at the beat, from beat_pop, on the time base of
+ *        the samples given to resp_add
+ * @return perfusion index of the beat, 0.01 %, 0 without a DC
+ */
+uint16_t resp_add_beat(resp_t *resp, const beat_rr_t *rr);
+
+/**
+ * @brief Breathing rate seen by a channel
+ *
+ * @param channel resp->wander or resp->amplitude
+ * @return 0.1 breaths/min, 0 until RESP_MIN_BREATHS breaths were timed
+ */
+uint16_t resp_channel_rate(const resp_channel_t *channel);
+
+/**
+ * @brief Breathing rate, mean of the channels that have one
+ *
+ * @param resp estimator
+ * @return 0.1 breaths/min, 0 if no channel has one
+ */
+uint16_t resp_rate(const resp_t *resp);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the estimator on a minute of synthetic pulse wave and prints
+ *        its cycles per processed sample and per beat on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void resp_profile(void);
+
+#endif
+
+#endif // RESP_H
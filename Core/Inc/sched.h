@@ -0,0 +1,100 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+/**
+ * @file sched.h
+ * @brief Run-to-completion event scheduler
+ *
+ * Interrupt handlers post events to a static queue, software timers raise
+ * theirs when they expire; sched_run executes them one at a time on the
+ * thread, each to completion, through the dispatch function of the
+ * application. Handlers never wait for each other: a handler that needs to
+ * wait arms a timer and returns.
+ *
+ * Timers count milliseconds of the microsecond clock (usclock.h) and sit in
+ * a hierarchical timing wheel of SCHED_WHEEL_LEVELS levels of 64 slots:
+ * starting, stopping and expiring a timer take constant time whatever the
+ * number of timers, a timer far ahead is moved to a finer level at most once
+ * per level. When there is nothing to do the clock alarm is set to the next
+ * deadline of the wheel and the core sleeps (power.h) until an interrupt.
+ */
+
+#include <stdint.h>
+
+#include "main.h"
+
+/**
+ * @brief Number of events the queue holds, must be a power of two
+ */
+#define SCHED_QUEUE_SIZE (16U)
+
+/**
+ * @brief Number of software timers
+ */
+#define SCHED_TIMERS (8U)
+
+/**
+ * @brief Levels of the timing wheel, deadlines up to 64^levels ms ahead are
+ *        placed directly (about 4.6 hours), farther ones are placed again when
+ *        the wheel reaches the horizon
+ */
+#define SCHED_WHEEL_LEVELS (4U)
+
+typedef struct sched_event {
+    uint8_t type; // defined by the application
+    uint8_t arg;  // meaning depends on the type, the timer index for timer events
+} sched_event_t;
+
+typedef void (*sched_dispatch_fn)(const sched_event_t *event);
+
+/**
+ * @brief Clears the queue and the timers
+ *
+ * @param dispatch function executing the events, called from sched_run only
+ */
+void sched_init(sched_dispatch_fn dispatch);
+
+/**
+ * @brief Queues an event
+ *
+ * Safe to call from interrupt context, interrupts are masked while the event
+ * is queued.
+ *
+ * @param type event type
+ * @param arg event argument
+ * @return 1 if queued, 0 if the queue is full and the event is dropped
+ */
+uint8_t sched_post(uint8_t type, uint8_t arg);
+
+/**
+ * @brief Starts or restarts a timer
+ *
+ * Thread context only. On expiry the event is executed with the given type
+ * and the timer index as argument, on the first millisecond at or after the
+ * deadline; a periodic timer keeps its phase even when an expiry is late.
+ *
+ * @param timer timer index, below SCHED_TIMERS
+ * @param type type of the event executed on expiry
+ * @param delay time to the first expiry, ms
+ * @param period time between the following expiries, ms, 0 for a one-shot timer
+ */
+void sched_timer_start(uint8_t timer, uint8_t type, uint32_t delay, uint32_t period);
+
+/**
+ * @brief Stops a timer, a pending expiry is cancelled
+ *
+ * @param timer timer index, below SCHED_TIMERS
+ */
+void sched_timer_stop(uint8_t timer);
+
+/**
+ * @brief Executes the events forever
+ */
+__NO_RETURN void sched_run(void);
+
+/**
+ * @brief Number of events dropped because the queue was full
+ */
+uint32_t sched_dropped(void);
+
+#endif // SCHED_H
@@ -0,0 +1,109 @@
+#ifndef SPO2_H
+#define SPO2_H
+
+/**
+ * @file spo2.h
+ * @brief SpO2 from the ratio of ratios of the red and IR PPG, beat by beat
+ *
+ * The processed samples of ppg.h are cut into beats at the upward zero
+ * crossings of the IR pulse wave. Over each beat the ratio of ratios is
+ *
+ *     R = (AC red / DC red) / (AC IR / DC IR)
+ *
+ * where the AC ratio is the least-squares gain from the IR to the red wave,
+ * sum(red * IR) / sum(IR^2): noise uncorrelated between the channels averages
+ * out instead of adding to the amplitudes. SpO2 is then a R^2 + b R + c, with
+ * the calibration coefficients of the sensor hub algorithm (see
+ * MAX32664_ReadMaximFastCoef), so both estimates agree on a calibrated
+ * sensor.
+ *
+ * Integer arithmetic only: R is in Q16, the coefficients and the polynomial
+ * in units of 10^-5 %.
+ */
+
+#include "ppg.h"
+
+/**
+ * @brief One in Q16, the format of R
+ */
+#define SPO2_RATIO_ONE (1UL << 16)
+
+/**
+ * @brief Calibration of the hub algorithm out of reset, x100000
+ */
+#define SPO2_DEFAULT_COEF_A (159584L)
+#define SPO2_DEFAULT_COEF_B (-3465966L)
+#define SPO2_DEFAULT_COEF_C (11268987L)
+
+/**
+ * @brief Beat lengths accepted, in samples at PPG_OUTPUT_HZ: 250 to 30 bpm
+ */
+#define SPO2_MIN_BEAT (6U)
+#define SPO2_MAX_BEAT (50U)
+
+/**
+ * @brief Depth the IR wave goes below zero between two beats, so that noise
+ *        around a crossing does not split a beat, 2^-PPG_GAIN_BITS counts
+ */
+#define SPO2_HYSTERESIS (16)
+
+typedef struct spo2 {
+    int32_t coef[3];    // a, b, c x100000, SpO2 in %
+    int64_t crossSum;   // sum of red x IR AC over the beat
+    uint64_t irSquares; // sum of IR AC squared over the beat
+    uint16_t length;    // samples in the beat, 0 until the first crossing
+    int16_t previous;   // previous IR AC sample
+    uint8_t armed;      // the IR went below -SPO2_HYSTERESIS since the crossing
+    uint32_t beats;     // beats estimated
+    uint32_t rejected;  // beats too short, too long or without a pulse
+    uint32_t ratio;     // R of the last beat, Q16
+    uint16_t spo2;      // SpO2 of the last beat, 0.1 %
+} spo2_t;
+
+/**
+ * @brief Sets the calibration and clears the state
+ *
+ * @param spo2 estimator to initialise
+ * @param coef a, b and c x100000, as read from the hub
+ */
+void spo2_init(spo2_t *spo2, const int32_t coef[3]);
+
+/**
+ * @brief Clears the state and the counters, the calibration is kept
+ *
+ * @param spo2 estimator
+ */
+void spo2_reset(spo2_t *spo2);
+
+/**
+ * @brief Adds a processed sample, ends the beat on an upward crossing
+ *
+ * @param spo2 estimator
+ * @param sample sample at PPG_OUTPUT_HZ
+ * @return 1 when the sample ends a beat with an estimate, in spo2->ratio and
+ *         spo2->spo2, 0 otherwise
+ */
+uint8_t spo2_add(spo2_t *spo2, const ppg_sample_t *sample);
+
+/**
+ * @brief Applies the calibration to a ratio of ratios
+ *
+ * @param coef a, b and c x100000
+ * @param ratio R, Q16
+ * @return SpO2 in 0.1 %, limited to 0 - 100 %
+ */
+uint16_t spo2_from_ratio(const int32_t coef[3], uint32_t ratio);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs the estimator on a minute of synthetic pulse wave and prints
+ *        its cycles per beat on USART2, sample processing included
+ *
+ * Blocking, call it from thread context only.
+ */
+void spo2_profile(void);
+
+#endif
+
+#endif // SPO2_H
@@ -0,0 +1,115 @@
+#ifndef STATS_H
+#define STATS_H
+
+/**
+ * @file stats.h
+ * @brief Streaming statistics of a series of 16-bit samples
+ *
+ * Each sample updates the statistics in constant time and memory: count,
+ * min, max, mean and variance (Welford's algorithm), and a mean weighted by a
+ * per-sample weight such as the confidence of a reading.
+ *
+ * Integer arithmetic only: the sum of the samples is kept exact, the mean is
+ * derived from it in Q24.8 and the sum of the squared deviations from the mean
+ * is kept in Q48.16. The mean is off by less than 1/512 of the unit of the
+ * samples; the sums hold at least 2^16 samples of any spread.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Fractional bits of the mean, STATS_ONE is 1 unit of the samples
+ */
+#define STATS_FRACTION_BITS (8U)
+#define STATS_ONE (1UL << STATS_FRACTION_BITS)
+
+/**
+ * @brief Variance of the rounding of a sample to the unit, 1/12, Q48.16
+ */
+#define STATS_QUANTISATION ((1ULL << (2U * STATS_FRACTION_BITS)) / 12U)
+
+typedef struct stats {
+    uint32_t count;       // number of samples
+    uint16_t min;         // smallest sample, UINT16_MAX when empty
+    uint16_t max;         // largest sample
+    int32_t mean;         // Q24.8, rounded
+    uint64_t sum;         // sum of the samples
+    uint64_t m2;          // sum of the squared deviations from the mean, Q48.16
+    uint64_t weightedSum; // sum of sample * weight
+    uint32_t weightSum;   // sum of the weights
+} stats_t;
+
+/**
+ * @brief Clears the statistics
+ *
+ * @param stats statistics to clear
+ */
+void stats_reset(stats_t *stats);
+
+/**
+ * @brief Records a sample
+ *
+ * @param stats statistics to update
+ * @param value sample
+ * @param weight weight of the sample in the weighted mean
+ */
+void stats_add(stats_t *stats, uint16_t value, uint8_t weight);
+
+/**
+ * @brief Mean of the samples
+ *
+ * @param stats statistics
+ * @return mean rounded to the nearest unit, 0 if there is no sample
+ */
+uint16_t stats_mean(const stats_t *stats);
+
+/**
+ * @brief Mean of the samples weighted by their weights
+ *
+ * @param stats statistics
+ * @return weighted mean rounded to the nearest unit, the plain mean if every
+ *         weight is 0
+ */
+uint16_t stats_weighted_mean(const stats_t *stats);
+
+/**
+ * @brief Sample variance, the sum of the squared deviations over count - 1
+ *
+ * @param stats statistics
+ * @return variance in Q48.16, 0 with less than 2 samples
+ */
+uint64_t stats_variance(const stats_t *stats);
+
+/**
+ * @brief Standard error of the mean, sqrt(variance / count)
+ *
+ * @param stats statistics
+ * @return standard error in Q24.8, 0 with less than 2 samples
+ */
+uint32_t stats_std_error(const stats_t *stats);
+
+/**
+ * @brief Standard error of the mean of samples that are not independent
+ *
+ * The samples are taken as outputs of a running average over correlation of
+ * them, such as the reports of an algorithm averaging over a few seconds:
+ * only one in correlation carries new information, so the effective count is
+ * count / correlation, at least 1. The variance is floored at the rounding
+ * noise of the unit, so that samples quantised to a constant still carry an
+ * uncertainty.
+ *
+ * @param stats statistics
+ * @param correlation samples per independent one, 1 for independent samples
+ * @return standard error in Q24.8, 0 with less than 2 samples
+ */
+uint32_t stats_std_error_correlated(const stats_t *stats, uint32_t correlation);
+
+/**
+ * @brief Integer square root, bit by bit
+ *
+ * @param value radicand
+ * @return largest integer whose square is at most value
+ */
+uint32_t stats_isqrt(uint64_t value);
+
+#endif // STATS_H
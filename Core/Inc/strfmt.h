@@ -58,6 +58,14 @@ void put_uint32(strbuf *buffer, uint32_t value);
  */
 void put_char(strbuf *buffer, char value);
 
+/**
+ * @brief Appends a byte as two lowercase hexadecimal digits
+ *
+ * @param buffer receiver buffer
+ * @param value byte to append
+ */
+void put_hex8(strbuf *buffer, uint8_t value);
+
 /**
  * @brief Appends a string to the string buffer
  *
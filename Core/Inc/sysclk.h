@@ -0,0 +1,74 @@
+#ifndef SYSCLK_H
+#define SYSCLK_H
+
+/**
+ * @file sysclk.h
+ * @brief Runtime clock profiles, the peripherals keep their timings across a switch
+ *
+ * SystemClock_Config starts the core on SYSCLK_LOW. A switch reprograms the
+ * RCC, then every peripheral clocked from APB1 so that what it produces does
+ * not change:
+ * - TIM2, TIM3, TIM5: prescaler recomputed for the same counting frequency,
+ *   the counter keeps its value. The microsecond clock (usclock.h) drifts by
+ *   the time between the switch and the reload of its prescaler: the switch
+ *   runs with interrupts enabled, its timeouts count on SysTick.
+ * - USART2: BRR recomputed for the same baud rate
+ * - I2C1: reinitialised, the HAL derives the SCL timing from PCLK1
+ * SysTick is reprogrammed by HAL_RCC_ClockConfig.
+ *
+ * The counting frequencies set by tim.c must divide the timer kernel clock of
+ * every profile, and the prescalers must fit 16 bits at SYSCLK_FAST.
+ *
+ * Switching to SYSCLK_FAST waits for the PLL to lock, about 100 us. Only work
+ * bound by the CPU gets faster: transfers on I2C1 and USART2 take the same
+ * time at a higher current.
+ *
+ * The profile is switched by hand only, with the 'c' console command: the
+ * measure runs on SYSCLK_LOW and nothing switches to SYSCLK_FAST on its own.
+ */
+
+#include "main.h"
+
+typedef enum sysclk_profile {
+    SYSCLK_LOW = 0x00U, // HSI 16 MHz, PLL off: idle and bus-bound work
+    SYSCLK_FAST,        // PLL 84 MHz from HSI, APB1 42 MHz: console 'c' only
+    SYSCLK_PROFILES
+} sysclk_profile_t;
+
+/**
+ * @brief Records the counting frequency of the timers on the boot clock
+ *
+ * Call after SystemClock_Config and the MX_TIMx_Init functions.
+ */
+void sysclk_init(void);
+
+/**
+ * @brief Switches to a profile
+ *
+ * Blocking, call it from thread context only, with no transfer in progress on
+ * I2C1 or USART2.
+ *
+ * @param profile profile to run on
+ * @return HAL_OK, HAL_ERROR if the PLL did not lock: the profile is unchanged
+ */
+HAL_StatusTypeDef sysclk_set(sysclk_profile_t profile);
+
+/**
+ * @brief Profile the core runs on
+ */
+sysclk_profile_t sysclk_get(void);
+
+/**
+ * @brief Brings the active profile back after STOP mode
+ *
+ * STOP stops the PLL and wakes the core up on HSI, which is SYSCLK_LOW: the
+ * other profiles are switched to again.
+ */
+void sysclk_restore(void);
+
+/**
+ * @brief Prints the profile and the bus frequencies on the console
+ */
+void sysclk_report(void);
+
+#endif // SYSCLK_H
@@ -36,7 +36,7 @@ extern TIM_HandleTypeDef htim2;
 
 extern TIM_HandleTypeDef htim3;
 
-extern TIM_HandleTypeDef htim10;
+extern TIM_HandleTypeDef htim5;
 
 /* USER CODE BEGIN Private defines */
 
@@ -44,7 +44,7 @@ extern TIM_HandleTypeDef htim10;
 
 void MX_TIM2_Init(void);
 void MX_TIM3_Init(void);
-void MX_TIM10_Init(void);
+void MX_TIM5_Init(void);
 
 void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
 
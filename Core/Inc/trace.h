@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * @file trace.h
+ * @brief Lock-free ring of timestamped binary events
+ *
+ * Events are recorded from interrupts and thread context alike: a slot is
+ * claimed with a single atomic increment, so recording never blocks and never
+ * masks interrupts. When the ring is full the oldest events are overwritten.
+ *
+ * The ring is dumped on USART2 as text lines, Tools/trace2chrome.py converts
+ * a captured dump to the Chrome trace format (chrome://tracing, Perfetto).
+ *
+ * Builds defining TRACE_OBSERVER as a function name also pass every event to
+ * that function as it is recorded, the host benchmarks measure with it.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Number of events kept in the ring, must be a power of two
+ */
+#define TRACE_SIZE (256U)
+
+typedef enum trace_type {
+    TRACE_I2C_BEGIN = 0x01U, // arg: 8-bit device address, value: bytes to transfer
+    TRACE_I2C_END,           // arg: 8-bit device address, value: HAL status
+    TRACE_STATE,             // arg: new MachineState, value: previous MachineState
+    TRACE_FIFO,              // arg: unused, value: samples in the sensor hub output FIFO
+    TRACE_UART_BEGIN,        // arg: unused, value: bytes queued for transmission
+    TRACE_UART_END,          // arg: unused, value: bytes transmitted
+    TRACE_SAMPLE,            // arg: 1 counted in the measure, 0 rejected, value: heart rate, 0.1 bpm
+    TRACE_REPORT_BEGIN,      // arg: unused, value: good samples of the measure
+    TRACE_REPORT_END,        // arg: new MachineState, value: good samples of the measure
+    TRACE_ALARM              // arg: alarm channel, bit 7 set if raised, value: latency from the read of the sample, us
+} trace_type_t;
+
+typedef struct trace_event {
+    uint32_t timestamp; // usclock_now, us
+    uint8_t type;       // trace_type_t
+    uint8_t arg;
+    uint16_t value;
+} trace_event_t;
+
+/**
+ * @brief Records an event
+ *
+ * Safe to call from interrupt context. Events recorded while a dump is in
+ * progress are dropped.
+ *
+ * @param type event type
+ * @param arg first argument, meaning depends on the type
+ * @param value second argument, meaning depends on the type
+ */
+void trace_record(trace_type_t type, uint8_t arg, uint16_t value);
+
+/**
+ * @brief Prints the content of the ring on USART2, oldest event first
+ *
+ * Blocking, call it from thread context only. The format is a header line
+ * "trace <events> <lost>", one line "<timestamp> <type> <arg> <value>" per
+ * event and a final "trace end" line, all numbers in decimal.
+ */
+void trace_dump(void);
+
+#endif // TRACE_H
@@ -0,0 +1,106 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+/**
+ * @file tracker.h
+ * @brief Live estimate of a slowly varying reading: scalar Kalman filter
+ *
+ * The reading is modelled as a random walk: each sample adds the process
+ * noise to the variance of the estimate, then the sample is fused with it,
+ * weighted by the inverse of its own variance. That is the measurement noise
+ * at 100% confidence, scaled by 100 / confidence: a sample the source is
+ * unsure of moves the estimate less, one with no confidence only ages it.
+ *
+ * A sample further than TRACKER_GATE standard deviations of the innovation
+ * from the estimate is rejected as an outlier. TRACKER_OUTLIER_RUN of them in
+ * a row mean the reading moved: the track starts over on the last one.
+ *
+ * The estimate is kept in Q8 of the unit of the samples and its variance in
+ * Q8 of the unit squared. Constant time per sample, integer arithmetic only.
+ */
+
+#include <stdint.h>
+
+#include "prof.h"
+
+/**
+ * @brief Innovations rejected, standard deviations
+ */
+#define TRACKER_GATE (4U)
+
+/**
+ * @brief Consecutive outliers that restart the track: half a second of the
+ *        100 Hz of the hub, longer than its algorithm glitches
+ */
+#define TRACKER_OUTLIER_RUN (50U)
+
+/**
+ * @brief Fractional bits of the estimate and of the variances
+ */
+#define TRACKER_FRACTION_BITS (8U)
+
+typedef struct tracker {
+    int32_t estimate;          // Q8
+    uint32_t variance;         // of the estimate, Q8 unit^2, saturated
+    uint32_t processNoise;     // variance added by each sample, Q8 unit^2
+    uint32_t measurementNoise; // variance of a sample at 100% confidence, Q8 unit^2
+    uint8_t primed;            // the estimate is set
+    uint8_t outliers;          // consecutive outliers
+    uint32_t updates;          // samples fused, restarts included
+    uint32_t rejected;         // outliers
+} tracker_t;
+
+/**
+ * @brief Clears the track
+ *
+ * @param tracker tracker to initialise
+ * @param processNoise variance the reading drifts by between two samples,
+ *        Q8 unit^2
+ * @param measurementNoise variance of a sample at 100% confidence, Q8 unit^2
+ */
+void tracker_init(tracker_t *tracker, uint32_t processNoise, uint32_t measurementNoise);
+
+/**
+ * @brief Ages the estimate by one sample and fuses the sample with it
+ *
+ * The first sample with a confidence sets the estimate.
+ *
+ * @param tracker tracker
+ * @param value sample
+ * @param confidence of the sample, %, 0 to only age the estimate
+ * @return 1 if the sample was fused, 0 if it had no confidence or was an
+ *         outlier
+ */
+uint8_t tracker_add(tracker_t *tracker, uint16_t value, uint8_t confidence);
+
+/**
+ * @brief Estimate, scaled
+ *
+ * @param tracker tracker
+ * @param scale factor, 10 for tenths of the unit of the samples
+ * @return estimate times scale, rounded, 0 until the first sample
+ */
+uint16_t tracker_value(const tracker_t *tracker, uint16_t scale);
+
+/**
+ * @brief Standard deviation of the estimate, scaled
+ *
+ * @param tracker tracker
+ * @param scale factor, 10 for tenths of the unit of the samples
+ * @return deviation times scale, rounded, UINT16_MAX until the first sample
+ */
+uint16_t tracker_deviation(const tracker_t *tracker, uint16_t scale);
+
+#if PROF_ENABLED
+
+/**
+ * @brief Runs a tracker on a minute of synthetic hub reports and prints its
+ *        cycles per sample on USART2
+ *
+ * Blocking, call it from thread context only.
+ */
+void tracker_profile(void);
+
+#endif
+
+#endif // TRACKER_H
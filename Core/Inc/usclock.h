@@ -0,0 +1,115 @@
+#ifndef USCLOCK_H
+#define USCLOCK_H
+
+/**
+ * @file usclock.h
+ * @brief Free-running microsecond clock and inter-sample interval statistics
+ *
+ * TIM5 is a 32-bit timer clocked at 1 MHz and never reloaded before 2^32 us
+ * (about 71 minutes): differences of two timestamps computed in uint32_t
+ * arithmetic are correct across the wrap-around.
+ *
+ * Channel 1 of TIM5 is the alarm of the clock: its compare interrupt wakes
+ * the core at a given timestamp. TIM5 stops in STOP mode, the power manager
+ * (power.h) adds the time spent there on wake-up.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Width of a bucket of the interval histogram, in microseconds
+ */
+#define USCLOCK_BIN_US (500U)
+
+/**
+ * @brief Number of buckets of the interval histogram, the last one collects
+ *        every interval longer than the histogram range
+ */
+#define USCLOCK_BINS (128U)
+
+typedef struct usclock_stats {
+    uint8_t started; // a reference sample has been recorded
+    uint32_t last;   // timestamp of the previous sample
+    uint32_t count;  // number of intervals
+    uint32_t min;    // shortest interval, us
+    uint32_t max;    // longest interval, us
+    uint64_t sum;    // sum of the intervals, us
+    uint16_t hist[USCLOCK_BINS];
+} usclock_stats_t;
+
+/**
+ * @brief Starts the microsecond clock
+ */
+void usclock_start(void);
+
+/**
+ * @brief Current value of the microsecond clock
+ *
+ * Safe to call from interrupt context.
+ *
+ * @return microseconds since usclock_start, modulo 2^32
+ */
+uint32_t usclock_now(void);
+
+/**
+ * @brief Moves the clock forward, by the time it stood still in STOP mode
+ *
+ * @param us microseconds to add
+ */
+void usclock_advance(uint32_t us);
+
+/**
+ * @brief Arms the alarm, replacing the previous one
+ *
+ * The compare interrupt only wakes the core, the caller checks the time once
+ * awake. It fires again on every wrap-around of the clock until cancelled.
+ *
+ * @param timestamp usclock_now value to raise the interrupt at, less than
+ *                  2^31 us ahead
+ * @return 0 if armed, 1 if the timestamp is already reached: the alarm is
+ *         then not armed
+ */
+uint8_t usclock_alarm(uint32_t timestamp);
+
+/**
+ * @brief Disarms the alarm
+ */
+void usclock_alarm_cancel(void);
+
+/**
+ * @brief Clears the statistics
+ *
+ * @param stats statistics to clear
+ */
+void usclock_stats_reset(usclock_stats_t *stats);
+
+/**
+ * @brief Records a sample: the interval from the previous sample is accumulated
+ *
+ * The first sample after a reset only sets the reference.
+ *
+ * @param stats statistics to update
+ * @param timestamp usclock_now value of the sample
+ */
+void usclock_stats_add(usclock_stats_t *stats, uint32_t timestamp);
+
+/**
+ * @brief Mean interval
+ *
+ * @param stats statistics
+ * @return mean interval in microseconds, 0 if no interval was recorded
+ */
+uint32_t usclock_stats_mean(const usclock_stats_t *stats);
+
+/**
+ * @brief Percentile of the intervals, from the histogram
+ *
+ * @param stats statistics
+ * @param percent percentile to compute, 1 to 100
+ * @return upper edge of the bucket holding the percentile in microseconds,
+ *         the maximum if it falls in the overflow bucket, 0 if no interval
+ *         was recorded
+ */
+uint32_t usclock_stats_percentile(const usclock_stats_t *stats, uint8_t percent);
+
+#endif // USCLOCK_H
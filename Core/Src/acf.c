@@ -0,0 +1,151 @@
+#include "acf.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define LAG_FRACTION_BITS (8U)
+
+_Static_assert((ACF_WINDOW & (ACF_WINDOW - 1U)) == 0U, "ACF_WINDOW must be a power of two");
+_Static_assert((ACF_MAX_LAG + 1U) < ACF_WINDOW, "the window must cover the longest period");
+
+/* Products of the window with itself shifted by lag */
+static int64_t correlate(const int16_t *x, uint32_t lag) {
+    int64_t sum = 0;
+
+    for (uint32_t n = 0U; n < (ACF_WINDOW - lag); n++) {
+        sum += (int32_t)x[n] * x[n + lag];
+    }
+    return sum;
+}
+
+/* Autocorrelation of the window over the lags searched and their neighbours */
+static uint8_t autocorrelation(acf_t *acf) {
+    const int16_t *x = &acf->window[acf->head];
+    int64_t energy = correlate(x, 0U);
+
+    if (energy <= 0) {
+        return 0U;
+    }
+    for (uint32_t lag = ACF_MIN_LAG - 1U; lag <= (ACF_MAX_LAG + 1U); lag++) {
+        // unbiased, then relative to the lag 0
+        int64_t unbiased = (correlate(x, lag) * ACF_WINDOW) / (int64_t)(ACF_WINDOW - lag);
+        int64_t relative = (unbiased * ACF_ONE) / energy;
+        // the unbiased correction can take it slightly over 1
+        if (relative >= ACF_ONE) {
+            relative = ACF_ONE - 1;
+        } else if (relative < -ACF_ONE) {
+            relative = -ACF_ONE;
+        } else {
+            // in range
+        }
+        acf->correlation[lag] = (int16_t)relative;
+    }
+    return 1U;
+}
+
+/* Period of the wave in samples, Q8, and its correlation, 0 if there is none */
+static uint32_t period(const acf_t *acf, int16_t *height) {
+    const int16_t *c = acf->correlation;
+    int16_t highest = 0;
+
+    for (uint32_t lag = ACF_MIN_LAG; lag <= ACF_MAX_LAG; lag++) {
+        if (c[lag] > highest) {
+            highest = c[lag];
+        }
+    }
+    for (uint32_t lag = ACF_MIN_LAG; lag <= ACF_MAX_LAG; lag++) {
+        uint8_t peak = ((c[lag] > c[lag - 1U]) && (c[lag] >= c[lag + 1U])) ? 1U : 0U;
+        if ((peak != 0U) && (((int32_t)c[lag] * 100) >= ((int32_t)highest * (int32_t)ACF_HARMONIC_PERCENT))) {
+            int32_t curvature = (int32_t)c[lag - 1U] - (2 * (int32_t)c[lag]) + (int32_t)c[lag + 1U];
+            int32_t offset = (curvature < 0) ? ((((int32_t)c[lag - 1U] - (int32_t)c[lag + 1U]) *
+                                                 (int32_t)(1UL << LAG_FRACTION_BITS)) /
+                                                (2 * curvature))
+                                             : 0;
+            *height = c[lag];
+            return (uint32_t)((int32_t)(lag << LAG_FRACTION_BITS) + offset);
+        }
+    }
+    *height = 0;
+    return 0U;
+}
+
+void acf_init(acf_t *acf) {
+    (void)memset(acf, 0, sizeof(*acf));
+}
+
+uint8_t acf_add(acf_t *acf, const ppg_sample_t *sample) {
+    // the newest sample replaces the oldest, in both copies
+    acf->window[acf->head] = sample->ir;
+    acf->window[acf->head + ACF_WINDOW] = sample->ir;
+    acf->head = (uint16_t)((acf->head + 1U) & (ACF_WINDOW - 1U));
+    if (acf->filled < ACF_WINDOW) {
+        acf->filled++;
+    }
+    acf->sinceEstimate++;
+    if ((acf->filled < ACF_WINDOW) || (acf->sinceEstimate < ACF_STEP)) {
+        return 0U;
+    }
+
+    acf->sinceEstimate = 0U;
+    acf->estimates++;
+    acf->heartRate = 0U;
+    acf->periodicity = 0U;
+    if (autocorrelation(acf) == 0U) {
+        return 1U;
+    }
+    int16_t height = 0;
+    uint32_t lag = period(acf, &height);
+    if (lag != 0U) {
+        // 0.1 bpm per period of PPG_OUTPUT_HZ samples
+        uint32_t perMinute = 600UL * PPG_OUTPUT_HZ << LAG_FRACTION_BITS;
+        acf->heartRate = (uint16_t)((perMinute + (lag / 2U)) / lag);
+        acf->periodicity = (uint8_t)(((int32_t)height * 100) / ACF_ONE);
+    }
+    return 1U;
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_SAMPLES (ACF_WINDOW + (ACF_STEP * 10U))
+
+void acf_profile(void) {
+    static acf_t acf;
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+    uint32_t worst = 0U;
+
+    acf_init(&acf);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        ppg_sample_t sample = {0};
+        sample.ir = prof_pulse(i);
+        uint32_t start = DWT->CYCCNT;
+        uint8_t estimated = acf_add(&acf, &sample);
+        uint32_t spent = DWT->CYCCNT - start;
+        if (estimated != 0U) {
+            cycles += spent;
+            worst = (spent > worst) ? spent : worst;
+        }
+    }
+
+    uint32_t perEstimate = (acf.estimates > 0U) ? (cycles / acf.estimates) : 0U;
+    str_clear(&line);
+    put_str(&line, "\r\nACF [cycles per estimate @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, perEstimate);
+    put_str(&line, ", max ");
+    put_uint32(&line, worst);
+    // one estimate per second: per mille of the CPU
+    put_str(&line, ", CPU ");
+    put_uint32(&line, (uint32_t)(((uint64_t)perEstimate * 1000U) / SystemCoreClock));
+    put_str(&line, " per mille");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,79 @@
+#include "alarm.h"
+
+#include <string.h>
+
+#define MS_PER_SECOND (1000UL)
+
+/* Whether a sample pushes the channel towards the other state */
+static uint8_t towards(const alarm_channel_t *channel, uint16_t value) {
+    const alarm_rule_t *rule = &channel->rule;
+
+    if (channel->active == 0U) {
+        return (uint8_t)((rule->above != 0U) ? (value > rule->threshold) : (value < rule->threshold));
+    }
+    if (rule->above != 0U) {
+        return (uint8_t)(((uint32_t)value + rule->hysteresis) <= rule->threshold);
+    }
+    return (uint8_t)((uint32_t)value >= ((uint32_t)rule->threshold + rule->hysteresis));
+}
+
+void alarm_init(alarm_t *alarm, const alarm_rule_t rules[ALARM_CHANNELS], uint16_t sampleRateHz) {
+    (void)memset(alarm, 0, sizeof(*alarm));
+    for (uint8_t i = 0U; i < ALARM_CHANNELS; i++) {
+        alarm_channel_t *channel = &alarm->channels[i];
+        channel->rule = rules[i];
+        // rounded up: a duration shorter than a sample is one sample
+        channel->minSamples = (((uint32_t)rules[i].minDurationMs * sampleRateHz) + (MS_PER_SECOND - 1U)) /
+                              MS_PER_SECOND;
+        if (channel->minSamples == 0U) {
+            channel->minSamples = 1U;
+        }
+    }
+}
+
+uint8_t alarm_add(alarm_t *alarm, uint8_t channel, uint16_t value, uint8_t confidence, uint32_t timestamp) {
+    if (channel >= ALARM_CHANNELS) {
+        return 0U;
+    }
+    alarm_channel_t *ch = &alarm->channels[channel];
+    if ((confidence == 0U) || (confidence < ch->rule.minConfidence)) {
+        return 0U;
+    }
+    if (towards(ch, value) == 0U) {
+        ch->run = 0U;
+        return 0U;
+    }
+    ch->run++;
+    if (ch->run < ch->minSamples) {
+        return 0U;
+    }
+
+    ch->run = 0U;
+    ch->active = (ch->active != 0U) ? 0U : 1U;
+    ch->raised += ch->active;
+    if (alarm->count >= ALARM_QUEUE_SIZE) {
+        alarm->dropped++;
+        return 1U;
+    }
+    alarm_event_t *event = &alarm->queue[(alarm->head + alarm->count) & (ALARM_QUEUE_SIZE - 1U)];
+    event->channel = channel;
+    event->raised = ch->active;
+    event->value = value;
+    event->timestamp = timestamp;
+    alarm->count++;
+    return 1U;
+}
+
+uint8_t alarm_pop(alarm_t *alarm, alarm_event_t *event) {
+    if (alarm->count == 0U) {
+        return 0U;
+    }
+    *event = alarm->queue[alarm->head];
+    alarm->head = (alarm->head + 1U) & (ALARM_QUEUE_SIZE - 1U);
+    alarm->count--;
+    return 1U;
+}
+
+uint8_t alarm_active(const alarm_t *alarm, uint8_t channel) {
+    return (channel < ALARM_CHANNELS) ? alarm->channels[channel].active : 0U;
+}
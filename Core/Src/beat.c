@@ -0,0 +1,166 @@
+#include "beat.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define US_PER_MS (1000UL)
+#define DECAY_SHIFT (4U)
+
+_Static_assert((BEAT_RR_SIZE & (BEAT_RR_SIZE - 1U)) == 0U, "BEAT_RR_SIZE must be a power of two");
+
+/* Offset of the vertex of the parabola through the three samples from the middle one, us */
+static int32_t vertex_offset(int32_t before, int32_t peak, int32_t after) {
+    int32_t curvature = before - (2 * peak) + after;
+
+    // negative at a strict maximum, flat tops are taken as they are
+    if (curvature >= 0) {
+        return 0;
+    }
+    return (int32_t)(((int64_t)(before - after) * (int64_t)BEAT_SAMPLE_US) / (2 * curvature));
+}
+
+/* Queues an interval, overwrites the oldest one when the ring is full */
+static void push(beat_t *beat, uint32_t timestamp, uint16_t interval, uint16_t amplitude) {
+    uint8_t tail = (uint8_t)((beat->head + beat->count) & (BEAT_RR_SIZE - 1U));
+
+    beat->ring[tail].timestamp = timestamp;
+    beat->ring[tail].interval = interval;
+    beat->ring[tail].amplitude = amplitude;
+    beat->ring[tail].successive = beat->queued;
+    if (beat->count == BEAT_RR_SIZE) {
+        beat->head = (uint8_t)((beat->head + 1U) & (BEAT_RR_SIZE - 1U));
+        beat->lost++;
+    } else {
+        beat->count++;
+    }
+}
+
+/* Checks the interval ending at a new peak, queues it if it is plausible */
+static uint8_t interval(beat_t *beat, uint32_t timestamp, int32_t peak) {
+    uint32_t rr = ((timestamp - beat->lastPeakUs) + (US_PER_MS / 2U)) / US_PER_MS;
+
+    if (rr > BEAT_MAX_RR_MS) {
+        // no pulse in between, nothing to measure
+        beat->queued = 0U;
+        return 0U;
+    }
+    if (beat->meanRr != 0U) {
+        uint32_t deviation = (rr > beat->meanRr) ? (rr - beat->meanRr) : (beat->meanRr - rr);
+        if ((deviation * 100U) > ((uint32_t)beat->meanRr * BEAT_RR_TOLERANCE)) {
+            beat->outliers++;
+            if (beat->outliers < BEAT_OUTLIER_RUN) {
+                beat->rejected++;
+                beat->queued = 0U;
+                return 0U;
+            }
+            // the rate changed: start the mean over
+            beat->meanRr = 0U;
+        }
+    }
+
+    push(beat, timestamp, (uint16_t)rr, (uint16_t)(peak - beat->trough));
+    if (beat->meanRr == 0U) {
+        beat->meanRr = (uint16_t)rr;
+    } else {
+        beat->meanRr = (uint16_t)((int32_t)beat->meanRr + (((int32_t)rr - (int32_t)beat->meanRr) / 4));
+    }
+    beat->outliers = 0U;
+    beat->queued = 1U;
+    return 1U;
+}
+
+void beat_init(beat_t *beat) {
+    (void)memset(beat, 0, sizeof(*beat));
+}
+
+uint8_t beat_add(beat_t *beat, const ppg_sample_t *sample) {
+    uint8_t queued = 0U;
+    int32_t before = beat->previous[0];
+    int32_t peak = beat->previous[1];
+    int32_t threshold = beat->amplitude / 2;
+
+    if (threshold < BEAT_MIN_AMPLITUDE) {
+        threshold = BEAT_MIN_AMPLITUDE;
+    }
+    // the middle sample of the three is a candidate, once the first two are in
+    if ((beat->samples >= 2U) && (peak > before) && (peak >= sample->ir) && (peak > threshold) &&
+        ((beat->havePeak == 0U) || ((beat->sincePeak * BEAT_SAMPLE_US) >= (BEAT_REFRACTORY_MS * US_PER_MS)))) {
+        uint32_t timestamp = ((beat->samples - 1U) * BEAT_SAMPLE_US) + (uint32_t)vertex_offset(before, peak, sample->ir);
+        if (beat->havePeak != 0U) {
+            queued = interval(beat, timestamp, peak);
+        }
+        beat->amplitude = (beat->havePeak == 0U) ? peak : (beat->amplitude + ((peak - beat->amplitude) / 4));
+        beat->lastPeakUs = timestamp;
+        beat->havePeak = 1U;
+        beat->sincePeak = 0U;
+        beat->peaks++;
+        beat->trough = sample->ir;
+    } else if (sample->ir < beat->trough) {
+        beat->trough = sample->ir;
+    } else {
+        // not a new low
+    }
+
+    // the next candidate is the current sample, one sample further
+    if (beat->sincePeak < UINT32_MAX) {
+        beat->sincePeak++;
+    }
+    if ((beat->sincePeak * BEAT_SAMPLE_US) > (BEAT_MAX_RR_MS * US_PER_MS)) {
+        // weaker pulse or none: lower the threshold
+        beat->amplitude -= beat->amplitude >> DECAY_SHIFT;
+    }
+    beat->previous[0] = beat->previous[1];
+    beat->previous[1] = sample->ir;
+    beat->samples++;
+    return queued;
+}
+
+uint8_t beat_pop(beat_t *beat, beat_rr_t *rr) {
+    if (beat->count == 0U) {
+        return 0U;
+    }
+    *rr = beat->ring[beat->head];
+    beat->head = (uint8_t)((beat->head + 1U) & (BEAT_RR_SIZE - 1U));
+    beat->count--;
+    return 1U;
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_SAMPLES (PPG_OUTPUT_HZ * 60U)
+
+void beat_profile(void) {
+    static beat_t beat;
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+    beat_rr_t rr;
+
+    beat_init(&beat);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        ppg_sample_t sample = {0};
+        sample.ir = prof_pulse(i);
+        uint32_t start = DWT->CYCCNT;
+        (void)beat_add(&beat, &sample);
+        while (beat_pop(&beat, &rr) != 0U) {
+        }
+        cycles += DWT->CYCCNT - start;
+    }
+
+    str_clear(&line);
+    put_str(&line, "\r\nBeats [cycles @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, cycles / PROFILE_SAMPLES);
+    put_str(&line, " per sample, ");
+    put_uint32(&line, (beat.peaks > 0U) ? (cycles / beat.peaks) : 0U);
+    put_str(&line, " per beat");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
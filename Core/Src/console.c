@@ -0,0 +1,106 @@
+#include "console.h"
+
+#include <string.h>
+
+#include "acf.h"
+#include "beat.h"
+#include "i2crec.h"
+#include "motion.h"
+#include "power.h"
+#include "ppg.h"
+#include "prof.h"
+#include "resp.h"
+#include "spo2.h"
+#include "sysclk.h"
+#include "trace.h"
+#include "tracker.h"
+#include "usart.h"
+
+static uint8_t rxChar;
+static volatile uint8_t pending = 0U;
+static volatile char command = '\0';
+
+void console_start(void) {
+    // USART2 is stopped in STOP mode: the start bit of a character on RX
+    // (PA3, still in alternate function) raises EXTI line 3 instead
+    EXTI_HandleTypeDef wake = {0};
+    EXTI_ConfigTypeDef wakeConfig = {
+        .Line = EXTI_LINE_3,
+        .Mode = EXTI_MODE_INTERRUPT,
+        .Trigger = EXTI_TRIGGER_FALLING,
+        .GPIOSel = EXTI_GPIOA,
+    };
+    (void)HAL_EXTI_SetConfigLine(&wake, &wakeConfig);
+    HAL_NVIC_SetPriority(EXTI3_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+    (void)HAL_UART_Receive_IT(&huart2, &rxChar, 1U);
+}
+
+void console_poll(void) {
+    if (pending == 0U) {
+        return;
+    }
+
+    char cmd = command;
+    pending = 0U;
+
+    switch (cmd) {
+    case 'p':
+#if PROF_ENABLED
+        prof_dump();
+#else
+        PRINT("\r\nProfiling is available in debug builds only");
+#endif
+        break;
+    case 'g':
+#if PROF_ENABLED
+        ppg_profile();
+        spo2_profile();
+        beat_profile();
+        acf_profile();
+        resp_profile();
+        motion_profile();
+        tracker_profile();
+#else
+        PRINT("\r\nProfiling is available in debug builds only");
+#endif
+        break;
+    case 'r':
+        prof_reset();
+        PRINT("\r\nProfile cleared");
+        break;
+    case 't':
+        trace_dump();
+        break;
+    case 'e':
+        power_report();
+        break;
+    case 'c':
+        (void)sysclk_set((sysclk_get() == SYSCLK_LOW) ? SYSCLK_FAST : SYSCLK_LOW);
+        sysclk_report();
+        break;
+    case 'i':
+#if I2CREC_ENABLED
+        i2crec_dump();
+#else
+        PRINT("\r\nI2C recording is not compiled in (I2C_RECORD)");
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+void console_rx_complete(UART_HandleTypeDef *huart) {
+    if (huart != &huart2) {
+        return;
+    }
+
+    // a command arriving before the previous one is executed is dropped
+    if (pending == 0U) {
+        command = (char)rxChar;
+        pending = 1U;
+    }
+    (void)HAL_UART_Receive_IT(&huart2, &rxChar, 1U);
+}
@@ -0,0 +1,69 @@
+#include "ds1307nv.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define CRC8_POLY (0x07U)
+
+typedef struct nv_slot {
+    uint8_t offset; // first byte in the RAM
+    uint8_t size;   // size of the value, the CRC byte follows it
+} nv_slot_t;
+
+// Slots are packed back to back, each one is the value plus its CRC byte
+static const nv_slot_t slots[NV_KEY_COUNT] = {
+    {0U, sizeof(uint8_t)},
+    {2U, sizeof(uint32_t)},
+    {7U, sizeof(nv_sensor_config_t)},
+    {12U, sizeof(nv_session_t)},
+};
+
+_Static_assert((12U + sizeof(nv_session_t) + 1U) <= DS1307_RAM_SIZE, "NVRAM layout exceeds the DS1307 RAM");
+
+static uint8_t shadow[DS1307_RAM_SIZE];
+
+/*
+ * CRC-8 of a slot. The key and the layout version seed the CRC, so a value read
+ * under the wrong key or written by another layout never validates.
+ */
+static uint8_t ds1307nv_crc(nv_key_t key, const uint8_t *data, uint8_t size) {
+    uint8_t crc = (uint8_t)(((uint8_t)key << 4) | NV_LAYOUT_VERSION);
+
+    for (uint8_t i = 0U; i < size; i++) {
+        crc ^= data[i];
+        for (uint8_t b = 0U; b < 8U; b++) {
+            crc = ((crc & 0x80U) != 0U) ? (uint8_t)((crc << 1) ^ CRC8_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+int8_t ds1307nv_load(void) {
+    return ds1307rtc_read_ram(0U, shadow, DS1307_RAM_SIZE);
+}
+
+int8_t ds1307nv_get(nv_key_t key, void *value, uint8_t size) {
+    if ((key >= NV_KEY_COUNT) || (slots[key].size != size)) {
+        return DS1307_ERR;
+    }
+
+    const uint8_t *slot = &shadow[slots[key].offset];
+    if (ds1307nv_crc(key, slot, size) != slot[size]) {
+        return DS1307_ERR;
+    }
+
+    (void)memcpy(value, slot, size);
+    return DS1307_OK;
+}
+
+int8_t ds1307nv_set(nv_key_t key, const void *value, uint8_t size) {
+    if ((key >= NV_KEY_COUNT) || (slots[key].size != size)) {
+        return DS1307_ERR;
+    }
+
+    uint8_t *slot = &shadow[slots[key].offset];
+    (void)memcpy(slot, value, size);
+    slot[size] = ds1307nv_crc(key, slot, size);
+
+    return ds1307rtc_write_ram(slots[key].offset, slot, size + 1U);
+}
@@ -1,5 +1,6 @@
 #include "ds1307rtc.h"
 #include "i2c.h"
+#include "i2cbus.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -10,6 +11,9 @@
 
 #define MAX_RETRY (3)
 
+// SQW edges stop arriving when this many milliseconds pass without one
+#define SQW_LOST_TIMEOUT (1500U)
+
 // DEVICE ADDRESS (From the user guide)
 #define DS1307_ADDRESS (0xD0) // It is 1101000<<1
 
@@ -22,6 +26,7 @@
 #define DS1307_MONTH (0x05)
 #define DS1307_YEAR (0x06)
 #define DS1307_CONTROL (0x07)
+#define DS1307_RAM (0x08)
 
 /* Bits in control register */
 #define DS1307_CONTROL_OUT (7)
@@ -29,6 +34,22 @@
 #define DS1307_CONTROL_RS1 (1)
 #define DS1307_CONTROL_RS0 (0)
 
+/* RS1 = RS0 = 0 selects the 1 Hz rate */
+#define DS1307_CONTROL_SQW_1HZ (1U << DS1307_CONTROL_SQWE)
+
+typedef struct ds1307rtc_snapshot_s {
+    date_time_t time; // content of the time registers
+    uint32_t tick;    // HAL tick at which the registers held that time
+} ds1307rtc_snapshot_t;
+
+static ds1307rtc_snapshot_t snapshots[2];
+static volatile uint8_t activeSnapshot = 0U;
+static uint8_t synced = 0U;
+
+static uint8_t sqwEnabled = 0U;
+static volatile uint8_t sqwPending = 0U;
+static volatile uint32_t sqwTick = 0U;
+
 /*
  * @fn          uint8_t bcd2Dec ( uint8_t val )
  * @brief       Convert BCD to Decimal
@@ -51,34 +72,20 @@ uint8_t dec2Bcd(uint8_t val) {
     return res;
 }
 
-int8_t ds1307rtc_get_date_time(date_time_t *datetime) {
+static int8_t ds1307rtc_read_time(date_time_t *datetime) {
     HAL_StatusTypeDef returnValue;
     uint8_t in_buff[DATA_TRANSFER_SIZE];
 
-    // USING Mem_Read function
-    // Mem_Read is equivalent for performing Transmit of the MemAddress and Receive
-
-    // DS1307_SECONDS is the first register to be read
-    returnValue = HAL_I2C_Mem_Read(HI2C, DS1307_ADDRESS, DS1307_SECONDS, ADDRESS_SIZE, in_buff, DATA_TRANSFER_SIZE, HAL_MAX_DELAY);
+    // Mem_Read is equivalent for performing Transmit of the MemAddress and Receive,
+    // all seven registers are fetched in a single burst starting from DS1307_SECONDS
+    returnValue = i2cbus_mem_read(HI2C, DS1307_ADDRESS, DS1307_SECONDS, ADDRESS_SIZE, in_buff, DATA_TRANSFER_SIZE, DS1307_TIMEOUT);
     if (returnValue != HAL_OK) {
         return DS1307_IC2_ERR;
     }
 
-    // USING Master Receive and Transmit functions
-    // DS1307_SECONDS is the first register to be read
-    returnValue = HAL_I2C_Master_Transmit(HI2C, DS1307_ADDRESS, DS1307_SECONDS, ADDRESS_SIZE, HAL_MAX_DELAY);
-    if (returnValue != HAL_OK) {
-        return DS1307_IC2_ERR;
-    }
-
-    returnValue = HAL_I2C_Master_Receive(HI2C, DS1307_ADDRESS, in_buff, DATA_TRANSFER_SIZE, HAL_MAX_DELAY);
-    if (returnValue != HAL_OK) {
-        return DS1307_IC2_ERR;
-    }
-
-    datetime->seconds = bcd2Dec(in_buff[0]);
+    datetime->seconds = bcd2Dec(in_buff[0] & 0x7FU); // bit 7 is the clock halt flag
     datetime->minutes = bcd2Dec(in_buff[1]);
-    datetime->hours = bcd2Dec(in_buff[2]);
+    datetime->hours = bcd2Dec(in_buff[2] & 0x3FU); // 24-hour mode
     datetime->day = bcd2Dec(in_buff[3]);
     datetime->date = bcd2Dec(in_buff[4]);
     datetime->month = bcd2Dec(in_buff[5]);
@@ -87,6 +94,36 @@ int8_t ds1307rtc_get_date_time(date_time_t *datetime) {
     return DS1307_OK;
 }
 
+/*
+ * Publishes a new time base. The reader may be an interrupt preempting this
+ * function, so the inactive snapshot is filled first and then made active with
+ * a single store.
+ */
+static void ds1307rtc_publish(const date_time_t *datetime, uint32_t tick) {
+    uint8_t next = (activeSnapshot == 0U) ? 1U : 0U;
+    snapshots[next].time = *datetime;
+    snapshots[next].tick = tick;
+    activeSnapshot = next;
+}
+
+/*
+ * Adds whole seconds to a date time, carrying into minutes and hours. The date
+ * is not advanced: the next sync with the chip takes care of it.
+ */
+static void ds1307rtc_add_seconds(date_time_t *datetime, uint32_t seconds) {
+    uint32_t total = datetime->seconds + seconds;
+    uint32_t minutes = datetime->minutes + (total / 60U);
+    uint32_t hours = datetime->hours + (minutes / 60U);
+
+    datetime->seconds = (uint8_t)(total % 60U);
+    datetime->minutes = (uint8_t)(minutes % 60U);
+    datetime->hours = (uint8_t)(hours % 24U);
+}
+
+int8_t ds1307rtc_get_date_time(date_time_t *datetime) {
+    return ds1307rtc_read_time(datetime);
+}
+
 int8_t ds1307rtc_set_date_time(const date_time_t *datetime) {
     HAL_StatusTypeDef returnValue;
     uint8_t out_buff[DATA_TRANSFER_SIZE + ADDRESS_SIZE];
@@ -102,13 +139,17 @@ int8_t ds1307rtc_set_date_time(const date_time_t *datetime) {
     out_buff[6] = dec2Bcd(datetime->month);
     out_buff[7] = dec2Bcd(datetime->year);
 
-    returnValue = HAL_I2C_Mem_Write(HI2C, DS1307_ADDRESS, DS1307_SECONDS, ADDRESS_SIZE, out_buff + 1, DATA_TRANSFER_SIZE, HAL_MAX_DELAY);
+    returnValue = i2cbus_mem_write(HI2C, DS1307_ADDRESS, DS1307_SECONDS, ADDRESS_SIZE, out_buff + 1, DATA_TRANSFER_SIZE, DS1307_TIMEOUT);
     if (returnValue != HAL_OK) {
         return DS1307_IC2_ERR;
     }
 
+    // writing the seconds register resets the internal one-second countdown
+    ds1307rtc_publish(datetime, HAL_GetTick());
+    synced = 1U;
+
     // USING Master_Transmit function
-    /*returnValue = HAL_I2C_Master_Transmit(HI2C, DS1307_ADDRESS, out_buff, ADDRESS_SIZE+DATA_TRANSFER_SIZE, HAL_MAX_DELAY);
+    /*returnValue = i2cbus_master_transmit(HI2C, DS1307_ADDRESS, out_buff, ADDRESS_SIZE+DATA_TRANSFER_SIZE, HAL_MAX_DELAY);
     if(returnValue != HAL_OK)
     {
         return DS1307_IC2_ERR;
@@ -119,9 +160,104 @@ int8_t ds1307rtc_set_date_time(const date_time_t *datetime) {
 
 int8_t ds1307rtc_init() {
     HAL_StatusTypeDef returnValue;
-    returnValue = HAL_I2C_IsDeviceReady(HI2C, DS1307_ADDRESS, MAX_RETRY, HAL_MAX_DELAY);
+    returnValue = i2cbus_is_device_ready(HI2C, DS1307_ADDRESS, MAX_RETRY, DS1307_TIMEOUT);
+    if (returnValue != HAL_OK) {
+        return DS1307_ERR;
+    }
+    return ds1307rtc_sync();
+}
+
+int8_t ds1307rtc_read_ram(uint8_t offset, uint8_t *data, uint8_t size) {
+    HAL_StatusTypeDef returnValue;
+
+    if (((uint32_t)offset + size) > DS1307_RAM_SIZE) {
+        return DS1307_ERR;
+    }
+
+    returnValue = i2cbus_mem_read(HI2C, DS1307_ADDRESS, DS1307_RAM + offset, ADDRESS_SIZE, data, size, DS1307_TIMEOUT);
     if (returnValue != HAL_OK) {
+        return DS1307_IC2_ERR;
+    }
+    return DS1307_OK;
+}
+
+int8_t ds1307rtc_write_ram(uint8_t offset, const uint8_t *data, uint8_t size) {
+    HAL_StatusTypeDef returnValue;
+
+    if (((uint32_t)offset + size) > DS1307_RAM_SIZE) {
         return DS1307_ERR;
     }
+
+    // the HAL takes a non-const pointer but only reads from it
+    returnValue = i2cbus_mem_write(HI2C, DS1307_ADDRESS, DS1307_RAM + offset, ADDRESS_SIZE, (uint8_t *)data, size, DS1307_TIMEOUT);
+    if (returnValue != HAL_OK) {
+        return DS1307_IC2_ERR;
+    }
+    return DS1307_OK;
+}
+
+int8_t ds1307rtc_enable_sqw(uint8_t enable) {
+    HAL_StatusTypeDef returnValue;
+    uint8_t control = (enable != 0U) ? DS1307_CONTROL_SQW_1HZ : 0U;
+
+    returnValue = i2cbus_mem_write(HI2C, DS1307_ADDRESS, DS1307_CONTROL, ADDRESS_SIZE, &control, 1U, DS1307_TIMEOUT);
+    if (returnValue != HAL_OK) {
+        return DS1307_IC2_ERR;
+    }
+
+    sqwPending = 0U;
+    sqwEnabled = (enable != 0U) ? 1U : 0U;
+    return DS1307_OK;
+}
+
+int8_t ds1307rtc_sync(void) {
+    date_time_t curr;
+    uint32_t tick = HAL_GetTick();
+
+    if (ds1307rtc_read_time(&curr) != DS1307_OK) {
+        return DS1307_IC2_ERR;
+    }
+
+    ds1307rtc_publish(&curr, tick);
+    synced = 1U;
     return DS1307_OK;
 }
+
+void ds1307rtc_poll(void) {
+    uint32_t now = HAL_GetTick();
+    uint32_t age = now - snapshots[activeSnapshot].tick;
+
+    if ((sqwEnabled != 0U) && (sqwPending != 0U)) {
+        // the registers have just been updated: the edge tick is the exact
+        // start of the second that is going to be read
+        uint32_t edge = sqwTick;
+        date_time_t curr;
+        sqwPending = 0U;
+        if (ds1307rtc_read_time(&curr) == DS1307_OK) {
+            ds1307rtc_publish(&curr, edge);
+            synced = 1U;
+        }
+    } else if ((synced == 0U) || (age >= ((sqwEnabled != 0U) ? SQW_LOST_TIMEOUT : DS1307_SYNC_PERIOD))) {
+        (void)ds1307rtc_sync();
+    } else {
+        // cached time base is still good
+    }
+}
+
+void ds1307rtc_sqw_edge(void) {
+    sqwTick = HAL_GetTick();
+    sqwPending = 1U;
+}
+
+void ds1307rtc_now(date_time_t *datetime, uint16_t *millis) {
+    const ds1307rtc_snapshot_t *snap = &snapshots[activeSnapshot];
+    uint32_t elapsed = HAL_GetTick() - snap->tick;
+
+    *datetime = snap->time;
+    if (elapsed >= 1000U) {
+        ds1307rtc_add_seconds(datetime, elapsed / 1000U);
+    }
+    if (millis != NULL) {
+        *millis = (uint16_t)(elapsed % 1000U);
+    }
+}
@@ -0,0 +1,94 @@
+#include "hampel.h"
+
+#include <string.h>
+
+#define MIDDLE (HAMPEL_WINDOW / 2U)
+
+/* Index of the first sorted sample not less than value */
+static uint8_t lower_bound(const hampel_t *filter, uint16_t value) {
+    uint8_t low = 0U;
+    uint8_t high = filter->count;
+
+    while (low < high) {
+        uint8_t mid = (uint8_t)((low + high) / 2U);
+        if (filter->sorted[mid] < value) {
+            low = (uint8_t)(mid + 1U);
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Puts value in place of the sorted sample at index, shifting the ones between */
+static void sorted_place(hampel_t *filter, uint8_t index, uint16_t value) {
+    uint8_t i = index;
+
+    while (((i + 1U) < filter->count) && (filter->sorted[i + 1U] < value)) {
+        filter->sorted[i] = filter->sorted[i + 1U];
+        i++;
+    }
+    while ((i > 0U) && (filter->sorted[i - 1U] > value)) {
+        filter->sorted[i] = filter->sorted[i - 1U];
+        i--;
+    }
+    filter->sorted[i] = value;
+}
+
+/* Median of the deviations from the median: merged outwards from the middle */
+static uint16_t mad(const hampel_t *filter, uint16_t median) {
+    uint8_t below = MIDDLE; // samples left of the middle not yet merged
+    uint8_t above = MIDDLE + 1U;
+    uint16_t deviation = 0U;
+
+    for (uint8_t k = 0U; k < MIDDLE; k++) {
+        uint16_t low = (below > 0U) ? (uint16_t)(median - filter->sorted[below - 1U]) : UINT16_MAX;
+        uint16_t high = (above < HAMPEL_WINDOW) ? (uint16_t)(filter->sorted[above] - median) : UINT16_MAX;
+        if (low <= high) {
+            deviation = low;
+            below--;
+        } else {
+            deviation = high;
+            above++;
+        }
+    }
+    return deviation;
+}
+
+void hampel_init(hampel_t *filter, uint16_t floor) {
+    (void)memset(filter, 0, sizeof(*filter));
+    filter->floor = floor;
+}
+
+uint8_t hampel_add(hampel_t *filter, uint16_t value) {
+    uint8_t outlier = 0U;
+
+    if (filter->count < HAMPEL_WINDOW) {
+        filter->window[filter->count] = value;
+        filter->count++;
+        sorted_place(filter, (uint8_t)(filter->count - 1U), value);
+        return 0U;
+    }
+
+    uint16_t median = filter->sorted[MIDDLE];
+    uint32_t deviation = (value > median) ? (uint32_t)(value - median) : (uint32_t)(median - value);
+    uint32_t limit = (uint32_t)mad(filter, median) * HAMPEL_THRESHOLD;
+    if (limit < ((uint32_t)filter->floor * 1000U)) {
+        limit = (uint32_t)filter->floor * 1000U;
+    }
+    filter->checked++;
+    if ((deviation * 1000U) > limit) {
+        filter->rejected++;
+        outlier = 1U;
+    }
+
+    // the new sample takes the place of the oldest one
+    sorted_place(filter, lower_bound(filter, filter->window[filter->oldest]), value);
+    filter->window[filter->oldest] = value;
+    filter->oldest = (uint8_t)((filter->oldest + 1U) % HAMPEL_WINDOW);
+    return outlier;
+}
+
+uint16_t hampel_median(const hampel_t *filter) {
+    return (filter->count == 0U) ? 0U : filter->sorted[(filter->count - 1U) / 2U];
+}
@@ -0,0 +1,44 @@
+#include "hrv.h"
+
+#include <string.h>
+
+void hrv_reset(hrv_t *hrv) {
+    (void)memset(hrv, 0, sizeof(*hrv));
+    stats_reset(&hrv->intervals);
+}
+
+void hrv_add(hrv_t *hrv, const beat_rr_t *rr) {
+    // a difference needs the interval just before, recorded here too
+    if ((rr->successive != 0U) && (hrv->intervals.count > 0U)) {
+        uint32_t diff = (rr->interval > hrv->previous) ? (uint32_t)(rr->interval - hrv->previous)
+                                                       : (uint32_t)(hrv->previous - rr->interval);
+        hrv->diffSquares += (uint64_t)diff * diff;
+        hrv->diffs++;
+        if (diff > HRV_NN50_MS) {
+            hrv->nn50++;
+        }
+    }
+    stats_add(&hrv->intervals, rr->interval, 1U);
+    hrv->previous = rr->interval;
+}
+
+uint16_t hrv_sdnn(const hrv_t *hrv) {
+    // the variance is in Q48.16, its root in Q.8
+    return (uint16_t)((stats_isqrt(stats_variance(&hrv->intervals)) + (STATS_ONE / 2U)) >> STATS_FRACTION_BITS);
+}
+
+uint16_t hrv_rmssd(const hrv_t *hrv) {
+    if (hrv->diffs == 0U) {
+        return 0U;
+    }
+    // in Q.8 before rounding to the ms
+    uint64_t meanSquare = (hrv->diffSquares << (2U * STATS_FRACTION_BITS)) / hrv->diffs;
+    return (uint16_t)((stats_isqrt(meanSquare) + (STATS_ONE / 2U)) >> STATS_FRACTION_BITS);
+}
+
+uint16_t hrv_pnn50(const hrv_t *hrv) {
+    if (hrv->diffs == 0U) {
+        return 0U;
+    }
+    return (uint16_t)((((uint64_t)hrv->nn50 * 1000U) + (hrv->diffs / 2U)) / hrv->diffs);
+}
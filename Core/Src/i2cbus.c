@@ -0,0 +1,55 @@
+#include "i2cbus.h"
+
+#include "i2crec.h"
+#include "trace.h"
+#include "usclock.h"
+
+HAL_StatusTypeDef i2cbus_master_transmit(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data,
+                                         uint16_t size, uint32_t timeout) {
+    uint32_t start = usclock_now();
+    trace_record(TRACE_I2C_BEGIN, (uint8_t)address, size);
+    HAL_StatusTypeDef status = HAL_I2C_Master_Transmit(hi2c, address, data, size, timeout);
+    trace_record(TRACE_I2C_END, (uint8_t)address, (uint16_t)status);
+    i2crec_record(I2CREC_TRANSMIT, address, 0U, 0U, status, data, size, start);
+    return status;
+}
+
+HAL_StatusTypeDef i2cbus_master_receive(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data,
+                                        uint16_t size, uint32_t timeout) {
+    uint32_t start = usclock_now();
+    trace_record(TRACE_I2C_BEGIN, (uint8_t)address, size);
+    HAL_StatusTypeDef status = HAL_I2C_Master_Receive(hi2c, address, data, size, timeout);
+    trace_record(TRACE_I2C_END, (uint8_t)address, (uint16_t)status);
+    i2crec_record(I2CREC_RECEIVE, address, 0U, 0U, status, data, size, start);
+    return status;
+}
+
+HAL_StatusTypeDef i2cbus_mem_write(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                   uint16_t memAddressSize, uint8_t *data, uint16_t size, uint32_t timeout) {
+    uint32_t start = usclock_now();
+    trace_record(TRACE_I2C_BEGIN, (uint8_t)address, size);
+    HAL_StatusTypeDef status = HAL_I2C_Mem_Write(hi2c, address, memAddress, memAddressSize, data, size, timeout);
+    trace_record(TRACE_I2C_END, (uint8_t)address, (uint16_t)status);
+    i2crec_record(I2CREC_MEM_WRITE, address, memAddress, memAddressSize, status, data, size, start);
+    return status;
+}
+
+HAL_StatusTypeDef i2cbus_mem_read(I2C_HandleTypeDef *hi2c, uint16_t address, uint16_t memAddress,
+                                  uint16_t memAddressSize, uint8_t *data, uint16_t size, uint32_t timeout) {
+    uint32_t start = usclock_now();
+    trace_record(TRACE_I2C_BEGIN, (uint8_t)address, size);
+    HAL_StatusTypeDef status = HAL_I2C_Mem_Read(hi2c, address, memAddress, memAddressSize, data, size, timeout);
+    trace_record(TRACE_I2C_END, (uint8_t)address, (uint16_t)status);
+    i2crec_record(I2CREC_MEM_READ, address, memAddress, memAddressSize, status, data, size, start);
+    return status;
+}
+
+HAL_StatusTypeDef i2cbus_is_device_ready(I2C_HandleTypeDef *hi2c, uint16_t address, uint32_t trials,
+                                         uint32_t timeout) {
+    uint32_t start = usclock_now();
+    trace_record(TRACE_I2C_BEGIN, (uint8_t)address, 0U);
+    HAL_StatusTypeDef status = HAL_I2C_IsDeviceReady(hi2c, address, trials, timeout);
+    trace_record(TRACE_I2C_END, (uint8_t)address, (uint16_t)status);
+    i2crec_record(I2CREC_READY, address, 0U, 0U, status, NULL, 0U, start);
+    return status;
+}
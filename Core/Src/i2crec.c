@@ -0,0 +1,148 @@
+#include "i2crec.h"
+
+#if I2CREC_ENABLED
+
+#include <string.h>
+
+#include "strfmt.h"
+#include "usart.h"
+
+// bytes of data printed per UART transmission
+#define DUMP_CHUNK (32U)
+
+typedef struct i2crec_header {
+    uint32_t timestamp;
+    uint16_t memAddress;
+    uint16_t size;
+    uint8_t address;
+    uint8_t op;
+    uint8_t status;
+    uint8_t memAddressSize;
+} i2crec_header_t;
+
+static uint8_t ring[I2CREC_SIZE];
+static uint32_t head = 0U; // bytes written since boot, offset is head % I2CREC_SIZE
+static uint32_t tail = 0U; // start of the oldest transfer kept
+static uint32_t count = 0U;
+static uint32_t lost = 0U;
+static volatile uint8_t frozen = 0U;
+
+_Static_assert((I2CREC_SIZE & (I2CREC_SIZE - 1U)) == 0U, "I2CREC_SIZE must be a power of two");
+
+static void ring_write(uint32_t position, const uint8_t *src, uint32_t size) {
+    uint32_t offset = position & (I2CREC_SIZE - 1U);
+    uint32_t first = ((offset + size) > I2CREC_SIZE) ? (I2CREC_SIZE - offset) : size;
+    (void)memcpy(&ring[offset], src, first);
+    (void)memcpy(ring, &src[first], size - first);
+}
+
+static void ring_read(uint32_t position, uint8_t *dst, uint32_t size) {
+    uint32_t offset = position & (I2CREC_SIZE - 1U);
+    uint32_t first = ((offset + size) > I2CREC_SIZE) ? (I2CREC_SIZE - offset) : size;
+    (void)memcpy(dst, &ring[offset], first);
+    (void)memcpy(&dst[first], ring, size - first);
+}
+
+void i2crec_record(i2crec_op_t op, uint16_t address, uint16_t memAddress, uint16_t memAddressSize,
+                   HAL_StatusTypeDef status, const uint8_t *data, uint16_t size, uint32_t timestamp) {
+    i2crec_header_t header;
+    uint32_t needed = (uint32_t)sizeof(header) + size;
+
+    if (frozen != 0U) {
+        return;
+    }
+
+    header.timestamp = timestamp;
+    header.memAddress = memAddress;
+    header.size = size;
+    header.address = (uint8_t)address;
+    header.op = (uint8_t)op;
+    header.status = (uint8_t)status;
+    header.memAddressSize = (uint8_t)memAddressSize;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (needed > I2CREC_SIZE) {
+        // would not fit even in an empty ring
+        lost++;
+    } else {
+        while ((head - tail + needed) > I2CREC_SIZE) {
+            i2crec_header_t oldest;
+            ring_read(tail, (uint8_t *)&oldest, sizeof(oldest));
+            tail += (uint32_t)sizeof(oldest) + oldest.size;
+            count--;
+            lost++;
+        }
+        ring_write(head, (const uint8_t *)&header, sizeof(header));
+        ring_write(head + (uint32_t)sizeof(header), data, size);
+        head += needed;
+        count++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void i2crec_dump(void) {
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+
+    frozen = 1U;
+
+    str_clear(&line);
+    put_str(&line, "\r\ni2crec ");
+    put_uint32(&line, count);
+    put_char(&line, ' ');
+    put_uint32(&line, lost);
+    put_end(&line);
+    PRINT(line.buf);
+
+    uint32_t position = tail;
+    while (position != head) {
+        i2crec_header_t header;
+        ring_read(position, (uint8_t *)&header, sizeof(header));
+        position += (uint32_t)sizeof(header);
+
+        str_clear(&line);
+        put_str(&line, "\r\n");
+        put_uint32(&line, header.timestamp);
+        put_char(&line, ' ');
+        put_uint8(&line, header.op);
+        put_char(&line, ' ');
+        put_uint8(&line, header.address);
+        put_char(&line, ' ');
+        put_uint16(&line, header.memAddress);
+        put_char(&line, ' ');
+        put_uint8(&line, header.memAddressSize);
+        put_char(&line, ' ');
+        put_uint8(&line, header.status);
+        put_char(&line, ' ');
+        if (header.size == 0U) {
+            put_char(&line, '-');
+        }
+        put_end(&line);
+        PRINT(line.buf);
+
+        uint32_t remaining = header.size;
+        while (remaining > 0U) {
+            uint8_t chunk[DUMP_CHUNK];
+            uint32_t n = (remaining > DUMP_CHUNK) ? DUMP_CHUNK : remaining;
+            ring_read(position, chunk, n);
+            position += n;
+            remaining -= n;
+
+            str_clear(&line);
+            for (uint32_t i = 0U; i < n; i++) {
+                put_hex8(&line, chunk[i]);
+            }
+            put_end(&line);
+            PRINT(line.buf);
+        }
+    }
+
+    PRINT("\r\ni2crec end");
+
+    frozen = 0U;
+}
+
+#endif // I2CREC_ENABLED
@@ -22,6 +22,7 @@
 #include "dma.h"
 #include "gpio.h"
 #include "i2c.h"
+#include "rtc.h"
 #include "tim.h"
 #include "usart.h"
 
@@ -32,20 +33,65 @@
 
 #include "hal_utils.h"
 
+#include "console.h"
+#include "ds1307nv.h"
 #include "ds1307rtc.h"
+#include "acf.h"
+#include "alarm.h"
+#include "beat.h"
+#include "hampel.h"
+#include "hrv.h"
 #include "max32664.h"
+#include "motion.h"
+#include "power.h"
+#include "ppg.h"
+#include "prof.h"
+#include "resp.h"
+#include "sched.h"
+#include "spo2.h"
 #include "ssd1306.h"
+#include "stats.h"
 #include "strfmt.h"
+#include "sysclk.h"
+#include "tracker.h"
+#include "usclock.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
 /* USER CODE BEGIN PTD */
-
+typedef enum app_event {
+    EV_BUTTON = 0x01U, // user button pressed, EXTI
+    EV_SQW,            // DS1307 SQW falling edge, EXTI
+    EV_CONSOLE,        // console character received, USART2
+    EV_TIMEOUT,        // time in the current state elapsed, TIMER_SESSION
+    EV_SAMPLE,         // sensor hub read due, TIMER_SAMPLE
+    EV_LED,            // breathing LED step, TIMER_LED
+    EV_RTC_SYNC        // time base check due, TIMER_RTC
+} app_event_t;
+
+typedef enum app_timer {
+    TIMER_SESSION = 0x00U,
+    TIMER_SAMPLE,
+    TIMER_LED,
+    TIMER_RTC
+} app_timer_t;
+
+typedef void (*state_handler_t)(const sched_event_t *event);
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+#define SAMPLE_PERIOD 40U    // ms from the end of a sensor hub read to the next one
+#define RTC_POLL_PERIOD 500U // ms between two checks of the time base
+#define LED_STEPS 500U       // brightness steps of the breathing LED in a breath, up and down
+#define CI95_WIDTH 392U      // width of a 95% confidence interval in hundredths of standard error
+#define SAMPLE_BATCH 32U     // most samples taken from the sensor hub FIFO by one read
+#define REPORT_RATE 10U      // Hz, hub reports of a batch kept in the statistics
+#define LIVE_TOP 16U         // first row of the live readout, on a page boundary
+#define LIVE_LEFT 21U        // column of its values, after the labels
+#define LIVE_CHARS 12U       // longest value: "100.0 +-99.9"
+#define ALARM_TOP 48U        // row of the alarm line, on a page boundary
+#define ALARM_CHARS 14U      // longest alarm line: "Ox low Hr high"
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -56,29 +102,122 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-// state
+// state, only read and written by the event handlers
 static MachineState state = MS_IDLE;
 
-static uint32_t measureCount = 0;
-static uint32_t cicleCount = 0;
-
+static MAX32664_Handle pox;
+
+// good samples of the current measure
+static stats_t hrStats;
+static stats_t oxyStats;
+static stats_t confStats;
+static uint8_t converged = 0U;
+
+// outlier rejection, on the samples above the measurable minimums
+static hampel_t hrFilter;
+static hampel_t oxyFilter;
+
+// raw PPG of the hub FIFO, processed while waiting and measuring; the local
+// SpO2 is an estimate per beat, cross-checked with the one of the hub
+static bioData samples[SAMPLE_BATCH];
+static uint16_t sampleRate = 0U;
+static uint16_t reportPhase = 0U;
+static uint8_t ppgEnabled = 0U;
+static ppg_t ppgChain;
+static spo2_t localSpo2;
+static stats_t localSpo2Stats;
+// beat to beat intervals of the same PPG, HRV of the measure
+static beat_t beats;
+static hrv_t hrv;
+// heart rate by autocorrelation, stands in for the hub when it is unsure
+static acf_t pulseAcf;
+static uint32_t fallbacks = 0U;
+// breathing from the same PPG, perfusion index of the beats of the measure
+static resp_t breathing;
+static stats_t perfusionStats;
+// breathing pace of the exercise, 0.1 breaths/min
+static uint16_t pace = PACE_MAX;
+// hand motion from the accelerometer of the hub, when it has one: the hub
+// reports and the beats taken while moving are left out of the measure
+static motion_t motion;
+static uint8_t moving[SAMPLE_BATCH];
+static uint32_t motionsNoticed = 0U;
+static uint32_t motionSamples = 0U;
+static uint32_t motionBeats = 0U;
+// live readout of the measure, every hub report weighted by its confidence
+static tracker_t hrTrack;
+static tracker_t oxyTrack;
+static uint32_t liveUs = 0U;
+static uint8_t livePrint = 0U;
+// alarms on every report of the measure and of the exercise, latency from the
+// read that brought the sample to the end of its notification
+static alarm_t alarms;
+static uint32_t alarmNotices = 0U;
+static uint32_t alarmLatencyMax = 0U;
+
+// result of the last measure
 static MachineData average;
-static MachineData maximum;
-static MachineData minimum;
+static uint32_t measureStartUs = 0U;
+
+// intervals between two consecutive sensor hub reads during a measure
+static usclock_stats_t sampleStats;
 
-static uint8_t oled_written = 0;
 static strbuf msgBuf;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
+static void setState(MachineState next);
+static void dispatch(const sched_event_t *event);
+static void idleHandler(const sched_event_t *event);
+static void waitHandler(const sched_event_t *event);
+static void measureHandler(const sched_event_t *event);
+static void pauseHandler(const sched_event_t *event);
+static void exerciseHandler(const sched_event_t *event);
+static void startMeasure(void);
+static void localSpo2Init(void);
+static uint16_t exercisePace(void);
+static uint32_t ledStepPeriod(uint16_t rate);
+static uint8_t readSamples(void);
+static void measureSample(const bioData *poxData);
+static uint8_t reportWeight(const bioData *sample, uint8_t gated);
+static void trackSample(const bioData *sample, uint8_t gated);
+static void checkAlarms(const bioData *sample, uint8_t gated);
+static uint8_t notifyAlarms(void);
+static void drawAlarms(void);
+static void showLive(void);
+static void putTracked(strbuf *buffer, const tracker_t *tracker, uint16_t scale);
+static uint8_t intervalWithin(const stats_t *stats, uint32_t width);
+static uint32_t uncertainty(const stats_t *stats);
+static uint8_t accepted(void);
+static void report(void);
 static void putDate(strbuf *buffer, date_time_t dt);
+static void putTenths(strbuf *buffer, uint16_t value);
+static void reportExercise(void);
+static void storeSession(const date_time_t *dt, uint32_t resultMs);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
-static char buf[1] = {'\0'};
+// indexed by MachineState
+static const state_handler_t stateHandlers[] = {
+    idleHandler, waitHandler, measureHandler, pauseHandler, pauseHandler, exerciseHandler,
+};
+
+// indexed by alarm_channel_id_t
+static const alarm_rule_t alarmRules[ALARM_CHANNELS] = {
+    {.threshold = LOW_OXY_THRES,
+     .hysteresis = ALARM_OXY_HYST,
+     .above = 0U,
+     .minConfidence = ALARM_CONFIDENCE,
+     .minDurationMs = ALARM_MIN_DURATION},
+    {.threshold = HIGH_HR_THRES,
+     .hysteresis = ALARM_HR_HYST,
+     .above = 1U,
+     .minConfidence = ALARM_CONFIDENCE,
+     .minDurationMs = ALARM_MIN_DURATION},
+};
 /* USER CODE END 0 */
 
 /**
@@ -87,9 +226,7 @@ static char buf[1] = {'\0'};
  */
 int main(void) {
     /* USER CODE BEGIN 1 */
-    static MAX32664_Handle pox;
 
-    uint8_t flag_finger_on_p = 0;
     /* USER CODE END 1 */
 
     /* MCU Configuration--------------------------------------------------------*/
@@ -115,111 +252,114 @@ int main(void) {
     MX_I2C1_Init();
     MX_TIM2_Init();
     MX_USART2_UART_Init();
-    MX_TIM10_Init();
     MX_TIM3_Init();
+    MX_TIM5_Init();
+    MX_RTC_Init();
     /* USER CODE BEGIN 2 */
     PRINT((const char *)"\r\nSystem init...");
+    // the application runs on the low profile, see sysclk.h
+    sysclk_init();
+    prof_init();
+    // events posted while booting are executed once the sensor is ready
+    sched_init(dispatch);
+    console_start();
 
     (void)HAL_TIM_Base_Start_IT(&htim3);
-    (void)HAL_TIM_Base_Start_IT(&htim10);
+    usclock_start();
+    power_init();
 
     // devices creation
     GPIO_Line PC0 = {.port = GPIOC, .pin = GPIO_PIN_0};
     GPIO_Line PC1 = {.port = GPIOC, .pin = GPIO_PIN_1};
-    MAX32664_Init(&pox, &hi2c1, &PC0, &PC1, 0x55);
+    MAX32664_Init(&pox, &hi2c1, &PC0, &PC1, WRITE_ADDRESS);
+
+    // reset cause: the sensor hub keeps its configuration unless power was lost
+    uint8_t warmStart = ((__HAL_RCC_GET_FLAG(RCC_FLAG_PORRST) == 0U) && (__HAL_RCC_GET_FLAG(RCC_FLAG_BORRST) == 0U)) ? 1U : 0U;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
 
     // devices init/start
     ssd1306_Init();
     (void)ds1307rtc_init();
-    (void)MAX32664_Begin(&pox);
-
-    date_time_t dt = {.year = 23, .month = 6, .date = 12, .hours = 8, .minutes = 21, .seconds = 0};
-    (void)ds1307rtc_set_date_time(&dt);
+    (void)ds1307nv_load();
+
+    uint32_t bootCount = 0U;
+    (void)ds1307nv_get(NV_BOOT_COUNT, &bootCount, sizeof(bootCount));
+    bootCount += 1U;
+    (void)ds1307nv_set(NV_BOOT_COUNT, &bootCount, sizeof(bootCount));
+
+    // the clock is set only once, then it runs on the backup battery
+    uint8_t clockSet = 0U;
+    if ((ds1307nv_get(NV_CLOCK_SET, &clockSet, sizeof(clockSet)) != DS1307_OK) || (clockSet != NV_CLOCK_SET_MARKER)) {
+        date_time_t dt = {.year = 23, .month = 6, .date = 12, .hours = 8, .minutes = 21, .seconds = 0};
+        if (ds1307rtc_set_date_time(&dt) == DS1307_OK) {
+            clockSet = NV_CLOCK_SET_MARKER;
+            (void)ds1307nv_set(NV_CLOCK_SET, &clockSet, sizeof(clockSet));
+        }
+    }
+    // seconds boundaries come from the SQW line, sub-second time from the tick
+    (void)ds1307rtc_enable_sqw(1U);
 
     date_time_t test;
-    (void)ds1307rtc_get_date_time(&test);
+    ds1307rtc_now(&test, NULL);
     str_clear(&msgBuf);
     put_str(&msgBuf, "\r\nDatetime: ");
     putDate(&msgBuf, test);
+    put_str(&msgBuf, ", boot #");
+    put_uint32(&msgBuf, bootCount);
     put_end(&msgBuf);
     PRINT(msgBuf.buf);
 
-    // Configuring just the BPM settings.
-    uint8_t error = MAX32664_ConfigBpm(&pox, MODE_ONE);
+    // on a warm restart take over the running hub with the last-known-good configuration
+    nv_sensor_config_t sensorConfig;
+    uint8_t error = SB_ERR_UNKNOWN;
+    if ((warmStart != 0U) && (ds1307nv_get(NV_SENSOR_CONFIG, &sensorConfig, sizeof(sensorConfig)) == DS1307_OK) &&
+        (sensorConfig.outputMode == SENSOR_AND_ALGORITHM)) {
+        error = MAX32664_Resume(&pox, sensorConfig.mode, sensorConfig.outputMode, sensorConfig.sampleRate);
+    }
+
     if (error == (uint8_t)SB_SUCCESS) {
-        PRINT("\r\nSensor configured correctly");
+        PRINT("\r\nSensor resumed");
     } else {
-        str_clear(&msgBuf);
-        put_str(&msgBuf, "\r\nError during configuration with status code ");
-        put_uint8(&msgBuf, error);
-        PRINT(msgBuf.buf);
-    }
+        (void)MAX32664_Begin(&pox);
+
+        // before the sensor, so that every sample in the FIFO has the axes
+        if (MAX32664_ConfigAccel(&pox) == (uint8_t)SB_SUCCESS) {
+            PRINT("\r\nAccelerometer enabled");
+        }
+        // LED values for the local processing, with the algorithm report and its R
+        error = MAX32664_ConfigSensorBpm(&pox, MODE_TWO);
+        if (error == (uint8_t)SB_SUCCESS) {
+            PRINT("\r\nSensor configured correctly");
+            sensorConfig.mode = MODE_TWO;
+            sensorConfig.outputMode = SENSOR_AND_ALGORITHM;
+            sensorConfig.fifoThreshold = 0x01U;
+            sensorConfig.sampleRate = pox._sampleRate;
+            (void)ds1307nv_set(NV_SENSOR_CONFIG, &sensorConfig, sizeof(sensorConfig));
+        } else {
+            str_clear(&msgBuf);
+            put_str(&msgBuf, "\r\nError during configuration with status code ");
+            put_uint8(&msgBuf, error);
+            put_end(&msgBuf);
+            PRINT(msgBuf.buf);
+        }
 
-    PRINT("\r\nLoading sensor data...");
-    // Data lags a bit behind the sensor, if you're finger is on the sensor when
-    // it's being configured this delay will give some time for the data to catch
-    // up.
-    HAL_Delay(4000);
+        PRINT("\r\nLoading sensor data...");
+        // Data lags a bit behind the sensor, if you're finger is on the sensor when
+        // it's being configured this delay will give some time for the data to catch
+        // up.
+        HAL_Delay(4000);
+    }
+    localSpo2Init();
     PRINT("\r\nOk, sensor ready");
+    // idle until the button is pressed, see setState
+    power_allow_stop(1U);
+    sched_timer_start(TIMER_RTC, EV_RTC_SYNC, 0U, RTC_POLL_PERIOD);
     /* USER CODE END 2 */
 
     /* Infinite loop */
     /* USER CODE BEGIN WHILE */
-    while (1) {
-        switch (state) {
-        case MS_WAIT: {
-            bioData poxData = MAX32664_ReadBpm(&pox);
-            flag_finger_on_p = (poxData.status == 3U) ? 0xFFU : 0x00U;
-            if (flag_finger_on_p > 0x00U) {
-                ssd1306_Fill(Black);
-                ssd1306_SetCursor(0, 0);
-                (void)ssd1306_WriteCString("Measuring", Font_7x10, White);
-                ssd1306_UpdateScreen();
-                PRINT("\r\nOk, measuring");
-                state = MS_MEASURE;
-            }
-            break;
-        }
-        case MS_MEASURE: {
-            bioData poxData = MAX32664_ReadBpm(&pox);
-            if ((poxData.heartRate < MIN_MEASURABLE_HR) || (poxData.oxygen < MIN_MEASURABLE_OXY)) {
-                break;
-            }
-            average.oxygen += poxData.oxygen;
-            average.heartRate += poxData.heartRate;
-            average.confidence += poxData.confidence;
-
-            if (poxData.heartRate > maximum.heartRate) {
-                maximum.heartRate = poxData.heartRate;
-            }
-            if ((uint32_t)(poxData.heartRate) < minimum.heartRate) {
-                minimum.heartRate = poxData.heartRate;
-            }
-
-            if (poxData.oxygen > maximum.oxygen) {
-                maximum.oxygen = poxData.oxygen;
-            }
-            if (poxData.oxygen < minimum.oxygen) {
-                minimum.oxygen = poxData.oxygen;
-            }
-
-            if (poxData.confidence > maximum.confidence) {
-                maximum.confidence = poxData.confidence;
-            }
-            if (poxData.confidence < minimum.confidence) {
-                minimum.confidence = poxData.confidence;
-            }
-
-            measureCount += 1U;
-            break;
-        }
-        default:
-            break;
-        }
-
-        // pox sensor delay
-        HAL_Delay(40);
-    }
+    // every task runs from the event handlers, sched_run never returns
+    sched_run();
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
@@ -243,9 +383,10 @@ void SystemClock_Config(void) {
     /** Initializes the RCC Oscillators according to the specified parameters
      * in the RCC_OscInitTypeDef structure.
      */
-    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI | RCC_OSCILLATORTYPE_LSI;
     RCC_OscInitStruct.HSIState = RCC_HSI_ON;
     RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.LSIState = RCC_LSI_ON;
     RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
     if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK) {
         Error_Handler();
@@ -265,6 +406,502 @@ void SystemClock_Config(void) {
 }
 
 /* USER CODE BEGIN 4 */
+static void setState(MachineState next) {
+    trace_record(TRACE_STATE, (uint8_t)next, (uint16_t)state);
+    state = next;
+    // the breathing LED is a PWM output, stopped with the clocks; the sample
+    // intervals of a measure would include the STOP wake-up latency
+    power_allow_stop(((next != MS_MEASURE) && (next != MS_EXERCISE)) ? 1U : 0U);
+
+    // the sensor hub is read while waiting for the finger, while measuring and
+    // while exercising, the other states last a fixed time
+    switch (next) {
+    case MS_WAIT:
+        // the FIFO was not read since the last measure: start the chain over
+        ppgEnabled = (ppg_init(&ppgChain, sampleRate) == HAL_OK) ? 1U : 0U;
+        beat_init(&beats);
+        acf_init(&pulseAcf);
+        resp_init(&breathing);
+        motion_init(&motion, sampleRate);
+        sched_timer_stop(TIMER_SESSION);
+        sched_timer_stop(TIMER_LED);
+        sched_timer_start(TIMER_SAMPLE, EV_SAMPLE, 0U, 0U);
+        break;
+    case MS_MEASURE:
+        sched_timer_start(TIMER_SESSION, EV_TIMEOUT, MAX_MEASURE_TIME * 1000U, 0U);
+        break;
+    case MS_END:
+    case MS_ERROR:
+        sched_timer_stop(TIMER_SAMPLE);
+        sched_timer_start(TIMER_SESSION, EV_TIMEOUT, PAUSE_TIME * 1000U, 0U);
+        break;
+    case MS_EXERCISE:
+        // still sampled: the pace follows the breathing
+        pace = exercisePace();
+        sched_timer_start(TIMER_SAMPLE, EV_SAMPLE, SAMPLE_PERIOD, 0U);
+        sched_timer_start(TIMER_SESSION, EV_TIMEOUT, EXERCISE_TIME * 1000U, 0U);
+        sched_timer_start(TIMER_LED, EV_LED, ledStepPeriod(pace), ledStepPeriod(pace));
+        break;
+    default:
+        sched_timer_stop(TIMER_SAMPLE);
+        sched_timer_stop(TIMER_SESSION);
+        break;
+    }
+}
+
+static void dispatch(const sched_event_t *event) {
+    PROF_BEGIN(PROF_DISPATCH);
+    switch (event->type) {
+    case EV_SQW:
+    case EV_RTC_SYNC:
+        ds1307rtc_poll();
+        break;
+    case EV_CONSOLE:
+        console_poll();
+        break;
+    default:
+        stateHandlers[state](event);
+        break;
+    }
+    PROF_END(PROF_DISPATCH);
+}
+
+static void idleHandler(const sched_event_t *event) {
+    if (event->type == EV_BUTTON) {
+        USART_PRINT("\r\nDevice is on");
+        setState(MS_WAIT);
+        ssd1306_Fill(Black);
+        (void)ssd1306_WriteCString("Put finger", Font_7x10, White);
+        ssd1306_SetCursor(0, 15);
+        (void)ssd1306_WriteCString("on sensors", Font_7x10, White);
+        ssd1306_UpdateScreen();
+    }
+}
+
+static void waitHandler(const sched_event_t *event) {
+    if (event->type == EV_SAMPLE) {
+        uint8_t count = readSamples();
+        sched_timer_start(TIMER_SAMPLE, EV_SAMPLE, SAMPLE_PERIOD, 0U);
+        if ((count != 0U) && (samples[count - 1U].status == 3U)) {
+            // the live readout fills the values in
+            ssd1306_Fill(Black);
+            ssd1306_SetCursor(0, 0);
+            (void)ssd1306_WriteCString("Measuring", Font_7x10, White);
+            ssd1306_SetCursor(0, LIVE_TOP);
+            (void)ssd1306_WriteCString("Hr", Font_7x10, White);
+            ssd1306_SetCursor(0, LIVE_TOP + Font_7x10.FontHeight);
+            (void)ssd1306_WriteCString("Ox", Font_7x10, White);
+            ssd1306_SetCursor(0, 0);
+            ssd1306_UpdateScreen();
+            PRINT("\r\nOk, measuring");
+            startMeasure();
+            setState(MS_MEASURE);
+        }
+    }
+}
+
+static void measureHandler(const sched_event_t *event) {
+    if (event->type == EV_TIMEOUT) {
+        report();
+        return;
+    }
+    if (event->type != EV_SAMPLE) {
+        return;
+    }
+
+    uint8_t count = readSamples();
+    sched_timer_start(TIMER_SAMPLE, EV_SAMPLE, SAMPLE_PERIOD, 0U);
+    if (count == 0U) {
+        return;
+    }
+    usclock_stats_add(&sampleStats, samples[count - 1U].timestamp);
+    if (motion.motions != motionsNoticed) {
+        motionsNoticed = motion.motions;
+        PRINT("\r\nMotion, hold still");
+    }
+    // consecutive reports are averaged over the same seconds of signal: the
+    // statistics take them at REPORT_RATE, whatever the read period
+    uint16_t decimation = ((sampleRate / REPORT_RATE) > 0U) ? (sampleRate / REPORT_RATE) : 1U;
+    for (uint8_t i = 0U; (i < count) && (state == MS_MEASURE); i++) {
+        trackSample(&samples[i], moving[i]);
+        checkAlarms(&samples[i], moving[i]);
+        reportPhase++;
+        if (reportPhase >= decimation) {
+            reportPhase = 0U;
+            if (moving[i] != 0U) {
+                motionSamples++;
+                trace_record(TRACE_SAMPLE, 0U, samples[i].heartRate);
+            } else {
+                measureSample(&samples[i]);
+            }
+        }
+    }
+    // an alarm goes out first, the live readout waits for the next read
+    if ((notifyAlarms() == 0U) && (state == MS_MEASURE)) {
+        showLive();
+    }
+}
+
+/* Adds a hub report to the measure, reports the result once it converged */
+static void measureSample(const bioData *sample) {
+    bioData poxData = *sample;
+
+    // the hub is unsure: the period of the pulse wave, if it is clearer
+    if ((poxData.confidence < FALLBACK_CONFIDENCE) && (pulseAcf.heartRate != 0U) &&
+        (pulseAcf.periodicity >= FALLBACK_CONFIDENCE)) {
+        poxData.heartRate = pulseAcf.heartRate;
+        poxData.confidence = pulseAcf.periodicity;
+        fallbacks++;
+    }
+    if ((poxData.heartRate < MIN_MEASURABLE_HR) || (poxData.oxygen < MIN_MEASURABLE_OXY)) {
+        trace_record(TRACE_SAMPLE, 0U, poxData.heartRate);
+        return;
+    }
+    // both windows see every sample, an outlier on either channel drops it
+    uint8_t outlier = hampel_add(&hrFilter, poxData.heartRate);
+    outlier |= hampel_add(&oxyFilter, poxData.oxygen);
+    if (outlier != 0U) {
+        trace_record(TRACE_SAMPLE, 0U, poxData.heartRate);
+        return;
+    }
+    // readings the hub is more confident in weigh more in the result
+    PROF_BEGIN(PROF_STATS);
+    stats_add(&hrStats, poxData.heartRate, poxData.confidence);
+    stats_add(&oxyStats, poxData.oxygen, poxData.confidence);
+    stats_add(&confStats, poxData.confidence, 1U);
+    PROF_END(PROF_STATS);
+    trace_record(TRACE_SAMPLE, 1U, poxData.heartRate);
+
+    // stable readings: no need to wait for MAX_MEASURE_TIME
+    if ((hrStats.count >= CONVERGE_MIN_MEASURES) && (intervalWithin(&hrStats, CONVERGE_HR_WIDTH) != 0U) &&
+        (intervalWithin(&oxyStats, CONVERGE_OXY_WIDTH) != 0U)) {
+        converged = 1U;
+        report();
+    }
+}
+
+/* Confidence of a hub report, 0 when it is gated on motion or not measurable */
+static uint8_t reportWeight(const bioData *sample, uint8_t gated) {
+    if ((gated != 0U) || (sample->heartRate < MIN_MEASURABLE_HR) || (sample->oxygen < MIN_MEASURABLE_OXY)) {
+        return 0U;
+    }
+    return sample->confidence;
+}
+
+/* Moves the live readout, a report without confidence only ages it */
+static void trackSample(const bioData *sample, uint8_t gated) {
+    uint8_t weight = reportWeight(sample, gated);
+
+    (void)tracker_add(&hrTrack, sample->heartRate, weight);
+    (void)tracker_add(&oxyTrack, sample->oxygen, weight);
+}
+
+/* Evaluates the alarms on a hub report, the changes are queued */
+static void checkAlarms(const bioData *sample, uint8_t gated) {
+    uint8_t weight = reportWeight(sample, gated);
+
+    (void)alarm_add(&alarms, (uint8_t)ALARM_LOW_OXY, sample->oxygen, weight, sample->timestamp);
+    (void)alarm_add(&alarms, (uint8_t)ALARM_HIGH_HR, sample->heartRate, weight, sample->timestamp);
+}
+
+/*
+ * Notifies the queued alarm changes, fastest output first: the ERROR LED, the
+ * alarm line of the display, then a console line per change. Returns 1 if
+ * there was any.
+ */
+static uint8_t notifyAlarms(void) {
+    alarm_event_t events[ALARM_QUEUE_SIZE];
+    uint8_t count = 0U;
+
+    while ((count < ALARM_QUEUE_SIZE) && (alarm_pop(&alarms, &events[count]) != 0U)) {
+        count++;
+    }
+    if (count == 0U) {
+        return 0U;
+    }
+    uint8_t on = alarm_active(&alarms, (uint8_t)ALARM_LOW_OXY) | alarm_active(&alarms, (uint8_t)ALARM_HIGH_HR);
+    HAL_GPIO_WritePin(ERROR_GPIO_Port, ERROR_Pin, ((on != 0U) || (state == MS_ERROR)) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    drawAlarms();
+    ssd1306_UpdateArea(0U, ALARM_TOP, ALARM_CHARS * Font_7x10.FontWidth, Font_7x10.FontHeight);
+
+    for (uint8_t i = 0U; i < count; i++) {
+        str_clear(&msgBuf);
+        put_str(&msgBuf, (events[i].raised != 0U) ? "\r\nAlarm: " : "\r\nAlarm cleared: ");
+        if (events[i].channel == (uint8_t)ALARM_LOW_OXY) {
+            put_str(&msgBuf, "Ox ");
+            put_uint16(&msgBuf, events[i].value);
+            put_str(&msgBuf, " %");
+        } else {
+            put_str(&msgBuf, "Hr ");
+            putTenths(&msgBuf, events[i].value);
+            put_str(&msgBuf, " bpm");
+        }
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+    }
+
+    uint32_t now = usclock_now();
+    for (uint8_t i = 0U; i < count; i++) {
+        uint32_t latency = now - events[i].timestamp;
+        alarmLatencyMax = (latency > alarmLatencyMax) ? latency : alarmLatencyMax;
+        alarmNotices++;
+        trace_record(TRACE_ALARM, (uint8_t)(events[i].channel | (uint8_t)(events[i].raised << 7U)),
+                     (latency > UINT16_MAX) ? UINT16_MAX : (uint16_t)latency);
+    }
+    return 1U;
+}
+
+/* Draws the raised alarms on their line, in the frame buffer only */
+static void drawAlarms(void) {
+    char tmpStr[ALARM_CHARS + 1U];
+    strbuf tmp = mkbuf(tmpStr);
+
+    ssd1306_FillRectangle(0U, ALARM_TOP, (ALARM_CHARS * Font_7x10.FontWidth) - 1U,
+                          ALARM_TOP + Font_7x10.FontHeight - 1U, Black);
+    str_clear(&tmp);
+    if (alarm_active(&alarms, (uint8_t)ALARM_LOW_OXY) != 0U) {
+        put_str(&tmp, "Ox low ");
+    }
+    if (alarm_active(&alarms, (uint8_t)ALARM_HIGH_HR) != 0U) {
+        put_str(&tmp, "Hr high");
+    }
+    put_end(&tmp);
+    ssd1306_SetCursor(0U, ALARM_TOP);
+    (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+    ssd1306_SetCursor(0U, 0U);
+}
+
+/*
+ * Live readout every LIVE_PERIOD, once the hub reported: the display after a
+ * read and the console after the next one, each within SAMPLE_PERIOD
+ */
+static void showLive(void) {
+    char tmpStr[30];
+    strbuf tmp = mkbuf(tmpStr);
+
+    if (livePrint != 0U) {
+        livePrint = 0U;
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nLive: Hr ");
+        putTracked(&msgBuf, &hrTrack, 1U);
+        put_str(&msgBuf, ", Ox ");
+        putTracked(&msgBuf, &oxyTrack, 10U);
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+        return;
+    }
+    if ((usclock_now() - liveUs) < (LIVE_PERIOD * 1000U)) {
+        return;
+    }
+    liveUs = usclock_now();
+    if ((hrTrack.primed == 0U) || (oxyTrack.primed == 0U)) {
+        return;
+    }
+    // only the values are drawn and sent, the labels are on screen since the measure started
+    ssd1306_FillRectangle(LIVE_LEFT, LIVE_TOP, LIVE_LEFT + (LIVE_CHARS * Font_7x10.FontWidth) - 1U,
+                          LIVE_TOP + (2U * Font_7x10.FontHeight) - 1U, Black);
+    ssd1306_SetCursor(LIVE_LEFT, LIVE_TOP);
+    str_clear(&tmp);
+    putTracked(&tmp, &hrTrack, 1U);
+    put_end(&tmp);
+    (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+    ssd1306_SetCursor(LIVE_LEFT, LIVE_TOP + Font_7x10.FontHeight);
+    str_clear(&tmp);
+    putTracked(&tmp, &oxyTrack, 10U);
+    put_end(&tmp);
+    (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+    ssd1306_SetCursor(0, 0);
+    ssd1306_UpdateArea(LIVE_LEFT, LIVE_TOP, LIVE_CHARS * Font_7x10.FontWidth, 2U * Font_7x10.FontHeight);
+    livePrint = 1U;
+}
+
+/* MS_END and MS_ERROR: the result stays on screen for PAUSE_TIME */
+static void pauseHandler(const sched_event_t *event) {
+    if (event->type == EV_TIMEOUT) {
+        HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_RESET);
+        ssd1306_Fill(Black);
+        ssd1306_SetCursor(0, 0);
+        (void)ssd1306_WriteCString("Put finger", Font_7x10, White);
+        ssd1306_SetCursor(0, 15);
+        (void)ssd1306_WriteCString("on sensors", Font_7x10, White);
+        ssd1306_UpdateScreen();
+        setState(MS_WAIT);
+    }
+}
+
+static void exerciseHandler(const sched_event_t *event) {
+    static uint8_t led_dir = 0;
+    static uint32_t led_pulse = 0;
+
+    if (event->type == EV_TIMEOUT) {
+        (void)HAL_TIM_PWM_Stop(&htim2, TIM_CHANNEL_2);
+        // the alarms are evaluated again from the next measure
+        HAL_GPIO_WritePin(ERROR_GPIO_Port, ERROR_Pin, GPIO_PIN_RESET);
+        reportExercise();
+        setState(MS_WAIT);
+    } else if (event->type == EV_SAMPLE) {
+        uint8_t count = readSamples();
+        sched_timer_start(TIMER_SAMPLE, EV_SAMPLE, SAMPLE_PERIOD, 0U);
+        for (uint8_t i = 0U; i < count; i++) {
+            checkAlarms(&samples[i], moving[i]);
+        }
+        (void)notifyAlarms();
+        uint16_t next = exercisePace();
+        if (ledStepPeriod(next) != ledStepPeriod(pace)) {
+            sched_timer_start(TIMER_LED, EV_LED, ledStepPeriod(next), ledStepPeriod(next));
+        }
+        pace = next;
+    } else if (event->type == EV_LED) {
+        // breathing pace: the brightness ramps by 4/1000 every step, LED_STEPS a breath
+        if (led_dir == 0U) {
+            led_pulse += 4U;
+        } else {
+            led_pulse -= 4U;
+        }
+
+        if ((led_pulse == 0U) || (led_pulse >= 999U)) {
+            led_dir = (led_dir == 0U) ? 1U : 0U;
+        }
+        __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, led_pulse);
+    } else {
+        // other events are not used while exercising
+    }
+}
+
+/* Clears the statistics of the previous measure */
+static void startMeasure(void) {
+    stats_reset(&hrStats);
+    stats_reset(&oxyStats);
+    stats_reset(&confStats);
+    converged = 0U;
+    hampel_init(&hrFilter, OUTLIER_HR_FLOOR);
+    hampel_init(&oxyFilter, OUTLIER_OXY_FLOOR);
+    usclock_stats_reset(&sampleStats);
+    spo2_reset(&localSpo2);
+    stats_reset(&localSpo2Stats);
+    hrv_reset(&hrv);
+    fallbacks = 0U;
+    stats_reset(&perfusionStats);
+    motionsNoticed = motion.motions;
+    motionSamples = 0U;
+    motionBeats = 0U;
+    tracker_init(&hrTrack, TRACK_HR_DRIFT, TRACK_HR_NOISE);
+    tracker_init(&oxyTrack, TRACK_OXY_DRIFT, TRACK_OXY_NOISE);
+    liveUs = usclock_now();
+    livePrint = 0U;
+    alarm_init(&alarms, alarmRules, sampleRate);
+    alarmNotices = 0U;
+    alarmLatencyMax = 0U;
+    reportPhase = 0U;
+    measureStartUs = usclock_now();
+}
+
+/* Calibration of the local SpO2 and sample rate of the raw PPG, from the hub */
+static void localSpo2Init(void) {
+    int32_t coef[3] = {SPO2_DEFAULT_COEF_A, SPO2_DEFAULT_COEF_B, SPO2_DEFAULT_COEF_C};
+
+    // left untouched when the read fails
+    (void)MAX32664_ReadMaximFastCoef(&pox, coef);
+    spo2_init(&localSpo2, coef);
+    sampleRate = MAX32664_ReadSampleRate(&pox);
+}
+
+/* Pace of the exercise: slower than the measured breathing, PACE_MAX without */
+static uint16_t exercisePace(void) {
+    uint32_t target = ((uint32_t)resp_rate(&breathing) * PACE_PERCENT) / 100U;
+
+    if ((target == 0U) || (target > PACE_MAX)) {
+        return PACE_MAX;
+    }
+    return (target < PACE_MIN) ? PACE_MIN : (uint16_t)target;
+}
+
+/* Time between two steps of the breathing LED at a pace in 0.1 breaths/min, ms */
+static uint32_t ledStepPeriod(uint16_t rate) {
+    // a breath lasts 600000 / rate ms at a rate in 0.1 breaths/min
+    uint32_t perStep = 600000UL / LED_STEPS;
+    return (perStep + (rate / 2U)) / rate;
+}
+
+/* Empties the hub FIFO into samples, its raw PPG through the chain */
+static uint8_t readSamples(void) {
+    static ppg_raw_t raw[SAMPLE_BATCH];
+    static ppg_sample_t processed[SAMPLE_BATCH];
+    static uint8_t afterMotion = 0U;
+
+    uint8_t count = MAX32664_ReadSensorBpmSamples(&pox, samples, SAMPLE_BATCH);
+    if (count == 0U) {
+        return 0U;
+    }
+    // SAMPLE_BATCH bounds the arrays below, whatever the driver returns
+    if (count > SAMPLE_BATCH) {
+        count = SAMPLE_BATCH;
+    }
+    // the processed samples of a batch are gated together
+    uint8_t batchMoving = 0U;
+    if (pox._accelEnabled == 0U) {
+        (void)memset(moving, 0, count);
+    } else {
+        for (uint8_t i = 0U; i < count; i++) {
+            moving[i] = motion_add(&motion, samples[i].accel);
+            batchMoving |= moving[i];
+        }
+    }
+    if (ppgEnabled == 0U) {
+        return count;
+    }
+
+    for (uint8_t i = 0U; i < count; i++) {
+        raw[i].ir = samples[i].irLed;
+        raw[i].red = samples[i].redLed;
+    }
+    uint16_t processedCount = ppg_process(&ppgChain, raw, count, processed);
+    for (uint16_t i = 0U; i < processedCount; i++) {
+        if ((spo2_add(&localSpo2, &processed[i]) != 0U) && (state == MS_MEASURE) && (batchMoving == 0U)) {
+            stats_add(&localSpo2Stats, localSpo2.spo2, 1U);
+        }
+        (void)beat_add(&beats, &processed[i]);
+        (void)acf_add(&pulseAcf, &processed[i]);
+        resp_add(&breathing, &processed[i]);
+    }
+    beat_rr_t rr;
+    while (beat_pop(&beats, &rr) != 0U) {
+        if (batchMoving != 0U) {
+            // the interval ends in the motion or its hold: no difference with the next one either
+            afterMotion = 1U;
+            motionBeats += (state == MS_MEASURE) ? 1U : 0U;
+            continue;
+        }
+        if (afterMotion != 0U) {
+            rr.successive = 0U;
+            afterMotion = 0U;
+        }
+        uint16_t perfusion = resp_add_beat(&breathing, &rr);
+        if (state == MS_MEASURE) {
+            hrv_add(&hrv, &rr);
+            stats_add(&perfusionStats, perfusion, 1U);
+        }
+    }
+    return count;
+}
+
+/* Whether the 95% confidence interval of the mean is at most width wide */
+static uint8_t intervalWithin(const stats_t *stats, uint32_t width) {
+    uint32_t stdError = stats_std_error_correlated(stats, (CONVERGE_WINDOW * REPORT_RATE) / 1000U);
+    return (((uint64_t)stdError * CI95_WIDTH) <= ((uint64_t)width * STATS_ONE * 100U)) ? 1U : 0U;
+}
+
+/* Half the range of the samples, permille of their mean */
+static uint32_t uncertainty(const stats_t *stats) {
+    uint32_t mean = stats_mean(stats);
+    return (mean == 0U) ? UINT32_MAX : ((((uint32_t)stats->max - stats->min) * 500U) / mean);
+}
+
+/* Enough good samples, or stable ones */
+static uint8_t accepted(void) {
+    return ((converged != 0U) || (hrStats.count >= OPT_MEASURES)) ? 1U : 0U;
+}
+
 static void putDate(strbuf *buffer, date_time_t dt) {
     put_uint8(buffer, dt.date);
     put_char(buffer, '/');
@@ -279,187 +916,338 @@ static void putDate(strbuf *buffer, date_time_t dt) {
     put_uint8(buffer, dt.seconds);
 }
 
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
-    if (htim == &htim10) {
-        static uint32_t timeCount = 0;
-        static uint8_t led_dir = 0;
-        static uint32_t led_pulse = 0;
+static void putTenths(strbuf *buffer, uint16_t value) {
+    put_uint16(buffer, value / 10U);
+    put_char(buffer, '.');
+    put_uint16(buffer, value % 10U);
+}
+
+/* Estimate and its standard deviation, in tenths of the unit once scaled */
+static void putTracked(strbuf *buffer, const tracker_t *tracker, uint16_t scale) {
+    putTenths(buffer, tracker_value(tracker, scale));
+    put_str(buffer, " +-");
+    putTenths(buffer, tracker_deviation(tracker, scale));
+}
 
-        if (state == MS_MEASURE) {
-            if (__EXPIRED(timeCount, MAX_MEASURE_TIME)) {
-                timeCount = 0U;
-                state = MS_END;
-                date_time_t curr = {0};
-                (void)ds1307rtc_get_date_time(&curr);
-                str_clear(&msgBuf);
-                put_str(&msgBuf, "\r\nReport [");
-                putDate(&msgBuf, curr);
-                put_str(&msgBuf, "]");
-                put_end(&msgBuf);
-                PRINT(msgBuf.buf);
-
-                str_clear(&msgBuf);
-                put_str(&msgBuf, "\r\nobtained ");
-                if (measureCount < OPT_MEASURES) {
-                    put_uint32(&msgBuf, measureCount);
-                    put_str(&msgBuf, "/");
-                    put_uint32(&msgBuf, OPT_MEASURES);
-                    put_str(&msgBuf, " good samples -> discard");
-                } else {
-                    put_str(&msgBuf, "\r\nobtained ");
-                    put_uint32(&msgBuf, measureCount);
-                    put_str(&msgBuf, "/");
-                    put_uint32(&msgBuf, OPT_MEASURES);
-                    put_str(&msgBuf, " good samples -> accept");
-                }
-                put_end(&msgBuf);
-                PRINT(msgBuf.buf);
-
-                if (measureCount < OPT_MEASURES) {
-                    state = MS_ERROR;
-                    HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-                    ssd1306_Fill(Black);
-                    ssd1306_SetCursor(0, 0);
-                    (void)ssd1306_WriteCString("Invalid measure", Font_7x10, White);
-                    ssd1306_SetCursor(0, 15);
-                    (void)ssd1306_WriteCString("Repeat", Font_7x10, White);
-                    ssd1306_SetCursor(0, 0);
-                    ssd1306_UpdateScreen();
-                } else {
-                    average.oxygen /= measureCount;
-                    average.heartRate /= measureCount;
-                    average.confidence /= measureCount;
-
-                    str_clear(&msgBuf);
-                    put_str(&msgBuf, "\r\nHr: ");
-                    put_uint32(&msgBuf, average.heartRate);
-                    put_str(&msgBuf, ", Ox: ");
-                    put_uint32(&msgBuf, average.oxygen);
-                    put_str(&msgBuf, ", Conf: ");
-                    put_uint32(&msgBuf, average.confidence);
-                    put_end(&msgBuf);
-                    PRINT(msgBuf.buf);
-
-                    // uncertainty computation
-                    MachineData unc;
-                    unc.heartRate = (maximum.heartRate - minimum.heartRate) / 2U;
-                    unc.oxygen = (maximum.oxygen - minimum.oxygen) / 2U;
-                    unc.heartRate = unc.heartRate / average.heartRate;
-                    unc.oxygen = unc.oxygen / average.oxygen;
-
-                    if ((unc.heartRate <= MIN_UNCERT_THRES) || (unc.oxygen <= MIN_UNCERT_THRES)) {
-                        state = MS_ERROR;
-                        HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
-                        ssd1306_Fill(Black);
-                        ssd1306_SetCursor(0, 0);
-                        (void)ssd1306_WriteCString("Invalid measure", Font_7x10, White);
-                        ssd1306_SetCursor(0, 15);
-                        (void)ssd1306_WriteCString("Repeat", Font_7x10, White);
-                        ssd1306_SetCursor(0, 0);
-                        ssd1306_UpdateScreen();
-                    } else if (average.heartRate > HIGH_HR_THRES) {
-                        state = MS_EXERCISE;
-                        PRINT("\r\nBreath exercise mode");
-                        ssd1306_Fill(Black);
-                        ssd1306_SetCursor(0, 0);
-                        (void)ssd1306_WriteCString("Exercise mode", Font_7x10, White);
-                        ssd1306_UpdateScreen();
-                        (void)HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2);
-                    } else {
-                        // write pox data
-                        char tmpStr[30];
-                        strbuf tmp = mkbuf(tmpStr);
-
-                        ssd1306_Fill(Black);
-                        ssd1306_SetCursor(0, 0);
-
-                        str_clear(&tmp);
-                        put_str(&tmp, "Hr: ");
-                        put_uint32(&tmp, average.heartRate);
-                        put_str(&tmp, " bpm");
-                        put_end(&tmp);
-                        (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
-                        ssd1306_SetCursor(0, 15);
-
-                        str_clear(&tmp);
-                        put_str(&tmp, "Ox: ");
-                        put_uint32(&tmp, average.oxygen);
-                        put_str(&tmp, " perc");
-                        put_end(&tmp);
-                        (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
-                        ssd1306_SetCursor(0, 30);
-
-                        str_clear(&tmp);
-                        put_str(&tmp, "Cf: ");
-                        put_uint32(&tmp, average.confidence);
-                        put_str(&tmp, " perc");
-                        put_end(&tmp);
-                        (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
-                        ssd1306_SetCursor(0, 0);
-                        ssd1306_UpdateScreen();
-                        state = MS_END;
-                    }
-                }
-            }
+static void storeSession(const date_time_t *dt, uint32_t resultMs) {
+    nv_session_t session = {0};
+    session.year = (uint8_t)dt->year;
+    session.month = dt->month;
+    session.date = dt->date;
+    session.hours = dt->hours;
+    session.minutes = dt->minutes;
+    session.seconds = dt->seconds;
+    session.samples = (hrStats.count > 0xFFFFU) ? 0xFFFFU : (uint16_t)hrStats.count;
+    session.resultMs = (uint16_t)resultMs;
+    session.outcome = (uint8_t)state;
+    // averages are only available for accepted sessions
+    if (accepted() != 0U) {
+        session.heartRate = (uint16_t)average.heartRate;
+        session.oxygen = (uint8_t)average.oxygen;
+        session.confidence = (uint8_t)average.confidence;
+    }
+    session.respiration = resp_rate(&breathing);
+    session.perfusion = stats_mean(&perfusionStats);
+    (void)ds1307nv_set(NV_SESSION, &session, sizeof(session));
+}
 
-            else {
-                timeCount++;
-            }
-        }
+/* End of the exercise: the breathing measured while pacing it, kept with the session */
+static void reportExercise(void) {
+    uint16_t breathRate = resp_rate(&breathing);
+    nv_session_t session;
 
-        else if (state == MS_EXERCISE) {
-            if (__EXPIRED(timeCount, EXERCISE_TIME)) {
-                timeCount = 0;
-                (void)HAL_TIM_PWM_Stop(&htim2, TIM_CHANNEL_2);
-                state = MS_WAIT;
-            } else {
-                if (led_dir == 0U) {
-                    led_pulse += 4U;
-                } else {
-                    led_pulse -= 4U;
-                }
-
-                if ((led_pulse == 0U) || (led_pulse >= 999U)) {
-                    led_dir = (led_dir == 0U) ? 1U : 0U;
-                }
-
-                __HAL_TIM_SET_COMPARE(&htim2, TIM_CHANNEL_2, led_pulse);
-                timeCount += 1U;
-            }
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nExercise done, breathing ");
+    if (breathRate != 0U) {
+        putTenths(&msgBuf, breathRate);
+        put_str(&msgBuf, " /min");
+    } else {
+        put_char(&msgBuf, '-');
+    }
+    put_str(&msgBuf, ", paced at ");
+    putTenths(&msgBuf, pace);
+    put_str(&msgBuf, " /min");
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    if ((breathRate != 0U) && (ds1307nv_get(NV_SESSION, &session, sizeof(session)) == DS1307_OK)) {
+        session.respiration = breathRate;
+        (void)ds1307nv_set(NV_SESSION, &session, sizeof(session));
+    }
+}
+
+/* End of the measure: prints and shows the result, then pauses */
+static void report(void) {
+    PROF_BEGIN(PROF_REPORT);
+    trace_record(TRACE_REPORT_BEGIN, 0U, (uint16_t)hrStats.count);
+    uint32_t resultMs = (usclock_now() - measureStartUs) / 1000U;
+    setState(MS_END);
+    date_time_t curr = {0};
+    ds1307rtc_now(&curr, NULL);
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nReport [");
+    putDate(&msgBuf, curr);
+    put_str(&msgBuf, "]");
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nobtained ");
+    put_uint32(&msgBuf, hrStats.count);
+    put_str(&msgBuf, "/");
+    put_uint32(&msgBuf, OPT_MEASURES);
+    if (accepted() == 0U) {
+        put_str(&msgBuf, " good samples -> discard");
+    } else {
+        put_str(&msgBuf, " good samples -> accept");
+        if (converged != 0U) {
+            put_str(&msgBuf, " (converged)");
         }
+    }
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
 
-        else if ((state == MS_ERROR) || (state == MS_END)) {
-            if (__EXPIRED(timeCount, PAUSE_TIME)) {
-                timeCount = 0;
-                HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_RESET);
-                ssd1306_Fill(Black);
-                ssd1306_SetCursor(0, 0);
-                (void)ssd1306_WriteCString("Put finger", Font_7x10, White);
-                ssd1306_SetCursor(0, 15);
-                (void)ssd1306_WriteCString("on sensors", Font_7x10, White);
-                ssd1306_UpdateScreen();
-                state = MS_WAIT;
-            }
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nOutliers rejected: hr ");
+    put_uint32(&msgBuf, hrFilter.rejected);
+    put_str(&msgBuf, ", ox ");
+    put_uint32(&msgBuf, oxyFilter.rejected);
+    put_str(&msgBuf, " of ");
+    put_uint32(&msgBuf, hrFilter.checked);
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nSample interval [us] min: ");
+    put_uint32(&msgBuf, (sampleStats.count > 0U) ? sampleStats.min : 0U);
+    put_str(&msgBuf, ", mean: ");
+    put_uint32(&msgBuf, usclock_stats_mean(&sampleStats));
+    put_str(&msgBuf, ", max: ");
+    put_uint32(&msgBuf, sampleStats.max);
+    put_str(&msgBuf, ", p99: ");
+    put_uint32(&msgBuf, usclock_stats_percentile(&sampleStats, 99U));
+    put_str(&msgBuf, " (");
+    put_uint32(&msgBuf, sampleStats.count);
+    put_str(&msgBuf, " intervals)");
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    if (localSpo2Stats.count > 0U) {
+        uint16_t local = stats_mean(&localSpo2Stats);
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nLocal SpO2: ");
+        put_uint16(&msgBuf, local / 10U);
+        put_char(&msgBuf, '.');
+        put_uint16(&msgBuf, local % 10U);
+        put_str(&msgBuf, " % over ");
+        put_uint32(&msgBuf, localSpo2Stats.count);
+        put_str(&msgBuf, " beats, hub ");
+        put_uint16(&msgBuf, stats_mean(&oxyStats));
+        put_str(&msgBuf, " %");
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+    }
+
+    if (pulseAcf.heartRate != 0U) {
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nACF Hr: ");
+        put_uint16(&msgBuf, pulseAcf.heartRate / 10U);
+        put_char(&msgBuf, '.');
+        put_uint16(&msgBuf, pulseAcf.heartRate % 10U);
+        put_str(&msgBuf, " bpm, periodicity ");
+        put_uint16(&msgBuf, pulseAcf.periodicity);
+        put_str(&msgBuf, " %, used for ");
+        put_uint32(&msgBuf, fallbacks);
+        put_str(&msgBuf, " samples");
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+    }
 
-            timeCount++;
+    str_clear(&msgBuf);
+    if (hrv.intervals.count < HRV_MIN_INTERVALS) {
+        put_str(&msgBuf, "\r\nHRV [ms]: -");
+    } else {
+        uint16_t pnn50 = hrv_pnn50(&hrv);
+        put_str(&msgBuf, "\r\nHRV [ms]: RMSSD ");
+        put_uint16(&msgBuf, hrv_rmssd(&hrv));
+        put_str(&msgBuf, ", SDNN ");
+        put_uint16(&msgBuf, hrv_sdnn(&hrv));
+        put_str(&msgBuf, ", pNN50 ");
+        put_uint16(&msgBuf, pnn50 / 10U);
+        put_char(&msgBuf, '.');
+        put_uint16(&msgBuf, pnn50 % 10U);
+        put_str(&msgBuf, " % over ");
+        put_uint32(&msgBuf, hrv.intervals.count);
+        put_str(&msgBuf, " intervals");
+    }
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    uint16_t breathRate = resp_rate(&breathing);
+    if ((breathRate != 0U) || (perfusionStats.count > 0U)) {
+        uint16_t perfusion = stats_mean(&perfusionStats);
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nRespiration: ");
+        if (breathRate != 0U) {
+            putTenths(&msgBuf, breathRate);
+            put_str(&msgBuf, " /min (wander ");
+            putTenths(&msgBuf, resp_channel_rate(&breathing.wander));
+            put_str(&msgBuf, ", amplitude ");
+            putTenths(&msgBuf, resp_channel_rate(&breathing.amplitude));
+            put_char(&msgBuf, ')');
         } else {
-            // do nothing
+            put_char(&msgBuf, '-');
         }
+        put_str(&msgBuf, ", PI ");
+        put_uint16(&msgBuf, perfusion / 100U);
+        put_char(&msgBuf, '.');
+        if ((perfusion % 100U) < 10U) {
+            put_char(&msgBuf, '0');
+        }
+        put_uint16(&msgBuf, perfusion % 100U);
+        put_str(&msgBuf, " %");
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
     }
-}
 
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
-    if (GPIO_Pin == GPIO_PIN_13) {
-        if (state == MS_IDLE) {
-            USART_PRINT("\r\nDevice is on");
-            state = MS_WAIT;
+    if (alarmNotices > 0U) {
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nAlarms: raised ");
+        put_uint32(&msgBuf, alarms.channels[ALARM_LOW_OXY].raised + alarms.channels[ALARM_HIGH_HR].raised);
+        put_str(&msgBuf, ", latency max ");
+        put_uint32(&msgBuf, alarmLatencyMax);
+        put_str(&msgBuf, " us");
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+    }
+
+    if (pox._accelEnabled != 0U) {
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nMotion: gated ");
+        put_uint32(&msgBuf, motionSamples);
+        put_str(&msgBuf, " samples, ");
+        put_uint32(&msgBuf, motionBeats);
+        put_str(&msgBuf, " beats");
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+    }
+
+    str_clear(&msgBuf);
+    put_str(&msgBuf, "\r\nTime to result: ");
+    put_uint32(&msgBuf, resultMs);
+    put_str(&msgBuf, " ms");
+    put_end(&msgBuf);
+    PRINT(msgBuf.buf);
+
+    if (accepted() == 0U) {
+        setState(MS_ERROR);
+        HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
+        ssd1306_Fill(Black);
+        ssd1306_SetCursor(0, 0);
+        (void)ssd1306_WriteCString("Invalid measure", Font_7x10, White);
+        ssd1306_SetCursor(0, 15);
+        (void)ssd1306_WriteCString("Repeat", Font_7x10, White);
+        ssd1306_SetCursor(0, 0);
+        ssd1306_UpdateScreen();
+    } else {
+        average.heartRate = stats_weighted_mean(&hrStats);
+        average.oxygen = stats_weighted_mean(&oxyStats);
+        average.confidence = stats_mean(&confStats);
+
+        str_clear(&msgBuf);
+        put_str(&msgBuf, "\r\nHr: ");
+        put_uint32(&msgBuf, average.heartRate / 10U);
+        put_str(&msgBuf, ", Ox: ");
+        put_uint32(&msgBuf, average.oxygen);
+        put_str(&msgBuf, ", Conf: ");
+        put_uint32(&msgBuf, average.confidence);
+        put_end(&msgBuf);
+        PRINT(msgBuf.buf);
+
+        if ((uncertainty(&hrStats) > MAX_UNCERT_THRES) || (uncertainty(&oxyStats) > MAX_UNCERT_THRES)) {
+            setState(MS_ERROR);
+            HAL_GPIO_WritePin(GPIOA, GPIO_PIN_7, GPIO_PIN_SET);
             ssd1306_Fill(Black);
-            (void)ssd1306_WriteCString("Put finger", Font_7x10, White);
+            ssd1306_SetCursor(0, 0);
+            (void)ssd1306_WriteCString("Invalid measure", Font_7x10, White);
             ssd1306_SetCursor(0, 15);
-            (void)ssd1306_WriteCString("on sensors", Font_7x10, White);
+            (void)ssd1306_WriteCString("Repeat", Font_7x10, White);
+            ssd1306_SetCursor(0, 0);
+            ssd1306_UpdateScreen();
+        } else if (average.heartRate > HIGH_HR_THRES) {
+            setState(MS_EXERCISE);
+            str_clear(&msgBuf);
+            put_str(&msgBuf, "\r\nBreath exercise mode, ");
+            putTenths(&msgBuf, pace);
+            put_str(&msgBuf, " breaths/min");
+            put_end(&msgBuf);
+            PRINT(msgBuf.buf);
+            ssd1306_Fill(Black);
+            ssd1306_SetCursor(0, 0);
+            (void)ssd1306_WriteCString("Exercise mode", Font_7x10, White);
+            // still evaluated while exercising
+            drawAlarms();
             ssd1306_UpdateScreen();
+            (void)HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_2);
+        } else {
+            // write pox data
+            char tmpStr[30];
+            strbuf tmp = mkbuf(tmpStr);
+
+            ssd1306_Fill(Black);
+            ssd1306_SetCursor(0, 0);
+
+            str_clear(&tmp);
+            put_str(&tmp, "Hr: ");
+            put_uint32(&tmp, average.heartRate / 10U);
+            put_str(&tmp, " bpm");
+            put_end(&tmp);
+            (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+            ssd1306_SetCursor(0, 15);
+
+            str_clear(&tmp);
+            put_str(&tmp, "Ox: ");
+            put_uint32(&tmp, average.oxygen);
+            put_str(&tmp, " perc");
+            put_end(&tmp);
+            (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+            ssd1306_SetCursor(0, 30);
+
+            str_clear(&tmp);
+            put_str(&tmp, "Cf: ");
+            put_uint32(&tmp, average.confidence);
+            put_str(&tmp, " perc");
+            put_end(&tmp);
+            (void)ssd1306_WriteString(tmp.buf, Font_7x10, White);
+            ssd1306_SetCursor(0, 0);
+            ssd1306_UpdateScreen();
+            setState(MS_END);
         }
     }
+
+    storeSession(&curr, resultMs);
+    trace_record(TRACE_REPORT_END, (uint8_t)state, (uint16_t)hrStats.count);
+    PROF_END(PROF_REPORT);
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    if (GPIO_Pin == SQW_Pin) {
+        ds1307rtc_sqw_edge();
+        (void)sched_post((uint8_t)EV_SQW, 0U);
+    }
+
+    if (GPIO_Pin == GPIO_PIN_13) {
+        (void)sched_post((uint8_t)EV_BUTTON, 0U);
+    }
+
+    if (GPIO_Pin == CONSOLE_WAKE_Pin) {
+        power_stay_awake(CONSOLE_AWAKE_TIME);
+    }
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+    console_rx_complete(huart);
+    (void)sched_post((uint8_t)EV_CONSOLE, 0U);
 }
 /* USER CODE END 4 */
 
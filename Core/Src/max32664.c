@@ -1,5 +1,9 @@
 #include "max32664.h"
+#include "i2cbus.h"
+#include "prof.h"
+#include "trace.h"
 #include "usart.h"
+#include "usclock.h"
 
 #include <stdlib.h>
 
@@ -9,6 +13,7 @@ void MAX32664_Init(MAX32664_Handle *handle, I2C_HandleTypeDef *hi2c, GPIO_Line *
     handle->_resetLine = resetLine;
     handle->_mfioLine = mfioLine;
     handle->_address = address;
+    handle->_accelEnabled = 0U;
 }
 
 // Family Byte: READ_DEVICE_MODE (0x02) Index Byte: 0x00, Write Byte: 0x00
@@ -56,6 +61,66 @@ uint8_t MAX32664_Begin(MAX32664_Handle *handle) {
     return responseByte;
 }
 
+// Family Bytes: READ_DEVICE_MODE (0x02), READ_OUTPUT_MODE (0x11), READ_SENSOR_MODE (0x45)
+// The following function takes over a sensor hub that kept running while the
+// host restarted: the reset line is driven high without pulsing it, and the
+// configuration is trusted only if the hub still reports it.
+uint8_t MAX32664_Resume(MAX32664_Handle *handle, uint8_t mode, uint8_t outputType, uint8_t sampleRate) {
+
+    if ((handle->hi2c == NULL) || (handle->_resetLine == NULL) || (handle->_mfioLine == NULL)) {
+        return SB_ERR_UNKNOWN;
+    }
+    if ((mode != MODE_ONE) && (mode != MODE_TWO)) {
+        return INCORR_PARAM;
+    }
+
+    GPIO_InitTypeDef conf = {0};
+    HAL_GPIO_WriteLine(handle->_resetLine, GPIO_PIN_SET);
+    conf.Pin = handle->_resetLine->pin;
+    conf.Mode = GPIO_MODE_OUTPUT_PP;
+    conf.Pull = GPIO_NOPULL;
+    conf.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(handle->_resetLine->port, &conf);
+
+    conf.Pin = handle->_mfioLine->pin;
+    conf.Mode = GPIO_MODE_INPUT;
+    conf.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(handle->_mfioLine->port, &conf);
+
+    uint8_t value;
+    uint8_t statusByte = MAX32664_ReadByte(handle, READ_DEVICE_MODE, 0x00, &value);
+    if (statusByte != SB_SUCCESS) {
+        return statusByte;
+    }
+    if (value != APP_MODE) {
+        return SB_ERR_MODE;
+    }
+
+    statusByte = MAX32664_ReadByte(handle, READ_OUTPUT_MODE, 0x00, &value); // Index 0x00: output format
+    if (statusByte != SB_SUCCESS) {
+        return statusByte;
+    }
+    if (value != outputType) {
+        return SB_ILLEGAL_CONF;
+    }
+
+    statusByte = MAX32664_ReadByte(handle, READ_SENSOR_MODE, READ_ENABLE_MAX30101, &value);
+    if (statusByte != SB_SUCCESS) {
+        return statusByte;
+    }
+    if (value != ENABLE) {
+        return SB_ILLEGAL_CONF;
+    }
+
+    // without an accelerometer the hub reports it disabled, or fails the read
+    statusByte = MAX32664_ReadByte(handle, READ_SENSOR_MODE, READ_ENABLE_ACCELEROMETER, &value);
+    handle->_accelEnabled = ((statusByte == SB_SUCCESS) && (value == ENABLE)) ? 1U : 0U;
+
+    handle->_userSelectedMode = mode;
+    handle->_sampleRate = sampleRate;
+    return SB_SUCCESS;
+}
+
 // Family Byte: READ_DEVICE_MODE (0x02) Index Byte: 0x00, Write Byte: 0x00
 // The following function puts the MAX32664 into bootloader mode. To place the MAX32664 into
 // bootloader mode, the MFIO pin must be pulled LOW while the board is held
@@ -210,7 +275,8 @@ uint8_t MAX32664_ConfigSensorBpm(MAX32664_Handle *handle, uint8_t mode) {
 // into the whrmFifo and returned.
 bioData MAX32664_ReadBpm(MAX32664_Handle *handle) {
 
-    bioData libBpm;
+    PROF_BEGIN(PROF_READ_BPM);
+    bioData libBpm = {0};
     uint8_t statusChauf; // The status chauffeur captures return values.
 
     statusChauf = MAX32664_ReadSensorHubStatus(handle);
@@ -219,20 +285,23 @@ bioData MAX32664_ReadBpm(MAX32664_Handle *handle) {
         libBpm.heartRate = 100;
         libBpm.confidence = 100;
         libBpm.oxygen = 100;
+        libBpm.timestamp = usclock_now();
+        PROF_END(PROF_READ_BPM);
         return libBpm;
     }
 
-    MAX32664_NumSamplesOutFifo(handle);
+    uint8_t samples = MAX32664_NumSamplesOutFifo(handle);
+    trace_record(TRACE_FIFO, 0U, samples);
 
     if (handle->_userSelectedMode == MODE_ONE) {
 
         MAX32664_ReadFillArray(handle, READ_DATA_OUTPUT, READ_DATA,
                                MAXFAST_ARRAY_SIZE, handle->bpmArr);
+        libBpm.timestamp = usclock_now();
 
         // Heart Rate formatting
         libBpm.heartRate = (uint16_t)(handle->bpmArr[0]) << 8;
         libBpm.heartRate |= (handle->bpmArr[1]);
-        libBpm.heartRate /= 10;
 
         // Confidence formatting
         libBpm.confidence = handle->bpmArr[2];
@@ -245,17 +314,19 @@ bioData MAX32664_ReadBpm(MAX32664_Handle *handle) {
         //"Machine State" - has a finger been detected?
         libBpm.status = handle->bpmArr[5];
 
+        PROF_END(PROF_READ_BPM);
+
         return libBpm;
     }
 
     else if (handle->_userSelectedMode == MODE_TWO) {
         MAX32664_ReadFillArray(handle, READ_DATA_OUTPUT, READ_DATA,
                                MAXFAST_ARRAY_SIZE + MAXFAST_EXTENDED_DATA, handle->bpmArrTwo);
+        libBpm.timestamp = usclock_now();
 
         // Heart Rate formatting
         libBpm.heartRate = (uint16_t)(handle->bpmArrTwo[0]) << 8;
         libBpm.heartRate |= (handle->bpmArrTwo[1]);
-        libBpm.heartRate /= 10;
 
         // Confidence formatting
         libBpm.confidence = handle->bpmArrTwo[2];
@@ -280,6 +351,7 @@ bioData MAX32664_ReadBpm(MAX32664_Handle *handle) {
         // There are two additional bytes of data that were requested but that
         // have not been implemented in firmware 10.1 so will not be saved to
         // user's data.
+        PROF_END(PROF_READ_BPM);
         return libBpm;
     }
 
@@ -287,6 +359,8 @@ bioData MAX32664_ReadBpm(MAX32664_Handle *handle) {
         libBpm.heartRate = 0;
         libBpm.confidence = 0;
         libBpm.oxygen = 0;
+        libBpm.timestamp = usclock_now();
+        PROF_END(PROF_READ_BPM);
         return libBpm;
     }
 }
@@ -346,7 +420,6 @@ bioData MAX32664_ReadSensorBpm(MAX32664_Handle *handle) {
         // Heart rate formatting
         libLedBpm.heartRate = ((uint16_t)(handle->bpmSenArr[12]) << 8);
         libLedBpm.heartRate |= (handle->bpmSenArr[13]);
-        libLedBpm.heartRate /= 10;
 
         // Confidence formatting
         libLedBpm.confidence = handle->bpmSenArr[14];
@@ -385,7 +458,6 @@ bioData MAX32664_ReadSensorBpm(MAX32664_Handle *handle) {
         // Heart rate formatting
         libLedBpm.heartRate = ((uint16_t)(handle->bpmSenArrTwo[12]) << 8);
         libLedBpm.heartRate |= (handle->bpmSenArrTwo[13]);
-        libLedBpm.heartRate /= 10;
 
         // Confidence formatting
         libLedBpm.confidence = handle->bpmSenArrTwo[14];
@@ -427,6 +499,79 @@ bioData MAX32664_ReadSensorBpm(MAX32664_Handle *handle) {
         return libLedBpm;
     }
 }
+// Decodes one sample of the SENSOR_AND_ALGORITHM output mode: the four LED
+// values, of which the last two are not fitted, then the algorithm report.
+static void MAX32664_DecodeSensorBpm(const uint8_t *raw, uint8_t mode, uint8_t accel, bioData *sample) {
+
+    sample->irLed = ((uint32_t)raw[0] << 16) | ((uint32_t)raw[1] << 8) | raw[2];
+    sample->redLed = ((uint32_t)raw[3] << 16) | ((uint32_t)raw[4] << 8) | raw[5];
+    raw += MAX30101_LED_ARRAY;
+    for (uint8_t axis = 0U; axis < 3U; axis++) {
+        sample->accel[axis] = (accel != 0U) ? (int16_t)(((uint16_t)raw[2U * axis] << 8) | raw[(2U * axis) + 1U]) : 0;
+    }
+    if (accel != 0U) {
+        raw += ACCEL_ARRAY;
+    }
+    sample->heartRate = (uint16_t)(((uint16_t)raw[0] << 8) | raw[1]);
+    sample->confidence = raw[2];
+    sample->oxygen = (uint16_t)((((uint16_t)raw[3] << 8) | raw[4]) / 10U);
+    sample->status = raw[5];
+    sample->rValue = 0.0f;
+    sample->extStatus = 0;
+    if (mode == MODE_TWO) {
+        sample->rValue = (float)(((uint16_t)raw[6] << 8) | raw[7]) / 10.0f;
+        sample->extStatus = (int8_t)raw[8];
+    }
+}
+
+// Family Byte: READ_DATA_OUTPUT (0x12), Index Bytes: NUM_SAMPLES (0x00), READ_DATA (0x01)
+// This function empties the FIFO in the SENSOR_AND_ALGORITHM output mode, up
+// to maxSamples samples, oldest first, in as many transfers as the read
+// buffer needs. Every sample is timestamped with the end of the last transfer.
+uint8_t MAX32664_ReadSensorBpmSamples(MAX32664_Handle *handle, bioData samples[], uint8_t maxSamples) {
+
+    PROF_BEGIN(PROF_READ_BPM);
+    uint8_t mode = handle->_userSelectedMode;
+    if ((mode != MODE_ONE) && (mode != MODE_TWO)) {
+        PROF_END(PROF_READ_BPM);
+        return 0U;
+    }
+    if (MAX32664_ReadSensorHubStatus(handle) == 1U) { // Communication Error
+        PROF_END(PROF_READ_BPM);
+        return 0U;
+    }
+
+    uint8_t available = MAX32664_NumSamplesOutFifo(handle);
+    trace_record(TRACE_FIFO, 0U, available);
+    if (available > maxSamples) {
+        available = maxSamples;
+    }
+
+    uint8_t sampleSize = MAX30101_LED_ARRAY + MAXFAST_ARRAY_SIZE + ((mode == MODE_TWO) ? MAXFAST_EXTENDED_DATA : 0U) +
+                         ((handle->_accelEnabled != 0U) ? ACCEL_ARRAY : 0U);
+    uint8_t perTransfer = (uint8_t)((READ_BUF_SIZE - 1U) / sampleSize);
+    uint8_t raw[READ_BUF_SIZE - 1U];
+    uint8_t count = 0U;
+    while (count < available) {
+        uint8_t chunk = ((available - count) < perTransfer) ? (uint8_t)(available - count) : perTransfer;
+        if (MAX32664_ReadFillArray(handle, READ_DATA_OUTPUT, READ_DATA, (uint8_t)(chunk * sampleSize), raw) !=
+            SB_SUCCESS) {
+            break;
+        }
+        for (uint8_t i = 0U; i < chunk; i++) {
+            MAX32664_DecodeSensorBpm(&raw[i * sampleSize], mode, handle->_accelEnabled, &samples[count + i]);
+        }
+        count += chunk;
+    }
+
+    uint32_t now = usclock_now();
+    for (uint8_t i = 0U; i < count; i++) {
+        samples[i].timestamp = now;
+    }
+    PROF_END(PROF_READ_BPM);
+    return count;
+}
+
 // This function modifies the pulse width of the MAX30101 LEDs. All of the LEDs
 // are modified to the same width. This will affect the number of samples that
 // can be collected and will also affect the ADC resolution.
@@ -704,8 +849,7 @@ uint8_t MAX32664_ReadMAX30101State(MAX32664_Handle *handle) {
 // This function enables the Accelerometer.
 uint8_t MAX32664_AccelControl(MAX32664_Handle *handle, uint8_t accelSwitch) {
 
-    if ((accelSwitch != 0x00) || (accelSwitch != 0x00)) {
-    } else
+    if ((accelSwitch != DISABLE) && (accelSwitch != ENABLE))
         return INCORR_PARAM;
 
     // Check that communication was successful, not that the sensor is enabled.
@@ -717,6 +861,25 @@ uint8_t MAX32664_AccelControl(MAX32664_Handle *handle, uint8_t accelSwitch) {
         return SB_SUCCESS;
 }
 
+// Family Bytes: READ_ATTRIBUTES_AFE (0x42), ENABLE_SENSOR (0x44), Index Byte:
+// ACCELEROMETER (0x04)
+// This function enables the accelerometer if the hub reports one: a hub
+// without it fails the attributes read, which then reads as zero.
+uint8_t MAX32664_ConfigAccel(MAX32664_Handle *handle) {
+
+    handle->_accelEnabled = 0U;
+    sensorAttr attributes = MAX32664_GetAfeAttributesAccelerometer(handle);
+    if ((attributes.byteWord == 0U) || (attributes.availRegisters == 0U))
+        return SB_NOTIMPL_FUNC;
+
+    uint8_t statusByte = MAX32664_AccelControl(handle, ENABLE);
+    if (statusByte != SB_SUCCESS)
+        return statusByte;
+
+    handle->_accelEnabled = 1U;
+    return SB_SUCCESS;
+}
+
 // Family Byte: OUTPUT_MODE (0x10), Index Byte: SET_FORMAT (0x00),
 // Write Byte : outputType (Parameter values in OUTPUT_MODE_WRITE_BYTE)
 uint8_t MAX32664_SetOutputMode(MAX32664_Handle *handle, uint8_t outputType) {
@@ -1041,9 +1204,6 @@ uint8_t MAX32664_ReadMaximFastCoef(MAX32664_Handle *handle, int32_t coefArr[3])
     const size_t numOfReads = 3;
     uint8_t status = MAX32664_ReadMultipleBytes32(handle, READ_ALGORITHM_CONFIG,
                                                   READ_MAX_FAST_COEF, READ_MAX_FAST_COEF_ID, numOfReads, coefArr);
-    coefArr[0] = coefArr[0] * 100000;
-    coefArr[1] = coefArr[1] * 100000;
-    coefArr[2] = coefArr[2] * 100000;
     return status;
 }
 
@@ -1102,8 +1262,8 @@ uint8_t MAX32664_EraseFlash(MAX32664_Handle *handle) {
 
     // This is a unique write in that it does not have a relevant write byte.
     uint8_t buffer[2] = {BOOTLOADER_FLASH, ERASE_FLASH};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, buffer, 2,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, buffer, 2,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     /*
@@ -1115,8 +1275,8 @@ uint8_t MAX32664_EraseFlash(MAX32664_Handle *handle) {
      */
 
     uint8_t statusByte[1] = {0xFF};
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, statusByte, 1,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, statusByte, 1,
+                          HAL_MAX_DELAY);
 
     /*
      _i2cPort->requestFrom(_address, static_cast<uint8_t>(1));
@@ -1134,8 +1294,8 @@ version MAX32664_ReadBootloaderVers(MAX32664_Handle *handle) {
 
     version booVers; // BOO!
     uint8_t wbuffer[2] = {BOOTLOADER_INFO, BOOTLOADER_VERS};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     /*
@@ -1147,8 +1307,8 @@ version MAX32664_ReadBootloaderVers(MAX32664_Handle *handle) {
      */
 
     uint8_t buffer[4];
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, buffer, 4,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer, 4,
+                          HAL_MAX_DELAY);
 
     uint8_t statusByte = buffer[0];
 
@@ -1180,8 +1340,8 @@ version MAX32664_ReadSensorHubVersion(MAX32664_Handle *handle) {
 
     version bioHubVers;
     uint8_t wbuffer[2] = {IDENTITY, READ_SENSOR_HUB_VERS};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, wbuffer, 2,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, wbuffer, 2,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     /*
@@ -1193,8 +1353,8 @@ version MAX32664_ReadSensorHubVersion(MAX32664_Handle *handle) {
      */
 
     uint8_t buffer[4];
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, buffer, 4,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, buffer, 4,
+                          HAL_MAX_DELAY);
     uint8_t statusByte = buffer[0];
 
     /*
@@ -1225,8 +1385,8 @@ version MAX32664_ReadAlgorithmVersion(MAX32664_Handle *handle) {
 
     version libAlgoVers;
     uint8_t wbuffer[2] = {IDENTITY, READ_ALGO_VERS};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, wbuffer, 2,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, wbuffer, 2,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     /*
@@ -1238,8 +1398,8 @@ version MAX32664_ReadAlgorithmVersion(MAX32664_Handle *handle) {
      */
 
     uint8_t buffer[4];
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, buffer, 4,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, buffer, 4,
+                          HAL_MAX_DELAY);
     uint8_t statusByte = buffer[0];
 
     /*
@@ -1404,7 +1564,7 @@ uint8_t MAX32664_ReadSP02AlgoCoef(MAX32664_Handle *handle, int32_t userArray[])
 uint8_t MAX32664_EnableWrite(MAX32664_Handle *handle, uint8_t _familyByte,
                              uint8_t _indexByte, uint8_t _enableByte) {
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _enableByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3, HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3, HAL_MAX_DELAY);
     HAL_Delay(ENABLE_CMD_DELAY);
 
     /*
@@ -1418,7 +1578,7 @@ uint8_t MAX32664_EnableWrite(MAX32664_Handle *handle, uint8_t _familyByte,
 
     // Status Byte, success or no? 0x00 is a successful transmit
     uint8_t buffer[1];
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, buffer, 1, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer, 1, HAL_MAX_DELAY);
     /*
      _i2cPort->requestFrom(_address, static_cast<uint8_t>(1));
      uint8_t statusByte = _i2cPort->read();
@@ -1435,13 +1595,30 @@ uint8_t MAX32664_WriteByte(MAX32664_Handle *handle, uint8_t _familyByte,
                            uint8_t _indexByte, uint8_t _writeByte) {
 
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _writeByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3, HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3, HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     // Status Byte, success or no? 0x00 is a successful transmit
     uint8_t buffer[1];
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, buffer,
-                           1, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer,
+                          1, HAL_MAX_DELAY);
+    return buffer[0];
+}
+
+// This function sends is simliar to the one above and sends info to the MAX32664
+// but takes an additional uint8_t as a paramter. Again there is the write
+// of the specific bytes followed by a read to confirm positive transmission.
+uint8_t MAX32664_WriteByteParameter(MAX32664_Handle *handle, uint8_t _familyByte,
+                                    uint8_t _indexByte, uint8_t _writeByte, uint8_t _paramByte) {
+
+    uint8_t wbuffer[4] = {_familyByte, _indexByte, _writeByte, _paramByte};
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 4, HAL_MAX_DELAY);
+    HAL_Delay(CMD_DELAY);
+
+    // Status Byte, success or no? 0x00 is a successful transmit
+    uint8_t buffer[1] = {0xFF};
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer,
+                          1, HAL_MAX_DELAY);
     return buffer[0];
 }
 
@@ -1455,13 +1632,13 @@ uint8_t MAX32664_WriteByteValue16(MAX32664_Handle *handle, uint8_t _familyByte,
                                   uint8_t _indexByte, uint8_t _writeByte, uint16_t _val) {
     uint8_t buffer[5] =
         {_familyByte, _indexByte, _writeByte, (_val >> 8), _val};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, buffer, 5,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, buffer, 5,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     uint8_t statusByte[1] = {0xFF};
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, statusByte, 1,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, statusByte, 1,
+                          HAL_MAX_DELAY);
     return *statusByte;
 }
 
@@ -1473,13 +1650,13 @@ uint8_t MAX32664_WriteByteValue(MAX32664_Handle *handle, uint8_t _familyByte,
                                 uint8_t _indexByte, uint8_t _writeByte, uint8_t _writeVal) {
 
     uint8_t buffer[4] = {_familyByte, _indexByte, _writeByte, _writeVal};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, buffer, 4,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, buffer, 4,
+                           HAL_MAX_DELAY);
 
     // Status Byte, 0x00 is a successful transmit.
     uint8_t statusByte[1] = {0xFF};
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, statusByte, 1,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, statusByte, 1,
+                          HAL_MAX_DELAY);
     return *statusByte;
 }
 
@@ -1503,15 +1680,15 @@ uint8_t MAX32664_WriteLongBytes(MAX32664_Handle *handle, uint8_t _familyByte,
         buffer[sizeof(int32_t) * i + 6] = _writeVal[i];
     }
 
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, buffer, bufSize,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, buffer, bufSize,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     // Status Byte, 0x00 is a successful transmit.
     free(buffer);
     uint8_t statusByte[1] = {0xFF};
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, statusByte, 1,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, statusByte, 1,
+                          HAL_MAX_DELAY);
     return *statusByte;
 }
 
@@ -1533,15 +1710,15 @@ uint8_t MAX32664_WriteBytes(MAX32664_Handle *handle, uint8_t _familyByte,
         buffer[3 + i] = _writeVal[i];
     }
 
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, buffer, 3 + _size,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, buffer, 3 + _size,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     // Status Byte, 0x00 is a successful transmit.
     free(buffer);
     uint8_t statusByte[1] = {0xFF};
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, statusByte, 1,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, statusByte, 1,
+                          HAL_MAX_DELAY);
     return *statusByte;
 }
 // This function handles all read commands or stated another way, all information
@@ -1550,16 +1727,15 @@ uint8_t MAX32664_WriteBytes(MAX32664_Handle *handle, uint8_t _familyByte,
 // information. An I-squared-C request is then issued, and the information is read.
 uint8_t MAX32664_ReadByte(MAX32664_Handle *handle, uint8_t _familyByte, uint8_t _indexByte, uint8_t *dest) {
 
-    uint8_t returnByte;
     uint8_t statusByte;
 
     uint8_t wbuffer[2] = {_familyByte, _indexByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2, HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2, HAL_MAX_DELAY);
 
     HAL_Delay(CMD_DELAY);
 
     uint8_t buffer[2] = {0x0A, 0x0B};
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, buffer, 2, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer, 2, HAL_MAX_DELAY);
     statusByte = buffer[0];
 
     *dest = buffer[1];
@@ -1574,18 +1750,17 @@ uint8_t MAX32664_ReadByte(MAX32664_Handle *handle, uint8_t _familyByte, uint8_t
 uint8_t MAX32664_ReadByteWrite(MAX32664_Handle *handle, uint8_t _familyByte,
                                uint8_t _indexByte, uint8_t _writeByte, uint8_t *dest) {
 
-    uint8_t returnByte;
     uint8_t statusByte;
 
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _writeByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 3,
+                           HAL_MAX_DELAY);
 
     HAL_Delay(CMD_DELAY);
 
     uint8_t buffer[2];
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, buffer, 2,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, buffer, 2,
+                          HAL_MAX_DELAY);
     statusByte = buffer[0];
     *dest = buffer[1];
     return statusByte;
@@ -1597,14 +1772,14 @@ uint8_t MAX32664_ReadFillArray(MAX32664_Handle *handle, uint8_t _familyByte,
     uint8_t statusByte;
 
     uint8_t wbuffer[2] = {_familyByte, _indexByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, WRITE_ADDRESS, wbuffer, 2,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
-    HAL_I2C_Master_Receive(handle->hi2c, READ_ADDRESS, handle->readsBuffer,
-                           _numOfReads + 1, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, READ_ADDRESS, handle->readsBuffer,
+                          _numOfReads + 1, HAL_MAX_DELAY);
     statusByte = handle->readsBuffer[0];
-    if (statusByte == SB_SUCCESS) {
+    if (statusByte != SB_SUCCESS) {
         for (size_t i = 0; i < _numOfReads; i++) {
             array[i] = 0;
         }
@@ -1630,13 +1805,13 @@ uint16_t MAX32664_ReadIntByte(MAX32664_Handle *handle, uint8_t _familyByte,
     uint8_t statusByte;
 
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _writeByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, wbuffer, 3,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, wbuffer, 3,
+                           HAL_MAX_DELAY);
     HAL_Delay(CMD_DELAY);
 
     uint8_t buffer[3];
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, buffer, 3,
-                           HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, buffer, 3,
+                          HAL_MAX_DELAY);
     statusByte = buffer[0];
     returnByte = (buffer[1] << 8);
     returnByte |= buffer[2];
@@ -1657,13 +1832,13 @@ uint8_t MAX32664_ReadMultipleBytes32(MAX32664_Handle *handle,
     uint8_t statusByte;
 
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _writeByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, wbuffer, 3,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, wbuffer, 3,
+                           HAL_MAX_DELAY);
 
     HAL_Delay(CMD_DELAY);
 
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, handle->readsBuffer,
-                           sizeof(int32_t) * _numOfReads + 1, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, handle->readsBuffer,
+                          sizeof(int32_t) * _numOfReads + 1, HAL_MAX_DELAY);
     statusByte = handle->readsBuffer[0];
     if (statusByte == SB_SUCCESS) {
         for (size_t i = 0; i < _numOfReads; i++) {
@@ -1689,12 +1864,12 @@ uint8_t MAX32664_ReadMultipleBytes(MAX32664_Handle *handle, uint8_t _familyByte,
     uint8_t statusByte;
 
     uint8_t wbuffer[3] = {_familyByte, _indexByte, _writeByte};
-    HAL_I2C_Master_Transmit(handle->hi2c, handle->_address, wbuffer, 3,
-                            HAL_MAX_DELAY);
+    i2cbus_master_transmit(handle->hi2c, handle->_address, wbuffer, 3,
+                           HAL_MAX_DELAY);
 
     HAL_Delay(CMD_DELAY);
-    HAL_I2C_Master_Receive(handle->hi2c, handle->_address, handle->readsBuffer,
-                           _numOfReads + 1, HAL_MAX_DELAY);
+    i2cbus_master_receive(handle->hi2c, handle->_address, handle->readsBuffer,
+                          _numOfReads + 1, HAL_MAX_DELAY);
     statusByte = handle->readsBuffer[0];
     if (statusByte == SB_SUCCESS) {
         for (size_t i = 0; i < _numOfReads; i++) {
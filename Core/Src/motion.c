@@ -0,0 +1,104 @@
+#include "motion.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define MS_PER_SECOND (1000UL)
+
+void motion_init(motion_t *motion, uint16_t sampleRateHz) {
+    (void)memset(motion, 0, sizeof(*motion));
+    motion->holdSamples = ((uint32_t)MOTION_HOLD_MS * sampleRateHz) / MS_PER_SECOND;
+}
+
+uint8_t motion_add(motion_t *motion, const int16_t accel[3]) {
+    int32_t sum = 0;
+
+    if (motion->primed == 0U) {
+        for (uint8_t axis = 0U; axis < 3U; axis++) {
+            motion->mean[axis] = (int32_t)accel[axis] * (int32_t)(1L << MOTION_FRACTION_BITS);
+        }
+        motion->primed = 1U;
+    }
+    for (uint8_t axis = 0U; axis < 3U; axis++) {
+        int32_t deviation = ((int32_t)accel[axis] * (int32_t)(1L << MOTION_FRACTION_BITS)) - motion->mean[axis];
+        motion->mean[axis] += deviation / (int32_t)(1L << MOTION_MEAN_SHIFT);
+        sum += (deviation < 0) ? -deviation : deviation;
+    }
+    motion->activity = (uint32_t)((int32_t)motion->activity +
+                                  ((sum - (int32_t)motion->activity) / (int32_t)(1L << MOTION_ACTIVITY_SHIFT)));
+
+    uint16_t activity = motion_activity(motion);
+    if (activity > motion->peak) {
+        motion->peak = activity;
+    }
+    if ((motion->moving == 0U) && (activity >= MOTION_ON_MG)) {
+        motion->moving = 1U;
+        motion->motions++;
+    } else if ((motion->moving != 0U) && (activity < MOTION_OFF_MG)) {
+        motion->moving = 0U;
+        motion->hold = motion->holdSamples;
+    } else {
+        // no change
+    }
+
+    if (motion->moving != 0U) {
+        return 1U;
+    }
+    if (motion->hold > 0U) {
+        motion->hold--;
+        return 1U;
+    }
+    return 0U;
+}
+
+uint16_t motion_activity(const motion_t *motion) {
+    uint32_t activity = motion->activity >> MOTION_FRACTION_BITS;
+    return (activity > UINT16_MAX) ? UINT16_MAX : (uint16_t)activity;
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_RATE_HZ (100U)
+#define PROFILE_SAMPLES (PROFILE_RATE_HZ * 60U)
+
+// gravity on Z, a shake of +-500 mg at 2 Hz on X every other 10 s
+#define PROFILE_GRAVITY (1000)
+#define PROFILE_SHAKE (500)
+#define PROFILE_SHAKE_PERIOD (PROFILE_RATE_HZ / 2U)
+#define PROFILE_EPISODE (PROFILE_RATE_HZ * 10U)
+
+void motion_profile(void) {
+    static motion_t motion;
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+    uint32_t gated = 0U;
+
+    motion_init(&motion, PROFILE_RATE_HZ);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        int16_t accel[3] = {0, 0, PROFILE_GRAVITY};
+        if (((i / PROFILE_EPISODE) % 2U) != 0U) {
+            accel[0] = (int16_t)prof_triangle(i, PROFILE_SHAKE_PERIOD, PROFILE_SHAKE);
+        }
+        uint32_t start = DWT->CYCCNT;
+        gated += motion_add(&motion, accel);
+        cycles += DWT->CYCCNT - start;
+    }
+
+    str_clear(&line);
+    put_str(&line, "\r\nMotion [cycles @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, cycles / PROFILE_SAMPLES);
+    put_str(&line, " per sample, ");
+    put_uint32(&line, (gated * 100U) / PROFILE_SAMPLES);
+    put_str(&line, " % gated");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,231 @@
+#include "power.h"
+
+#include <string.h>
+
+#include "rtc.h"
+#include "strfmt.h"
+#include "sysclk.h"
+#include "usart.h"
+#include "usclock.h"
+
+// RTC calendar ticks: prescaled LSI periods, counted modulo one day
+#define RTC_TICKS_PER_SECOND (RTC_SYNCH_PREDIV + 1U)
+#define RTC_TICKS_PER_DAY (86400UL * RTC_TICKS_PER_SECOND)
+
+// the wake-up timer counts LSI / 16, on 16 bits
+#define WAKEUP_DIVIDER (16U)
+#define WAKEUP_MAX_COUNT (0x10000UL)
+
+static uint64_t timeUs[POWER_STATES];
+static uint32_t accountedUs = 0U; // usclock_now up to which the time is accounted
+static uint32_t stops = 0U;
+
+static uint8_t stopAllowed = 0U;
+static volatile uint8_t awake = 0U;
+static volatile uint32_t awakeUntil = 0U;
+
+// LSI calibration window, restarted after every STOP
+static uint32_t lsiHz = LSI_VALUE;
+static uint8_t calibrated = 0U;
+static uint32_t windowUs = 0U;
+static uint32_t windowTicks = 0U;
+
+// us of the last idle periods not yet added to the HAL tick
+static uint32_t tickRestUs = 0U;
+
+static uint32_t rtc_ticks(void) {
+    RTC_TimeTypeDef time;
+    RTC_DateTypeDef date;
+
+    (void)HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BIN);
+    // reading the date unlocks the shadow registers frozen by reading the time
+    (void)HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BIN);
+
+    uint32_t seconds = ((uint32_t)time.Hours * 3600U) + ((uint32_t)time.Minutes * 60U) + time.Seconds;
+    // the sub-second register counts down
+    return (seconds * RTC_TICKS_PER_SECOND) + (RTC_SYNCH_PREDIV - time.SubSeconds);
+}
+
+static uint32_t rtc_elapsed(uint32_t from, uint32_t to) {
+    return (to >= from) ? (to - from) : ((to + RTC_TICKS_PER_DAY) - from);
+}
+
+static uint32_t rtc_to_us(uint32_t ticks) {
+    return (uint32_t)(((uint64_t)ticks * (RTC_ASYNCH_PREDIV + 1U) * 1000000U) / lsiHz);
+}
+
+static void calibration_restart(uint32_t now) {
+    windowUs = now;
+    windowTicks = rtc_ticks();
+}
+
+/* Measures LSI against TIM5 once the window is long enough */
+static void calibrate(uint32_t now) {
+    uint32_t us = now - windowUs;
+    if (us < POWER_CALIBRATION_US) {
+        return;
+    }
+    uint32_t ticks = rtc_ticks();
+    uint64_t cycles = (uint64_t)rtc_elapsed(windowTicks, ticks) * (RTC_ASYNCH_PREDIV + 1U);
+    lsiHz = (uint32_t)(((cycles * 1000000U) + (us / 2U)) / us);
+    calibrated = 1U;
+    windowUs = now;
+    windowTicks = ticks;
+}
+
+/* The HAL tick stands still while SysTick is suspended */
+static void advance_tick(uint32_t us) {
+    tickRestUs += us;
+    uwTick += tickRestUs / 1000U;
+    tickRestUs %= 1000U;
+}
+
+static uint32_t enter_sleep(void) {
+    uint32_t start = usclock_now();
+    HAL_SuspendTick();
+    __WFI();
+    uint32_t slept = usclock_now() - start;
+    advance_tick(slept);
+    HAL_ResumeTick();
+    return slept;
+}
+
+static uint32_t enter_stop(uint32_t idleUs) {
+    uint32_t count = (uint32_t)(((uint64_t)(idleUs - POWER_STOP_WAKEUP_US) * lsiHz) / (WAKEUP_DIVIDER * 1000000U));
+    if (count > WAKEUP_MAX_COUNT) {
+        count = WAKEUP_MAX_COUNT;
+    }
+
+    uint32_t before = rtc_ticks();
+    HAL_SuspendTick();
+    (void)HAL_RTCEx_SetWakeUpTimer_IT(&hrtc, count - 1U, RTC_WAKEUPCLOCK_RTCCLK_DIV16);
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+    // the core runs on HSI again, as set by SystemClock_Config
+    sysclk_restore();
+    (void)HAL_RTCEx_DeactivateWakeUpTimer(&hrtc);
+    // the calendar shadow registers are stale until resynchronised
+    __HAL_RTC_WRITEPROTECTION_DISABLE(&hrtc);
+    (void)HAL_RTC_WaitForSynchro(&hrtc);
+    __HAL_RTC_WRITEPROTECTION_ENABLE(&hrtc);
+
+    uint32_t after = rtc_ticks();
+    uint32_t stopped = rtc_to_us(rtc_elapsed(before, after));
+    usclock_advance(stopped);
+    advance_tick(stopped);
+    HAL_ResumeTick();
+
+    stops += 1U;
+    calibration_restart(usclock_now());
+    return stopped;
+}
+
+void power_init(void) {
+    (void)memset(timeUs, 0, sizeof(timeUs));
+    stops = 0U;
+    accountedUs = usclock_now();
+    calibrated = 0U;
+    lsiHz = LSI_VALUE;
+    calibration_restart(accountedUs);
+    tickRestUs = 0U;
+
+    // lower STOP current for a longer wake-up, covered by POWER_STOP_WAKEUP_US
+    HAL_PWREx_EnableFlashPowerDown();
+#ifdef DEBUG
+    // keeps the debugger connected while the core is stopped
+    HAL_DBGMCU_EnableDBGStopMode();
+#endif
+}
+
+void power_allow_stop(uint8_t allow) {
+    stopAllowed = (allow != 0U) ? 1U : 0U;
+}
+
+void power_stay_awake(uint32_t ms) {
+    uint32_t until = usclock_now() + (ms * 1000U);
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((awake == 0U) || ((int32_t)(until - awakeUntil) > 0)) {
+        awakeUntil = until;
+    }
+    awake = 1U;
+
+    __set_PRIMASK(primask);
+}
+
+void power_idle(uint32_t idleUs) {
+    uint32_t start = usclock_now();
+    timeUs[POWER_RUN] += start - accountedUs;
+
+    calibrate(start);
+    if ((awake != 0U) && ((int32_t)(start - awakeUntil) >= 0)) {
+        awake = 0U;
+    }
+
+    power_state_t state = POWER_SLEEP;
+    uint32_t slept;
+    if ((stopAllowed != 0U) && (calibrated != 0U) && (awake == 0U) && (idleUs >= POWER_STOP_MIN_US)) {
+        state = POWER_STOP;
+        slept = enter_stop(idleUs);
+    } else {
+        slept = enter_sleep();
+    }
+
+    uint32_t end = usclock_now();
+    timeUs[state] += slept;
+    timeUs[POWER_RUN] += (end - start) - slept;
+    accountedUs = end;
+}
+
+void power_get_stats(power_stats_t *stats) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint32_t i = 0U; i < (uint32_t)POWER_STATES; i++) {
+        stats->time[i] = timeUs[i];
+    }
+    stats->time[POWER_RUN] += usclock_now() - accountedUs;
+    stats->stops = stops;
+    stats->lsiHz = (calibrated != 0U) ? lsiHz : 0U;
+
+    __set_PRIMASK(primask);
+}
+
+/* Fraction of the total in tenths of a percent, as "12.3%" */
+static void put_permille(strbuf *buffer, uint64_t part, uint64_t total) {
+    uint32_t permille = (total > 0U) ? (uint32_t)(((part * 1000U) + (total / 2U)) / total) : 0U;
+    put_uint32(buffer, permille / 10U);
+    put_char(buffer, '.');
+    put_uint32(buffer, permille % 10U);
+    put_char(buffer, '%');
+}
+
+void power_report(void) {
+    static const char *const stateNames[POWER_STATES] = {"run", "sleep", "stop"};
+    char lineStr[120];
+    strbuf line = mkbuf(lineStr);
+    power_stats_t stats;
+
+    power_get_stats(&stats);
+    uint64_t total = stats.time[POWER_RUN] + stats.time[POWER_SLEEP] + stats.time[POWER_STOP];
+
+    str_clear(&line);
+    put_str(&line, "\r\nPower over ");
+    put_uint32(&line, (uint32_t)(total / 1000U));
+    put_str(&line, " ms:");
+    for (uint32_t i = 0U; i < (uint32_t)POWER_STATES; i++) {
+        put_char(&line, ' ');
+        put_str(&line, stateNames[i]);
+        put_char(&line, ' ');
+        put_permille(&line, stats.time[i], total);
+        put_char(&line, ((i + 1U) < (uint32_t)POWER_STATES) ? ',' : ';');
+    }
+    put_str(&line, " stops: ");
+    put_uint32(&line, stats.stops);
+    put_str(&line, ", LSI: ");
+    put_uint32(&line, stats.lsiHz);
+    put_str(&line, " Hz");
+    put_end(&line);
+    PRINT(line.buf);
+}
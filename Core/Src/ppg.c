@@ -0,0 +1,238 @@
+#include "ppg.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define Q15_COEF_BITS (14U)
+#define Q31_COEF_BITS (30U)
+#define SAMPLE_BITS (15U)
+#define SAMPLE_MAX ((1L << (SAMPLE_BITS - 1U)) - 1L)
+
+// pair of 16-bit values, first in the low half as the SMLAD operands
+#define PACK(first, second) (((uint32_t)(uint16_t)(first)) | ((uint32_t)(uint16_t)(second) << 16))
+
+typedef struct biquad_q15 {
+    int16_t b0;
+    uint32_t b12; // b1 | b2 << 16
+    uint32_t a12; // -a1 | -a2 << 16
+} biquad_q15_t;
+
+typedef struct biquad_q31 {
+    int32_t b[3];
+    int32_t a[2]; // -a1, -a2
+} biquad_q31_t;
+
+// Butterworth at PPG_RATE_HZ by the bilinear transform: low-pass at 5 Hz in
+// Q14, DC gain 1, and high-pass at 0.5 Hz in Q30, Nyquist gain 1
+static const biquad_q15_t lowPass = {1105, PACK(2210, 1105), PACK(18727, -6763)};
+static const biquad_q31_t highPass = {{1027080468, -2054160935, 1027080468}, {2052132225, -982447822}};
+
+static const uint16_t sampleRates[] = {50U, 100U, 200U, 400U, 800U, 1000U, 1600U, 3200U};
+#define SAMPLE_RATES (sizeof(sampleRates) / sizeof(sampleRates[0]))
+
+/*
+ * Direct form I on a block, in place, two multiply-accumulates per SMLAD. The
+ * states stay in registers over the block: each new sample is packed in front
+ * of the previous one by PKHBT.
+ */
+static void low_pass_block(uint32_t state[2], int16_t *data, uint16_t count) {
+    uint32_t x = state[0];
+    uint32_t y = state[1];
+
+    for (uint16_t i = 0U; i < count; i++) {
+        int32_t in = data[i];
+        int32_t acc = in * lowPass.b0;
+        acc = (int32_t)__SMLAD(lowPass.b12, x, (uint32_t)acc);
+        acc = (int32_t)__SMLAD(lowPass.a12, y, (uint32_t)acc);
+        int32_t out = __SSAT((acc + (1L << (Q15_COEF_BITS - 1U))) >> Q15_COEF_BITS, SAMPLE_BITS);
+        x = __PKHBT(in, x, 16);
+        y = __PKHBT(out, y, 16);
+        data[i] = (int16_t)out;
+    }
+    state[0] = x;
+    state[1] = y;
+}
+
+/*
+ * Direct form I on a block, in place, with 32-bit states and a 64-bit
+ * accumulator (SMLAL). Rounded to 16 bits, the output fed back would be
+ * amplified about 40 times by the poles, close to the unit circle.
+ */
+static void high_pass_block(int32_t state[4], int16_t *data, uint16_t count) {
+    int32_t x1 = state[0];
+    int32_t x2 = state[1];
+    int32_t y1 = state[2];
+    int32_t y2 = state[3];
+
+    for (uint16_t i = 0U; i < count; i++) {
+        int32_t x0 = (int32_t)data[i] * (1L << 16);
+        int64_t acc = (int64_t)highPass.b[0] * x0;
+        acc += (int64_t)highPass.b[1] * x1;
+        acc += (int64_t)highPass.b[2] * x2;
+        acc += (int64_t)highPass.a[0] * y1;
+        acc += (int64_t)highPass.a[1] * y2;
+        int64_t y0 = acc >> Q31_COEF_BITS;
+        data[i] = (int16_t)__SSAT((int32_t)((y0 + (1LL << 15)) >> 16), SAMPLE_BITS);
+        if (y0 > INT32_MAX) {
+            y0 = INT32_MAX;
+        } else if (y0 < INT32_MIN) {
+            y0 = INT32_MIN;
+        }
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = (int32_t)y0;
+    }
+    state[0] = x1;
+    state[1] = x2;
+    state[2] = y1;
+    state[3] = y2;
+}
+
+/* Ends the boxcar of a channel: DC tracking and AC of its average */
+static int16_t remove_dc(ppg_t *ppg, ppg_channel_t *channel) {
+    uint32_t level = (uint32_t)((((uint64_t)channel->sum << PPG_GAIN_BITS) + (ppg->boxcar / 2U)) / ppg->boxcar);
+
+    channel->sum = 0U;
+    if (ppg->primed == 0U) {
+        channel->dc = level << PPG_DC_SHIFT;
+    }
+    int32_t ac = (int32_t)level - (int32_t)(channel->dc >> PPG_DC_SHIFT);
+    if ((ac > SAMPLE_MAX) || (ac < -SAMPLE_MAX)) {
+        // a finger put on or taken off, not a pulse: the DC jumps to the new
+        // level instead of hiding the pulse in saturation for seconds
+        channel->dc = level << PPG_DC_SHIFT;
+        return 0;
+    }
+    channel->dc = (uint32_t)((int32_t)channel->dc + ac);
+    return (int16_t)ac;
+}
+
+/* Band-passes a block of both channels and decimates it into out */
+static uint16_t filter_block(ppg_t *ppg, int16_t *ir, int16_t *red, const uint32_t *irDc, const uint32_t *redDc,
+                             uint16_t count, ppg_sample_t *out) {
+    uint16_t written = 0U;
+
+    low_pass_block(ppg->ir.lowPass, ir, count);
+    high_pass_block(ppg->ir.highPass, ir, count);
+    low_pass_block(ppg->red.lowPass, red, count);
+    high_pass_block(ppg->red.highPass, red, count);
+    for (uint16_t i = 0U; i < count; i++) {
+        if (ppg->skip == 0U) {
+            out[written].ir = ir[i];
+            out[written].red = red[i];
+            out[written].irDc = irDc[i] >> (PPG_GAIN_BITS + PPG_DC_SHIFT);
+            out[written].redDc = redDc[i] >> (PPG_GAIN_BITS + PPG_DC_SHIFT);
+            written++;
+        }
+        ppg->skip ^= 1U;
+    }
+    return written;
+}
+
+HAL_StatusTypeDef ppg_init(ppg_t *ppg, uint16_t sampleRate) {
+    for (uint32_t i = 0U; i < SAMPLE_RATES; i++) {
+        if (sampleRates[i] == sampleRate) {
+            (void)memset(ppg, 0, sizeof(*ppg));
+            ppg->boxcar = sampleRate / PPG_RATE_HZ;
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
+uint16_t ppg_process(ppg_t *ppg, const ppg_raw_t *in, uint16_t count, ppg_sample_t *out) {
+    int16_t ir[PPG_BLOCK];
+    int16_t red[PPG_BLOCK];
+    uint32_t irDc[PPG_BLOCK];
+    uint32_t redDc[PPG_BLOCK];
+    uint16_t filled = 0U;
+    uint16_t written = 0U;
+
+    for (uint16_t i = 0U; i < count; i++) {
+        ppg->ir.sum += in[i].ir;
+        ppg->red.sum += in[i].red;
+        ppg->summed++;
+        if (ppg->summed < ppg->boxcar) {
+            continue;
+        }
+
+        ppg->summed = 0U;
+        ir[filled] = remove_dc(ppg, &ppg->ir);
+        red[filled] = remove_dc(ppg, &ppg->red);
+        irDc[filled] = ppg->ir.dc;
+        redDc[filled] = ppg->red.dc;
+        ppg->primed = 1U;
+        filled++;
+        if (filled == PPG_BLOCK) {
+            written += filter_block(ppg, ir, red, irDc, redDc, filled, &out[written]);
+            filled = 0U;
+        }
+    }
+    if (filled > 0U) {
+        written += filter_block(ppg, ir, red, irDc, redDc, filled, &out[written]);
+    }
+    return written;
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_SECONDS (2U)
+#define PROFILE_CHUNK (64U)
+
+// triangle at about 1.2 Hz on the levels of a finger, ADC counts
+#define PROFILE_DC (120000U)
+#define PROFILE_AC (1500)
+
+void ppg_profile(void) {
+    static ppg_t ppg;
+    static ppg_raw_t raw[PROFILE_CHUNK];
+    static ppg_sample_t out[PROFILE_CHUNK];
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+
+    str_clear(&line);
+    put_str(&line, "\r\nPPG [cycles per sample @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]");
+    put_end(&line);
+    PRINT(line.buf);
+
+    for (uint32_t r = 0U; r < SAMPLE_RATES; r++) {
+        uint32_t rate = sampleRates[r];
+        uint32_t period = (rate * 5U) / 6U;
+        uint32_t samples = rate * PROFILE_SECONDS;
+        uint32_t cycles = 0U;
+
+        (void)ppg_init(&ppg, (uint16_t)rate);
+        for (uint32_t done = 0U; done < samples; done += PROFILE_CHUNK) {
+            uint32_t chunk = ((samples - done) < PROFILE_CHUNK) ? (samples - done) : PROFILE_CHUNK;
+            for (uint32_t i = 0U; i < chunk; i++) {
+                int32_t wave = prof_triangle(done + i, period, PROFILE_AC / 2) + (PROFILE_AC / 2);
+                raw[i].ir = PROFILE_DC + (uint32_t)wave;
+                raw[i].red = (raw[i].ir * 3U) / 4U;
+            }
+            uint32_t start = DWT->CYCCNT;
+            (void)ppg_process(&ppg, raw, (uint16_t)chunk, out);
+            cycles += DWT->CYCCNT - start;
+        }
+
+        // tenths of a cycle
+        uint32_t perSample = (cycles * 10U) / samples;
+        str_clear(&line);
+        put_str(&line, "\r\n");
+        put_uint32(&line, rate);
+        put_str(&line, " Hz: ");
+        put_uint32(&line, perSample / 10U);
+        put_char(&line, '.');
+        put_uint32(&line, perSample % 10U);
+        put_end(&line);
+        PRINT(line.buf);
+    }
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,138 @@
+#include "prof.h"
+
+#if PROF_ENABLED
+
+#include <string.h>
+
+#include "ppg.h"
+#include "strfmt.h"
+#include "usart.h"
+
+typedef struct prof_stats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_BUCKETS];
+} prof_stats_t;
+
+static const char *const regionNames[PROF_REGION_COUNT] = {
+    "read_bpm",
+    "oled_update",
+    "oled_char",
+    "report",
+    "dispatch",
+    "timers",
+    "stats",
+};
+
+static prof_stats_t stats[PROF_REGION_COUNT];
+
+void prof_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    prof_reset();
+}
+
+void prof_record(prof_region_t region, uint32_t cycles) {
+    if (region >= PROF_REGION_COUNT) {
+        return;
+    }
+
+    // log2 bucket, a zero duration falls in the first one
+    uint32_t bucket = (cycles == 0U) ? 0U : (31U - __CLZ(cycles));
+    if (bucket >= PROF_BUCKETS) {
+        bucket = PROF_BUCKETS - 1U;
+    }
+
+    // regions are recorded both from the main loop and from interrupts
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    prof_stats_t *s = &stats[region];
+    s->count += 1U;
+    s->total += cycles;
+    if (cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+    s->hist[bucket] += 1U;
+
+    __set_PRIMASK(primask);
+}
+
+void prof_reset(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    (void)memset(stats, 0, sizeof(stats));
+    for (uint32_t i = 0U; i < (uint32_t)PROF_REGION_COUNT; i++) {
+        stats[i].min = UINT32_MAX;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void prof_dump(void) {
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+
+    str_clear(&line);
+    put_str(&line, "\r\nProfile [cycles @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]");
+    put_end(&line);
+    PRINT(line.buf);
+
+    for (uint32_t i = 0U; i < (uint32_t)PROF_REGION_COUNT; i++) {
+        // copy first, the regions keep running while the dump is printed
+        prof_stats_t s;
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        s = stats[i];
+        __set_PRIMASK(primask);
+
+        str_clear(&line);
+        put_str(&line, "\r\n");
+        put_str(&line, regionNames[i]);
+        put_str(&line, " n: ");
+        put_uint32(&line, s.count);
+        if (s.count > 0U) {
+            put_str(&line, ", min: ");
+            put_uint32(&line, s.min);
+            put_str(&line, ", mean: ");
+            put_uint32(&line, (uint32_t)(s.total / s.count));
+            put_str(&line, ", max: ");
+            put_uint32(&line, s.max);
+        }
+        put_end(&line);
+        PRINT(line.buf);
+
+        for (uint32_t b = 0U; b < PROF_BUCKETS; b++) {
+            if (s.hist[b] > 0U) {
+                str_clear(&line);
+                put_str(&line, "\r\n  2^");
+                put_uint32(&line, b);
+                put_str(&line, ": ");
+                put_uint32(&line, s.hist[b]);
+                put_end(&line);
+                PRINT(line.buf);
+            }
+        }
+    }
+}
+
+int32_t prof_triangle(uint32_t i, uint32_t period, int32_t amplitude) {
+    uint32_t phase = i % period;
+    int32_t wave = (int32_t)((phase < (period / 2U)) ? phase : (period - phase));
+    return ((wave * 4 * amplitude) / (int32_t)period) - amplitude;
+}
+
+int16_t prof_pulse(uint32_t i) {
+    return (int16_t)prof_triangle(i, (PPG_OUTPUT_HZ * 5U) / 6U, PROF_PULSE_AC);
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,168 @@
+#include "resp.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define US_PER_MS (1000UL)
+#define MS_PER_MINUTE_10 (600000UL)
+
+// the baseline of a beat is averaged over at most the longest interval
+#define DC_SAMPLES_MAX ((BEAT_MAX_RR_MS * PPG_OUTPUT_HZ) / 1000U)
+
+/* Times a rising crossing: ends a breath unless it is too short to be one */
+static void crossing(resp_channel_t *channel, uint32_t timeUs) {
+    if (channel->haveCrossing != 0U) {
+        uint32_t period = ((timeUs - channel->crossingUs) + (US_PER_MS / 2U)) / US_PER_MS;
+        if (period < RESP_MIN_PERIOD_MS) {
+            // a ripple of the breath in progress
+            return;
+        }
+        if (period <= RESP_MAX_PERIOD_MS) {
+            if (channel->periodMs == 0U) {
+                channel->periodMs = (uint16_t)period;
+            } else {
+                channel->periodMs = (uint16_t)((int32_t)channel->periodMs +
+                                               (((int32_t)period - (int32_t)channel->periodMs) / 4));
+            }
+            channel->breaths++;
+        }
+    }
+    channel->crossingUs = timeUs;
+    channel->haveCrossing = 1U;
+}
+
+/* Adds the value of a beat to a channel */
+static void channel_add(resp_channel_t *channel, int32_t value, uint32_t timeUs) {
+    int32_t scaled = value * (int32_t)(1L << RESP_FRACTION_BITS);
+
+    if (channel->primed == 0U) {
+        channel->trend = scaled;
+        channel->previous = 0;
+        channel->previousUs = timeUs;
+        channel->primed = 1U;
+        return;
+    }
+
+    int32_t detrended = scaled - channel->trend;
+    int32_t magnitude = (detrended < 0) ? -detrended : detrended;
+    channel->trend += detrended / (int32_t)(1L << RESP_TREND_SHIFT);
+    channel->deviation += (magnitude - channel->deviation) / (int32_t)(1L << RESP_TREND_SHIFT);
+
+    if (detrended < -(channel->deviation / 2)) {
+        channel->armed = 1U;
+    } else if ((channel->armed != 0U) && (detrended >= 0)) {
+        // the previous value was under the trend: interpolate between the two
+        uint32_t span = timeUs - channel->previousUs;
+        int32_t rise = detrended - channel->previous;
+        uint32_t offset = (uint32_t)(((int64_t)span * (int64_t)(-channel->previous)) / rise);
+        crossing(channel, channel->previousUs + offset);
+        channel->armed = 0U;
+    } else {
+        // within the hysteresis
+    }
+    channel->previous = detrended;
+    channel->previousUs = timeUs;
+}
+
+void resp_init(resp_t *resp) {
+    (void)memset(resp, 0, sizeof(*resp));
+}
+
+void resp_add(resp_t *resp, const ppg_sample_t *sample) {
+    if (resp->dcSamples >= DC_SAMPLES_MAX) {
+        // no beat for a while: keep the last samples only
+        resp->dcSum = 0U;
+        resp->dcSamples = 0U;
+    }
+    resp->dcSum += sample->irDc;
+    resp->dcSamples++;
+    resp->dc = sample->irDc;
+}
+
+uint16_t resp_add_beat(resp_t *resp, const beat_rr_t *rr) {
+    if (resp->dcSamples > 0U) {
+        channel_add(&resp->wander, (int32_t)(resp->dcSum / resp->dcSamples), rr->timestamp);
+        resp->dcSum = 0U;
+        resp->dcSamples = 0U;
+    }
+    channel_add(&resp->amplitude, (int32_t)rr->amplitude, rr->timestamp);
+
+    resp->perfusion = 0U;
+    if (resp->dc > 0U) {
+        // AC / DC in 0.01 %, the AC in 2^-PPG_GAIN_BITS counts
+        uint32_t perfusion = (((uint32_t)rr->amplitude * (10000UL >> PPG_GAIN_BITS)) + (resp->dc / 2U)) / resp->dc;
+        resp->perfusion = (perfusion > UINT16_MAX) ? UINT16_MAX : (uint16_t)perfusion;
+    }
+    return resp->perfusion;
+}
+
+uint16_t resp_channel_rate(const resp_channel_t *channel) {
+    if ((channel->breaths < RESP_MIN_BREATHS) || (channel->periodMs == 0U)) {
+        return 0U;
+    }
+    return (uint16_t)((MS_PER_MINUTE_10 + (channel->periodMs / 2U)) / channel->periodMs);
+}
+
+uint16_t resp_rate(const resp_t *resp) {
+    uint32_t wander = resp_channel_rate(&resp->wander);
+    uint32_t amplitude = resp_channel_rate(&resp->amplitude);
+
+    if ((wander != 0U) && (amplitude != 0U)) {
+        return (uint16_t)((wander + amplitude + 1U) / 2U);
+    }
+    return (uint16_t)(wander + amplitude);
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_SAMPLES (PPG_OUTPUT_HZ * 60U)
+
+// processed pulse wave of prof_pulse, breathing at 15 breaths/min swelling the
+// DC by up to PROFILE_SWELL
+#define PROFILE_BREATH (PPG_OUTPUT_HZ * 4U)
+#define PROFILE_SWELL ((int32_t)PROFILE_BREATH / 2)
+#define PROFILE_DC (120000)
+
+void resp_profile(void) {
+    static beat_t beat;
+    static resp_t resp;
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+    uint32_t beats = 0U;
+    beat_rr_t rr;
+
+    beat_init(&beat);
+    resp_init(&resp);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        int32_t swell = prof_triangle(i, PROFILE_BREATH, PROFILE_SWELL / 2) + (PROFILE_SWELL / 2);
+        ppg_sample_t sample = {0};
+        sample.ir = prof_pulse(i);
+        sample.irDc = (uint32_t)(PROFILE_DC + swell);
+        (void)beat_add(&beat, &sample);
+        uint32_t start = DWT->CYCCNT;
+        resp_add(&resp, &sample);
+        while (beat_pop(&beat, &rr) != 0U) {
+            (void)resp_add_beat(&resp, &rr);
+            beats++;
+        }
+        cycles += DWT->CYCCNT - start;
+    }
+
+    str_clear(&line);
+    put_str(&line, "\r\nRespiration [cycles @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, cycles / PROFILE_SAMPLES);
+    put_str(&line, " per sample, ");
+    put_uint32(&line, (beats > 0U) ? (cycles / beats) : 0U);
+    put_str(&line, " per beat");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,350 @@
+#include "sched.h"
+
+#include "main.h"
+#include "power.h"
+#include "prof.h"
+#include "usclock.h"
+
+#define WHEEL_BITS (6U)
+#define WHEEL_SLOTS (1UL << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1UL)
+
+// ticks from the wheel position to the farthest deadline placed directly
+#define WHEEL_HORIZON ((1UL << (WHEEL_BITS * SCHED_WHEEL_LEVELS)) - 1UL)
+
+// level of the timers taken out of their slot to be executed
+#define LEVEL_EXPIRING (0xFFU)
+
+typedef struct sched_timer {
+    struct sched_timer *next;
+    struct sched_timer *prev;
+    uint32_t expires; // tick of the next expiry
+    uint32_t period;  // ticks, 0 for one-shot
+    uint8_t type;
+    uint8_t active;
+    uint8_t level; // position in the wheel while active
+    uint8_t slot;
+} sched_timer_t;
+
+static sched_event_t queue[SCHED_QUEUE_SIZE];
+static volatile uint32_t head = 0U; // events posted since init, slot is head % SCHED_QUEUE_SIZE
+static volatile uint32_t tail = 0U; // events executed since init
+static volatile uint32_t dropped = 0U;
+
+static sched_dispatch_fn dispatchFn = NULL;
+
+static sched_timer_t timers[SCHED_TIMERS];
+static sched_timer_t *wheel[SCHED_WHEEL_LEVELS][WHEEL_SLOTS];
+static uint64_t occupied[SCHED_WHEEL_LEVELS]; // bit s set when slot s is not empty
+static sched_timer_t *expiring = NULL;        // timers of the slot being executed
+static uint32_t wheelTick = 0U;               // next tick the wheel executes
+
+// millisecond ticks of the microsecond clock
+static uint32_t clockUs = 0U;   // usclock_now at the last update
+static uint32_t clockRest = 0U; // us from the start of the current tick to clockUs
+static uint32_t clockTick = 0U; // ticks since init
+
+_Static_assert((SCHED_QUEUE_SIZE & (SCHED_QUEUE_SIZE - 1U)) == 0U, "SCHED_QUEUE_SIZE must be a power of two");
+_Static_assert((WHEEL_BITS * SCHED_WHEEL_LEVELS) < 32U, "the wheel must cover less than 2^32 ticks");
+
+/* Event queue ----------------------------------------------------------------*/
+
+uint8_t sched_post(uint8_t type, uint8_t arg) {
+    uint8_t queued = 0U;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((head - tail) < SCHED_QUEUE_SIZE) {
+        sched_event_t *event = &queue[head & (SCHED_QUEUE_SIZE - 1U)];
+        event->type = type;
+        event->arg = arg;
+        head = head + 1U;
+        queued = 1U;
+    } else {
+        dropped = dropped + 1U;
+    }
+
+    __set_PRIMASK(primask);
+    return queued;
+}
+
+uint32_t sched_dropped(void) {
+    return dropped;
+}
+
+/* Takes the oldest queued event, returns 0 if the queue is empty */
+static uint8_t next_event(sched_event_t *event) {
+    uint8_t found = 0U;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (head != tail) {
+        *event = queue[tail & (SCHED_QUEUE_SIZE - 1U)];
+        tail = tail + 1U;
+        found = 1U;
+    }
+
+    __set_PRIMASK(primask);
+    return found;
+}
+
+/* Timing wheel ---------------------------------------------------------------*/
+
+static uint32_t update_clock(void) {
+    uint32_t now = usclock_now();
+    uint32_t elapsed = clockRest + (now - clockUs);
+
+    clockUs = now;
+    clockTick += elapsed / 1000U;
+    clockRest = elapsed % 1000U;
+    return clockTick;
+}
+
+static void wheel_link(sched_timer_t *timer, uint8_t level, uint8_t slot) {
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = wheel[level][slot];
+    if (timer->next != NULL) {
+        timer->next->prev = timer;
+    }
+    wheel[level][slot] = timer;
+    occupied[level] |= 1ULL << slot;
+}
+
+static void wheel_unlink(sched_timer_t *timer) {
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else if (timer->level == LEVEL_EXPIRING) {
+        expiring = timer->next;
+    } else {
+        wheel[timer->level][timer->slot] = timer->next;
+        if (timer->next == NULL) {
+            occupied[timer->level] &= ~(1ULL << timer->slot);
+        }
+    }
+}
+
+/*
+ * Level 0 holds the deadlines less than 64 ticks ahead of the wheel position,
+ * one slot per tick; each following level covers 64 times the range of the
+ * previous one with slots 64 times as wide. A deadline already passed goes in
+ * the slot executed next.
+ */
+static void wheel_add(sched_timer_t *timer) {
+    uint32_t delta = timer->expires - wheelTick;
+    uint32_t expires = timer->expires;
+    uint8_t level = 0U;
+
+    if ((int32_t)delta < 0) {
+        expires = wheelTick;
+    } else {
+        if (delta > WHEEL_HORIZON) {
+            expires = wheelTick + WHEEL_HORIZON;
+            delta = WHEEL_HORIZON;
+        }
+        while ((level < (SCHED_WHEEL_LEVELS - 1U)) && (delta >= (1UL << (WHEEL_BITS * (level + 1U))))) {
+            level++;
+        }
+    }
+    wheel_link(timer, level, (uint8_t)((expires >> (WHEEL_BITS * level)) & WHEEL_MASK));
+}
+
+/* Moves the timers of a slot of a coarse level to the finer levels */
+static void wheel_cascade(uint8_t level, uint8_t slot) {
+    sched_timer_t *timer = wheel[level][slot];
+
+    wheel[level][slot] = NULL;
+    occupied[level] &= ~(1ULL << slot);
+    while (timer != NULL) {
+        sched_timer_t *next = timer->next;
+        wheel_add(timer);
+        timer = next;
+    }
+}
+
+/* Executes the timers of the slot of wheelTick, then moves to the next tick */
+static void wheel_step(void) {
+    uint8_t slot = (uint8_t)(wheelTick & WHEEL_MASK);
+
+    // entering a new turn of a level: its next slot is spread on the finer levels
+    if (slot == 0U) {
+        for (uint8_t level = 1U; level < SCHED_WHEEL_LEVELS; level++) {
+            uint8_t index = (uint8_t)((wheelTick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+            wheel_cascade(level, index);
+            if (index != 0U) {
+                break;
+            }
+        }
+    }
+
+    // detached first: timers the handlers start meanwhile go to later slots
+    expiring = wheel[0][slot];
+    wheel[0][slot] = NULL;
+    occupied[0] &= ~(1ULL << slot);
+    for (sched_timer_t *timer = expiring; timer != NULL; timer = timer->next) {
+        timer->level = LEVEL_EXPIRING;
+    }
+    wheelTick++;
+
+    while (expiring != NULL) {
+        sched_timer_t *timer = expiring;
+        wheel_unlink(timer);
+        if (timer->period == 0U) {
+            timer->active = 0U;
+        } else {
+            timer->expires += timer->period;
+            wheel_add(timer);
+        }
+        sched_event_t event = {.type = timer->type, .arg = (uint8_t)(timer - timers)};
+        dispatchFn(&event);
+    }
+}
+
+/* Rotates a slot bitmap so that bit 0 is the slot of index first */
+static uint64_t rotate(uint64_t slots, uint32_t first) {
+    return (first == 0U) ? slots : ((slots >> first) | (slots << (WHEEL_SLOTS - first)));
+}
+
+/*
+ * Ticks from the wheel position to the next tick with work: a level 0 slot to
+ * execute, or the turn at which a non-empty slot of a coarser level is
+ * cascaded. UINT32_MAX if the wheel is empty.
+ */
+static uint32_t wheel_next(void) {
+    uint32_t next = UINT32_MAX;
+
+    for (uint8_t level = 0U; level < SCHED_WHEEL_LEVELS; level++) {
+        if (occupied[level] == 0U) {
+            continue;
+        }
+        uint32_t shift = WHEEL_BITS * level;
+        uint32_t span = 1UL << shift;
+        // first tick from which the slots of this level are visited again
+        uint32_t turn = (level == 0U) ? wheelTick : ((wheelTick + span - 1U) & ~(span - 1U));
+        uint32_t index = (turn >> shift) & WHEEL_MASK;
+        uint32_t distance = (uint32_t)__builtin_ctzll(rotate(occupied[level], index));
+        uint32_t ticks = (turn - wheelTick) + (distance << shift);
+        if (ticks < next) {
+            next = ticks;
+        }
+    }
+    return next;
+}
+
+/* Executes every tick up to now, skipping the ticks without work */
+static void run_timers(void) {
+    PROF_BEGIN(PROF_TIMERS);
+    uint32_t now = update_clock();
+
+    while ((int32_t)(now - wheelTick) >= 0) {
+        uint32_t next = wheel_next();
+        uint32_t remaining = now - wheelTick;
+        if (next > remaining) {
+            wheelTick = now + 1U;
+            break;
+        }
+        wheelTick += next;
+        wheel_step();
+    }
+    PROF_END(PROF_TIMERS);
+}
+
+void sched_timer_start(uint8_t timer, uint8_t type, uint32_t delay, uint32_t period) {
+    if (timer >= SCHED_TIMERS) {
+        return;
+    }
+    sched_timer_t *t = &timers[timer];
+    if (t->active != 0U) {
+        wheel_unlink(t);
+    }
+    t->type = type;
+    t->expires = update_clock() + delay;
+    t->period = period;
+    t->active = 1U;
+    wheel_add(t);
+}
+
+void sched_timer_stop(uint8_t timer) {
+    if ((timer < SCHED_TIMERS) && (timers[timer].active != 0U)) {
+        wheel_unlink(&timers[timer]);
+        timers[timer].active = 0U;
+    }
+}
+
+/* Scheduler ------------------------------------------------------------------*/
+
+void sched_init(sched_dispatch_fn dispatch) {
+    head = 0U;
+    tail = 0U;
+    dropped = 0U;
+    for (uint32_t i = 0U; i < SCHED_TIMERS; i++) {
+        timers[i].active = 0U;
+    }
+    for (uint32_t level = 0U; level < SCHED_WHEEL_LEVELS; level++) {
+        for (uint32_t slot = 0U; slot < WHEEL_SLOTS; slot++) {
+            wheel[level][slot] = NULL;
+        }
+        occupied[level] = 0U;
+    }
+    expiring = NULL;
+    clockUs = usclock_now();
+    clockRest = 0U;
+    clockTick = 0U;
+    wheelTick = 0U;
+    dispatchFn = dispatch;
+}
+
+/*
+ * Arms the clock alarm on the next tick with work, returns the time to it in
+ * us, 0 if it is already due, UINT32_MAX if no timer is running
+ */
+static uint32_t arm_alarm(void) {
+    uint32_t next = wheel_next();
+
+    if (next == UINT32_MAX) {
+        usclock_alarm_cancel();
+        return UINT32_MAX;
+    }
+    // the clock may be ahead of the wheel when a timer was started since the
+    // last run: the tick is then overdue. The alarm is limited to 2^31 us
+    // ahead, the wheel is reprogrammed on waking.
+    uint32_t ticks = wheelTick + next - clockTick;
+    if ((int32_t)ticks < 0) {
+        ticks = 0U;
+    } else if (ticks > 2000000U) {
+        ticks = 2000000U;
+    }
+    uint32_t alarm = clockUs - clockRest + (ticks * 1000U);
+    if (usclock_alarm(alarm) != 0U) {
+        return 0U;
+    }
+    uint32_t idle = alarm - usclock_now();
+    return ((int32_t)idle > 0) ? idle : 1U;
+}
+
+void sched_run(void) {
+    for (;;) {
+        run_timers();
+
+        sched_event_t event;
+        if (next_event(&event) != 0U) {
+            dispatchFn(&event);
+            continue;
+        }
+
+        // an interrupt between the check and the sleep still wakes the core:
+        // it stays pending while interrupts are masked
+        __disable_irq();
+        if (head == tail) {
+            uint32_t idle = arm_alarm();
+            if (idle != 0U) {
+                power_idle(idle);
+            }
+        }
+        __enable_irq();
+    }
+}
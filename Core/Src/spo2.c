@@ -0,0 +1,139 @@
+#include "spo2.h"
+
+#include <string.h>
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+// 10^-5 % of the coefficients to 0.1 %
+#define COEF_PER_UNIT (10000L)
+#define SPO2_MAX (1000)
+
+/* Starts a beat at the current sample */
+static void start_beat(spo2_t *spo2) {
+    spo2->crossSum = 0;
+    spo2->irSquares = 0U;
+    spo2->length = 1U;
+    spo2->armed = 0U;
+}
+
+/* R of the beat just ended, 0 if the red does not follow the IR */
+static uint32_t beat_ratio(const spo2_t *spo2, const ppg_sample_t *sample) {
+    if ((spo2->crossSum <= 0) || (spo2->irSquares == 0U) || (sample->redDc == 0U)) {
+        return 0U;
+    }
+    // both sums hold at most SPO2_MAX_BEAT products of 15-bit samples
+    uint64_t acRatio = ((uint64_t)spo2->crossSum << 16) / spo2->irSquares;
+    return (uint32_t)(((acRatio * sample->irDc) + (sample->redDc / 2U)) / sample->redDc);
+}
+
+void spo2_init(spo2_t *spo2, const int32_t coef[3]) {
+    (void)memcpy(spo2->coef, coef, sizeof(spo2->coef));
+    spo2_reset(spo2);
+}
+
+void spo2_reset(spo2_t *spo2) {
+    spo2->crossSum = 0;
+    spo2->irSquares = 0U;
+    spo2->length = 0U;
+    spo2->previous = 0;
+    spo2->armed = 0U;
+    spo2->beats = 0U;
+    spo2->rejected = 0U;
+    spo2->ratio = 0U;
+    spo2->spo2 = 0U;
+}
+
+uint8_t spo2_add(spo2_t *spo2, const ppg_sample_t *sample) {
+    uint8_t estimated = 0U;
+    uint8_t crossing = ((spo2->previous < 0) && (sample->ir >= 0) && (spo2->armed != 0U)) ? 1U : 0U;
+
+    spo2->previous = sample->ir;
+    if (sample->ir < -SPO2_HYSTERESIS) {
+        spo2->armed = 1U;
+    }
+
+    if (crossing != 0U) {
+        if (spo2->length != 0U) {
+            uint32_t ratio = (spo2->length >= SPO2_MIN_BEAT) ? beat_ratio(spo2, sample) : 0U;
+            if (ratio != 0U) {
+                spo2->ratio = ratio;
+                spo2->spo2 = spo2_from_ratio(spo2->coef, ratio);
+                spo2->beats++;
+                estimated = 1U;
+            } else {
+                spo2->rejected++;
+            }
+        }
+        start_beat(spo2);
+    } else if (spo2->length == 0U) {
+        // waiting for a beat boundary
+        return 0U;
+    } else if (spo2->length >= SPO2_MAX_BEAT) {
+        // no pulse: the next crossing starts over
+        spo2->rejected++;
+        spo2->length = 0U;
+        return 0U;
+    } else {
+        spo2->length++;
+    }
+
+    spo2->crossSum += (int32_t)sample->ir * sample->red;
+    spo2->irSquares += (uint32_t)((int32_t)sample->ir * sample->ir);
+    return estimated;
+}
+
+uint16_t spo2_from_ratio(const int32_t coef[3], uint32_t ratio) {
+    int64_t square = (int64_t)((((uint64_t)ratio * ratio) + (SPO2_RATIO_ONE / 2U)) >> 16);
+    int64_t polynomial = ((int64_t)coef[0] * square) + ((int64_t)coef[1] * (int64_t)ratio);
+
+    // back from Q16, rounded, then to 0.1 %
+    int64_t value = ((polynomial + (int64_t)(SPO2_RATIO_ONE / 2U)) >> 16) + coef[2];
+    value = (value + (COEF_PER_UNIT / 2)) / COEF_PER_UNIT;
+    if (value < 0) {
+        return 0U;
+    }
+    return (value > SPO2_MAX) ? (uint16_t)SPO2_MAX : (uint16_t)value;
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_SAMPLES (PPG_OUTPUT_HZ * 60U)
+
+// processed pulse wave of prof_pulse, R about 0.5
+#define PROFILE_DC (120000U)
+
+void spo2_profile(void) {
+    static spo2_t spo2;
+    const int32_t coef[3] = {SPO2_DEFAULT_COEF_A, SPO2_DEFAULT_COEF_B, SPO2_DEFAULT_COEF_C};
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+
+    spo2_init(&spo2, coef);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        ppg_sample_t sample;
+        sample.ir = prof_pulse(i);
+        sample.red = (int16_t)(sample.ir / 2);
+        sample.irDc = PROFILE_DC;
+        sample.redDc = PROFILE_DC;
+        uint32_t start = DWT->CYCCNT;
+        (void)spo2_add(&spo2, &sample);
+        cycles += DWT->CYCCNT - start;
+    }
+
+    str_clear(&line);
+    put_str(&line, "\r\nSpO2 [cycles per beat @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, (spo2.beats > 0U) ? (cycles / spo2.beats) : 0U);
+    put_str(&line, " over ");
+    put_uint32(&line, spo2.beats);
+    put_str(&line, " beats");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
@@ -1,4 +1,6 @@
 #include "ssd1306.h"
+#include "i2cbus.h"
+#include "prof.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h> // For memcpy
@@ -11,12 +13,17 @@ void ssd1306_Reset(void) {
 
 // Send a byte to the command register
 void ssd1306_WriteCommand(uint8_t byte) {
-    HAL_I2C_Mem_Write(&SSD1306_I2C_PORT, SSD1306_I2C_ADDR, 0x00U, 1U, &byte, 1U, HAL_MAX_DELAY);
+    i2cbus_mem_write(&SSD1306_I2C_PORT, SSD1306_I2C_ADDR, 0x00U, 1U, &byte, 1U, HAL_MAX_DELAY);
+}
+
+// Send a sequence of commands and their parameters in one transfer
+void ssd1306_WriteCommands(uint8_t *buffer, size_t buff_size) {
+    i2cbus_mem_write(&SSD1306_I2C_PORT, SSD1306_I2C_ADDR, 0x00U, 1U, buffer, buff_size, HAL_MAX_DELAY);
 }
 
 // Send data
 void ssd1306_WriteData(uint8_t *buffer, size_t buff_size) {
-    HAL_I2C_Mem_Write(&SSD1306_I2C_PORT, SSD1306_I2C_ADDR, 0x40U, 1U, buffer, buff_size, HAL_MAX_DELAY);
+    i2cbus_mem_write(&SSD1306_I2C_PORT, SSD1306_I2C_ADDR, 0x40U, 1U, buffer, buff_size, HAL_MAX_DELAY);
 }
 
 #elif defined(SSD1306_USE_SPI)
@@ -40,6 +47,14 @@ void ssd1306_WriteCommand(uint8_t byte) {
     HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_SET); // un-select OLED
 }
 
+// Send a sequence of commands and their parameters
+void ssd1306_WriteCommands(uint8_t *buffer, size_t buff_size) {
+    HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_RESET); // select OLED
+    HAL_GPIO_WritePin(SSD1306_DC_Port, SSD1306_DC_Pin, GPIO_PIN_RESET); // command
+    HAL_SPI_Transmit(&SSD1306_SPI_PORT, buffer, buff_size, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_SET); // un-select OLED
+}
+
 // Send data
 void ssd1306_WriteData(uint8_t *buffer, size_t buff_size) {
     HAL_GPIO_WritePin(SSD1306_CS_Port, SSD1306_CS_Pin, GPIO_PIN_RESET); // select OLED
@@ -181,6 +196,7 @@ void ssd1306_Fill(SSD1306_COLOR color) {
 
 /* Write the screenbuffer with changed to the screen */
 void ssd1306_UpdateScreen(void) {
+    PROF_BEGIN(PROF_OLED_UPDATE);
     // Write data to each page of RAM. Number of pages
     // depends on the screen height:
     //
@@ -193,6 +209,33 @@ void ssd1306_UpdateScreen(void) {
         ssd1306_WriteCommand(0x10U + SSD1306_X_OFFSET_UPPER);
         ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH * i], SSD1306_WIDTH);
     }
+    PROF_END(PROF_OLED_UPDATE);
+}
+
+/*
+ * Write the pages of the screenbuffer under a rectangle to the screen, from
+ * column x on: the window of the horizontal addressing mode is narrowed to
+ * them, then set back to the whole screen for ssd1306_UpdateScreen
+ */
+void ssd1306_UpdateArea(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+    if ((x >= SSD1306_WIDTH) || (y >= SSD1306_HEIGHT) || (w == 0U) || (h == 0U)) {
+        return;
+    }
+    uint8_t lastX = ((SSD1306_WIDTH - x) < w) ? (SSD1306_WIDTH - 1U) : (uint8_t)(x + w - 1U);
+    uint8_t lastY = ((SSD1306_HEIGHT - y) < h) ? (SSD1306_HEIGHT - 1U) : (uint8_t)(y + h - 1U);
+    uint8_t offset = (uint8_t)((SSD1306_X_OFFSET_UPPER << 4) | SSD1306_X_OFFSET_LOWER);
+
+    // Set Column Address, Set Page Address
+    uint8_t area[6] = {0x21U, offset + x, offset + lastX, 0x22U, y / 8U, lastY / 8U};
+    uint8_t screen[6] = {0x21U, offset, offset + SSD1306_WIDTH - 1U, 0x22U, 0x00U, (SSD1306_HEIGHT / 8U) - 1U};
+
+    PROF_BEGIN(PROF_OLED_UPDATE);
+    ssd1306_WriteCommands(area, sizeof(area));
+    for (uint8_t i = y / 8U; i <= (lastY / 8U); i++) {
+        ssd1306_WriteData(&SSD1306_Buffer[(SSD1306_WIDTH * i) + x], (size_t)(lastX - x) + 1U);
+    }
+    ssd1306_WriteCommands(screen, sizeof(screen));
+    PROF_END(PROF_OLED_UPDATE);
 }
 
 /*
@@ -219,6 +262,7 @@ void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
  * color    => Black or White
  */
 char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
+    PROF_BEGIN(PROF_OLED_CHAR);
     uint32_t i, b, j;
     char res = ch;
 
@@ -235,9 +279,9 @@ char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
     }
 
     // Use the font to write
-    if (res > 0U) {
+    if (res != '\0') {
         for (i = 0U; i < Font.FontHeight; i++) {
-            b = Font.data[((ch - 32U) * Font.FontHeight) + i];
+            b = Font.data[(((uint32_t)ch - 32U) * Font.FontHeight) + i];
             for (j = 0U; j < Font.FontWidth; j++) {
                 if ((b << j) & 0x8000U) {
                     ssd1306_DrawPixel(SSD1306.CurrentX + j, (SSD1306.CurrentY + i), (SSD1306_COLOR)color);
@@ -251,6 +295,7 @@ char ssd1306_WriteChar(char ch, FontDef Font, SSD1306_COLOR color) {
     // The current space is now taken
     SSD1306.CurrentX += Font.FontWidth;
 
+    PROF_END(PROF_OLED_CHAR);
     // Return written char for validation
     return res;
 }
@@ -0,0 +1,104 @@
+#include "stats.h"
+
+#include <string.h>
+
+/* Quotient rounded to the nearest integer, halves away from zero */
+static int64_t div_round(int64_t num, uint32_t den) {
+    int64_t half = (int64_t)(den / 2U);
+    return (num >= 0) ? ((num + half) / (int64_t)den) : -((-num + half) / (int64_t)den);
+}
+
+uint32_t stats_isqrt(uint64_t value) {
+    uint64_t root = 0U;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0U) {
+        if (value >= (root + bit)) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+void stats_reset(stats_t *stats) {
+    (void)memset(stats, 0, sizeof(*stats));
+    stats->min = UINT16_MAX;
+}
+
+void stats_add(stats_t *stats, uint16_t value, uint8_t weight) {
+    int64_t x = (int64_t)value << STATS_FRACTION_BITS;
+
+    stats->count += 1U;
+    if (value < stats->min) {
+        stats->min = value;
+    }
+    if (value > stats->max) {
+        stats->max = value;
+    }
+
+    // Welford: the product of the deviations from the old and the new mean
+    // adds the contribution of the sample to m2 without cancellation. The mean
+    // is derived from the exact sum, its rounding does not accumulate.
+    int64_t delta = x - stats->mean;
+    stats->sum += value;
+    stats->mean = (int32_t)div_round((int64_t)(stats->sum << STATS_FRACTION_BITS), stats->count);
+    int64_t product = delta * (x - stats->mean);
+    // both deviations have the same sign, but for the rounding of the mean
+    if (product > 0) {
+        stats->m2 += (uint64_t)product;
+    }
+
+    stats->weightedSum += (uint64_t)value * weight;
+    stats->weightSum += weight;
+}
+
+uint16_t stats_mean(const stats_t *stats) {
+    return (uint16_t)((stats->mean + (int32_t)(STATS_ONE / 2U)) >> STATS_FRACTION_BITS);
+}
+
+uint16_t stats_weighted_mean(const stats_t *stats) {
+    if (stats->weightSum == 0U) {
+        return stats_mean(stats);
+    }
+    return (uint16_t)((stats->weightedSum + (stats->weightSum / 2U)) / stats->weightSum);
+}
+
+uint64_t stats_variance(const stats_t *stats) {
+    return (stats->count < 2U) ? 0U : (stats->m2 / (stats->count - 1U));
+}
+
+/* sqrt(variance / count), variance in Q48.16, result in Q24.8 */
+static uint32_t root_of_ratio(uint64_t variance, uint32_t count) {
+    // Q48.16 under the root gives Q24.8; when it fits, the root is taken in
+    // Q32 and rounded to Q24.8 for precision on small variances
+    if (variance < (1ULL << 47)) {
+        return (stats_isqrt((variance << 16) / count) + (STATS_ONE / 2U)) >> STATS_FRACTION_BITS;
+    }
+    return stats_isqrt(variance / count);
+}
+
+uint32_t stats_std_error(const stats_t *stats) {
+    if (stats->count < 2U) {
+        return 0U;
+    }
+    return root_of_ratio(stats_variance(stats), stats->count);
+}
+
+uint32_t stats_std_error_correlated(const stats_t *stats, uint32_t correlation) {
+    if (stats->count < 2U) {
+        return 0U;
+    }
+    uint64_t variance = stats_variance(stats);
+    if (variance < STATS_QUANTISATION) {
+        variance = STATS_QUANTISATION;
+    }
+    uint32_t effective = (correlation > 1U) ? (stats->count / correlation) : stats->count;
+    return root_of_ratio(variance, (effective > 0U) ? effective : 1U);
+}
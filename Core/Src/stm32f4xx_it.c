@@ -55,8 +55,9 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern RTC_HandleTypeDef hrtc;
 extern TIM_HandleTypeDef htim2;
-extern TIM_HandleTypeDef htim10;
+extern TIM_HandleTypeDef htim5;
 extern UART_HandleTypeDef huart2;
 /* USER CODE BEGIN EV */
 
@@ -187,16 +188,16 @@ void SysTick_Handler(void) {
 /******************************************************************************/
 
 /**
- * @brief This function handles TIM1 update interrupt and TIM10 global interrupt.
+ * @brief This function handles RTC wake-up interrupt through EXTI line 22.
  */
-void TIM1_UP_TIM10_IRQHandler(void) {
-    /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 0 */
+void RTC_WKUP_IRQHandler(void) {
+    /* USER CODE BEGIN RTC_WKUP_IRQn 0 */
 
-    /* USER CODE END TIM1_UP_TIM10_IRQn 0 */
-    HAL_TIM_IRQHandler(&htim10);
-    /* USER CODE BEGIN TIM1_UP_TIM10_IRQn 1 */
+    /* USER CODE END RTC_WKUP_IRQn 0 */
+    HAL_RTCEx_WakeUpTimerIRQHandler(&hrtc);
+    /* USER CODE BEGIN RTC_WKUP_IRQn 1 */
 
-    /* USER CODE END TIM1_UP_TIM10_IRQn 1 */
+    /* USER CODE END RTC_WKUP_IRQn 1 */
 }
 
 /**
@@ -233,11 +234,33 @@ void EXTI15_10_IRQHandler(void) {
 
     /* USER CODE END EXTI15_10_IRQn 0 */
     HAL_GPIO_EXTI_IRQHandler(BUTTON_Pin);
+    HAL_GPIO_EXTI_IRQHandler(SQW_Pin);
     /* USER CODE BEGIN EXTI15_10_IRQn 1 */
 
     /* USER CODE END EXTI15_10_IRQn 1 */
 }
 
+/**
+ * @brief This function handles TIM5 global interrupt.
+ */
+void TIM5_IRQHandler(void) {
+    /* USER CODE BEGIN TIM5_IRQn 0 */
+
+    /* USER CODE END TIM5_IRQn 0 */
+    HAL_TIM_IRQHandler(&htim5);
+    /* USER CODE BEGIN TIM5_IRQn 1 */
+
+    /* USER CODE END TIM5_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
+/**
+ * @brief This function handles EXTI line3 interrupt, the console RX line.
+ *
+ * Set up by console_start on PA3, which stays in USART2 alternate function.
+ */
+void EXTI3_IRQHandler(void) {
+    HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+}
 
 /* USER CODE END 1 */
@@ -4,7 +4,7 @@
 
 static void str_reverse(char *str, size_t startIdx, size_t size) {
     for (size_t i = startIdx; i < (startIdx + (size / 2U)); i++) {
-        size_t j = i + size - 1U;
+        size_t j = (startIdx + size - 1U) - (i - startIdx);
         char tmp = str[i];
         str[i] = str[j];
         str[j] = tmp;
@@ -15,6 +15,8 @@ strbuf mkbuf(char *buf) {
     strbuf sb;
     sb.buf = buf;
     sb.index = 0U;
+    // str_clear measures the previous content, the array may be uninitialised
+    sb.buf[0] = '\0';
     return sb;
 }
 
@@ -95,6 +97,13 @@ void put_char(strbuf *buffer, char value) {
     buffer->index++;
 }
 
+void put_hex8(strbuf *buffer, uint8_t value) {
+    static const char digits[16] = "0123456789abcdef";
+    buffer->buf[buffer->index] = digits[value >> 4];
+    buffer->buf[buffer->index + 1U] = digits[value & 0x0FU];
+    buffer->index += 2U;
+}
+
 void put_str(strbuf *buffer, const char *value) {
     (void)strcpy(&buffer->buf[buffer->index], value);
     buffer->index += strlen(value);
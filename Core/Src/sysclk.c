@@ -0,0 +1,178 @@
+#include "sysclk.h"
+
+#include <string.h>
+
+#include "i2c.h"
+#include "strfmt.h"
+#include "tim.h"
+#include "usart.h"
+
+// PLL from HSI: 16 MHz / 16 * 336 / 4 = 84 MHz, 48 MHz on the Q output
+#define PLL_M (16U)
+#define PLL_N (336U)
+#define PLL_Q (7U)
+
+typedef struct sysclk_config {
+    uint32_t source;      // RCC_SYSCLKSOURCE_*
+    uint32_t apb1Divider; // PCLK1 at most 42 MHz
+    uint32_t latency;     // flash wait states, one per 30 MHz at 2.7-3.6 V
+} sysclk_config_t;
+
+// indexed by sysclk_profile_t, voltage scale 2 covers both
+static const sysclk_config_t configs[SYSCLK_PROFILES] = {
+    {RCC_SYSCLKSOURCE_HSI, RCC_HCLK_DIV1, FLASH_LATENCY_0},
+    {RCC_SYSCLKSOURCE_PLLCLK, RCC_HCLK_DIV2, FLASH_LATENCY_2},
+};
+
+// timers retimed on a switch, all on APB1
+static TIM_HandleTypeDef *const timers[] = {&htim2, &htim3, &htim5};
+#define TIMERS (sizeof(timers) / sizeof(timers[0]))
+
+static uint32_t countHz[TIMERS];
+static sysclk_profile_t active = SYSCLK_LOW;
+
+/* Kernel clock of the APB1 timers: PCLK1, doubled when APB1 is divided */
+static uint32_t timer_clock(void) {
+    RCC_ClkInitTypeDef clk;
+    uint32_t latency;
+
+    HAL_RCC_GetClockConfig(&clk, &latency);
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    return (clk.APB1CLKDivider == RCC_HCLK_DIV1) ? pclk : (2U * pclk);
+}
+
+/*
+ * The prescaler is preloaded: an update event loads it at once, with URS set
+ * so that it raises no interrupt, and the counter it clears is written back
+ */
+static void retime_timer(TIM_HandleTypeDef *htim, uint32_t hz, uint32_t kernelHz) {
+    uint32_t prescaler = (kernelHz / hz) - 1U;
+    uint32_t counter = __HAL_TIM_GET_COUNTER(htim);
+
+    htim->Init.Prescaler = prescaler;
+    __HAL_TIM_SET_PRESCALER(htim, prescaler);
+    __HAL_TIM_URS_ENABLE(htim);
+    (void)HAL_TIM_GenerateEvent(htim, TIM_EVENTSOURCE_UPDATE);
+    __HAL_TIM_URS_DISABLE(htim);
+    __HAL_TIM_SET_COUNTER(htim, counter);
+}
+
+static void retime_timers(void) {
+    uint32_t kernelHz = timer_clock();
+
+    for (uint32_t i = 0U; i < TIMERS; i++) {
+        retime_timer(timers[i], countHz[i], kernelHz);
+    }
+}
+
+/* USART2 and I2C1 are idle: the caller does not switch during a transfer */
+static void retime_buses(void) {
+    huart2.Instance->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), huart2.Init.BaudRate);
+    if (HAL_I2C_Init(&hi2c1) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+static HAL_StatusTypeDef pll_config(uint32_t state) {
+    RCC_OscInitTypeDef osc = {0};
+
+    osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    osc.PLL.PLLState = state;
+    osc.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+    osc.PLL.PLLM = PLL_M;
+    osc.PLL.PLLN = PLL_N;
+    osc.PLL.PLLP = RCC_PLLP_DIV4;
+    osc.PLL.PLLQ = PLL_Q;
+    return HAL_RCC_OscConfig(&osc);
+}
+
+/* Switches SYSCLK and the bus dividers, then retimes the peripherals */
+static HAL_StatusTypeDef apply(sysclk_profile_t profile) {
+    const sysclk_config_t *config = &configs[profile];
+    RCC_ClkInitTypeDef clk = {0};
+
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource = config->source;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = config->apb1Divider;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+
+    // the switch waits on HAL_GetTick timeouts: SysTick must keep running
+    HAL_StatusTypeDef status = HAL_RCC_ClockConfig(&clk, config->latency);
+
+    // the timers are reloaded together, no interrupt sees them on different rates
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    retime_timers();
+    __set_PRIMASK(primask);
+
+    retime_buses();
+    return status;
+}
+
+void sysclk_init(void) {
+    uint32_t kernelHz = timer_clock();
+
+    for (uint32_t i = 0U; i < TIMERS; i++) {
+        countHz[i] = kernelHz / (timers[i]->Init.Prescaler + 1U);
+    }
+    active = SYSCLK_LOW;
+}
+
+HAL_StatusTypeDef sysclk_set(sysclk_profile_t profile) {
+    if (profile >= SYSCLK_PROFILES) {
+        return HAL_ERROR;
+    }
+    if (profile == active) {
+        return HAL_OK;
+    }
+
+    if ((configs[profile].source == RCC_SYSCLKSOURCE_PLLCLK) && (pll_config(RCC_PLL_ON) != HAL_OK)) {
+        return HAL_ERROR;
+    }
+    HAL_StatusTypeDef status = apply(profile);
+    if (status == HAL_OK) {
+        active = profile;
+    }
+    if (configs[active].source != RCC_SYSCLKSOURCE_PLLCLK) {
+        (void)pll_config(RCC_PLL_OFF);
+    }
+    return status;
+}
+
+sysclk_profile_t sysclk_get(void) {
+    return active;
+}
+
+void sysclk_restore(void) {
+    if (active == SYSCLK_LOW) {
+        return;
+    }
+
+    // the dividers are kept through STOP: until the PLL is back the peripherals
+    // follow HSI divided as for the active profile
+    SystemCoreClockUpdate();
+    retime_timers();
+    if ((pll_config(RCC_PLL_ON) != HAL_OK) || (apply(active) != HAL_OK)) {
+        // the PLL did not lock: stay on HSI, as the peripherals now are
+        (void)apply(SYSCLK_LOW);
+        active = SYSCLK_LOW;
+    }
+}
+
+void sysclk_report(void) {
+    static const char *const profileNames[SYSCLK_PROFILES] = {"low", "fast"};
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+
+    str_clear(&line);
+    put_str(&line, "\r\nClock: ");
+    put_str(&line, profileNames[active]);
+    put_str(&line, ", HCLK ");
+    put_uint32(&line, HAL_RCC_GetHCLKFreq() / 1000000U);
+    put_str(&line, " MHz, PCLK1 ");
+    put_uint32(&line, HAL_RCC_GetPCLK1Freq() / 1000000U);
+    put_str(&line, " MHz");
+    put_end(&line);
+    PRINT(line.buf);
+}
@@ -0,0 +1,74 @@
+#include "trace.h"
+
+#include <string.h>
+
+#include "main.h"
+#include "strfmt.h"
+#include "usart.h"
+#include "usclock.h"
+
+static trace_event_t ring[TRACE_SIZE];
+static uint32_t head = 0U; // events recorded since boot, slot is head % TRACE_SIZE
+static volatile uint8_t frozen = 0U;
+
+_Static_assert((TRACE_SIZE & (TRACE_SIZE - 1U)) == 0U, "TRACE_SIZE must be a power of two");
+
+#ifdef TRACE_OBSERVER
+void TRACE_OBSERVER(uint8_t type, uint8_t arg, uint16_t value);
+#endif
+
+void trace_record(trace_type_t type, uint8_t arg, uint16_t value) {
+#ifdef TRACE_OBSERVER
+    TRACE_OBSERVER((uint8_t)type, arg, value);
+#endif
+
+    if (frozen != 0U) {
+        return;
+    }
+
+    // an interrupt may record between the claim and the stamp, so slot order
+    // and timestamp order can differ by one event: the viewer sorts by time
+    uint32_t slot = __atomic_fetch_add(&head, 1U, __ATOMIC_RELAXED) & (TRACE_SIZE - 1U);
+    trace_event_t *event = &ring[slot];
+    event->timestamp = usclock_now();
+    event->type = (uint8_t)type;
+    event->arg = arg;
+    event->value = value;
+}
+
+void trace_dump(void) {
+    char lineStr[48];
+    strbuf line = mkbuf(lineStr);
+
+    frozen = 1U;
+
+    uint32_t total = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    uint32_t count = (total < TRACE_SIZE) ? total : TRACE_SIZE;
+
+    str_clear(&line);
+    put_str(&line, "\r\ntrace ");
+    put_uint32(&line, count);
+    put_char(&line, ' ');
+    put_uint32(&line, total - count);
+    put_end(&line);
+    PRINT(line.buf);
+
+    for (uint32_t i = total - count; i != total; i++) {
+        const trace_event_t *event = &ring[i & (TRACE_SIZE - 1U)];
+        str_clear(&line);
+        put_str(&line, "\r\n");
+        put_uint32(&line, event->timestamp);
+        put_char(&line, ' ');
+        put_uint8(&line, event->type);
+        put_char(&line, ' ');
+        put_uint8(&line, event->arg);
+        put_char(&line, ' ');
+        put_uint16(&line, event->value);
+        put_end(&line);
+        PRINT(line.buf);
+    }
+
+    PRINT("\r\ntrace end");
+
+    frozen = 0U;
+}
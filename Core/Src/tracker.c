@@ -0,0 +1,140 @@
+#include "tracker.h"
+
+#include <string.h>
+
+#include "stats.h"
+
+#if PROF_ENABLED
+#include "strfmt.h"
+#include "usart.h"
+#endif
+
+#define GAIN_BITS (16U)
+#define CONFIDENCE_FULL (100U)
+
+/* Scales a Q8 value, rounds it and saturates it to 16 bits */
+static uint16_t scaled(uint64_t value, uint16_t scale) {
+    uint64_t result = ((value * scale) + (1UL << (TRACKER_FRACTION_BITS - 1U))) >> TRACKER_FRACTION_BITS;
+    return (result > UINT16_MAX) ? UINT16_MAX : (uint16_t)result;
+}
+
+/* Sets the estimate on a sample */
+static void restart(tracker_t *tracker, int32_t measurement, uint64_t noise) {
+    tracker->estimate = measurement;
+    tracker->variance = (noise > UINT32_MAX) ? UINT32_MAX : (uint32_t)noise;
+    tracker->outliers = 0U;
+    tracker->primed = 1U;
+    tracker->updates++;
+}
+
+void tracker_init(tracker_t *tracker, uint32_t processNoise, uint32_t measurementNoise) {
+    (void)memset(tracker, 0, sizeof(*tracker));
+    tracker->processNoise = processNoise;
+    tracker->measurementNoise = measurementNoise;
+}
+
+uint8_t tracker_add(tracker_t *tracker, uint16_t value, uint8_t confidence) {
+    int32_t measurement = (int32_t)value * (int32_t)(1L << TRACKER_FRACTION_BITS);
+
+    if (tracker->primed != 0U) {
+        tracker->variance = (tracker->variance > (UINT32_MAX - tracker->processNoise))
+                                ? UINT32_MAX
+                                : (tracker->variance + tracker->processNoise);
+    }
+    if (confidence == 0U) {
+        return 0U;
+    }
+    if (confidence > CONFIDENCE_FULL) {
+        confidence = CONFIDENCE_FULL;
+    }
+    uint64_t noise = ((uint64_t)tracker->measurementNoise * CONFIDENCE_FULL) / confidence;
+    if (tracker->primed == 0U) {
+        restart(tracker, measurement, noise);
+        return 1U;
+    }
+
+    // innovation against its variance, both in Q16
+    int32_t innovation = measurement - tracker->estimate;
+    uint64_t spread = (uint64_t)tracker->variance + noise;
+    uint64_t squared = (uint64_t)((int64_t)innovation * (int64_t)innovation);
+    if (squared > ((TRACKER_GATE * TRACKER_GATE) * (spread << TRACKER_FRACTION_BITS))) {
+        tracker->rejected++;
+        tracker->outliers++;
+        if (tracker->outliers < TRACKER_OUTLIER_RUN) {
+            return 0U;
+        }
+        // the reading moved: start over on it
+        restart(tracker, measurement, noise);
+        return 1U;
+    }
+
+    uint32_t gain = (uint32_t)(((uint64_t)tracker->variance << GAIN_BITS) / spread);
+    tracker->estimate += (int32_t)(((int64_t)innovation * (int64_t)gain) / (int64_t)(1L << GAIN_BITS));
+    tracker->variance -= (uint32_t)(((uint64_t)tracker->variance * gain) >> GAIN_BITS);
+    tracker->outliers = 0U;
+    tracker->updates++;
+    return 1U;
+}
+
+uint16_t tracker_value(const tracker_t *tracker, uint16_t scale) {
+    if ((tracker->primed == 0U) || (tracker->estimate <= 0)) {
+        return 0U;
+    }
+    return scaled((uint64_t)tracker->estimate, scale);
+}
+
+uint16_t tracker_deviation(const tracker_t *tracker, uint16_t scale) {
+    if (tracker->primed == 0U) {
+        return UINT16_MAX;
+    }
+    // the root of a Q16 variance is a Q8 deviation
+    return scaled(stats_isqrt((uint64_t)tracker->variance << TRACKER_FRACTION_BITS), scale);
+}
+
+#if PROF_ENABLED
+
+#define PROFILE_RATE_HZ (100U)
+#define PROFILE_SAMPLES (PROFILE_RATE_HZ * 60U)
+
+// heart rate reports, 0.1 bpm: a 6 bpm triangle over 20 s, 1 bpm of
+// quantisation noise, a 40 bpm glitch of 200 ms every 1.5 s
+#define PROFILE_HR (720)
+#define PROFILE_SWING (60)
+#define PROFILE_SWING_PERIOD (PROFILE_RATE_HZ * 20U)
+#define PROFILE_GLITCH (400)
+#define PROFILE_GLITCH_PERIOD (PROFILE_RATE_HZ * 3U / 2U)
+#define PROFILE_GLITCH_LENGTH (PROFILE_RATE_HZ / 5U)
+#define PROFILE_DRIFT (64U)
+#define PROFILE_NOISE (102400U)
+
+void tracker_profile(void) {
+    static tracker_t tracker;
+    char lineStr[80];
+    strbuf line = mkbuf(lineStr);
+    uint32_t cycles = 0U;
+
+    tracker_init(&tracker, PROFILE_DRIFT, PROFILE_NOISE);
+    for (uint32_t i = 0U; i < PROFILE_SAMPLES; i++) {
+        int32_t swing = prof_triangle(i, PROFILE_SWING_PERIOD, PROFILE_SWING / 2) + (PROFILE_SWING / 2);
+        int32_t value = PROFILE_HR + swing + (int32_t)(i % 10U);
+        if ((i % PROFILE_GLITCH_PERIOD) < PROFILE_GLITCH_LENGTH) {
+            value += PROFILE_GLITCH;
+        }
+        uint32_t start = DWT->CYCCNT;
+        (void)tracker_add(&tracker, (uint16_t)value, 95U);
+        cycles += DWT->CYCCNT - start;
+    }
+
+    str_clear(&line);
+    put_str(&line, "\r\nTracker [cycles @ ");
+    put_uint32(&line, SystemCoreClock);
+    put_str(&line, " Hz]: ");
+    put_uint32(&line, cycles / PROFILE_SAMPLES);
+    put_str(&line, " per sample, ");
+    put_uint32(&line, (tracker.rejected * 100U) / PROFILE_SAMPLES);
+    put_str(&line, " % rejected");
+    put_end(&line);
+    PRINT(line.buf);
+}
+
+#endif // PROF_ENABLED
@@ -0,0 +1,95 @@
+#include "usclock.h"
+
+#include <string.h>
+
+#include "tim.h"
+
+void usclock_start(void) {
+    (void)HAL_TIM_Base_Start(&htim5);
+}
+
+uint32_t usclock_now(void) {
+    return __HAL_TIM_GET_COUNTER(&htim5);
+}
+
+void usclock_advance(uint32_t us) {
+    __HAL_TIM_SET_COUNTER(&htim5, __HAL_TIM_GET_COUNTER(&htim5) + us);
+}
+
+uint8_t usclock_alarm(uint32_t timestamp) {
+    __HAL_TIM_SET_COMPARE(&htim5, TIM_CHANNEL_1, timestamp);
+    __HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_CC1);
+    __HAL_TIM_ENABLE_IT(&htim5, TIM_IT_CC1);
+
+    // checked after arming: a match from now on raises the interrupt, a
+    // timestamp already passed would only match after the wrap-around
+    if ((int32_t)(timestamp - usclock_now()) <= 0) {
+        usclock_alarm_cancel();
+        return 1U;
+    }
+    return 0U;
+}
+
+void usclock_alarm_cancel(void) {
+    __HAL_TIM_DISABLE_IT(&htim5, TIM_IT_CC1);
+    __HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_CC1);
+}
+
+void usclock_stats_reset(usclock_stats_t *stats) {
+    (void)memset(stats, 0, sizeof(*stats));
+    stats->min = UINT32_MAX;
+}
+
+void usclock_stats_add(usclock_stats_t *stats, uint32_t timestamp) {
+    if (stats->started == 0U) {
+        stats->started = 1U;
+        stats->last = timestamp;
+        return;
+    }
+
+    uint32_t interval = timestamp - stats->last;
+    stats->last = timestamp;
+
+    stats->count += 1U;
+    stats->sum += interval;
+    if (interval < stats->min) {
+        stats->min = interval;
+    }
+    if (interval > stats->max) {
+        stats->max = interval;
+    }
+
+    uint32_t bin = interval / USCLOCK_BIN_US;
+    if (bin >= USCLOCK_BINS) {
+        bin = USCLOCK_BINS - 1U;
+    }
+    if (stats->hist[bin] < UINT16_MAX) {
+        stats->hist[bin] += 1U;
+    }
+}
+
+uint32_t usclock_stats_mean(const usclock_stats_t *stats) {
+    if (stats->count == 0U) {
+        return 0U;
+    }
+    return (uint32_t)(stats->sum / stats->count);
+}
+
+uint32_t usclock_stats_percentile(const usclock_stats_t *stats, uint8_t percent) {
+    if (stats->count == 0U) {
+        return 0U;
+    }
+
+    // rank of the percentile, rounded up
+    uint32_t rank = (uint32_t)((((uint64_t)stats->count * percent) + 99U) / 100U);
+    uint32_t seen = 0U;
+
+    for (uint32_t bin = 0U; bin < (USCLOCK_BINS - 1U); bin++) {
+        seen += stats->hist[bin];
+        if (seen >= rank) {
+            uint32_t edge = (bin + 1U) * USCLOCK_BIN_US;
+            return (edge < stats->max) ? edge : stats->max;
+        }
+    }
+    return stats->max;
+}
@@ -0,0 +1,14 @@
+#ifndef _ANSIDECL_H_
+#define _ANSIDECL_H_
+
+/* The parts of the newlib header used by the firmware */
+
+#ifdef __cplusplus
+#define _BEGIN_STD_C extern "C" {
+#define _END_STD_C }
+#else
+#define _BEGIN_STD_C
+#define _END_STD_C
+#endif
+
+#endif // _ANSIDECL_H_
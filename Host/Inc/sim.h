@@ -0,0 +1,195 @@
+#ifndef SIM_H
+#define SIM_H
+
+/**
+ * @file sim.h
+ * @brief Virtual time, interrupt dispatch and I2C bus of the host simulator
+ *
+ * Time only advances when the firmware waits: HAL_Delay and every blocking
+ * transfer advance the virtual clock by the duration the transfer would take
+ * on the target. Scheduled events (timer updates, device activity, stimuli)
+ * are executed at their exact virtual time; the interrupts they raise are
+ * dispatched as soon as they are enabled, unmasked and no other handler is
+ * running. Runs are therefore fully deterministic.
+ *
+ * __WFI and HAL_PWR_EnterSTOPMode advance the clock up to the next interrupt.
+ * SysTick wakes the core from SLEEP every millisecond unless it is suspended.
+ * In STOP the timers and USART2 are frozen: only EXTI lines and the RTC
+ * wake-up timer wake the core, the characters received meanwhile are lost.
+ */
+
+#include <stdint.h>
+
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief Time the PLL takes to lock, HAL_RCC_OscConfig waits for it
+ *
+ * The clock tree follows the RCC configuration: the timers count on their APB
+ * kernel clock, the SCL of I2C1 and the baud rate of USART2 follow PCLK1 and
+ * the registers set at their initialisation. STOP mode stops the PLL and
+ * wakes the core up on HSI, the bus dividers kept.
+ */
+#define SIM_PLL_LOCK_US (100U)
+
+/**
+ * @brief Frequency of the simulated LSI, the RTC clock
+ *
+ * Off the nominal LSI_VALUE, as a real LSI is: the firmware has to measure it.
+ */
+#define SIM_LSI_HZ (31500U)
+
+typedef void (*sim_event_fn)(void *ctx);
+
+/**
+ * @brief Resets the simulator: time 0, no events, no devices, pins released
+ *
+ * @param coldBoot non-zero to report a power-on reset in the RCC flags
+ */
+void sim_reset(uint8_t coldBoot);
+
+/**
+ * @brief Current virtual time in microseconds
+ */
+uint64_t sim_now(void);
+
+/**
+ * @brief Advances the virtual time, executing events and interrupts on the way
+ *
+ * @param us microseconds to advance
+ */
+void sim_advance(uint64_t us);
+
+/**
+ * @brief Advances the virtual time up to an absolute time
+ *
+ * @param time virtual time to reach, us, nothing happens if already past
+ */
+void sim_advance_to(uint64_t time);
+
+/**
+ * @brief Schedules an event
+ *
+ * @param time absolute virtual time of the event, us
+ * @param fn function executed at that time, in "hardware" context
+ * @param ctx argument of the function, also identifies the event for
+ *            sim_cancel
+ */
+void sim_schedule(uint64_t time, sim_event_fn fn, void *ctx);
+
+/**
+ * @brief Cancels every scheduled event with the given function and context
+ */
+void sim_cancel(sim_event_fn fn, void *ctx);
+
+/**
+ * @brief Marks an interrupt as pending, it is dispatched at the next safe point
+ */
+void sim_irq_pend(IRQn_Type irq);
+
+/**
+ * @brief Runs the firmware until the virtual time reaches the limit
+ *
+ * @param entry firmware entry point, never returns by itself
+ * @param limit virtual time to stop at, us
+ */
+void sim_run(int (*entry)(void), uint64_t limit);
+
+/* GPIO ---------------------------------------------------------------------*/
+
+/**
+ * @brief Drives an input pin from a simulated device
+ *
+ * A transition on a pin configured in interrupt mode raises the EXTI line.
+ */
+void sim_gpio_drive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level);
+
+typedef void (*sim_gpio_watch_fn)(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level, void *ctx);
+
+/**
+ * @brief Registers a function called on every write of an output pin
+ */
+void sim_gpio_watch(sim_gpio_watch_fn fn, void *ctx);
+
+/* I2C ----------------------------------------------------------------------*/
+
+/**
+ * @brief Simulated I2C device
+ *
+ * Embed it as the first member of the device model. write receives the bytes
+ * of a write transfer (register address included), read fills the bytes of a
+ * read transfer. Returning HAL_ERROR models a NACK.
+ */
+typedef struct sim_i2c_device {
+    uint8_t address; // 8-bit write address
+    HAL_StatusTypeDef (*write)(struct sim_i2c_device *dev, const uint8_t *data, uint16_t size);
+    HAL_StatusTypeDef (*read)(struct sim_i2c_device *dev, uint8_t *data, uint16_t size);
+    struct sim_i2c_device *next;
+} sim_i2c_device_t;
+
+/**
+ * @brief Connects a device to I2C1
+ */
+void sim_i2c_attach(sim_i2c_device_t *dev);
+
+/**
+ * @brief Device answering at an address, the one attached last, NULL if none
+ *
+ * @param address 8-bit address, the read/write bit is ignored
+ */
+sim_i2c_device_t *sim_i2c_find(uint16_t address);
+
+/**
+ * @brief Virtual time the transfer being processed ends at, us
+ *
+ * Valid in the write and read functions of a device, which are called when
+ * the transfer starts.
+ */
+uint64_t sim_i2c_transfer_end(void);
+
+/* UART ---------------------------------------------------------------------*/
+
+typedef void (*sim_uart_sink_fn)(const uint8_t *data, uint16_t size, void *ctx);
+
+/**
+ * @brief Sets the receiver of the bytes transmitted on USART2, NULL discards them
+ */
+void sim_uart_sink(sim_uart_sink_fn fn, void *ctx);
+
+/**
+ * @brief Sends a character to USART2, as typed on the serial console
+ */
+void sim_uart_inject(uint8_t c);
+
+/* Firmware trace -----------------------------------------------------------*/
+
+typedef void (*sim_trace_fn)(uint8_t type, uint8_t arg, uint16_t value, void *ctx);
+
+/**
+ * @brief Registers a function called on every trace_record of the firmware
+ *
+ * Called synchronously, at the virtual time of the event (see trace.h for the
+ * event types).
+ */
+void sim_trace_watch(sim_trace_fn fn, void *ctx);
+
+/* Statistics ---------------------------------------------------------------*/
+
+typedef struct sim_stats {
+    uint32_t i2cTransfers; // transfers started on I2C1
+    uint32_t i2cBytes;     // bytes on I2C1, addresses included
+    uint32_t i2cNacks;     // transfers to an absent device or refused
+    uint32_t uartBytes;    // bytes transmitted on USART2
+    uint32_t irqs;         // interrupt handlers dispatched
+    uint64_t sleepUs;      // virtual time spent in __WFI
+    uint64_t stopUs;       // virtual time spent in STOP mode
+    uint64_t pllUs;        // virtual time with SYSCLK on the PLL
+    uint64_t pllSleepUs;   // part of sleepUs with SYSCLK on the PLL
+} sim_stats_t;
+
+/**
+ * @brief Counters of the current run
+ */
+const sim_stats_t *sim_stats(void);
+
+#endif // SIM_H
@@ -0,0 +1,32 @@
+#ifndef SIM_DS1307_H
+#define SIM_DS1307_H
+
+/**
+ * @file sim_ds1307.h
+ * @brief DS1307 real-time clock model for the host simulator
+ *
+ * Models the 64 byte register file with its auto-incrementing pointer, the
+ * BCD time keeping driven by the 32768 Hz oscillator and the SQW/OUT pin,
+ * wired to PB15 as on the board.
+ */
+
+#include "sim.h"
+
+typedef struct sim_ds1307 {
+    sim_i2c_device_t dev;
+    uint8_t regs[64];
+    uint8_t pointer;
+    uint64_t secondStart; // virtual time the current second started at, us
+} sim_ds1307_t;
+
+/**
+ * @brief Initialises the model and connects it to I2C1
+ *
+ * @param rtc model to initialise
+ * @param seconds, minutes, hours, day, date, month, year initial time, year
+ *        in 0..99, the oscillator runs and the RAM is cleared
+ */
+void sim_ds1307_init(sim_ds1307_t *rtc, uint8_t seconds, uint8_t minutes, uint8_t hours, uint8_t day, uint8_t date,
+                     uint8_t month, uint8_t year);
+
+#endif // SIM_DS1307_H
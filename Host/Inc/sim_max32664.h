@@ -0,0 +1,140 @@
+#ifndef SIM_MAX32664_H
+#define SIM_MAX32664_H
+
+/**
+ * @file sim_max32664.h
+ * @brief Behavioural model of the MAX32664 biometric sensor hub
+ *
+ * Speaks the family/index/write byte protocol of max32664.h on I2C1: every
+ * write is a command, processed after a delay that depends on its family, and
+ * the following read returns the status byte and the response. Reading before
+ * the processing ends returns SB_DEV_BUSY. The reset (PC0) and MFIO (PC1)
+ * lines select application or bootloader mode like on the real chip, and the
+ * hub does not answer while it boots.
+ *
+ * Once the MAX30101 is enabled and an output mode is set, samples are pushed
+ * in the output FIFO at the configured rate. Their content is synthetic: a
+ * finger placed at a configurable time, a heart rate and an SpO2 slowly
+ * varying around their nominal values, and the matching red/IR PPG waveform.
+ *
+ * The accelerometer is not fitted by default, as on the SparkFun board. When
+ * it is, its X/Y/Z follow the MAX30101 samples once enabled, with gravity on
+ * Z; a motion episode shakes them, adds the shake to the PPG and makes the
+ * algorithm lock onto it.
+ */
+
+#include "sim.h"
+
+#define SIM_MAX32664_FIFO_SIZE (64U)
+
+/* counter byte, 4 LEDs of 24 bit, accelerometer, extended algorithm report */
+#define SIM_MAX32664_SAMPLE_MAX (1U + 12U + 6U + 11U)
+
+#define SIM_MAX32664_COMMAND_MAX (32U)
+
+// systolic peaks kept for the benchmarks, a power of two
+#define SIM_MAX32664_PEAKS (8U)
+#define SIM_MAX32664_RESPONSE_MAX (16U)
+
+typedef struct sim_max32664_config {
+    uint32_t sampleRateHz;     // output FIFO rate
+    uint32_t fifoDepth;        // samples kept, the oldest is dropped on overflow
+    uint32_t cmdDelayUs;       // processing time of a command
+    uint32_t enableDelayUs;    // processing time of ENABLE_SENSOR and ENABLE_ALGORITHM
+    uint32_t appBootUs;        // reset release to application mode
+    uint32_t bootloaderBootUs; // reset release to bootloader mode
+    uint64_t fingerOnUs;       // virtual time the finger is placed
+    uint64_t fingerOffUs;      // virtual time the finger is removed
+    uint16_t heartRate;        // nominal heart rate, 0.1 bpm
+    uint16_t oxygen;           // nominal SpO2, 0.1 %
+    uint64_t glitchPeriodUs;   // time between two algorithm glitches, 0 for none
+    uint8_t confidence;        // algorithm confidence once settled, %
+    uint16_t respiration;      // breathing rate, 0.1 breaths/min, 0 for none
+    uint8_t accelerometer;     // accelerometer fitted
+    uint64_t motionOnUs;       // virtual time the hand starts shaking
+    uint64_t motionOffUs;      // virtual time it stops
+    uint64_t desatOnUs;        // virtual time the SpO2 drops
+    uint64_t desatOffUs;       // virtual time it recovers
+} sim_max32664_config_t;
+
+typedef struct sim_max32664_stats {
+    uint32_t commands;      // write transfers accepted
+    uint32_t busy;          // reads answered with SB_DEV_BUSY
+    uint32_t overrun;       // commands sent before the previous one was processed
+    uint32_t samples;       // samples pushed in the FIFO
+    uint32_t dropped;       // samples lost on FIFO overflow
+    uint32_t read;          // samples read by the host
+    uint64_t latencySum;    // sum over the read samples of their age, us
+    uint64_t latencyMax;    // age of the oldest sample read, us
+} sim_max32664_stats_t;
+
+typedef struct sim_max32664 {
+    sim_i2c_device_t dev;
+    sim_max32664_config_t config;
+    sim_max32664_stats_t stats;
+
+    // power and mode
+    uint8_t inReset;
+    uint8_t booting;
+    uint8_t deviceMode; // APP_MODE or BOOTLOADER_MODE
+    uint8_t resetLevel;
+
+    // configuration
+    uint8_t outputMode;
+    uint8_t fifoThreshold;
+    uint8_t sensorEnabled;
+    uint8_t accelEnabled;
+    uint8_t agcEnabled;
+    uint8_t algoMode; // 0 disabled, MODE_ONE or MODE_TWO
+    uint8_t agc[4];   // target percentage, step size, sensitivity, samples
+    int32_t coef[3];  // SpO2 calibration coefficients
+    uint8_t afe[256]; // MAX30101 registers
+
+    // command being processed and its response
+    uint8_t command[SIM_MAX32664_COMMAND_MAX];
+    uint16_t commandSize;
+    uint8_t busy;
+    uint8_t response[SIM_MAX32664_RESPONSE_MAX];
+    uint16_t responseSize;
+
+    // output FIFO
+    uint8_t fifo[SIM_MAX32664_FIFO_SIZE][SIM_MAX32664_SAMPLE_MAX];
+    uint64_t fifoTime[SIM_MAX32664_FIFO_SIZE];
+    uint32_t fifoHead;
+    uint32_t fifoCount;
+    uint8_t counter;
+
+    // signal generator
+    uint64_t sampleIndex;
+    uint32_t phase; // heart beat phase, 2^32 per beat
+    uint32_t noise;
+    double oxygen; // SpO2 of the last sample generated, 0.1 %, for the benchmarks
+    double heartRate;                  // heart rate of the last sample generated, 0.1 bpm
+    double peakUs[SIM_MAX32664_PEAKS]; // last systolic peaks of the PPG, interpolated
+    uint32_t peaks;                    // peaks since reset, the last in peakUs[(peaks - 1) % size]
+    double breathPhase;                // respiration cycles since reset
+    double perfusion;                  // IR AC over DC of the last sample generated, 0.01 %
+    double shapeRange;                 // peak to trough of the pulse shape
+} sim_max32664_t;
+
+/**
+ * @brief Default configuration: 100 Hz, 32 samples FIFO, timings of the user guide
+ */
+sim_max32664_config_t sim_max32664_defaults(void);
+
+/**
+ * @brief Initialises the model in application mode and connects it to I2C1
+ *
+ * The hub starts powered and unconfigured, as after a power-on. Call
+ * sim_max32664_preconfigure to model a hub that kept running.
+ */
+void sim_max32664_init(sim_max32664_t *hub, const sim_max32664_config_t *config);
+
+/**
+ * @brief Puts the hub in the state MAX32664_ConfigBpm leaves it in
+ *
+ * @param mode MODE_ONE or MODE_TWO
+ */
+void sim_max32664_preconfigure(sim_max32664_t *hub, uint8_t mode);
+
+#endif // SIM_MAX32664_H
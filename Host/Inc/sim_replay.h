@@ -0,0 +1,48 @@
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+
+/**
+ * @file sim_replay.h
+ * @brief Replay of a captured I2C transcript against the drivers
+ *
+ * Loads a transcript dumped by i2crec_dump (console command 'i') and puts a
+ * replay device in front of the model of every address it mentions. The
+ * transfers of each device are replayed in order: writes are compared with
+ * the recorded bytes, reads return the recorded bytes, recorded failures are
+ * NACKed. Timing is not replayed, the firmware runs on the virtual clock, so
+ * only the order of the transfers of a device matters.
+ *
+ * The models behind still see every replayed transfer, which keeps their pin
+ * activity (SQW, reset sampling) going; once the transcript of a device is
+ * exhausted its model answers live.
+ */
+
+#include <stdio.h>
+
+#include "sim.h"
+
+typedef struct sim_replay_stats {
+    uint32_t transfers;  // transfers answered from the transcript
+    uint32_t mismatches; // writes differing from the transcript, reads of another size
+    uint32_t live;       // transfers after the end of the transcript, answered by the models
+} sim_replay_stats_t;
+
+/**
+ * @brief Loads the last complete dump found in a console capture
+ *
+ * @return 0 on success, -1 if there is no complete dump, if it lost
+ *         transfers or if it is malformed (reported on stderr)
+ */
+int sim_replay_load(FILE *capture);
+
+/**
+ * @brief Connects the replay devices to I2C1, in front of the models attached so far
+ */
+void sim_replay_attach(void);
+
+/**
+ * @brief Counters of the replay
+ */
+const sim_replay_stats_t *sim_replay_stats(void);
+
+#endif // SIM_REPLAY_H
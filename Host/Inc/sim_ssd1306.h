@@ -0,0 +1,135 @@
+#ifndef SIM_SSD1306_H
+#define SIM_SSD1306_H
+
+/**
+ * @file sim_ssd1306.h
+ * @brief SSD1306 OLED controller model for the host simulator
+ *
+ * Decodes the I2C stream sent by ssd1306_WriteCommand/ssd1306_WriteData:
+ * control bytes, the fundamental, addressing, hardware configuration and
+ * scrolling commands, and data written into the 128x64 GDDRAM through the
+ * page, horizontal or vertical addressing mode. The visible image, with
+ * remapping, start line, inversion, contrast and scrolling applied, can be
+ * saved as a PPM file.
+ *
+ * The column and page start commands (00h-1Fh, B0h-B7h) only act in page
+ * addressing mode, as the datasheet specifies; in the other modes they are
+ * counted as ignored.
+ *
+ * The traffic is grouped in frames: a frame ends when the bus stays idle for
+ * SIM_SSD1306_FRAME_GAP_US, which separates two ssd1306_UpdateScreen calls.
+ */
+
+#include <stdio.h>
+
+#include "sim.h"
+
+#define SIM_SSD1306_WIDTH (128U)
+#define SIM_SSD1306_HEIGHT (64U)
+#define SIM_SSD1306_PAGES (SIM_SSD1306_HEIGHT / 8U)
+
+#define SIM_SSD1306_FRAME_GAP_US (2000U)
+
+typedef struct sim_ssd1306_frame {
+    uint32_t transfers;    // I2C transfers
+    uint32_t commandBytes; // command bytes, parameters included
+    uint32_t ignored;      // commands without effect in the current addressing mode
+    uint32_t dataBytes;    // bytes written to the GDDRAM
+    uint32_t busBytes;     // bytes on the bus, addresses and control bytes included
+    uint64_t start;        // first transfer, us
+    uint64_t end;          // end of the last transfer, us
+} sim_ssd1306_frame_t;
+
+typedef struct sim_ssd1306_stats {
+    uint32_t frames;
+    uint64_t transfers;
+    uint64_t commandBytes;
+    uint64_t ignored;
+    uint64_t dataBytes;
+    uint64_t busBytes;
+    uint64_t busyTime; // sum of the frame durations, us
+} sim_ssd1306_stats_t;
+
+struct sim_ssd1306;
+
+typedef void (*sim_ssd1306_frame_fn)(struct sim_ssd1306 *oled, const sim_ssd1306_frame_t *frame, void *ctx);
+
+typedef struct sim_ssd1306 {
+    sim_i2c_device_t dev;
+
+    uint8_t gddram[SIM_SSD1306_PAGES][SIM_SSD1306_WIDTH];
+
+    // command decoder: opcode and the parameters still expected
+    uint8_t command;
+    uint8_t params[6];
+    uint8_t paramCount;
+    uint8_t paramExpected;
+
+    // fundamental and hardware configuration
+    uint8_t displayOn;
+    uint8_t entireOn;
+    uint8_t inverse;
+    uint8_t contrast;
+    uint8_t segmentRemap;
+    uint8_t comRemap;
+    uint8_t startLine;
+    uint8_t offset;
+    uint8_t multiplex;
+    uint8_t clockDivide; // D5 parameter
+    uint8_t precharge;   // D9 parameter
+    uint8_t chargePump;
+
+    // addressing
+    uint8_t addressingMode; // 0 horizontal, 1 vertical, 2 page
+    uint8_t column;
+    uint8_t page;
+    uint8_t columnStart;
+    uint8_t columnEnd;
+    uint8_t pageStart;
+    uint8_t pageEnd;
+
+    // scrolling
+    uint8_t scrollActive;
+    uint8_t scrollCommand; // 0x26, 0x27, 0x29 or 0x2A
+    uint8_t scrollStartPage;
+    uint8_t scrollEndPage;
+    uint8_t scrollInterval;
+    uint8_t scrollVerticalOffset;
+    uint8_t scrollAreaTop;
+    uint8_t scrollAreaRows;
+    uint64_t scrollSince;
+
+    // traffic
+    sim_ssd1306_frame_t frame;
+    uint8_t frameOpen;
+    sim_ssd1306_stats_t stats;
+    sim_ssd1306_frame_fn onFrame;
+    void *onFrameCtx;
+} sim_ssd1306_t;
+
+/**
+ * @brief Initialises the model in its reset state and connects it to I2C1
+ */
+void sim_ssd1306_init(sim_ssd1306_t *oled);
+
+/**
+ * @brief Sets a function called at the end of every frame
+ */
+void sim_ssd1306_on_frame(sim_ssd1306_t *oled, sim_ssd1306_frame_fn fn, void *ctx);
+
+/**
+ * @brief Renders the visible image, one byte per pixel, 0 is black
+ *
+ * @param image receiver, SIM_SSD1306_WIDTH * SIM_SSD1306_HEIGHT bytes, row by row
+ */
+void sim_ssd1306_render(const sim_ssd1306_t *oled, uint8_t *image);
+
+/**
+ * @brief Writes the visible image as a binary PPM (P6)
+ *
+ * @param scale size of the square drawn for each pixel, 1 or more
+ * @return 0 on success, -1 if the file cannot be written
+ */
+int sim_ssd1306_write_ppm(const sim_ssd1306_t *oled, FILE *file, uint32_t scale);
+
+#endif // SIM_SSD1306_H
@@ -0,0 +1,643 @@
+#ifndef STM32F4XX_HAL_H
+#define STM32F4XX_HAL_H
+
+/**
+ * @file stm32f4xx_hal.h
+ * @brief Host fake of the subset of the STM32F4 HAL used by the firmware
+ *
+ * Types, constants and functions keep the names and the signatures of the
+ * HAL, so the firmware sources compile unchanged on the host. Peripherals are
+ * simulated on a virtual microsecond clock (see sim.h): blocking transfers and
+ * HAL_Delay advance the clock and interrupts are dispatched while it advances.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Common -------------------------------------------------------------------*/
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+#define __weak __attribute__((weak))
+#define __NO_RETURN __attribute__((__noreturn__))
+
+// HCLK, set by HAL_RCC_ClockConfig; stale after STOP until SystemCoreClockUpdate
+extern uint32_t SystemCoreClock;
+
+void SystemCoreClockUpdate(void);
+
+// millisecond tick, counted by SysTick while it is not suspended
+extern volatile uint32_t uwTick;
+
+HAL_StatusTypeDef HAL_Init(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+
+/* Cortex -------------------------------------------------------------------*/
+
+typedef enum {
+    RTC_WKUP_IRQn = 3,
+    EXTI0_IRQn = 6,
+    EXTI1_IRQn = 7,
+    EXTI2_IRQn = 8,
+    EXTI3_IRQn = 9,
+    EXTI4_IRQn = 10,
+    ADC_IRQn = 18,
+    EXTI9_5_IRQn = 23,
+    TIM1_UP_TIM10_IRQn = 25,
+    TIM2_IRQn = 28,
+    TIM3_IRQn = 29,
+    USART2_IRQn = 38,
+    EXTI15_10_IRQn = 40,
+    TIM5_IRQn = 50,
+    DMA2_Stream0_IRQn = 56,
+    SIM_IRQ_COUNT = 64
+} IRQn_Type;
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __WFI(void);
+
+#define __NOP() ((void)0)
+#define __CLZ(value) ((uint8_t)(((value) == 0U) ? 32U : (uint32_t)__builtin_clz(value)))
+
+// Cortex-M4 DSP instructions, bit-exact
+static inline int32_t __SSAT(int32_t value, uint32_t bits) {
+    const int32_t max = (int32_t)((1UL << (bits - 1U)) - 1U);
+    return (value > max) ? max : ((value < (-max - 1)) ? (-max - 1) : value);
+}
+
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3) {
+    int32_t low = (int32_t)(int16_t)(op1 & 0xFFFFU) * (int16_t)(op2 & 0xFFFFU);
+    int32_t high = (int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16);
+    return op3 + (uint32_t)low + (uint32_t)high;
+}
+
+#define __PKHBT(ARG1, ARG2, ARG3) ((((uint32_t)(ARG1)) & 0x0000FFFFUL) | ((((uint32_t)(ARG2)) << (ARG3)) & 0xFFFF0000UL))
+
+/* RCC and PWR --------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t PLLState;
+    uint32_t PLLSource;
+    uint32_t PLLM;
+    uint32_t PLLN;
+    uint32_t PLLP;
+    uint32_t PLLQ;
+} RCC_PLLInitTypeDef;
+
+typedef struct {
+    uint32_t OscillatorType;
+    uint32_t HSEState;
+    uint32_t LSEState;
+    uint32_t HSIState;
+    uint32_t HSICalibrationValue;
+    uint32_t LSIState;
+    RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct {
+    uint32_t ClockType;
+    uint32_t SYSCLKSource;
+    uint32_t AHBCLKDivider;
+    uint32_t APB1CLKDivider;
+    uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+#define RCC_OSCILLATORTYPE_NONE 0x00000000U
+#define RCC_OSCILLATORTYPE_HSE 0x00000001U
+#define RCC_OSCILLATORTYPE_HSI 0x00000002U
+#define RCC_OSCILLATORTYPE_LSI 0x00000008U
+#define RCC_HSI_OFF 0x00U
+#define RCC_HSI_ON 0x01U
+#define RCC_HSICALIBRATION_DEFAULT 0x10U
+#define RCC_LSI_OFF 0x00U
+#define RCC_LSI_ON 0x01U
+#define RCC_PLL_NONE 0x00U
+#define RCC_PLL_OFF 0x01U
+#define RCC_PLL_ON 0x02U
+#define RCC_PLLSOURCE_HSI 0x00000000U
+#define RCC_PLLP_DIV2 0x00000002U
+#define RCC_PLLP_DIV4 0x00000004U
+
+#define RCC_CLOCKTYPE_SYSCLK 0x00000001U
+#define RCC_CLOCKTYPE_HCLK 0x00000002U
+#define RCC_CLOCKTYPE_PCLK1 0x00000004U
+#define RCC_CLOCKTYPE_PCLK2 0x00000008U
+#define RCC_SYSCLKSOURCE_HSI 0x00000000U
+#define RCC_SYSCLKSOURCE_PLLCLK 0x00000002U
+#define RCC_SYSCLK_DIV1 0x00000000U
+#define RCC_HCLK_DIV1 0x00000000U
+#define RCC_HCLK_DIV2 0x00001000U
+#define RCC_HCLK_DIV4 0x00001400U
+
+#define FLASH_LATENCY_0 0x00000000U
+#define FLASH_LATENCY_1 0x00000001U
+#define FLASH_LATENCY_2 0x00000002U
+
+#define RCC_FLAG_BORRST 0x79U
+#define RCC_FLAG_PINRST 0x7AU
+#define RCC_FLAG_PORRST 0x7BU
+#define RCC_FLAG_SFTRST 0x7CU
+#define RCC_FLAG_IWDGRST 0x7DU
+
+#define HSI_VALUE 16000000U
+#define LSI_VALUE 32000U
+
+typedef struct {
+    uint32_t PeriphClockSelection;
+    uint32_t RTCClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_PERIPHCLK_RTC 0x00000002U
+#define RCC_RTCCLKSOURCE_LSI 0x00000200U
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit);
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t *pFLatency);
+uint32_t HAL_RCC_GetSysClockFreq(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+uint32_t sim_rcc_get_flag(uint32_t flag);
+void sim_rcc_clear_reset_flags(void);
+
+#define __HAL_RCC_GET_FLAG(flag) sim_rcc_get_flag(flag)
+#define __HAL_RCC_CLEAR_RESET_FLAGS() sim_rcc_clear_reset_flags()
+
+#define __HAL_RCC_PWR_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_I2C1_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_I2C1_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_USART2_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_TIM2_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM2_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_TIM3_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM3_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_TIM5_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM5_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_TIM10_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_TIM10_CLK_DISABLE() ((void)0)
+#define __HAL_RCC_RTC_ENABLE() ((void)0)
+#define __HAL_RCC_RTC_DISABLE() ((void)0)
+
+#define PWR_REGULATOR_VOLTAGE_SCALE1 0x0000C000U
+#define PWR_REGULATOR_VOLTAGE_SCALE2 0x00008000U
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(scale) ((void)(scale))
+
+#define PWR_MAINREGULATOR_ON 0x00000000U
+#define PWR_LOWPOWERREGULATOR_ON 0x00000001U
+#define PWR_STOPENTRY_WFI ((uint8_t)0x01)
+#define PWR_STOPENTRY_WFE ((uint8_t)0x02)
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry);
+void HAL_PWREx_EnableFlashPowerDown(void);
+void HAL_DBGMCU_EnableDBGStopMode(void);
+
+/* GPIO ---------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t ODR;      // output data
+    uint32_t IDR;      // level driven on the pins by the simulated devices
+    uint32_t DRV;      // pins driven by a simulated device, the others float
+    uint32_t mode[16]; // GPIO_MODE_* of each pin
+    uint32_t pull[16]; // GPIO_PULL* of each pin
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef sim_gpio_ports[3];
+
+#define GPIOA (&sim_gpio_ports[0])
+#define GPIOB (&sim_gpio_ports[1])
+#define GPIOC (&sim_gpio_ports[2])
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+#define GPIO_PIN_All ((uint16_t)0xFFFF)
+
+#define GPIO_MODE_INPUT 0x00000000U
+#define GPIO_MODE_OUTPUT_PP 0x00000001U
+#define GPIO_MODE_OUTPUT_OD 0x00000011U
+#define GPIO_MODE_AF_PP 0x00000002U
+#define GPIO_MODE_AF_OD 0x00000012U
+#define GPIO_MODE_ANALOG 0x00000003U
+#define GPIO_MODE_IT_RISING 0x10110000U
+#define GPIO_MODE_IT_FALLING 0x10210000U
+#define GPIO_MODE_IT_RISING_FALLING 0x10310000U
+
+#define GPIO_NOPULL 0x00000000U
+#define GPIO_PULLUP 0x00000001U
+#define GPIO_PULLDOWN 0x00000002U
+
+#define GPIO_SPEED_FREQ_LOW 0x00000000U
+#define GPIO_SPEED_FREQ_MEDIUM 0x00000001U
+#define GPIO_SPEED_FREQ_HIGH 0x00000002U
+#define GPIO_SPEED_FREQ_VERY_HIGH 0x00000003U
+
+#define GPIO_AF1_TIM2 ((uint8_t)0x01)
+#define GPIO_AF4_I2C1 ((uint8_t)0x04)
+#define GPIO_AF7_USART2 ((uint8_t)0x07)
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+/* EXTI ---------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t Line;
+    uint32_t Mode;
+    uint32_t Trigger;
+    uint32_t GPIOSel;
+} EXTI_ConfigTypeDef;
+
+typedef struct {
+    uint32_t Line;
+    void (*PendingCallback)(void);
+} EXTI_HandleTypeDef;
+
+#define EXTI_LINE_3 0x06000003U
+#define EXTI_MODE_NONE 0x00000000U
+#define EXTI_MODE_INTERRUPT 0x00000001U
+#define EXTI_MODE_EVENT 0x00000002U
+#define EXTI_TRIGGER_NONE 0x00000000U
+#define EXTI_TRIGGER_RISING 0x00000001U
+#define EXTI_TRIGGER_FALLING 0x00000002U
+#define EXTI_TRIGGER_RISING_FALLING 0x00000003U
+#define EXTI_GPIOA 0x00000000U
+#define EXTI_GPIOB 0x00000001U
+#define EXTI_GPIOC 0x00000002U
+
+HAL_StatusTypeDef HAL_EXTI_SetConfigLine(EXTI_HandleTypeDef *hexti, EXTI_ConfigTypeDef *pExtiConfig);
+
+/* DMA and ADC (declarations only, not simulated) ---------------------------*/
+
+typedef struct {
+    void *Instance;
+} DMA_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} ADC_HandleTypeDef;
+
+/* I2C ----------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t id;
+    uint32_t CCR; // SCL half period in PCLK1 cycles, set by HAL_I2C_Init
+} I2C_TypeDef;
+
+extern I2C_TypeDef sim_i2c1;
+
+#define I2C1 (&sim_i2c1)
+
+typedef struct {
+    uint32_t ClockSpeed;
+    uint32_t DutyCycle;
+    uint32_t OwnAddress1;
+    uint32_t AddressingMode;
+    uint32_t DualAddressMode;
+    uint32_t OwnAddress2;
+    uint32_t GeneralCallMode;
+    uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_TypeDef *Instance;
+    I2C_InitTypeDef Init;
+} I2C_HandleTypeDef;
+
+#define I2C_DUTYCYCLE_2 0x00000000U
+#define I2C_ADDRESSINGMODE_7BIT 0x00004000U
+#define I2C_DUALADDRESS_DISABLE 0x00000000U
+#define I2C_GENERALCALL_DISABLE 0x00000000U
+#define I2C_NOSTRETCH_DISABLE 0x00000000U
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define I2C_MEMADD_SIZE_16BIT 0x00000010U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MspDeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                         uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+                                        uint32_t Timeout);
+
+/* UART ---------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t id;
+    uint32_t BRR; // PCLK1 cycles per bit, oversampling by 16
+} USART_TypeDef;
+
+extern USART_TypeDef sim_usart2;
+
+#define USART2 (&sim_usart2)
+
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    uint8_t *pRxBuffPtr;
+    uint16_t RxXferSize;
+    uint16_t RxXferCount;
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B 0x00000000U
+#define UART_STOPBITS_1 0x00000000U
+#define UART_PARITY_NONE 0x00000000U
+#define UART_MODE_TX_RX 0x0000000CU
+#define UART_HWCONTROL_NONE 0x00000000U
+#define UART_OVERSAMPLING_16 0x00000000U
+
+#define UART_BRR_SAMPLING16(pclk, baud) ((uint32_t)(((pclk) + ((baud) / 2U)) / (baud)))
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+void HAL_UART_MspInit(UART_HandleTypeDef *huart);
+void HAL_UART_MspDeInit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size,
+                                    uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+
+/* RTC ----------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t id;
+} RTC_TypeDef;
+
+extern RTC_TypeDef sim_rtc;
+
+#define RTC (&sim_rtc)
+
+typedef struct {
+    uint32_t HourFormat;
+    uint32_t AsynchPrediv;
+    uint32_t SynchPrediv;
+    uint32_t OutPut;
+    uint32_t OutPutPolarity;
+    uint32_t OutPutType;
+} RTC_InitTypeDef;
+
+typedef struct {
+    RTC_TypeDef *Instance;
+    RTC_InitTypeDef Init;
+} RTC_HandleTypeDef;
+
+typedef struct {
+    uint8_t Hours;
+    uint8_t Minutes;
+    uint8_t Seconds;
+    uint8_t TimeFormat;
+    uint32_t SubSeconds;
+    uint32_t SecondFraction;
+    uint32_t DayLightSaving;
+    uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct {
+    uint8_t WeekDay;
+    uint8_t Month;
+    uint8_t Date;
+    uint8_t Year;
+} RTC_DateTypeDef;
+
+#define RTC_HOURFORMAT_24 0x00000000U
+#define RTC_OUTPUT_DISABLE 0x00000000U
+#define RTC_OUTPUT_POLARITY_HIGH 0x00000000U
+#define RTC_OUTPUT_TYPE_OPENDRAIN 0x00000000U
+#define RTC_FORMAT_BIN 0x00000000U
+#define RTC_FORMAT_BCD 0x00000001U
+#define RTC_WAKEUPCLOCK_RTCCLK_DIV16 0x00000000U
+#define RTC_WAKEUPCLOCK_RTCCLK_DIV8 0x00000001U
+#define RTC_WAKEUPCLOCK_RTCCLK_DIV4 0x00000002U
+#define RTC_WAKEUPCLOCK_RTCCLK_DIV2 0x00000003U
+
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc);
+void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc);
+void HAL_RTC_MspDeInit(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc);
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock);
+HAL_StatusTypeDef HAL_RTCEx_DeactivateWakeUpTimer(RTC_HandleTypeDef *hrtc);
+void HAL_RTCEx_WakeUpTimerIRQHandler(RTC_HandleTypeDef *hrtc);
+void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc);
+
+#define __HAL_RTC_WRITEPROTECTION_DISABLE(h) ((void)(h))
+#define __HAL_RTC_WRITEPROTECTION_ENABLE(h) ((void)(h))
+
+/* TIM ----------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t id;
+} TIM_TypeDef;
+
+extern TIM_TypeDef sim_tim2;
+extern TIM_TypeDef sim_tim3;
+extern TIM_TypeDef sim_tim5;
+extern TIM_TypeDef sim_tim10;
+
+#define TIM2 (&sim_tim2)
+#define TIM3 (&sim_tim3)
+#define TIM5 (&sim_tim5)
+#define TIM10 (&sim_tim10)
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef enum {
+    HAL_TIM_ACTIVE_CHANNEL_1 = 0x01U,
+    HAL_TIM_ACTIVE_CHANNEL_2 = 0x02U,
+    HAL_TIM_ACTIVE_CHANNEL_3 = 0x04U,
+    HAL_TIM_ACTIVE_CHANNEL_4 = 0x08U,
+    HAL_TIM_ACTIVE_CHANNEL_CLEARED = 0x00U
+} HAL_TIM_ActiveChannel;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+    HAL_TIM_ActiveChannel Channel;
+    uint64_t simStart;       // virtual time the counter was at simBase, us
+    uint64_t simBase;        // counter ticks at simStart, not wrapped
+    uint32_t simPsc;         // prescaler in use
+    uint32_t simPscPreload;  // prescaler loaded at the next update event
+    uint32_t simUrs;         // only overflows raise the update interrupt
+    uint32_t simRunning;     // counter enabled
+    uint32_t simUpdate;      // update event pending
+    uint32_t simCompare[4];  // CCR1..CCR4
+    uint32_t simIt;          // TIM_IT_* enabled
+    uint32_t simFlags;       // TIM_FLAG_CC* raised
+} TIM_HandleTypeDef;
+
+typedef struct {
+    uint32_t ClockSource;
+    uint32_t ClockPolarity;
+    uint32_t ClockPrescaler;
+    uint32_t ClockFilter;
+} TIM_ClockConfigTypeDef;
+
+typedef struct {
+    uint32_t MasterOutputTrigger;
+    uint32_t MasterSlaveMode;
+} TIM_MasterConfigTypeDef;
+
+typedef struct {
+    uint32_t OCMode;
+    uint32_t Pulse;
+    uint32_t OCPolarity;
+    uint32_t OCNPolarity;
+    uint32_t OCFastMode;
+    uint32_t OCIdleState;
+    uint32_t OCNIdleState;
+} TIM_OC_InitTypeDef;
+
+#define TIM_COUNTERMODE_UP 0x00000000U
+#define TIM_CLOCKDIVISION_DIV1 0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE 0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE 0x00000080U
+#define TIM_CLOCKSOURCE_INTERNAL 0x00001000U
+#define TIM_TRGO_RESET 0x00000000U
+#define TIM_TRGO_UPDATE 0x00000020U
+#define TIM_MASTERSLAVEMODE_ENABLE 0x00000080U
+#define TIM_MASTERSLAVEMODE_DISABLE 0x00000000U
+#define TIM_OCMODE_TIMING 0x00000000U
+#define TIM_OCMODE_PWM1 0x00000060U
+#define TIM_OCPOLARITY_HIGH 0x00000000U
+#define TIM_OCFAST_DISABLE 0x00000000U
+#define TIM_CHANNEL_1 0x00000000U
+#define TIM_CHANNEL_2 0x00000004U
+#define TIM_CHANNEL_3 0x00000008U
+#define TIM_CHANNEL_4 0x0000000CU
+#define TIM_IT_UPDATE 0x00000001U
+#define TIM_IT_CC1 0x00000002U
+#define TIM_IT_CC2 0x00000004U
+#define TIM_IT_CC3 0x00000008U
+#define TIM_IT_CC4 0x00000010U
+#define TIM_FLAG_CC1 0x00000002U
+#define TIM_FLAG_CC2 0x00000004U
+#define TIM_FLAG_CC3 0x00000008U
+#define TIM_FLAG_CC4 0x00000010U
+#define TIM_EVENTSOURCE_UPDATE 0x00000001U
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *sClockSourceConfig);
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim,
+                                                        TIM_MasterConfigTypeDef *sMasterConfig);
+HAL_StatusTypeDef HAL_TIM_GenerateEvent(TIM_HandleTypeDef *htim, uint32_t EventSource);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+uint32_t sim_tim_counter(const TIM_HandleTypeDef *htim);
+void sim_tim_set_counter(TIM_HandleTypeDef *htim, uint32_t counter);
+void sim_tim_set_compare(TIM_HandleTypeDef *htim, uint32_t channel, uint32_t compare);
+void sim_tim_enable_it(TIM_HandleTypeDef *htim, uint32_t it);
+void sim_tim_disable_it(TIM_HandleTypeDef *htim, uint32_t it);
+
+#define __HAL_TIM_GET_COUNTER(h) sim_tim_counter(h)
+#define __HAL_TIM_SET_COUNTER(h, counter) sim_tim_set_counter((h), (counter))
+#define __HAL_TIM_SET_COMPARE(h, channel, compare) sim_tim_set_compare((h), (channel), (compare))
+#define __HAL_TIM_ENABLE_IT(h, it) sim_tim_enable_it((h), (it))
+#define __HAL_TIM_DISABLE_IT(h, it) sim_tim_disable_it((h), (it))
+#define __HAL_TIM_CLEAR_FLAG(h, flag) ((h)->simFlags &= ~(flag))
+#define __HAL_TIM_GET_COMPARE(h, channel) ((h)->simCompare[(channel) >> 2U])
+#define __HAL_TIM_GET_AUTORELOAD(h) ((h)->Init.Period)
+#define __HAL_TIM_SET_PRESCALER(h, prescaler) ((h)->simPscPreload = (prescaler))
+#define __HAL_TIM_URS_ENABLE(h) ((h)->simUrs = 1U)
+#define __HAL_TIM_URS_DISABLE(h) ((h)->simUrs = 0U)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STM32F4XX_HAL_H
@@ -0,0 +1,7 @@
+#ifndef STM32F4XX_HAL_GPIO_H
+#define STM32F4XX_HAL_GPIO_H
+
+/* The GPIO part of the fake HAL lives in stm32f4xx_hal.h */
+#include "stm32f4xx_hal.h"
+
+#endif // STM32F4XX_HAL_GPIO_H
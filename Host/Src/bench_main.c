@@ -0,0 +1,1314 @@
+/*
+ * Host benchmarks: fixed scenarios run on the simulated board, timed on the
+ * virtual clock, so every result is exact and reproducible.
+ *
+ *   project_work_bench [--output file.json]
+ *
+ * The results are written as JSON ({"metrics": {name: {"value", "better"}}})
+ * on stdout or in the output file, and as a table on stderr. Host/bench.cmake
+ * compares them with Host/bench_baseline.json.
+ *
+ * Each scenario runs in a child process, so the firmware boots from its
+ * initial data every time, as after a power-on.
+ *
+ * Scenarios:
+ * - session: the firmware from power-on, button at 8 s and finger at 9 s, up
+ *   to the end of the report: boot to "Ok, sensor ready", finger placed to
+ *   first sample counted, finger detected to the report (time to result),
+ *   samples counted per second of measure, report time, mean MCU current over
+ *   the run, MCU energy from the start of the measure to the end of the report
+ * - fast_session: the same on the fast clock profile, selected from the
+ *   console ('c') at 1 s: report time and energy of the measure, to weigh the
+ *   latency gained against the current of the PLL
+ * - motion_session: the session with the accelerometer fitted and the hand
+ *   shaking from 12 s to 14 s, early in the measure: time to result with the
+ *   samples and beats gated on motion
+ * - alarm_session: the session with the SpO2 down 6% from 13 s to 14 s, once
+ *   the hub confidence passed the alarm gate: time from the drop to the alarm
+ *   notified, and latency of the notification from the read of the sample
+ *   that raised it, as the firmware measures it
+ * - idle: the firmware from power-on with nobody at the device, from
+ *   "Ok, sensor ready" on: fraction of time in STOP mode and mean MCU current
+ * - algo, sensor_algo: max32664.c alone, reading the hub back to back in
+ *   ALGO_DATA (ConfigBpm/ReadBpm) and SENSOR_AND_ALGORITHM
+ *   (ConfigSensorBpm/ReadSensorBpm) output modes: samples with a finger
+ *   detected per second and bus bytes per sample
+ * - display: ssd1306.c alone, time and bus bytes of ssd1306_UpdateScreen
+ * - stats: stats.c alone on a synthetic heart rate series: error of the
+ *   fixed-point mean and variance against a double precision two-pass
+ *   reference, in ppb, and memory per series
+ * - spo2: max32664.c, ppg.c and spo2.c on the hub in the SENSOR_AND_ALGORITHM
+ *   output mode, its FIFO emptied as by the firmware: error of the SpO2
+ *   estimated beat by beat from the raw PPG against the SpO2 of the hub
+ *   model, in ppm of saturation, estimates per minute and beats rejected.
+ *   Cycles per beat are measured on the target, console 'g'
+ * - beats: max32664.c, ppg.c and beat.c in the same setup: RR intervals
+ *   against the systolic peaks of the hub model, aligned on them: mean error
+ *   in us, share of the true intervals found and of the intervals found that
+ *   are not true ones, per mille. Cycles per beat on the target, console 'g'
+ * - acf: max32664.c, ppg.c and acf.c in the same setup, once the window holds
+ *   the pulse: error of the heart rate estimated every second against the
+ *   mean rate of the hub model over the window, in thousandths of bpm,
+ *   estimates without a period and memory per estimator. Cycles per estimate
+ *   on the target, console 'g'
+ * - resp: max32664.c, ppg.c, beat.c and resp.c in the same setup, the hub
+ *   model breathing at 9, 15 and 20 breaths/min, once the channels timed
+ *   their first breaths: worst mean error of the rate in thousandths of
+ *   breaths/min, share of the beats without a rate, and error of the mean
+ *   perfusion index against the AC/DC of the model, per mille. Cycles per
+ *   beat on the target, console 'g'
+ * - tracker: max32664.c and tracker.c in the same setup, the hub algorithm
+ *   glitching every 1.5 s, each report fed to the trackers of the firmware
+ *   once the confidence settled: mean error of the live heart rate and SpO2
+ *   against the hub model, in thousandths of bpm and ppm of saturation, and
+ *   memory per tracker. Cycles per sample on the target, console 'g'
+ * - ppg: ppg.c alone on a synthetic finger PPG at each sample rate of the
+ *   sensor: worst RMS error of the fixed-point pulse wave against the same
+ *   chain in double precision, in ppm of the RMS of the wave, and memory per
+ *   chain. Cycles per sample are measured on the target, console 'g'
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "acf.h"
+#include "beat.h"
+#include "gpio.h"
+#include "i2c.h"
+#include "main.h"
+#include "max32664.h"
+#include "ppg.h"
+#include "resp.h"
+#include "sim.h"
+#include "sim_ds1307.h"
+#include "sim_max32664.h"
+#include "sim_ssd1306.h"
+#include "spo2.h"
+#include "ssd1306.h"
+#include "stats.h"
+#include "tim.h"
+#include "trace.h"
+#include "tracker.h"
+#include "usclock.h"
+
+#define MAX_METRICS (48U)
+
+#define SECOND_US (1000000U)
+
+// session scenario stimuli and length
+#define PRESS_US (8U * SECOND_US)
+#define FINGER_US (9U * SECOND_US)
+#define SESSION_US (60U * SECOND_US)
+#define MOTION_ON_US (12U * SECOND_US)
+#define MOTION_OFF_US (14U * SECOND_US)
+#define DESAT_ON_US (13U * SECOND_US)
+#define DESAT_OFF_US (14U * SECOND_US)
+
+// driver scenarios: samples are counted over a window after a warm-up
+#define WARMUP_US (2U * SECOND_US)
+#define WINDOW_US (10U * SECOND_US)
+
+#define DISPLAY_UPDATES (10U)
+
+// idle scenario length
+#define IDLE_US (60U * SECOND_US)
+
+// statistics scenario: 72 bpm swinging by 3 bpm, uniform noise of +-2 bpm,
+// in 0.1 bpm
+#define STATS_SAMPLES (10000U)
+#define STATS_MEAN (720.0)
+#define STATS_SWING (30.0)
+#define STATS_SWING_SAMPLES (200.0)
+#define STATS_NOISE (20U)
+
+// SpO2 scenario: estimates compared over a window after the finger settled,
+// FIFO read as often as by the firmware
+#define OXIMETRY_WINDOW_US (60U * SECOND_US)
+#define OXIMETRY_BATCH (32U)
+#define OXIMETRY_PERIOD_MS (40U)
+
+// beats scenario: intervals and true peaks kept, distance of a detected peak
+// to the true one it is matched with
+#define BEATS_MAX (256U)
+#define BEAT_MATCH_US (100000.0)
+
+// acf scenario: the window is filled with the pulse before the estimates count
+#define ACF_SETTLE_US ((ACF_WINDOW * SECOND_US) / PPG_OUTPUT_HZ)
+
+// resp scenario: breathing rates of the hub model, 0.1 breaths/min, and time
+// for the channels to time their first breaths
+#define RESP_RATES {90U, 150U, 200U}
+#define RESP_SETTLE_US (20U * SECOND_US)
+
+// tracker scenario: algorithm glitches of the hub, and time for its confidence
+// to settle after the finger is detected
+#define TRACKER_GLITCH_US (1500000U)
+#define TRACKER_SETTLE_US (6U * SECOND_US)
+
+// PPG scenario: a finger at 72 bpm breathing at 15 per minute, ADC counts, fed
+// in chunks that do not divide the boxcars; the error is measured once the DC
+// tracker has settled
+#define PPG_SECONDS (30U)
+#define PPG_SETTLE_SECONDS (5U)
+#define PPG_CHUNK (37U)
+#define PPG_PULSE_HZ (1.2)
+#define PPG_BREATH_HZ (0.25)
+#define PPG_IR_DC (120000.0)
+#define PPG_IR_AC (1500.0)
+#define PPG_RED_DC (90000.0)
+#define PPG_RED_AC (1100.0)
+#define PPG_WANDER (600.0)
+#define PPG_NOISE (20U)
+
+// absolute limits of the accuracy metrics, checked on every run: the baseline
+// only holds them within its tolerance of their last value
+#define SPO2_ERROR_LIMIT_PPM (5000U)          // 0.5 % of saturation
+#define RR_ERROR_LIMIT_US (5000U)
+#define RR_FOUND_LIMIT_PERMILLE (980U)
+#define ACF_HR_ERROR_LIMIT_MBPM (1000U)       // 1 bpm
+#define RESP_ERROR_LIMIT_MBRPM (1500U)        // 1.5 breaths/min
+#define PI_ERROR_LIMIT_PERMILLE (150U)
+#define TRACKER_HR_ERROR_LIMIT_MBPM (1000U)   // 1 bpm
+#define TRACKER_OXY_ERROR_LIMIT_PPM (10000U)  // 1 % of saturation
+#define STATS_ERROR_LIMIT_PPB (10000U)
+#define PPG_ERROR_LIMIT_PPM (1000U)
+#define MISSING_LIMIT_PERMILLE (50U)          // rejected, missing or false estimates
+
+// MCU supply current in each power state, datasheet typical values with the
+// peripherals as configured by the firmware, uA: at 16 MHz on HSI, at 84 MHz
+// on the PLL
+#define RUN_UA (3600U)
+#define SLEEP_UA (1400U)
+#define RUN_PLL_UA (11700U)
+#define SLEEP_PLL_UA (5300U)
+#define STOP_UA (12U)
+
+#define SUPPLY_MV (3300U)
+
+// console key switching to the fast clock profile, and when it is typed
+#define FAST_KEY ('c')
+#define FAST_KEY_US (1U * SECOND_US)
+
+int firmware_main(void);
+void SystemClock_Config(void);
+
+typedef struct metric {
+    const char *name;
+    uint64_t value;
+    uint8_t higherIsBetter;
+    uint64_t limit; // worst value accepted, 0 without
+} metric_t;
+
+static metric_t metrics[MAX_METRICS];
+static uint32_t metricCount = 0U;
+
+static sim_ds1307_t rtc;
+static sim_max32664_t hub;
+static sim_ssd1306_t oled;
+
+static void add_limited_metric(const char *name, uint64_t value, uint8_t higherIsBetter, uint64_t limit) {
+    if (metricCount < MAX_METRICS) {
+        metrics[metricCount].name = name;
+        metrics[metricCount].value = value;
+        metrics[metricCount].higherIsBetter = higherIsBetter;
+        metrics[metricCount].limit = limit;
+        metricCount++;
+    }
+}
+
+static void add_metric(const char *name, uint64_t value, uint8_t higherIsBetter) {
+    add_limited_metric(name, value, higherIsBetter, 0U);
+}
+
+static void board(uint64_t fingerOnUs) {
+    sim_max32664_config_t config = sim_max32664_defaults();
+    config.fingerOnUs = fingerOnUs;
+
+    sim_reset(1U);
+    sim_ds1307_init(&rtc, 0U, 0U, 12U, 1U, 1U, 1U, 24U);
+    sim_max32664_init(&hub, &config);
+    sim_ssd1306_init(&oled);
+}
+
+/* Peripherals the drivers need, as main() initialises them */
+static void peripherals(void) {
+    (void)HAL_Init();
+    SystemClock_Config();
+    MX_GPIO_Init();
+    MX_I2C1_Init();
+    MX_TIM5_Init();
+    usclock_start();
+}
+
+/* Power --------------------------------------------------------------------*/
+
+typedef struct power_sample {
+    uint64_t time;
+    uint64_t sleepUs;
+    uint64_t stopUs;
+    uint64_t pllUs;
+    uint64_t pllSleepUs;
+} power_sample_t;
+
+static power_sample_t power_sample(void) {
+    const sim_stats_t *stats = sim_stats();
+    power_sample_t sample = {
+        .time = sim_now(),
+        .sleepUs = stats->sleepUs,
+        .stopUs = stats->stopUs,
+        .pllUs = stats->pllUs,
+        .pllSleepUs = stats->pllSleepUs,
+    };
+    return sample;
+}
+
+/* Supply charge between two samples, uA * us */
+static uint64_t power_charge(const power_sample_t *from, const power_sample_t *to) {
+    uint64_t total = to->time - from->time;
+    uint64_t sleep = to->sleepUs - from->sleepUs;
+    uint64_t stop = to->stopUs - from->stopUs;
+    uint64_t pllSleep = to->pllSleepUs - from->pllSleepUs;
+    uint64_t pllRun = (to->pllUs - from->pllUs) - pllSleep;
+    uint64_t run = total - sleep - stop - pllRun;
+    return (run * RUN_UA) + (pllRun * RUN_PLL_UA) + ((sleep - pllSleep) * SLEEP_UA) + (pllSleep * SLEEP_PLL_UA) +
+           (stop * STOP_UA);
+}
+
+/* Mean supply current between two samples, uA */
+static uint64_t power_current(const power_sample_t *from, const power_sample_t *to) {
+    return power_charge(from, to) / (to->time - from->time);
+}
+
+/* Supply energy between two samples, uJ */
+static uint64_t power_energy(const power_sample_t *from, const power_sample_t *to) {
+    return (power_charge(from, to) * SUPPLY_MV) / 1000000000U;
+}
+
+/* Session --------------------------------------------------------------------*/
+
+typedef struct session {
+    uint64_t ready;
+    uint64_t measureStart;
+    uint64_t firstSample;
+    uint32_t samples;
+    uint64_t reportBegin;
+    uint64_t reportEnd;
+    uint64_t alarm;              // first alarm raised
+    uint16_t alarmLatency;       // its latency from the read of the sample, us
+    power_sample_t measurePower; // at measureStart
+    power_sample_t reportPower;  // at reportEnd
+} session_t;
+
+static session_t session;
+
+static void session_console(const uint8_t *data, uint16_t size, void *ctx) {
+    static const char ready[] = "Ok, sensor ready";
+    (void)ctx;
+
+    if ((session.ready == 0U) && (size >= (sizeof(ready) - 1U))) {
+        for (uint16_t i = 0U; i <= (size - (sizeof(ready) - 1U)); i++) {
+            if (memcmp(&data[i], ready, sizeof(ready) - 1U) == 0) {
+                session.ready = sim_now();
+                break;
+            }
+        }
+    }
+}
+
+static void session_trace(uint8_t type, uint8_t arg, uint16_t value, void *ctx) {
+    (void)value;
+    (void)ctx;
+
+    // only the first measure, the firmware starts another one after the report
+    if ((type == (uint8_t)TRACE_STATE) && (arg == (uint8_t)MS_MEASURE) && (session.measureStart == 0U)) {
+        session.measureStart = sim_now();
+        session.measurePower = power_sample();
+    } else if ((type == (uint8_t)TRACE_SAMPLE) && (arg != 0U) && (session.reportBegin == 0U)) {
+        if (session.firstSample == 0U) {
+            session.firstSample = sim_now();
+        }
+        session.samples++;
+    } else if ((type == (uint8_t)TRACE_ALARM) && ((arg & 0x80U) != 0U) && (session.alarm == 0U)) {
+        session.alarm = sim_now();
+        session.alarmLatency = value;
+    } else if ((type == (uint8_t)TRACE_REPORT_BEGIN) && (session.reportBegin == 0U)) {
+        session.reportBegin = sim_now();
+    } else if ((type == (uint8_t)TRACE_REPORT_END) && (session.reportEnd == 0U)) {
+        session.reportEnd = sim_now();
+        session.reportPower = power_sample();
+    } else {
+        // other events are not measured
+    }
+}
+
+static void release(void *ctx) {
+    (void)ctx;
+    sim_gpio_drive(GPIOC, GPIO_PIN_13, GPIO_PIN_RESET);
+}
+
+static void press(void *ctx) {
+    (void)ctx;
+    sim_gpio_drive(GPIOC, GPIO_PIN_13, GPIO_PIN_SET);
+    sim_schedule(sim_now() + 100000U, release, NULL);
+}
+
+static void fast_key(void *ctx) {
+    (void)ctx;
+    sim_uart_inject((uint8_t)FAST_KEY);
+}
+
+static void run_session(uint8_t fast, uint8_t motion, uint8_t desat) {
+    (void)memset(&session, 0, sizeof(session));
+    board(FINGER_US);
+    if (motion != 0U) {
+        hub.config.accelerometer = 1U;
+        hub.config.motionOnUs = MOTION_ON_US;
+        hub.config.motionOffUs = MOTION_OFF_US;
+    }
+    if (desat != 0U) {
+        hub.config.desatOnUs = DESAT_ON_US;
+        hub.config.desatOffUs = DESAT_OFF_US;
+    }
+    sim_uart_sink(session_console, NULL);
+    sim_trace_watch(session_trace, NULL);
+    sim_schedule(PRESS_US, press, NULL);
+    if (fast != 0U) {
+        sim_schedule(FAST_KEY_US, fast_key, NULL);
+    }
+
+    sim_run(firmware_main, SESSION_US);
+
+    if ((session.ready == 0U) || (session.firstSample == 0U) || (session.reportEnd == 0U)) {
+        (void)fprintf(stderr, "%s%s%ssession scenario did not complete\n", (fast != 0U) ? "fast_" : "",
+                      (motion != 0U) ? "motion_" : "", (desat != 0U) ? "alarm_" : "");
+        exit(1);
+    }
+}
+
+static void bench_session(void) {
+    run_session(0U, 0U, 0U);
+    power_sample_t start = {0};
+    power_sample_t end = power_sample();
+
+    add_metric("boot_to_ready_us", session.ready, 0U);
+    add_metric("finger_to_first_sample_us", session.firstSample - FINGER_US, 0U);
+    add_metric("time_to_result_us", session.reportBegin - session.measureStart, 0U);
+    add_metric("session_samples_mps",
+               ((uint64_t)session.samples * SECOND_US * 1000U) / (session.reportBegin - session.measureStart), 1U);
+    add_metric("report_us", session.reportEnd - session.reportBegin, 0U);
+    add_metric("session_current_ua", power_current(&start, &end), 0U);
+    add_metric("session_energy_uj", power_energy(&session.measurePower, &session.reportPower), 0U);
+}
+
+static void bench_fast_session(void) {
+    run_session(1U, 0U, 0U);
+
+    add_metric("fast_report_us", session.reportEnd - session.reportBegin, 0U);
+    add_metric("fast_session_energy_uj", power_energy(&session.measurePower, &session.reportPower), 0U);
+}
+
+static void bench_motion_session(void) {
+    run_session(0U, 1U, 0U);
+
+    add_metric("motion_time_to_result_us", session.reportBegin - session.measureStart, 0U);
+}
+
+static void bench_alarm_session(void) {
+    run_session(0U, 0U, 1U);
+
+    if (session.alarm < DESAT_ON_US) {
+        (void)fprintf(stderr, "alarm_session scenario raised no alarm on the drop\n");
+        exit(1);
+    }
+    add_metric("alarm_detect_us", session.alarm - DESAT_ON_US, 0U);
+    add_metric("alarm_latency_us", session.alarmLatency, 0U);
+}
+
+/* Idle -----------------------------------------------------------------------*/
+
+static power_sample_t idleReady;
+
+static void idle_console(const uint8_t *data, uint16_t size, void *ctx) {
+    static const char ready[] = "Ok, sensor ready";
+    (void)ctx;
+
+    if ((idleReady.time == 0U) && (size >= (sizeof(ready) - 1U))) {
+        for (uint16_t i = 0U; i <= (size - (sizeof(ready) - 1U)); i++) {
+            if (memcmp(&data[i], ready, sizeof(ready) - 1U) == 0) {
+                idleReady = power_sample();
+                break;
+            }
+        }
+    }
+}
+
+static void bench_idle(void) {
+    (void)memset(&idleReady, 0, sizeof(idleReady));
+    board(0U);
+    sim_uart_sink(idle_console, NULL);
+
+    sim_run(firmware_main, IDLE_US);
+    power_sample_t end = power_sample();
+
+    if (idleReady.time == 0U) {
+        (void)fprintf(stderr, "idle scenario did not complete\n");
+        exit(1);
+    }
+    add_metric("idle_stop_permille", ((end.stopUs - idleReady.stopUs) * 1000U) / (end.time - idleReady.time), 1U);
+    add_metric("idle_current_ua", power_current(&idleReady, &end), 0U);
+}
+
+/* Sensor hub driver ----------------------------------------------------------*/
+
+typedef struct acquisition {
+    uint8_t outputMode; // ALGO_DATA or SENSOR_AND_ALGORITHM
+    uint8_t configured;
+    uint64_t windowStart;
+    uint32_t samples;
+    uint32_t bytesAtStart;
+    uint32_t bytes;
+} acquisition_t;
+
+static acquisition_t acquisition;
+
+static _Noreturn int acquisition_main(void) {
+    static MAX32664_Handle pox;
+    GPIO_Line reset = {.port = GPIOC, .pin = GPIO_PIN_0};
+    GPIO_Line mfio = {.port = GPIOC, .pin = GPIO_PIN_1};
+
+    peripherals();
+    MAX32664_Init(&pox, &hi2c1, &reset, &mfio, WRITE_ADDRESS);
+    (void)MAX32664_Begin(&pox);
+    uint8_t error = (acquisition.outputMode == ALGO_DATA) ? MAX32664_ConfigBpm(&pox, MODE_ONE)
+                                                          : MAX32664_ConfigSensorBpm(&pox, MODE_ONE);
+    acquisition.configured = (error == (uint8_t)SB_SUCCESS) ? 1U : 0U;
+    acquisition.windowStart = sim_now() + WARMUP_US;
+
+    for (;;) {
+        bioData data = (acquisition.outputMode == ALGO_DATA) ? MAX32664_ReadBpm(&pox) : MAX32664_ReadSensorBpm(&pox);
+        if (sim_now() < acquisition.windowStart) {
+            acquisition.bytesAtStart = sim_stats()->i2cBytes;
+        } else if (sim_now() <= (acquisition.windowStart + WINDOW_US)) {
+            acquisition.bytes = sim_stats()->i2cBytes - acquisition.bytesAtStart;
+            if (data.status == 3U) {
+                acquisition.samples++;
+            }
+        } else {
+            // past the window, wait for the end of the run
+        }
+    }
+}
+
+static void bench_acquisition(uint8_t outputMode, const char *rateName, const char *bytesName) {
+    (void)memset(&acquisition, 0, sizeof(acquisition));
+    acquisition.outputMode = outputMode;
+    board(0U);
+
+    sim_run(acquisition_main, 20U * SECOND_US);
+
+    if ((acquisition.configured == 0U) || (acquisition.samples == 0U)) {
+        (void)fprintf(stderr, "%s scenario did not complete\n", rateName);
+        exit(1);
+    }
+    add_metric(rateName, ((uint64_t)acquisition.samples * SECOND_US * 1000U) / WINDOW_US, 1U);
+    add_metric(bytesName, acquisition.bytes / acquisition.samples, 0U);
+}
+
+/* Raw PPG ---------------------------------------------------------------------*/
+
+typedef struct raw_ppg {
+    MAX32664_Handle pox;
+    bioData batch[OXIMETRY_BATCH]; // reports of the last read
+    uint8_t count;                 // in batch
+    ppg_raw_t raw[OXIMETRY_BATCH];
+    ppg_t ppg;
+    uint8_t configured;
+} raw_ppg_t;
+
+static raw_ppg_t rawPpg;
+
+/* Algorithm run on the raw PPG of the finger of the hub model */
+typedef struct raw_scenario {
+    const char *name;                                            // in the error message
+    void (*start)(const int32_t coef[3]);                        // initialises it, calibration read from the hub
+    void (*step)(const ppg_sample_t *processed, uint16_t count); // feeds it a read, reports in rawPpg.batch
+    uint64_t settleUs;                                           // after the finger and the warm-up, then the window
+    const uint32_t *results;                                     // counted in the window, 0 if it did not run
+} raw_scenario_t;
+
+static const raw_scenario_t *rawScenario;
+
+/* Configures the hub as the firmware does, 1 if the chain is ready */
+static uint8_t raw_ppg_start(int32_t coef[3]) {
+    GPIO_Line reset = {.port = GPIOC, .pin = GPIO_PIN_0};
+    GPIO_Line mfio = {.port = GPIOC, .pin = GPIO_PIN_1};
+
+    peripherals();
+    MAX32664_Init(&rawPpg.pox, &hi2c1, &reset, &mfio, WRITE_ADDRESS);
+    (void)MAX32664_Begin(&rawPpg.pox);
+    uint8_t error = MAX32664_ConfigSensorBpm(&rawPpg.pox, MODE_TWO);
+    (void)MAX32664_ReadMaximFastCoef(&rawPpg.pox, coef);
+    return ((error == (uint8_t)SB_SUCCESS) && (ppg_init(&rawPpg.ppg, MAX32664_ReadSampleRate(&rawPpg.pox)) == HAL_OK))
+               ? 1U
+               : 0U;
+}
+
+/* Empties the hub FIFO through the chain */
+static uint16_t raw_ppg_read(ppg_sample_t *processed) {
+    rawPpg.count = MAX32664_ReadSensorBpmSamples(&rawPpg.pox, rawPpg.batch, OXIMETRY_BATCH);
+    for (uint8_t i = 0U; i < rawPpg.count; i++) {
+        rawPpg.raw[i].ir = rawPpg.batch[i].irLed;
+        rawPpg.raw[i].red = rawPpg.batch[i].redLed;
+    }
+    return ppg_process(&rawPpg.ppg, rawPpg.raw, rawPpg.count, processed);
+}
+
+static _Noreturn int raw_scenario_main(void) {
+    static ppg_sample_t processed[OXIMETRY_BATCH];
+    int32_t coef[3] = {SPO2_DEFAULT_COEF_A, SPO2_DEFAULT_COEF_B, SPO2_DEFAULT_COEF_C};
+
+    rawPpg.configured = raw_ppg_start(coef);
+    rawScenario->start(coef);
+
+    for (;;) {
+        uint16_t processedCount = raw_ppg_read(processed);
+        rawScenario->step(processed, processedCount);
+        HAL_Delay(OXIMETRY_PERIOD_MS);
+    }
+}
+
+/* Runs a scenario on the board set up by the caller, exits when it has no result */
+static void raw_scenario_run(const raw_scenario_t *scenario) {
+    rawScenario = scenario;
+
+    sim_run(raw_scenario_main, FINGER_US + WARMUP_US + scenario->settleUs + OXIMETRY_WINDOW_US + SECOND_US);
+
+    if ((rawPpg.configured == 0U) || (*scenario->results == 0U)) {
+        (void)fprintf(stderr, "%s scenario did not complete\n", scenario->name);
+        exit(1);
+    }
+}
+
+/* Local SpO2 -----------------------------------------------------------------*/
+
+typedef struct oximetry {
+    spo2_t spo2;
+    uint32_t beats;
+    uint32_t rejected;
+    uint32_t rejectedAtStart;
+    double errorSum; // absolute errors, 0.1 %
+} oximetry_t;
+
+static oximetry_t oximetry;
+
+static void oximetry_start(const int32_t coef[3]) {
+    spo2_init(&oximetry.spo2, coef);
+}
+
+static void oximetry_step(const ppg_sample_t *processed, uint16_t count) {
+    spo2_t *spo2 = &oximetry.spo2;
+
+    for (uint16_t i = 0U; i < count; i++) {
+        uint8_t estimated = spo2_add(spo2, &processed[i]);
+        if (sim_now() < (WARMUP_US + FINGER_US)) {
+            oximetry.rejectedAtStart = spo2->rejected;
+        } else if ((estimated != 0U) && (sim_now() <= (WARMUP_US + FINGER_US + OXIMETRY_WINDOW_US))) {
+            oximetry.beats++;
+            oximetry.errorSum += fabs((double)spo2->spo2 - hub.oxygen);
+            oximetry.rejected = spo2->rejected - oximetry.rejectedAtStart;
+        } else {
+            // outside the window
+        }
+    }
+}
+
+static const raw_scenario_t oximetryScenario = {"spo2", oximetry_start, oximetry_step, 0U, &oximetry.beats};
+
+static void bench_oximetry(void) {
+    (void)memset(&oximetry, 0, sizeof(oximetry));
+    board(FINGER_US);
+    raw_scenario_run(&oximetryScenario);
+    // 0.1 % is 1000 ppm of saturation
+    add_limited_metric("spo2_error_ppm", (uint64_t)((oximetry.errorSum * 1000.0) / oximetry.beats), 0U,
+                       SPO2_ERROR_LIMIT_PPM);
+    add_metric("spo2_estimates_per_min", ((uint64_t)oximetry.beats * 60U * SECOND_US) / OXIMETRY_WINDOW_US, 1U);
+    add_limited_metric("spo2_rejected_permille",
+                       ((uint64_t)oximetry.rejected * 1000U) / (oximetry.beats + oximetry.rejected), 0U,
+                       MISSING_LIMIT_PERMILLE);
+}
+
+/* Beat detection -------------------------------------------------------------*/
+
+typedef struct beats {
+    beat_t beat;
+    uint32_t intervals;               // intervals popped
+    beat_rr_t rr[BEATS_MAX];          // in the time of the detector
+    uint32_t peaks;                   // systolic peaks of the hub model
+    double peakUs[BEATS_MAX];         // in sim time
+} beats_t;
+
+static beats_t beats;
+
+static void beats_start(const int32_t coef[3]) {
+    (void)coef;
+    beat_init(&beats.beat);
+}
+
+static void beats_step(const ppg_sample_t *processed, uint16_t count) {
+    for (uint16_t i = 0U; i < count; i++) {
+        (void)beat_add(&beats.beat, &processed[i]);
+    }
+    while ((beats.intervals < BEATS_MAX) && (beat_pop(&beats.beat, &beats.rr[beats.intervals]) != 0U)) {
+        beats.intervals++;
+    }
+    while ((beats.peaks < hub.peaks) && (beats.peaks < BEATS_MAX)) {
+        beats.peakUs[beats.peaks] = hub.peakUs[beats.peaks & (SIM_MAX32664_PEAKS - 1U)];
+        beats.peaks++;
+    }
+}
+
+static const raw_scenario_t beatsScenario = {"beats", beats_start, beats_step, 0U, &beats.intervals};
+
+/* Index of the true peak within BEAT_MATCH_US of a time, -1 if there is none */
+static int32_t beats_match(double timeUs) {
+    for (uint32_t j = 0U; j < beats.peaks; j++) {
+        if (fabs(beats.peakUs[j] - timeUs) <= BEAT_MATCH_US) {
+            return (int32_t)j;
+        }
+    }
+    return -1;
+}
+
+typedef struct beats_score {
+    uint32_t matched;   // intervals ending at a true peak
+    uint32_t unmatched; // intervals ending elsewhere
+    double errorSum;    // absolute errors of the matched intervals, us
+} beats_score_t;
+
+/* Compares the intervals found in the window with the true ones, for an offset of the detector time */
+static beats_score_t beats_score(double offset) {
+    const double from = (double)(FINGER_US + WARMUP_US);
+    const double to = from + (double)OXIMETRY_WINDOW_US;
+    beats_score_t score = {0};
+
+    for (uint32_t i = 0U; i < beats.intervals; i++) {
+        double end = (double)beats.rr[i].timestamp + offset;
+        if ((end < from) || (end > to)) {
+            continue;
+        }
+        int32_t j = beats_match(end);
+        if (j < 1) {
+            score.unmatched++;
+            continue;
+        }
+        score.errorSum += fabs(((double)beats.rr[i].interval * 1000.0) - (beats.peakUs[j] - beats.peakUs[j - 1]));
+        score.matched++;
+    }
+    return score;
+}
+
+static void bench_beats(void) {
+    (void)memset(&beats, 0, sizeof(beats));
+    board(FINGER_US);
+    raw_scenario_run(&beatsScenario);
+
+    // the detector counts its own time: align it on the true peaks, any whole
+    // number of beats matches as many intervals, the rate swing tells them apart
+    beats_score_t best = {0};
+    for (uint32_t j = 0U; j < beats.peaks; j++) {
+        beats_score_t score = beats_score(beats.peakUs[j] - (double)beats.rr[0].timestamp);
+        if ((score.matched > best.matched) || ((score.matched == best.matched) && (score.errorSum < best.errorSum))) {
+            best = score;
+        }
+    }
+
+    uint32_t truthIntervals = 0U;
+    for (uint32_t j = 1U; j < beats.peaks; j++) {
+        if ((beats.peakUs[j] >= (double)(FINGER_US + WARMUP_US)) &&
+            (beats.peakUs[j] <= (double)(FINGER_US + WARMUP_US + OXIMETRY_WINDOW_US))) {
+            truthIntervals++;
+        }
+    }
+    if ((best.matched == 0U) || (truthIntervals == 0U)) {
+        (void)fprintf(stderr, "beats scenario found no interval\n");
+        exit(1);
+    }
+    add_limited_metric("rr_error_us", (uint64_t)(best.errorSum / best.matched), 0U, RR_ERROR_LIMIT_US);
+    add_limited_metric("rr_found_permille", ((uint64_t)best.matched * 1000U) / truthIntervals, 1U,
+                       RR_FOUND_LIMIT_PERMILLE);
+    add_limited_metric("rr_false_permille", ((uint64_t)best.unmatched * 1000U) / (best.matched + best.unmatched), 0U,
+                       MISSING_LIMIT_PERMILLE);
+}
+
+/* Heart rate by autocorrelation ----------------------------------------------*/
+
+typedef struct autocorr {
+    acf_t acf;
+    double truth[ACF_WINDOW]; // rate of the model along the window
+    uint32_t truthHead;
+    uint32_t estimates;       // in the window, with a period found
+    uint32_t missing;         // in the window, without one
+    double errorSum;          // absolute errors, 0.1 bpm
+} autocorr_t;
+
+static autocorr_t autocorr;
+
+static void autocorr_start(const int32_t coef[3]) {
+    (void)coef;
+    acf_init(&autocorr.acf);
+}
+
+static void autocorr_step(const ppg_sample_t *processed, uint16_t count) {
+    const acf_t *acf = &autocorr.acf;
+
+    for (uint16_t i = 0U; i < count; i++) {
+        uint64_t now = sim_now();
+        autocorr.truth[autocorr.truthHead] = hub.heartRate;
+        autocorr.truthHead = (autocorr.truthHead + 1U) % ACF_WINDOW;
+        if ((acf_add(&autocorr.acf, &processed[i]) == 0U) || (now < (FINGER_US + WARMUP_US + ACF_SETTLE_US)) ||
+            (now > (FINGER_US + WARMUP_US + ACF_SETTLE_US + OXIMETRY_WINDOW_US))) {
+            continue;
+        }
+        if (acf->heartRate == 0U) {
+            autocorr.missing++;
+        } else {
+            double mean = 0.0;
+            for (uint32_t j = 0U; j < ACF_WINDOW; j++) {
+                mean += autocorr.truth[j] / ACF_WINDOW;
+            }
+            autocorr.estimates++;
+            autocorr.errorSum += fabs((double)acf->heartRate - mean);
+        }
+    }
+}
+
+static const raw_scenario_t autocorrScenario = {"acf", autocorr_start, autocorr_step, ACF_SETTLE_US,
+                                                &autocorr.estimates};
+
+static void bench_autocorr(void) {
+    (void)memset(&autocorr, 0, sizeof(autocorr));
+    board(FINGER_US);
+    raw_scenario_run(&autocorrScenario);
+    // 0.1 bpm is 100 mbpm
+    add_limited_metric("acf_hr_error_mbpm", (uint64_t)((autocorr.errorSum * 100.0) / autocorr.estimates), 0U,
+                       ACF_HR_ERROR_LIMIT_MBPM);
+    add_limited_metric("acf_missing_permille",
+                       ((uint64_t)autocorr.missing * 1000U) / (autocorr.estimates + autocorr.missing), 0U,
+                       MISSING_LIMIT_PERMILLE);
+    add_metric("acf_bytes", sizeof(acf_t), 0U);
+}
+
+/* Respiration and perfusion ----------------------------------------------------*/
+
+typedef struct breathing {
+    beat_t beat;
+    resp_t resp;
+    uint32_t beats;       // in the window
+    uint32_t estimates;   // beats in the window with a rate
+    uint32_t missing;     // beats in the window without one
+    double errorSum;      // absolute errors of the rates, 0.1 breaths/min
+    double perfusionSum;  // perfusion indexes of the beats, 0.01 %
+    double truthSum;      // of the hub model at the beats
+} breathing_t;
+
+static breathing_t breathing;
+
+static void breathing_start(const int32_t coef[3]) {
+    (void)coef;
+    beat_init(&breathing.beat);
+    resp_init(&breathing.resp);
+}
+
+static void breathing_step(const ppg_sample_t *processed, uint16_t count) {
+    resp_t *resp = &breathing.resp;
+    uint64_t now = sim_now();
+    beat_rr_t rr;
+
+    for (uint16_t i = 0U; i < count; i++) {
+        (void)beat_add(&breathing.beat, &processed[i]);
+        resp_add(resp, &processed[i]);
+    }
+    while (beat_pop(&breathing.beat, &rr) != 0U) {
+        uint16_t perfusion = resp_add_beat(resp, &rr);
+        if ((now < (FINGER_US + WARMUP_US + RESP_SETTLE_US)) ||
+            (now > (FINGER_US + WARMUP_US + RESP_SETTLE_US + OXIMETRY_WINDOW_US))) {
+            continue;
+        }
+        breathing.beats++;
+        breathing.perfusionSum += (double)perfusion;
+        breathing.truthSum += hub.perfusion;
+        if (resp_rate(resp) == 0U) {
+            breathing.missing++;
+        } else {
+            breathing.estimates++;
+            breathing.errorSum += fabs((double)resp_rate(resp) - (double)hub.config.respiration);
+        }
+    }
+}
+
+static const raw_scenario_t breathingScenario = {"resp", breathing_start, breathing_step, RESP_SETTLE_US,
+                                                 &breathing.beats};
+
+static void bench_breathing(void) {
+    static const uint16_t rates[] = RESP_RATES;
+    uint64_t worstError = 0U;
+    uint64_t worstMissing = 0U;
+    uint64_t worstPerfusion = 0U;
+
+    for (uint32_t r = 0U; r < (sizeof(rates) / sizeof(rates[0])); r++) {
+        (void)memset(&breathing, 0, sizeof(breathing));
+        board(FINGER_US);
+        hub.config.respiration = rates[r];
+        raw_scenario_run(&breathingScenario);
+
+        // 0.1 breaths/min is 100 thousandths
+        uint64_t error = (breathing.estimates > 0U) ? (uint64_t)((breathing.errorSum * 100.0) / breathing.estimates)
+                                                    : UINT32_MAX;
+        uint64_t missing = ((uint64_t)breathing.missing * 1000U) / breathing.beats;
+        uint64_t perfusion =
+            (uint64_t)((fabs(breathing.perfusionSum - breathing.truthSum) * 1000.0) / breathing.truthSum);
+        worstError = (error > worstError) ? error : worstError;
+        worstMissing = (missing > worstMissing) ? missing : worstMissing;
+        worstPerfusion = (perfusion > worstPerfusion) ? perfusion : worstPerfusion;
+    }
+    add_limited_metric("resp_error_mbrpm", worstError, 0U, RESP_ERROR_LIMIT_MBRPM);
+    add_limited_metric("resp_missing_permille", worstMissing, 0U, MISSING_LIMIT_PERMILLE);
+    add_limited_metric("pi_error_permille", worstPerfusion, 0U, PI_ERROR_LIMIT_PERMILLE);
+}
+
+/* Live tracking ----------------------------------------------------------------*/
+
+typedef struct tracking {
+    tracker_t hr;
+    tracker_t oxy;
+    uint32_t samples;   // in the window
+    double hrErrorSum;  // absolute errors, 0.1 bpm
+    double oxyErrorSum; // absolute errors, 0.1 %
+} tracking_t;
+
+static tracking_t tracking;
+
+static void tracking_start(const int32_t coef[3]) {
+    (void)coef;
+    tracker_init(&tracking.hr, TRACK_HR_DRIFT, TRACK_HR_NOISE);
+    tracker_init(&tracking.oxy, TRACK_OXY_DRIFT, TRACK_OXY_NOISE);
+}
+
+/* Tracks the reports of the hub, the processed samples are not used */
+static void tracking_step(const ppg_sample_t *processed, uint16_t count) {
+    uint64_t now = sim_now();
+
+    (void)processed;
+    (void)count;
+    for (uint8_t i = 0U; i < rawPpg.count; i++) {
+        // as the firmware: the reports under the measurable range only age the estimates
+        const bioData *sample = &rawPpg.batch[i];
+        uint8_t weight = ((sample->heartRate < MIN_MEASURABLE_HR) || (sample->oxygen < MIN_MEASURABLE_OXY))
+                             ? 0U
+                             : sample->confidence;
+        (void)tracker_add(&tracking.hr, sample->heartRate, weight);
+        (void)tracker_add(&tracking.oxy, sample->oxygen, weight);
+        if ((now < (FINGER_US + WARMUP_US + TRACKER_SETTLE_US)) ||
+            (now > (FINGER_US + WARMUP_US + TRACKER_SETTLE_US + OXIMETRY_WINDOW_US))) {
+            continue;
+        }
+        tracking.samples++;
+        tracking.hrErrorSum += fabs((double)tracker_value(&tracking.hr, 1U) - hub.heartRate);
+        tracking.oxyErrorSum += fabs((double)tracker_value(&tracking.oxy, 10U) - hub.oxygen);
+    }
+}
+
+static const raw_scenario_t trackingScenario = {"tracker", tracking_start, tracking_step, TRACKER_SETTLE_US,
+                                                &tracking.samples};
+
+static void bench_tracking(void) {
+    (void)memset(&tracking, 0, sizeof(tracking));
+    board(FINGER_US);
+    hub.config.glitchPeriodUs = TRACKER_GLITCH_US;
+    raw_scenario_run(&trackingScenario);
+    // 0.1 bpm is 100 mbpm, 0.1 % is 1000 ppm of saturation
+    add_limited_metric("tracker_hr_error_mbpm", (uint64_t)((tracking.hrErrorSum * 100.0) / tracking.samples), 0U,
+                       TRACKER_HR_ERROR_LIMIT_MBPM);
+    add_limited_metric("tracker_oxy_error_ppm", (uint64_t)((tracking.oxyErrorSum * 1000.0) / tracking.samples), 0U,
+                       TRACKER_OXY_ERROR_LIMIT_PPM);
+    add_metric("tracker_bytes", sizeof(tracker_t), 0U);
+}
+
+/* Display driver -------------------------------------------------------------*/
+
+typedef struct refresh {
+    uint32_t updates;
+    uint64_t time;
+    uint32_t bytes;
+} refresh_t;
+
+static refresh_t refresh;
+
+static _Noreturn int display_main(void) {
+    peripherals();
+    ssd1306_Init();
+
+    for (;;) {
+        ssd1306_Fill(Black);
+        ssd1306_SetCursor(0, 0);
+        (void)ssd1306_WriteCString("Measuring", Font_7x10, White);
+
+        uint64_t start = sim_now();
+        uint32_t bytes = sim_stats()->i2cBytes;
+        ssd1306_UpdateScreen();
+        if (refresh.updates < DISPLAY_UPDATES) {
+            refresh.time += sim_now() - start;
+            refresh.bytes += sim_stats()->i2cBytes - bytes;
+            refresh.updates++;
+        }
+        HAL_Delay(100);
+    }
+}
+
+static void bench_display(void) {
+    (void)memset(&refresh, 0, sizeof(refresh));
+    board(0U);
+
+    sim_run(display_main, 5U * SECOND_US);
+
+    if (refresh.updates < DISPLAY_UPDATES) {
+        (void)fprintf(stderr, "display scenario did not complete\n");
+        exit(1);
+    }
+    add_metric("display_refresh_us", refresh.time / refresh.updates, 0U);
+    add_metric("display_bytes_per_refresh", refresh.bytes / refresh.updates, 0U);
+}
+
+/* Statistics -----------------------------------------------------------------*/
+
+static uint64_t error_ppb(double value, double reference) {
+    return (uint64_t)((fabs(value - reference) * 1e9) / reference);
+}
+
+static void bench_stats(void) {
+    static uint16_t values[STATS_SAMPLES];
+    stats_t stats;
+    uint32_t noise = 1U;
+
+    stats_reset(&stats);
+    for (uint32_t i = 0U; i < STATS_SAMPLES; i++) {
+        noise = (noise * 1664525U) + 1013904223U;
+        double swing = STATS_SWING * sin((2.0 * M_PI * (double)i) / STATS_SWING_SAMPLES);
+        values[i] = (uint16_t)((STATS_MEAN + swing) + (double)((noise >> 16) % ((2U * STATS_NOISE) + 1U)) -
+                               (double)STATS_NOISE);
+        stats_add(&stats, values[i], 1U);
+    }
+
+    double sum = 0.0;
+    for (uint32_t i = 0U; i < STATS_SAMPLES; i++) {
+        sum += values[i];
+    }
+    double mean = sum / STATS_SAMPLES;
+    double squares = 0.0;
+    for (uint32_t i = 0U; i < STATS_SAMPLES; i++) {
+        squares += (values[i] - mean) * (values[i] - mean);
+    }
+    double variance = squares / (STATS_SAMPLES - 1U);
+
+    add_limited_metric("stats_mean_error_ppb", error_ppb((double)stats.mean / STATS_ONE, mean), 0U,
+                       STATS_ERROR_LIMIT_PPB);
+    add_limited_metric("stats_variance_error_ppb",
+                       error_ppb((double)stats_variance(&stats) / ((double)STATS_ONE * STATS_ONE), variance), 0U,
+                       STATS_ERROR_LIMIT_PPB);
+    add_metric("stats_bytes", sizeof(stats_t), 0U);
+}
+
+/* PPG ------------------------------------------------------------------------*/
+
+typedef struct ref_biquad {
+    double b[3];
+    double a[2]; // feedback, y[n] = ... + a[0] * y[n-1] + a[1] * y[n-2]
+    double x[2];
+    double y[2];
+} ref_biquad_t;
+
+typedef struct ref_channel {
+    double sum;
+    double dc;
+    ref_biquad_t stages[2];
+} ref_channel_t;
+
+/* Butterworth biquad by the bilinear transform, cut-off prewarped */
+static void ref_butterworth(ref_biquad_t *stage, double cutoffHz, double rateHz, uint8_t highPass) {
+    double k = tan((M_PI * cutoffHz) / rateHz);
+    double norm = 1.0 / (1.0 + (M_SQRT2 * k) + (k * k));
+
+    (void)memset(stage, 0, sizeof(*stage));
+    if (highPass != 0U) {
+        stage->b[0] = norm;
+        stage->b[1] = -2.0 * norm;
+    } else {
+        stage->b[0] = k * k * norm;
+        stage->b[1] = 2.0 * k * k * norm;
+    }
+    stage->b[2] = stage->b[0];
+    stage->a[0] = -2.0 * ((k * k) - 1.0) * norm;
+    stage->a[1] = -(1.0 - (M_SQRT2 * k) + (k * k)) * norm;
+}
+
+static double ref_biquad(ref_biquad_t *stage, double in) {
+    double out = (stage->b[0] * in) + (stage->b[1] * stage->x[0]) + (stage->b[2] * stage->x[1]) +
+                 (stage->a[0] * stage->y[0]) + (stage->a[1] * stage->y[1]);
+    stage->x[1] = stage->x[0];
+    stage->x[0] = in;
+    stage->y[1] = stage->y[0];
+    stage->y[0] = out;
+    return out;
+}
+
+/* The chain of ppg.c on one boxcar average, in 2^-PPG_GAIN_BITS counts */
+static double ref_filter(ref_channel_t *channel, double level, uint8_t primed) {
+    if (primed == 0U) {
+        channel->dc = level;
+    }
+    double ac = level - channel->dc;
+    channel->dc += ac / (double)(1U << PPG_DC_SHIFT);
+    for (uint32_t s = 0U; s < 2U; s++) {
+        ac = ref_biquad(&channel->stages[s], ac);
+    }
+    return ac;
+}
+
+/* Worst of the IR and red RMS errors at one sample rate, ppm */
+static uint64_t ppg_error_ppm(uint16_t rate) {
+    static ppg_raw_t raw[PPG_SECONDS * 3200U];
+    static ppg_sample_t out[PPG_SECONDS * PPG_OUTPUT_HZ];
+    ppg_t ppg;
+    ref_channel_t ref[2];
+    uint32_t samples = (uint32_t)rate * PPG_SECONDS;
+    uint32_t boxcar = rate / PPG_RATE_HZ;
+    uint32_t noise = 1U;
+
+    for (uint32_t i = 0U; i < samples; i++) {
+        double t = (double)i / rate;
+        double pulse = sin(2.0 * M_PI * PPG_PULSE_HZ * t) + (0.4 * sin(4.0 * M_PI * PPG_PULSE_HZ * t));
+        double wander = PPG_WANDER * sin(2.0 * M_PI * PPG_BREATH_HZ * t);
+        noise = (noise * 1664525U) + 1013904223U;
+        double n = (double)((noise >> 16) % ((2U * PPG_NOISE) + 1U)) - (double)PPG_NOISE;
+        raw[i].ir = (uint32_t)lround(PPG_IR_DC + (PPG_IR_AC * pulse) + wander + n);
+        raw[i].red = (uint32_t)lround(PPG_RED_DC + (PPG_RED_AC * pulse) + (0.75 * wander) + n);
+    }
+
+    (void)ppg_init(&ppg, rate);
+    uint32_t outputs = 0U;
+    for (uint32_t i = 0U; i < samples; i += PPG_CHUNK) {
+        uint16_t chunk = (uint16_t)(((samples - i) < PPG_CHUNK) ? (samples - i) : PPG_CHUNK);
+        outputs += ppg_process(&ppg, &raw[i], chunk, &out[outputs]);
+    }
+
+    for (uint32_t c = 0U; c < 2U; c++) {
+        ref_butterworth(&ref[c].stages[0], 5.0, PPG_RATE_HZ, 0U);
+        ref_butterworth(&ref[c].stages[1], 0.5, PPG_RATE_HZ, 1U);
+    }
+    double error[2] = {0.0, 0.0};
+    double power[2] = {0.0, 0.0};
+    uint32_t compared = 0U;
+    for (uint32_t k = 0U; (k * boxcar) < samples; k++) {
+        double level[2] = {0.0, 0.0};
+        for (uint32_t i = k * boxcar; i < ((k + 1U) * boxcar); i++) {
+            level[0] += raw[i].ir;
+            level[1] += raw[i].red;
+        }
+        double ac[2];
+        for (uint32_t c = 0U; c < 2U; c++) {
+            ac[c] = ref_filter(&ref[c], (level[c] * (1U << PPG_GAIN_BITS)) / boxcar, (uint8_t)(k > 0U));
+        }
+        // one filtered sample in two is kept
+        uint32_t o = k / 2U;
+        if (((k % 2U) != 0U) || (o >= outputs) || (o < (PPG_SETTLE_SECONDS * PPG_OUTPUT_HZ))) {
+            continue;
+        }
+        double got[2] = {out[o].ir, out[o].red};
+        for (uint32_t c = 0U; c < 2U; c++) {
+            error[c] += (got[c] - ac[c]) * (got[c] - ac[c]);
+            power[c] += ac[c] * ac[c];
+        }
+        compared++;
+    }
+
+    if ((outputs != (samples / boxcar / 2U)) || (compared == 0U)) {
+        (void)fprintf(stderr, "ppg at %u Hz: %u samples out\n", rate, outputs);
+        return UINT64_MAX;
+    }
+    uint64_t worst = 0U;
+    for (uint32_t c = 0U; c < 2U; c++) {
+        uint64_t ppm = (uint64_t)(sqrt(error[c] / power[c]) * 1e6);
+        if (ppm > worst) {
+            worst = ppm;
+        }
+    }
+    return worst;
+}
+
+static void bench_ppg(void) {
+    static const uint16_t rates[] = {50U, 100U, 200U, 400U, 800U, 1000U, 1600U, 3200U};
+    uint64_t worst = 0U;
+
+    for (uint32_t i = 0U; i < (sizeof(rates) / sizeof(rates[0])); i++) {
+        uint64_t ppm = ppg_error_ppm(rates[i]);
+        (void)fprintf(stderr, "ppg at %u Hz: error %llu ppm\n", rates[i], (unsigned long long)ppm);
+        if (ppm > worst) {
+            worst = ppm;
+        }
+    }
+    add_limited_metric("ppg_error_ppm", worst, 0U, PPG_ERROR_LIMIT_PPM);
+    add_metric("ppg_bytes", sizeof(ppg_t), 0U);
+}
+
+/* Output ---------------------------------------------------------------------*/
+
+static void write_json(FILE *file) {
+    (void)fprintf(file, "{\n  \"metrics\": {\n");
+    for (uint32_t i = 0U; i < metricCount; i++) {
+        (void)fprintf(file, "    \"%s\": {\"value\": %llu, \"better\": \"%s\"}%s\n", metrics[i].name,
+                      (unsigned long long)metrics[i].value, (metrics[i].higherIsBetter != 0U) ? "higher" : "lower",
+                      ((i + 1U) < metricCount) ? "," : "");
+    }
+    (void)fprintf(file, "  }\n}\n");
+}
+
+static void bench_algo_acquisition(void) {
+    bench_acquisition(ALGO_DATA, "algo_samples_mps", "algo_bytes_per_sample");
+}
+
+static void bench_sensor_algo_acquisition(void) {
+    bench_acquisition(SENSOR_AND_ALGORITHM, "sensor_algo_samples_mps", "sensor_algo_bytes_per_sample");
+}
+
+// in the order of the metrics
+static void (*const scenarios[])(void) = {
+    bench_session,
+    bench_fast_session,
+    bench_motion_session,
+    bench_alarm_session,
+    bench_idle,
+    bench_algo_acquisition,
+    bench_sensor_algo_acquisition,
+    bench_oximetry,
+    bench_beats,
+    bench_autocorr,
+    bench_breathing,
+    bench_tracking,
+    bench_display,
+    bench_stats,
+    bench_ppg,
+};
+
+// the scenarios of the algorithms, whose metrics have limits
+static void (*const accuracyScenarios[])(void) = {
+    bench_oximetry, bench_beats, bench_autocorr, bench_breathing, bench_tracking, bench_stats, bench_ppg,
+};
+
+/*
+ * Runs a scenario in a child process and collects its metrics. The names of
+ * the metrics are string literals, at the same addresses in both processes.
+ */
+static void run_scenario(void (*scenario)(void)) {
+    int fds[2];
+
+    (void)fflush(stdout);
+    (void)fflush(stderr);
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        (void)close(fds[0]);
+        metricCount = 0U;
+        scenario();
+        ssize_t size = (ssize_t)(metricCount * sizeof(metric_t));
+        _exit((write(fds[1], metrics, (size_t)size) == size) ? 0 : 1);
+    }
+
+    (void)close(fds[1]);
+    uint8_t *into = (uint8_t *)&metrics[metricCount];
+    size_t room = (MAX_METRICS - metricCount) * sizeof(metric_t);
+    size_t got = 0U;
+    ssize_t n;
+    while ((n = read(fds[0], &into[got], room - got)) > 0) {
+        got += (size_t)n;
+    }
+    (void)close(fds[0]);
+    int status = 0;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        // the scenario already said why
+        exit(1);
+    }
+    metricCount += (uint32_t)(got / sizeof(metric_t));
+}
+
+/* Reports the metrics beyond their limit, returns how many */
+static uint32_t check_limits(void) {
+    uint32_t beyond = 0U;
+
+    for (uint32_t i = 0U; i < metricCount; i++) {
+        const metric_t *metric = &metrics[i];
+        if ((metric->limit == 0U) ||
+            ((metric->higherIsBetter != 0U) ? (metric->value >= metric->limit) : (metric->value <= metric->limit))) {
+            continue;
+        }
+        if (beyond == 0U) {
+            (void)fprintf(stderr, "accuracy beyond the limits:\n");
+        }
+        (void)fprintf(stderr, "  %s: %llu, limit %llu\n", metric->name, (unsigned long long)metric->value,
+                      (unsigned long long)metric->limit);
+        beyond++;
+    }
+    return beyond;
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    void (*const *run)(void) = scenarios;
+    uint32_t runCount = sizeof(scenarios) / sizeof(scenarios[0]);
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--output") == 0) && ((i + 1) < argc)) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--accuracy") == 0) {
+            run = accuracyScenarios;
+            runCount = sizeof(accuracyScenarios) / sizeof(accuracyScenarios[0]);
+        } else {
+            (void)fprintf(stderr, "usage: %s [--accuracy] [--output file.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (uint32_t i = 0U; i < runCount; i++) {
+        run_scenario(run[i]);
+    }
+
+    for (uint32_t i = 0U; i < metricCount; i++) {
+        (void)fprintf(stderr, "%-32s %12llu\n", metrics[i].name, (unsigned long long)metrics[i].value);
+    }
+    if (check_limits() != 0U) {
+        return 1;
+    }
+
+    if (output == NULL) {
+        write_json(stdout);
+        return 0;
+    }
+    FILE *file = fopen(output, "w");
+    if (file == NULL) {
+        (void)fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    write_json(file);
+    (void)fclose(file);
+    return 0;
+}
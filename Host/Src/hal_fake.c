@@ -0,0 +1,1065 @@
+#include "sim.h"
+#include "sim_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Largest transfer on the simulated I2C bus, register address included */
+#define SIM_I2C_MAX_TRANSFER (1024U)
+
+#define SIM_MAX_GPIO_WATCHERS (8U)
+
+#define SIM_MAX_TIMERS (4U)
+
+uint32_t SystemCoreClock = HSI_VALUE;
+
+GPIO_TypeDef sim_gpio_ports[3];
+I2C_TypeDef sim_i2c1 = {.id = 1U};
+USART_TypeDef sim_usart2 = {.id = 2U};
+TIM_TypeDef sim_tim2 = {2U};
+TIM_TypeDef sim_tim3 = {3U};
+TIM_TypeDef sim_tim5 = {5U};
+TIM_TypeDef sim_tim10 = {10U};
+RTC_TypeDef sim_rtc = {1U};
+
+volatile uint32_t uwTick = 0U;
+static uint64_t tickTime = 0U; // virtual time of the last SysTick counted in uwTick
+static uint8_t tickSuspended = 0U;
+static uint8_t stopped = 0U;
+static uint64_t stopStart = 0U;
+
+// clock tree, AHB never divided
+static uint32_t pllHz = 0U; // PLL output, 0 while stopped
+static uint32_t sysclkSource = RCC_SYSCLKSOURCE_HSI;
+static uint32_t apb1Divider = RCC_HCLK_DIV1;
+static uint32_t apb2Divider = RCC_HCLK_DIV1;
+static uint32_t flashLatency = FLASH_LATENCY_0;
+static uint64_t pllAccounted = 0U; // virtual time up to which the PLL time is counted
+
+// timer handles initialised by the firmware, frozen in STOP
+static TIM_HandleTypeDef *timers[SIM_MAX_TIMERS];
+
+static sim_i2c_device_t *i2cDevices = NULL;
+static uint64_t transferEnd = 0U;
+
+static struct {
+    sim_gpio_watch_fn fn;
+    void *ctx;
+} gpioWatchers[SIM_MAX_GPIO_WATCHERS];
+
+static uint16_t extiPending = 0U;
+
+static sim_uart_sink_fn uartSink = NULL;
+static void *uartSinkCtx = NULL;
+static UART_HandleTypeDef *uartRx = NULL;
+static uint8_t uartRxDone = 0U;
+static uint8_t consoleWake = 0U; // EXTI line 3 set on the USART2 RX pin
+
+static uint64_t rtcStart = 0U;  // virtual time the calendar was initialised at
+static uint64_t rtcShadow = 0U; // virtual time the calendar registers show
+static uint8_t rtcStale = 0U;   // shadow registers not synchronised since STOP
+static uint32_t rtcAsynch = 1U; // AsynchPrediv + 1
+static uint32_t rtcSynch = 1U;  // SynchPrediv + 1
+
+static void tim_freeze(TIM_HandleTypeDef *htim);
+static void tim_thaw(TIM_HandleTypeDef *htim, uint64_t stoppedUs);
+static void tim_rebase(TIM_HandleTypeDef *htim);
+static void tim_reschedule(TIM_HandleTypeDef *htim);
+static void rtc_wakeup(void *ctx);
+
+/* Common -------------------------------------------------------------------*/
+
+void sim_hal_reset(void) {
+    uwTick = 0U;
+    tickTime = 0U;
+    tickSuspended = 0U;
+    stopped = 0U;
+    pllHz = 0U;
+    sysclkSource = RCC_SYSCLKSOURCE_HSI;
+    apb1Divider = RCC_HCLK_DIV1;
+    apb2Divider = RCC_HCLK_DIV1;
+    flashLatency = FLASH_LATENCY_0;
+    pllAccounted = 0U;
+    SystemCoreClock = HSI_VALUE;
+    (void)memset(timers, 0, sizeof(timers));
+    consoleWake = 0U;
+    rtcStart = 0U;
+    rtcStale = 0U;
+}
+
+/* Counts the SysTicks elapsed since the last call */
+static void tick_update(void) {
+    if ((tickSuspended == 0U) && (stopped == 0U)) {
+        uint64_t ticks = (sim_now() - tickTime) / 1000U;
+        uwTick += (uint32_t)ticks;
+        tickTime += ticks * 1000U;
+    }
+}
+
+uint8_t sim_tick_running(void) {
+    return ((tickSuspended == 0U) && (stopped == 0U)) ? 1U : 0U;
+}
+
+HAL_StatusTypeDef HAL_Init(void) {
+    uwTick = 0U;
+    tickTime = sim_now();
+    tickSuspended = 0U;
+    return HAL_OK;
+}
+
+void HAL_IncTick(void) {
+    // SysTick is not an interrupt of the simulator, see tick_update
+}
+
+uint32_t HAL_GetTick(void) {
+    tick_update();
+    return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay) {
+    uint32_t tickstart = HAL_GetTick();
+    uint64_t wait = Delay;
+
+    // same minimum wait as the HAL: at least one full tick
+    if (wait < HAL_MAX_DELAY) {
+        wait += 1U;
+    }
+    while ((uint64_t)(HAL_GetTick() - tickstart) < wait) {
+        sim_advance_to(tickTime + (((uint64_t)tickstart + wait - uwTick) * 1000U));
+    }
+}
+
+/* SysTick keeps counting while its interrupt is disabled: the phase is kept */
+void HAL_SuspendTick(void) {
+    tick_update();
+    tickSuspended = 1U;
+}
+
+void HAL_ResumeTick(void) {
+    tickTime += ((sim_now() - tickTime) / 1000U) * 1000U;
+    tickSuspended = 0U;
+}
+
+/* RCC ----------------------------------------------------------------------*/
+
+static uint32_t sysclk_hz(void) {
+    return (sysclkSource == RCC_SYSCLKSOURCE_PLLCLK) ? pllHz : HSI_VALUE;
+}
+
+/* APB clock from HCLK: RCC_HCLK_DIVx encodes the divider as in PPRE */
+static uint32_t apb_hz(uint32_t hclk, uint32_t divider) {
+    uint32_t shift = ((divider & 0x1000U) != 0U) ? (((divider >> 10U) & 0x3U) + 1U) : 0U;
+    return hclk >> shift;
+}
+
+uint8_t sim_hal_on_pll(void) {
+    return ((sysclkSource == RCC_SYSCLKSOURCE_PLLCLK) && (stopped == 0U)) ? 1U : 0U;
+}
+
+/* Adds the time spent on the PLL up to now to the statistics */
+void sim_hal_account(void) {
+    uint64_t time = sim_now();
+    if (sim_hal_on_pll() != 0U) {
+        sim_stats_mut()->pllUs += time - pllAccounted;
+    }
+    pllAccounted = time;
+}
+
+/* Timers keep their count across a change of their kernel clock */
+static void clock_change_begin(void) {
+    sim_hal_account();
+    for (uint32_t i = 0U; i < SIM_MAX_TIMERS; i++) {
+        if (timers[i] != NULL) {
+            tim_rebase(timers[i]);
+        }
+    }
+}
+
+static void clock_change_end(void) {
+    for (uint32_t i = 0U; i < SIM_MAX_TIMERS; i++) {
+        if (timers[i] != NULL) {
+            tim_reschedule(timers[i]);
+        }
+    }
+}
+
+void SystemCoreClockUpdate(void) {
+    SystemCoreClock = sysclk_hz();
+}
+
+/* Only the PLL is configured here, the oscillators are always on */
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct) {
+    const RCC_PLLInitTypeDef *pll = &RCC_OscInitStruct->PLL;
+
+    if (pll->PLLState == RCC_PLL_NONE) {
+        return HAL_OK;
+    }
+    // as the HAL: the PLL clocking the system is not touched
+    if (sysclkSource == RCC_SYSCLKSOURCE_PLLCLK) {
+        return HAL_ERROR;
+    }
+    if (pll->PLLState == RCC_PLL_ON) {
+        if ((pll->PLLM == 0U) || (pll->PLLP == 0U)) {
+            return HAL_ERROR;
+        }
+        pllHz = ((HSI_VALUE / pll->PLLM) * pll->PLLN) / pll->PLLP;
+        sim_advance(SIM_PLL_LOCK_US);
+    } else {
+        pllHz = 0U;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency) {
+    if (((RCC_ClkInitStruct->SYSCLKSource == RCC_SYSCLKSOURCE_PLLCLK) && (pllHz == 0U)) ||
+        (RCC_ClkInitStruct->AHBCLKDivider != RCC_SYSCLK_DIV1)) {
+        return HAL_ERROR;
+    }
+
+    clock_change_begin();
+    sysclkSource = RCC_ClkInitStruct->SYSCLKSource;
+    apb1Divider = RCC_ClkInitStruct->APB1CLKDivider;
+    apb2Divider = RCC_ClkInitStruct->APB2CLKDivider;
+    flashLatency = FLatency;
+    SystemCoreClock = sysclk_hz();
+    clock_change_end();
+
+    // one wait state per 30 MHz at 2.7-3.6 V, the core would read garbage
+    if (SystemCoreClock > ((flashLatency + 1U) * 30000000U)) {
+        (void)fprintf(stderr, "sim: %u flash wait states at %u Hz\n", (unsigned)flashLatency,
+                      (unsigned)SystemCoreClock);
+        abort();
+    }
+    return HAL_OK;
+}
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t *pFLatency) {
+    RCC_ClkInitStruct->ClockType = RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    RCC_ClkInitStruct->SYSCLKSource = sysclkSource;
+    RCC_ClkInitStruct->AHBCLKDivider = RCC_SYSCLK_DIV1;
+    RCC_ClkInitStruct->APB1CLKDivider = apb1Divider;
+    RCC_ClkInitStruct->APB2CLKDivider = apb2Divider;
+    *pFLatency = flashLatency;
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void) {
+    return sysclk_hz();
+}
+
+/* As the HAL, the bus frequencies derive from SystemCoreClock */
+uint32_t HAL_RCC_GetHCLKFreq(void) {
+    return SystemCoreClock;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return apb_hz(SystemCoreClock, apb1Divider);
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void) {
+    return apb_hz(SystemCoreClock, apb2Divider);
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef *PeriphClkInit) {
+    (void)PeriphClkInit;
+    return HAL_OK;
+}
+
+/* PWR ----------------------------------------------------------------------*/
+
+void HAL_PWREx_EnableFlashPowerDown(void) {
+}
+
+void HAL_DBGMCU_EnableDBGStopMode(void) {
+}
+
+void sim_hal_stop_enter(void) {
+    sim_hal_account();
+    stopped = 1U;
+    stopStart = sim_now();
+    for (uint32_t i = 0U; i < SIM_MAX_TIMERS; i++) {
+        if (timers[i] != NULL) {
+            tim_freeze(timers[i]);
+        }
+    }
+}
+
+/*
+ * The core restarts on HSI with the PLL stopped and the bus dividers kept,
+ * SystemCoreClock is not updated: the timers resume where they stopped
+ */
+void sim_hal_stop_exit(void) {
+    uint64_t stoppedUs = sim_now() - stopStart;
+
+    sim_hal_account();
+    stopped = 0U;
+    for (uint32_t i = 0U; i < SIM_MAX_TIMERS; i++) {
+        if (timers[i] != NULL) {
+            tim_thaw(timers[i], stoppedUs);
+        }
+    }
+    clock_change_begin();
+    sysclkSource = RCC_SYSCLKSOURCE_HSI;
+    pllHz = 0U;
+    clock_change_end();
+    rtcShadow = stopStart;
+    rtcStale = 1U;
+}
+
+/* GPIO ---------------------------------------------------------------------*/
+
+static uint32_t pin_index(uint16_t pin) {
+    return (uint32_t)__builtin_ctz(pin);
+}
+
+static IRQn_Type exti_irq(uint32_t index) {
+    if (index <= 4U) {
+        return (IRQn_Type)((uint32_t)EXTI0_IRQn + index);
+    }
+    return (index <= 9U) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+static GPIO_PinState pin_level(const GPIO_TypeDef *port, uint32_t index) {
+    uint32_t mask = 1UL << index;
+    uint32_t mode = port->mode[index];
+
+    if ((mode == GPIO_MODE_OUTPUT_PP) || (mode == GPIO_MODE_OUTPUT_OD)) {
+        return ((port->ODR & mask) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
+    if ((port->DRV & mask) != 0U) {
+        return ((port->IDR & mask) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+    }
+    return (port->pull[index] == GPIO_PULLUP) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init) {
+    for (uint32_t i = 0U; i < 16U; i++) {
+        if ((GPIO_Init->Pin & (1UL << i)) != 0U) {
+            GPIOx->mode[i] = GPIO_Init->Mode;
+            GPIOx->pull[i] = GPIO_Init->Pull;
+        }
+    }
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin) {
+    for (uint32_t i = 0U; i < 16U; i++) {
+        if ((GPIO_Pin & (1UL << i)) != 0U) {
+            GPIOx->mode[i] = GPIO_MODE_INPUT;
+            GPIOx->pull[i] = GPIO_NOPULL;
+        }
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    return pin_level(GPIOx, pin_index(GPIO_Pin));
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (PinState == GPIO_PIN_SET) {
+        GPIOx->ODR |= GPIO_Pin;
+    } else {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+
+    for (uint32_t i = 0U; i < 16U; i++) {
+        if ((GPIO_Pin & (1UL << i)) == 0U) {
+            continue;
+        }
+        for (uint32_t w = 0U; w < SIM_MAX_GPIO_WATCHERS; w++) {
+            if (gpioWatchers[w].fn != NULL) {
+                gpioWatchers[w].fn(GPIOx, (uint16_t)(1UL << i), PinState, gpioWatchers[w].ctx);
+            }
+        }
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    GPIO_PinState level = ((GPIOx->ODR & GPIO_Pin) != 0U) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    HAL_GPIO_WritePin(GPIOx, GPIO_Pin, level);
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin) {
+    if ((extiPending & GPIO_Pin) != 0U) {
+        extiPending &= (uint16_t)~GPIO_Pin;
+        HAL_GPIO_EXTI_Callback(GPIO_Pin);
+    }
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    (void)GPIO_Pin;
+}
+
+void sim_gpio_drive(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level) {
+    uint32_t index = pin_index(pin);
+    GPIO_PinState before = pin_level(port, index);
+
+    port->DRV |= pin;
+    if (level == GPIO_PIN_SET) {
+        port->IDR |= pin;
+    } else {
+        port->IDR &= ~(uint32_t)pin;
+    }
+
+    GPIO_PinState after = pin_level(port, index);
+    uint32_t mode = port->mode[index];
+    uint8_t rising = (before == GPIO_PIN_RESET) && (after == GPIO_PIN_SET);
+    uint8_t falling = (before == GPIO_PIN_SET) && (after == GPIO_PIN_RESET);
+
+    if ((rising && ((mode == GPIO_MODE_IT_RISING) || (mode == GPIO_MODE_IT_RISING_FALLING))) ||
+        (falling && ((mode == GPIO_MODE_IT_FALLING) || (mode == GPIO_MODE_IT_RISING_FALLING)))) {
+        extiPending |= pin;
+        sim_irq_pend(exti_irq(index));
+    }
+}
+
+HAL_StatusTypeDef HAL_EXTI_SetConfigLine(EXTI_HandleTypeDef *hexti, EXTI_ConfigTypeDef *pExtiConfig) {
+    hexti->Line = pExtiConfig->Line;
+    // only the console RX line is set up this way
+    consoleWake = ((pExtiConfig->Line == EXTI_LINE_3) && (pExtiConfig->GPIOSel == EXTI_GPIOA) &&
+                   (pExtiConfig->Mode == EXTI_MODE_INTERRUPT) && ((pExtiConfig->Trigger & EXTI_TRIGGER_FALLING) != 0U))
+                      ? 1U
+                      : 0U;
+    return HAL_OK;
+}
+
+void sim_gpio_watch(sim_gpio_watch_fn fn, void *ctx) {
+    if (fn == NULL) {
+        (void)memset(gpioWatchers, 0, sizeof(gpioWatchers));
+        extiPending = 0U;
+        return;
+    }
+    for (uint32_t w = 0U; w < SIM_MAX_GPIO_WATCHERS; w++) {
+        if (gpioWatchers[w].fn == NULL) {
+            gpioWatchers[w].fn = fn;
+            gpioWatchers[w].ctx = ctx;
+            return;
+        }
+    }
+}
+
+/* I2C ----------------------------------------------------------------------*/
+
+sim_i2c_device_t *sim_i2c_find(uint16_t address) {
+    for (sim_i2c_device_t *dev = i2cDevices; dev != NULL; dev = dev->next) {
+        if (dev->address == (uint8_t)(address & 0xFEU)) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Bus time of a transfer: 9 clocks per byte, plus start and stop conditions.
+ * An SCL period is 2 * CCR cycles of the current PCLK1.
+ */
+static uint64_t i2c_duration(const I2C_HandleTypeDef *hi2c, uint32_t bytes) {
+    uint64_t clocks = ((uint64_t)bytes * 9U) + 2U;
+    if (hi2c->Instance->CCR == 0U) {
+        return clocks * 1000000U / 100000U;
+    }
+    return (clocks * 2U * hi2c->Instance->CCR * 1000000U) / apb_hz(sysclk_hz(), apb1Divider);
+}
+
+static void i2c_wait(const I2C_HandleTypeDef *hi2c, uint32_t bytes) {
+    sim_stats_mut()->i2cBytes += bytes;
+    sim_advance(i2c_duration(hi2c, bytes));
+}
+
+static HAL_StatusTypeDef i2c_write(I2C_HandleTypeDef *hi2c, uint16_t address, const uint8_t *data, uint16_t size) {
+    sim_i2c_device_t *dev = sim_i2c_find(address);
+    sim_stats_mut()->i2cTransfers += 1U;
+
+    HAL_StatusTypeDef status = HAL_ERROR;
+    transferEnd = sim_now() + i2c_duration(hi2c, 1U + size);
+    if ((dev != NULL) && (dev->write != NULL)) {
+        status = dev->write(dev, data, size);
+    }
+    if (status != HAL_OK) {
+        sim_stats_mut()->i2cNacks += 1U;
+        i2c_wait(hi2c, 1U);
+        return HAL_ERROR;
+    }
+    i2c_wait(hi2c, 1U + size);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef i2c_read(I2C_HandleTypeDef *hi2c, uint16_t address, uint8_t *data, uint16_t size) {
+    sim_i2c_device_t *dev = sim_i2c_find(address);
+    sim_stats_mut()->i2cTransfers += 1U;
+
+    HAL_StatusTypeDef status = HAL_ERROR;
+    transferEnd = sim_now() + i2c_duration(hi2c, 1U + size);
+    if ((dev != NULL) && (dev->read != NULL)) {
+        status = dev->read(dev, data, size);
+    }
+    if (status != HAL_OK) {
+        sim_stats_mut()->i2cNacks += 1U;
+        i2c_wait(hi2c, 1U);
+        return HAL_ERROR;
+    }
+    i2c_wait(hi2c, 1U + size);
+    return HAL_OK;
+}
+
+uint64_t sim_i2c_transfer_end(void) {
+    return transferEnd;
+}
+
+void sim_i2c_attach(sim_i2c_device_t *dev) {
+    dev->next = i2cDevices;
+    i2cDevices = dev;
+}
+
+void sim_i2c_detach_all(void) {
+    i2cDevices = NULL;
+}
+
+/* Standard mode only: SCL high and low for CCR cycles of PCLK1 each */
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c) {
+    if ((hi2c->Init.ClockSpeed == 0U) || (hi2c->Init.ClockSpeed > 100000U)) {
+        return HAL_ERROR;
+    }
+    HAL_I2C_MspInit(hi2c);
+    hi2c->Instance->CCR = HAL_RCC_GetPCLK1Freq() / (2U * hi2c->Init.ClockSpeed);
+    return HAL_OK;
+}
+
+__weak void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+}
+
+__weak void HAL_I2C_MspDeInit(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    return i2c_write(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                         uint16_t Size, uint32_t Timeout) {
+    (void)Timeout;
+    return i2c_read(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    static uint8_t buffer[SIM_I2C_MAX_TRANSFER];
+    uint16_t header = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2U : 1U;
+
+    (void)Timeout;
+    if (((uint32_t)header + Size) > SIM_I2C_MAX_TRANSFER) {
+        return HAL_ERROR;
+    }
+    if (header == 2U) {
+        buffer[0] = (uint8_t)(MemAddress >> 8);
+        buffer[1] = (uint8_t)MemAddress;
+    } else {
+        buffer[0] = (uint8_t)MemAddress;
+    }
+    (void)memcpy(&buffer[header], pData, Size);
+    return i2c_write(hi2c, DevAddress, buffer, (uint16_t)(header + Size));
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+    uint8_t header[2];
+    uint16_t headerSize = (MemAddSize == I2C_MEMADD_SIZE_16BIT) ? 2U : 1U;
+
+    (void)Timeout;
+    if (headerSize == 2U) {
+        header[0] = (uint8_t)(MemAddress >> 8);
+        header[1] = (uint8_t)MemAddress;
+    } else {
+        header[0] = (uint8_t)MemAddress;
+    }
+    if (i2c_write(hi2c, DevAddress, header, headerSize) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    return i2c_read(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+                                        uint32_t Timeout) {
+    (void)Timeout;
+    for (uint32_t i = 0U; i < Trials; i++) {
+        sim_stats_mut()->i2cTransfers += 1U;
+        i2c_wait(hi2c, 1U);
+        if (sim_i2c_find(DevAddress) != NULL) {
+            return HAL_OK;
+        }
+        sim_stats_mut()->i2cNacks += 1U;
+    }
+    return HAL_ERROR;
+}
+
+/* UART ---------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart) {
+    if (huart->Init.BaudRate == 0U) {
+        return HAL_ERROR;
+    }
+    HAL_UART_MspInit(huart);
+    huart->Instance->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), huart->Init.BaudRate);
+    return HAL_OK;
+}
+
+__weak void HAL_UART_MspInit(UART_HandleTypeDef *huart) {
+    (void)huart;
+}
+
+__weak void HAL_UART_MspDeInit(UART_HandleTypeDef *huart) {
+    (void)huart;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size,
+                                    uint32_t Timeout) {
+    (void)Timeout;
+    if (uartSink != NULL) {
+        uartSink(pData, Size, uartSinkCtx);
+    }
+    sim_stats_mut()->uartBytes += Size;
+
+    // start bit, 8 data bits, stop bit, BRR cycles of the current PCLK1 each
+    uint64_t bits = (uint64_t)Size * 10U;
+    if (huart->Instance->BRR == 0U) {
+        sim_advance(bits * 1000000U / 9600U);
+    } else {
+        sim_advance((bits * huart->Instance->BRR * 1000000U) / apb_hz(sysclk_hz(), apb1Divider));
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size) {
+    if ((pData == NULL) || (Size == 0U)) {
+        return HAL_ERROR;
+    }
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->RxXferCount = Size;
+    uartRx = huart;
+    return HAL_OK;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart) {
+    if ((uartRxDone != 0U) && (huart == uartRx)) {
+        uartRxDone = 0U;
+        uartRx = NULL;
+        HAL_UART_RxCpltCallback(huart);
+    }
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+    (void)huart;
+}
+
+void sim_uart_sink(sim_uart_sink_fn fn, void *ctx) {
+    uartSink = fn;
+    uartSinkCtx = ctx;
+    if (fn == NULL) {
+        uartRx = NULL;
+        uartRxDone = 0U;
+    }
+}
+
+void sim_uart_inject(uint8_t c) {
+    // the falling edge of the start bit
+    if (consoleWake != 0U) {
+        extiPending |= GPIO_PIN_3;
+        sim_irq_pend(EXTI3_IRQn);
+    }
+    // no reception armed, USART2 stopped or the previous character is not
+    // consumed: overrun
+    if ((uartRx == NULL) || (stopped != 0U) || (uartRx->RxXferCount == 0U)) {
+        return;
+    }
+    *uartRx->pRxBuffPtr = c;
+    uartRx->pRxBuffPtr++;
+    uartRx->RxXferCount--;
+    if (uartRx->RxXferCount == 0U) {
+        uartRxDone = 1U;
+        sim_irq_pend(USART2_IRQn);
+    }
+}
+
+/* TIM ----------------------------------------------------------------------*/
+
+static IRQn_Type tim_irq(const TIM_HandleTypeDef *htim) {
+    if (htim->Instance == TIM10) {
+        return TIM1_UP_TIM10_IRQn;
+    }
+    if (htim->Instance == TIM2) {
+        return TIM2_IRQn;
+    }
+    if (htim->Instance == TIM3) {
+        return TIM3_IRQn;
+    }
+    return TIM5_IRQn;
+}
+
+/* Kernel clock of a timer: its APB clock, doubled when the APB is divided */
+static uint64_t tim_clock(const TIM_HandleTypeDef *htim) {
+    uint32_t divider = (htim->Instance == TIM10) ? apb2Divider : apb1Divider;
+    uint32_t pclk = apb_hz(sysclk_hz(), divider);
+    return (divider == RCC_HCLK_DIV1) ? pclk : (2U * (uint64_t)pclk);
+}
+
+/* Counter ticks at a virtual time, not wrapped */
+static uint64_t tim_ticks(const TIM_HandleTypeDef *htim, uint64_t time) {
+    uint64_t scale = 1000000U * ((uint64_t)htim->simPsc + 1U);
+    return htim->simBase + (((time - htim->simStart) * tim_clock(htim)) / scale);
+}
+
+/* Virtual time the counter reaches a tick count at, rounded up */
+static uint64_t tim_time(const TIM_HandleTypeDef *htim, uint64_t ticks) {
+    uint64_t scale = 1000000U * ((uint64_t)htim->simPsc + 1U);
+    uint64_t clock = tim_clock(htim);
+    return htim->simStart + ((((ticks - htim->simBase) * scale) + clock - 1U) / clock);
+}
+
+/* Restarts the counting from now, before the counting rate changes */
+static void tim_rebase(TIM_HandleTypeDef *htim) {
+    if (htim->simRunning != 0U) {
+        htim->simBase = tim_ticks(htim, sim_now());
+        htim->simStart = sim_now();
+    }
+}
+
+static void tim_compare(void *ctx);
+static void tim_update(void *ctx);
+
+/* Schedules the next match of the enabled compare channels */
+static void tim_compare_schedule(TIM_HandleTypeDef *htim) {
+    uint64_t wrap = (uint64_t)htim->Init.Period + 1U;
+    uint64_t ticks = tim_ticks(htim, sim_now());
+    uint64_t next = UINT64_MAX;
+
+    sim_cancel(tim_compare, htim);
+    if (htim->simRunning == 0U) {
+        return;
+    }
+    for (uint32_t i = 0U; i < 4U; i++) {
+        if ((htim->simIt & (TIM_IT_CC1 << i)) != 0U) {
+            // the counter matches the compare value when it reaches it, not while it holds it
+            uint64_t distance = (htim->simCompare[i] + wrap - (ticks % wrap)) % wrap;
+            uint64_t match = ticks + ((distance == 0U) ? wrap : distance);
+            if (match < next) {
+                next = match;
+            }
+        }
+    }
+    if (next != UINT64_MAX) {
+        sim_schedule(tim_time(htim, next), tim_compare, htim);
+    }
+}
+
+/* Schedules the next overflow, when the update interrupt is enabled */
+static void tim_update_schedule(TIM_HandleTypeDef *htim) {
+    uint64_t wrap = (uint64_t)htim->Init.Period + 1U;
+
+    sim_cancel(tim_update, htim);
+    if ((htim->simRunning == 0U) || ((htim->simIt & TIM_IT_UPDATE) == 0U)) {
+        return;
+    }
+    uint64_t next = ((tim_ticks(htim, sim_now()) / wrap) + 1U) * wrap;
+    sim_schedule(tim_time(htim, next), tim_update, htim);
+}
+
+/* The counting rate changed: the pending events move */
+static void tim_reschedule(TIM_HandleTypeDef *htim) {
+    tim_compare_schedule(htim);
+    tim_update_schedule(htim);
+}
+
+static void tim_compare(void *ctx) {
+    TIM_HandleTypeDef *htim = (TIM_HandleTypeDef *)ctx;
+    uint32_t counter = sim_tim_counter(htim);
+
+    for (uint32_t i = 0U; i < 4U; i++) {
+        if (((htim->simIt & (TIM_IT_CC1 << i)) != 0U) && (htim->simCompare[i] == counter)) {
+            htim->simFlags |= TIM_FLAG_CC1 << i;
+            sim_irq_pend(tim_irq(htim));
+        }
+    }
+    tim_compare_schedule(htim);
+}
+
+/* Overflow: raises the update interrupt and loads the preloaded prescaler */
+static void tim_update(void *ctx) {
+    TIM_HandleTypeDef *htim = (TIM_HandleTypeDef *)ctx;
+    htim->simUpdate = 1U;
+    sim_irq_pend(tim_irq(htim));
+    if (htim->simPsc != htim->simPscPreload) {
+        tim_rebase(htim);
+        htim->simPsc = htim->simPscPreload;
+    }
+    tim_reschedule(htim);
+}
+
+/* Cancels the events of a timer, its counter stops */
+static void tim_freeze(TIM_HandleTypeDef *htim) {
+    sim_cancel(tim_compare, htim);
+    sim_cancel(tim_update, htim);
+}
+
+/* Restarts a frozen timer, the counter resumes from the value it stopped at */
+static void tim_thaw(TIM_HandleTypeDef *htim, uint64_t stoppedUs) {
+    if (htim->simRunning == 0U) {
+        return;
+    }
+    htim->simStart += stoppedUs;
+    tim_reschedule(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim) {
+    for (uint32_t i = 0U; i < SIM_MAX_TIMERS; i++) {
+        if ((timers[i] == NULL) || (timers[i] == htim)) {
+            timers[i] = htim;
+            break;
+        }
+    }
+    // the handles outlive a run of the simulator
+    htim->simStart = 0U;
+    htim->simBase = 0U;
+    htim->simPsc = htim->Init.Prescaler;
+    htim->simPscPreload = htim->Init.Prescaler;
+    htim->simUrs = 0U;
+    htim->simRunning = 0U;
+    htim->simUpdate = 0U;
+    htim->simIt = 0U;
+    htim->simFlags = 0U;
+    HAL_TIM_Base_MspInit(htim);
+    return HAL_OK;
+}
+
+__weak void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+__weak void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim) {
+    htim->simStart = sim_now();
+    htim->simBase = 0U;
+    htim->simRunning = 1U;
+    tim_compare_schedule(htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) {
+    (void)HAL_TIM_Base_Start(htim);
+    htim->simIt |= TIM_IT_UPDATE;
+    tim_update_schedule(htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim) {
+    htim->simRunning = 0U;
+    htim->simIt &= ~TIM_IT_UPDATE;
+    sim_cancel(tim_update, htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(TIM_HandleTypeDef *htim, TIM_ClockConfigTypeDef *sClockSourceConfig) {
+    (void)htim;
+    (void)sClockSourceConfig;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim) {
+    (void)htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel) {
+    sim_tim_set_compare(htim, Channel, sConfig->Pulse);
+    return HAL_OK;
+}
+
+__weak void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim) {
+    (void)htim;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel) {
+    htim->simCompare[Channel >> 2U] = sConfig->Pulse;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel) {
+    (void)Channel;
+    htim->simRunning = 1U;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel) {
+    (void)Channel;
+    htim->simRunning = 0U;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef *htim,
+                                                        TIM_MasterConfigTypeDef *sMasterConfig) {
+    (void)htim;
+    (void)sMasterConfig;
+    return HAL_OK;
+}
+
+/* UG: clears the counter and loads the preloaded prescaler */
+HAL_StatusTypeDef HAL_TIM_GenerateEvent(TIM_HandleTypeDef *htim, uint32_t EventSource) {
+    if ((EventSource & TIM_EVENTSOURCE_UPDATE) != 0U) {
+        htim->simPsc = htim->simPscPreload;
+        htim->simBase = 0U;
+        htim->simStart = sim_now();
+        if ((htim->simUrs == 0U) && ((htim->simIt & TIM_IT_UPDATE) != 0U)) {
+            htim->simUpdate = 1U;
+            sim_irq_pend(tim_irq(htim));
+        }
+        tim_reschedule(htim);
+    }
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim) {
+    for (uint32_t i = 0U; i < 4U; i++) {
+        uint32_t flag = TIM_FLAG_CC1 << i;
+        if (((htim->simFlags & flag) != 0U) && ((htim->simIt & flag) != 0U)) {
+            htim->simFlags &= ~flag;
+            htim->Channel = (HAL_TIM_ActiveChannel)(1U << i);
+            HAL_TIM_OC_DelayElapsedCallback(htim);
+            htim->Channel = HAL_TIM_ACTIVE_CHANNEL_CLEARED;
+        }
+    }
+    if (htim->simUpdate != 0U) {
+        htim->simUpdate = 0U;
+        HAL_TIM_PeriodElapsedCallback(htim);
+    }
+}
+
+__weak void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+uint32_t sim_tim_counter(const TIM_HandleTypeDef *htim) {
+    if (htim->simRunning == 0U) {
+        return 0U;
+    }
+    return (uint32_t)(tim_ticks(htim, sim_now()) % ((uint64_t)htim->Init.Period + 1U));
+}
+
+void sim_tim_set_counter(TIM_HandleTypeDef *htim, uint32_t counter) {
+    htim->simBase = counter;
+    htim->simStart = sim_now();
+    tim_reschedule(htim);
+}
+
+void sim_tim_set_compare(TIM_HandleTypeDef *htim, uint32_t channel, uint32_t compare) {
+    htim->simCompare[channel >> 2U] = compare;
+    if ((htim->simIt & (TIM_IT_CC1 << (channel >> 2U))) != 0U) {
+        tim_compare_schedule(htim);
+    }
+}
+
+void sim_tim_enable_it(TIM_HandleTypeDef *htim, uint32_t it) {
+    htim->simIt |= it;
+    tim_compare_schedule(htim);
+}
+
+void sim_tim_disable_it(TIM_HandleTypeDef *htim, uint32_t it) {
+    htim->simIt &= ~it;
+    tim_compare_schedule(htim);
+}
+
+/* RTC ----------------------------------------------------------------------*/
+
+/* Calendar time shown by the registers, in prescaled LSI ticks */
+static uint64_t rtc_ticks(void) {
+    uint64_t time = (rtcStale != 0U) ? rtcShadow : sim_now();
+    return ((time - rtcStart) * SIM_LSI_HZ) / ((uint64_t)rtcAsynch * 1000000U);
+}
+
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef *hrtc) {
+    HAL_RTC_MspInit(hrtc);
+    rtcStart = sim_now();
+    rtcStale = 0U;
+    rtcAsynch = hrtc->Init.AsynchPrediv + 1U;
+    rtcSynch = hrtc->Init.SynchPrediv + 1U;
+    return HAL_OK;
+}
+
+__weak void HAL_RTC_MspInit(RTC_HandleTypeDef *hrtc) {
+    (void)hrtc;
+}
+
+__weak void HAL_RTC_MspDeInit(RTC_HandleTypeDef *hrtc) {
+    (void)hrtc;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *sTime, uint32_t Format) {
+    (void)hrtc;
+    (void)Format;
+    uint64_t ticks = rtc_ticks();
+    uint32_t seconds = (uint32_t)((ticks / rtcSynch) % 86400U);
+
+    sTime->Hours = (uint8_t)(seconds / 3600U);
+    sTime->Minutes = (uint8_t)((seconds / 60U) % 60U);
+    sTime->Seconds = (uint8_t)(seconds % 60U);
+    sTime->SubSeconds = (rtcSynch - 1U) - (uint32_t)(ticks % rtcSynch);
+    sTime->SecondFraction = rtcSynch - 1U;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *sDate, uint32_t Format) {
+    (void)hrtc;
+    (void)Format;
+    (void)memset(sDate, 0, sizeof(*sDate));
+    sDate->Date = 1U;
+    sDate->Month = 1U;
+    return HAL_OK;
+}
+
+/* The shadow registers are updated after two RTCCLK periods */
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef *hrtc) {
+    (void)hrtc;
+    sim_advance(((2U * 1000000U) + SIM_LSI_HZ - 1U) / SIM_LSI_HZ);
+    rtcStale = 0U;
+    return HAL_OK;
+}
+
+/* The wake-up timer counts (WakeUpCounter + 1) periods of LSI / 16 */
+HAL_StatusTypeDef HAL_RTCEx_SetWakeUpTimer_IT(RTC_HandleTypeDef *hrtc, uint32_t WakeUpCounter, uint32_t WakeUpClock) {
+    uint64_t divider = 16U >> WakeUpClock;
+    uint64_t us = (((uint64_t)WakeUpCounter + 1U) * divider * 1000000U) / SIM_LSI_HZ;
+
+    // the configuration waits for WUTWF, two RTCCLK periods
+    sim_advance(((2U * 1000000U) + SIM_LSI_HZ - 1U) / SIM_LSI_HZ);
+    sim_cancel(rtc_wakeup, hrtc);
+    sim_schedule(sim_now() + us, rtc_wakeup, hrtc);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_DeactivateWakeUpTimer(RTC_HandleTypeDef *hrtc) {
+    sim_cancel(rtc_wakeup, hrtc);
+    return HAL_OK;
+}
+
+static void rtc_wakeup(void *ctx) {
+    (void)ctx;
+    sim_irq_pend(RTC_WKUP_IRQn);
+}
+
+void HAL_RTCEx_WakeUpTimerIRQHandler(RTC_HandleTypeDef *hrtc) {
+    HAL_RTCEx_WakeUpTimerEventCallback(hrtc);
+}
+
+__weak void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc) {
+    (void)hrtc;
+}
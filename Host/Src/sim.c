@@ -0,0 +1,338 @@
+#include "sim.h"
+#include "sim_internal.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stm32f4xx_it.h"
+
+#define SIM_MAX_EVENTS (64U)
+
+typedef struct sim_event {
+    uint64_t time;
+    uint64_t seq; // orders events scheduled for the same time
+    sim_event_fn fn;
+    void *ctx;
+    uint8_t used;
+} sim_event_t;
+
+typedef void (*sim_irq_handler)(void);
+
+static uint64_t now = 0U;
+static uint64_t limit = UINT64_MAX;
+static uint64_t nextSeq = 0U;
+static sim_event_t events[SIM_MAX_EVENTS];
+
+static uint8_t irqPending[SIM_IRQ_COUNT];
+static uint8_t irqEnabled[SIM_IRQ_COUNT];
+static uint8_t irqPriority[SIM_IRQ_COUNT];
+static uint8_t inHandler = 0U;
+static uint32_t primask = 0U;
+
+static uint8_t resetFlagPor = 1U;
+
+static jmp_buf stopJump;
+static uint8_t running = 0U;
+
+static sim_stats_t stats;
+
+static sim_trace_fn traceFn = NULL;
+static void *traceCtx = NULL;
+
+// vector table of the interrupts the firmware uses
+static sim_irq_handler irqHandler(IRQn_Type irq) {
+    switch (irq) {
+    case RTC_WKUP_IRQn:
+        return RTC_WKUP_IRQHandler;
+    case EXTI3_IRQn:
+        return EXTI3_IRQHandler;
+    case TIM2_IRQn:
+        return TIM2_IRQHandler;
+    case USART2_IRQn:
+        return USART2_IRQHandler;
+    case EXTI15_10_IRQn:
+        return EXTI15_10_IRQHandler;
+    case TIM5_IRQn:
+        return TIM5_IRQHandler;
+    default:
+        return NULL;
+    }
+}
+
+/*
+ * Dispatches the pending interrupts, highest priority first. Handlers do not
+ * nest: an interrupt raised while a handler runs waits for it to return.
+ */
+static void sim_dispatch(void) {
+    while ((inHandler == 0U) && (primask == 0U)) {
+        int best = -1;
+        for (int irq = 0; irq < (int)SIM_IRQ_COUNT; irq++) {
+            if ((irqPending[irq] != 0U) && (irqEnabled[irq] != 0U) &&
+                ((best < 0) || (irqPriority[irq] < irqPriority[best]))) {
+                best = irq;
+            }
+        }
+        if (best < 0) {
+            return;
+        }
+
+        irqPending[best] = 0U;
+        sim_irq_handler handler = irqHandler((IRQn_Type)best);
+        if (handler != NULL) {
+            stats.irqs += 1U;
+            inHandler = 1U;
+            handler();
+            inHandler = 0U;
+        }
+    }
+}
+
+static sim_event_t *sim_next_event(uint64_t until) {
+    sim_event_t *next = NULL;
+    for (uint32_t i = 0U; i < SIM_MAX_EVENTS; i++) {
+        sim_event_t *e = &events[i];
+        if ((e->used != 0U) && (e->time <= until) &&
+            ((next == NULL) || (e->time < next->time) || ((e->time == next->time) && (e->seq < next->seq)))) {
+            next = e;
+        }
+    }
+    return next;
+}
+
+void sim_reset(uint8_t coldBoot) {
+    now = 0U;
+    limit = UINT64_MAX;
+    nextSeq = 0U;
+    (void)memset(events, 0, sizeof(events));
+    (void)memset(irqPending, 0, sizeof(irqPending));
+    (void)memset(irqEnabled, 0, sizeof(irqEnabled));
+    (void)memset(irqPriority, 0, sizeof(irqPriority));
+    inHandler = 0U;
+    primask = 0U;
+    resetFlagPor = (coldBoot != 0U) ? 1U : 0U;
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)memset(sim_gpio_ports, 0, sizeof(GPIO_TypeDef) * 3U);
+    sim_gpio_watch(NULL, NULL);
+    sim_uart_sink(NULL, NULL);
+    sim_trace_watch(NULL, NULL);
+    sim_i2c_detach_all();
+    sim_hal_reset();
+}
+
+uint64_t sim_now(void) {
+    return now;
+}
+
+void sim_advance_to(uint64_t time) {
+    uint64_t target = (time < limit) ? time : limit;
+
+    for (;;) {
+        sim_dispatch();
+        sim_event_t *e = sim_next_event(target);
+        if (e == NULL) {
+            break;
+        }
+        if (e->time > now) {
+            now = e->time;
+        }
+        sim_event_t fired = *e;
+        e->used = 0U;
+        fired.fn(fired.ctx);
+    }
+
+    if (target > now) {
+        now = target;
+    }
+
+    if (running && (now >= limit)) {
+        longjmp(stopJump, 1);
+    }
+    sim_dispatch();
+}
+
+void sim_advance(uint64_t us) {
+    sim_advance_to(now + us);
+}
+
+void sim_schedule(uint64_t time, sim_event_fn fn, void *ctx) {
+    for (uint32_t i = 0U; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].used == 0U) {
+            events[i].time = time;
+            events[i].seq = nextSeq++;
+            events[i].fn = fn;
+            events[i].ctx = ctx;
+            events[i].used = 1U;
+            return;
+        }
+    }
+    (void)fprintf(stderr, "sim: event queue full\n");
+    abort();
+}
+
+void sim_cancel(sim_event_fn fn, void *ctx) {
+    for (uint32_t i = 0U; i < SIM_MAX_EVENTS; i++) {
+        if ((events[i].used != 0U) && (events[i].fn == fn) && (events[i].ctx == ctx)) {
+            events[i].used = 0U;
+        }
+    }
+}
+
+void sim_irq_pend(IRQn_Type irq) {
+    if ((int)irq < (int)SIM_IRQ_COUNT) {
+        irqPending[irq] = 1U;
+    }
+}
+
+void sim_run(int (*entry)(void), uint64_t stopAt) {
+    limit = stopAt;
+    if (setjmp(stopJump) == 0) {
+        running = 1U;
+        (void)entry();
+    }
+    running = 0U;
+    inHandler = 0U;
+    limit = UINT64_MAX;
+}
+
+const sim_stats_t *sim_stats(void) {
+    sim_hal_account();
+    return &stats;
+}
+
+sim_stats_t *sim_stats_mut(void) {
+    return &stats;
+}
+
+void sim_trace_watch(sim_trace_fn fn, void *ctx) {
+    traceFn = fn;
+    traceCtx = ctx;
+}
+
+/* TRACE_OBSERVER of the host build, called by trace_record */
+void sim_trace_event(uint8_t type, uint8_t arg, uint16_t value) {
+    if (traceFn != NULL) {
+        traceFn(type, arg, value, traceCtx);
+    }
+}
+
+/* Cortex -------------------------------------------------------------------*/
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+    if ((int)IRQn < (int)SIM_IRQ_COUNT) {
+        irqPriority[IRQn] = (uint8_t)((PreemptPriority << 4) | SubPriority);
+    }
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn < (int)SIM_IRQ_COUNT) {
+        irqEnabled[IRQn] = 1U;
+    }
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+    if ((int)IRQn < (int)SIM_IRQ_COUNT) {
+        irqEnabled[IRQn] = 0U;
+    }
+}
+
+void __disable_irq(void) {
+    primask = 1U;
+}
+
+/* An enabled interrupt is pending: the core does not sleep, or wakes up */
+static uint8_t sim_irq_waiting(void) {
+    for (int irq = 0; irq < (int)SIM_IRQ_COUNT; irq++) {
+        if ((irqPending[irq] != 0U) && (irqEnabled[irq] != 0U)) {
+            return 1U;
+        }
+    }
+    return 0U;
+}
+
+/*
+ * Advances to the next interrupt, or to the next SysTick when it wakes the
+ * core, adding the time to *spent and *spentPll (if not NULL) as it goes: the
+ * run may end meanwhile. With interrupts unmasked the handlers run on the
+ * way, the first one ends the wait.
+ */
+static void sim_wait(uint8_t systick, uint64_t *spent, uint64_t *spentPll) {
+    uint32_t irqs = stats.irqs;
+
+    while ((sim_irq_waiting() == 0U) && (stats.irqs == irqs)) {
+        uint64_t until = (systick != 0U) ? (((now / 1000U) + 1U) * 1000U) : limit;
+        sim_event_t *e = sim_next_event(until);
+        uint64_t target = (e != NULL) ? e->time : until;
+        if (target > limit) {
+            target = limit;
+        }
+        if (target > now) {
+            *spent += target - now;
+            if (spentPll != NULL) {
+                *spentPll += target - now;
+            }
+        }
+        sim_advance_to(target);
+        if ((systick != 0U) && (e == NULL)) {
+            return;
+        }
+    }
+}
+
+/*
+ * Sleeps until the next interrupt: returns at once if one is pending,
+ * otherwise advances to the next interrupt or to the next SysTick, at every
+ * millisecond boundary while it is not suspended.
+ */
+void __WFI(void) {
+    sim_wait(sim_tick_running(), &stats.sleepUs, (sim_hal_on_pll() != 0U) ? &stats.pllSleepUs : NULL);
+}
+
+/*
+ * The clocks stop with the core: the timers freeze, only the simulated
+ * devices, EXTI lines and the RTC keep running.
+ */
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry) {
+    (void)Regulator;
+    (void)STOPEntry;
+    if (sim_irq_waiting() != 0U) {
+        return;
+    }
+
+    sim_hal_stop_enter();
+    sim_wait(0U, &stats.stopUs, NULL);
+    sim_hal_stop_exit();
+}
+
+void __enable_irq(void) {
+    primask = 0U;
+    sim_dispatch();
+}
+
+uint32_t __get_PRIMASK(void) {
+    return primask;
+}
+
+void __set_PRIMASK(uint32_t priMask) {
+    primask = priMask & 1U;
+    sim_dispatch();
+}
+
+/* RCC ----------------------------------------------------------------------*/
+
+uint32_t sim_rcc_get_flag(uint32_t flag) {
+    switch (flag) {
+    case RCC_FLAG_PORRST:
+    case RCC_FLAG_BORRST:
+        return resetFlagPor;
+    case RCC_FLAG_PINRST:
+        return 1U;
+    default:
+        return 0U;
+    }
+}
+
+void sim_rcc_clear_reset_flags(void) {
+    resetFlagPor = 0U;
+}
@@ -0,0 +1,193 @@
+#include "sim_ds1307.h"
+
+#include <string.h>
+
+#define DS1307_ADDRESS (0xD0U)
+
+#define REG_SECONDS (0x00U)
+#define REG_MINUTES (0x01U)
+#define REG_HOURS (0x02U)
+#define REG_DAY (0x03U)
+#define REG_DATE (0x04U)
+#define REG_MONTH (0x05U)
+#define REG_YEAR (0x06U)
+#define REG_CONTROL (0x07U)
+
+#define SECONDS_CH (0x80U)
+#define CONTROL_OUT (0x80U)
+#define CONTROL_SQWE (0x10U)
+#define CONTROL_RS (0x03U)
+
+#define SQW_PORT GPIOB
+#define SQW_PIN GPIO_PIN_15
+
+#define SECOND_US (1000000U)
+
+static uint8_t bcd_to_bin(uint8_t bcd) {
+    return (uint8_t)(((bcd >> 4) * 10U) + (bcd & 0x0FU));
+}
+
+static uint8_t bin_to_bcd(uint8_t bin) {
+    return (uint8_t)(((bin / 10U) << 4) | (bin % 10U));
+}
+
+static uint8_t days_in_month(uint8_t month, uint8_t year) {
+    static const uint8_t days[12] = {31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U};
+    if ((month == 2U) && ((year % 4U) == 0U)) {
+        return 29U;
+    }
+    return ((month >= 1U) && (month <= 12U)) ? days[month - 1U] : 31U;
+}
+
+/* Increments a BCD register, returns 1 when it wraps from max to min */
+static uint8_t bump(uint8_t *reg, uint8_t mask, uint8_t min, uint8_t max) {
+    uint8_t value = bcd_to_bin(*reg & mask);
+    uint8_t keep = *reg & (uint8_t)~mask;
+    uint8_t wrapped = 0U;
+
+    if (value >= max) {
+        value = min;
+        wrapped = 1U;
+    } else {
+        value++;
+    }
+    *reg = keep | bin_to_bcd(value);
+    return wrapped;
+}
+
+static void tick_second(sim_ds1307_t *rtc) {
+    uint8_t *r = rtc->regs;
+
+    if (bump(&r[REG_SECONDS], 0x7FU, 0U, 59U) == 0U) {
+        return;
+    }
+    if (bump(&r[REG_MINUTES], 0x7FU, 0U, 59U) == 0U) {
+        return;
+    }
+    if (bump(&r[REG_HOURS], 0x3FU, 0U, 23U) == 0U) {
+        return;
+    }
+    (void)bump(&r[REG_DAY], 0x07U, 1U, 7U);
+    uint8_t month = bcd_to_bin(r[REG_MONTH] & 0x1FU);
+    uint8_t year = bcd_to_bin(r[REG_YEAR]);
+    if (bump(&r[REG_DATE], 0x3FU, 1U, days_in_month(month, year)) == 0U) {
+        return;
+    }
+    if (bump(&r[REG_MONTH], 0x1FU, 1U, 12U) == 0U) {
+        return;
+    }
+    (void)bump(&r[REG_YEAR], 0xFFU, 0U, 99U);
+}
+
+static uint8_t sqw_running(const sim_ds1307_t *rtc) {
+    return ((rtc->regs[REG_CONTROL] & CONTROL_SQWE) != 0U) && ((rtc->regs[REG_CONTROL] & CONTROL_RS) == 0U) &&
+           ((rtc->regs[REG_SECONDS] & SECONDS_CH) == 0U);
+}
+
+/* The 1 Hz output falls when the seconds register increments, rises half a second later */
+static void sqw_rise(void *ctx) {
+    sim_ds1307_t *rtc = (sim_ds1307_t *)ctx;
+    if (sqw_running(rtc)) {
+        sim_gpio_drive(SQW_PORT, SQW_PIN, GPIO_PIN_SET);
+    }
+}
+
+static void second_elapsed(void *ctx) {
+    sim_ds1307_t *rtc = (sim_ds1307_t *)ctx;
+
+    if ((rtc->regs[REG_SECONDS] & SECONDS_CH) != 0U) {
+        return;
+    }
+    tick_second(rtc);
+    rtc->secondStart = sim_now();
+    if (sqw_running(rtc)) {
+        sim_gpio_drive(SQW_PORT, SQW_PIN, GPIO_PIN_RESET);
+        sim_schedule(rtc->secondStart + (SECOND_US / 2U), sqw_rise, rtc);
+    }
+    sim_schedule(rtc->secondStart + SECOND_US, second_elapsed, rtc);
+}
+
+/* Restarts the one-second countdown, as a write to the seconds register does */
+static void restart_oscillator(sim_ds1307_t *rtc) {
+    sim_cancel(second_elapsed, rtc);
+    sim_cancel(sqw_rise, rtc);
+    rtc->secondStart = sim_now();
+    if ((rtc->regs[REG_SECONDS] & SECONDS_CH) == 0U) {
+        sim_schedule(rtc->secondStart + SECOND_US, second_elapsed, rtc);
+    }
+}
+
+static void update_output(sim_ds1307_t *rtc) {
+    uint8_t control = rtc->regs[REG_CONTROL];
+
+    if ((control & CONTROL_SQWE) == 0U) {
+        sim_gpio_drive(SQW_PORT, SQW_PIN, ((control & CONTROL_OUT) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    } else if (sqw_running(rtc)) {
+        // high during the first half of the second, as after a falling edge
+        uint8_t high = (sim_now() - rtc->secondStart) >= (SECOND_US / 2U);
+        sim_gpio_drive(SQW_PORT, SQW_PIN, high ? GPIO_PIN_SET : GPIO_PIN_RESET);
+        sim_cancel(sqw_rise, rtc);
+        if (!high) {
+            sim_schedule(rtc->secondStart + (SECOND_US / 2U), sqw_rise, rtc);
+        }
+    }
+}
+
+static HAL_StatusTypeDef rtc_write(sim_i2c_device_t *dev, const uint8_t *data, uint16_t size) {
+    sim_ds1307_t *rtc = (sim_ds1307_t *)dev;
+    uint8_t secondsWritten = 0U;
+    uint8_t controlWritten = 0U;
+
+    if (size == 0U) {
+        return HAL_OK;
+    }
+    rtc->pointer = data[0] & 0x3FU;
+    for (uint16_t i = 1U; i < size; i++) {
+        if (rtc->pointer == REG_SECONDS) {
+            secondsWritten = 1U;
+        } else if (rtc->pointer == REG_CONTROL) {
+            controlWritten = 1U;
+        }
+        rtc->regs[rtc->pointer] = data[i];
+        rtc->pointer = (uint8_t)((rtc->pointer + 1U) & 0x3FU);
+    }
+
+    if (secondsWritten) {
+        restart_oscillator(rtc);
+    }
+    if (secondsWritten || controlWritten) {
+        update_output(rtc);
+    }
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef rtc_read(sim_i2c_device_t *dev, uint8_t *data, uint16_t size) {
+    sim_ds1307_t *rtc = (sim_ds1307_t *)dev;
+
+    for (uint16_t i = 0U; i < size; i++) {
+        data[i] = rtc->regs[rtc->pointer];
+        rtc->pointer = (uint8_t)((rtc->pointer + 1U) & 0x3FU);
+    }
+    return HAL_OK;
+}
+
+void sim_ds1307_init(sim_ds1307_t *rtc, uint8_t seconds, uint8_t minutes, uint8_t hours, uint8_t day, uint8_t date,
+                     uint8_t month, uint8_t year) {
+    (void)memset(rtc, 0, sizeof(*rtc));
+    rtc->dev.address = DS1307_ADDRESS;
+    rtc->dev.write = rtc_write;
+    rtc->dev.read = rtc_read;
+
+    rtc->regs[REG_SECONDS] = bin_to_bcd(seconds);
+    rtc->regs[REG_MINUTES] = bin_to_bcd(minutes);
+    rtc->regs[REG_HOURS] = bin_to_bcd(hours);
+    rtc->regs[REG_DAY] = bin_to_bcd(day);
+    rtc->regs[REG_DATE] = bin_to_bcd(date);
+    rtc->regs[REG_MONTH] = bin_to_bcd(month);
+    rtc->regs[REG_YEAR] = bin_to_bcd(year);
+    rtc->regs[REG_CONTROL] = CONTROL_OUT;
+
+    sim_i2c_attach(&rtc->dev);
+    restart_oscillator(rtc);
+    update_output(rtc);
+}
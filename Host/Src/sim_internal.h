@@ -0,0 +1,19 @@
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+/* Shared between the simulator core and the HAL fake, not for device models */
+
+#include "sim.h"
+
+sim_stats_t *sim_stats_mut(void);
+void sim_i2c_detach_all(void);
+
+/* HAL fake state: reset with the simulator, SysTick, STOP mode freezing, clock tree */
+void sim_hal_reset(void);
+uint8_t sim_tick_running(void);
+void sim_hal_stop_enter(void);
+void sim_hal_stop_exit(void);
+uint8_t sim_hal_on_pll(void);
+void sim_hal_account(void);
+
+#endif // SIM_INTERNAL_H
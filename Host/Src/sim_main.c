@@ -0,0 +1,277 @@
+/*
+ * Host runner: boots the firmware on the simulated board and prints what it
+ * writes on the serial console.
+ *
+ *   project_work_sim [--duration ms] [--press ms] [--key ms:c] [--finger ms[:ms]]
+ *                    [--rate hz] [--hr bpm10] [--glitch ms] [--confidence pct] [--breath br10]
+ *                    [--accel] [--motion ms:ms] [--desat ms:ms]
+ *                    [--snapshots dir]
+ *                    [--replay capture]
+ *                    [--warm] [--quiet]
+ *
+ * --press pushes the user button at the given virtual time, --key types a
+ * character on the console, both can be repeated. --finger places the finger
+ * on the sensor and optionally removes it, --rate sets the sensor hub output
+ * rate, --hr the heart rate it measures in 0.1 bpm, --glitch makes its
+ * algorithm output a wrong heart rate and SpO2 for 200 ms every period,
+ * --confidence sets the confidence it settles to, --breath the breathing
+ * rate that modulates the PPG in 0.1 breaths/min (0 for none). --accel fits
+ * the accelerometer on the hub, --motion shakes the hand between the two
+ * times, --desat drops the SpO2 by 6% between the two times.
+ * --snapshots saves every distinct screen the display shows, in order
+ * of first appearance, as dir/screen_NN.ppm. --replay answers the I2C
+ * transfers from the last transcript dump (console command 'i') found in a
+ * saved console output. --warm boots as after a reset with the power kept,
+ * --quiet drops the console output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "max32664.h"
+#include "sim.h"
+#include "sim_ds1307.h"
+#include "sim_max32664.h"
+#include "sim_replay.h"
+#include "sim_ssd1306.h"
+
+#define MAX_STIMULI (32U)
+#define MAX_SCREENS (32U)
+
+// button press length, the line is sampled on the rising edge only
+#define PRESS_US (100000U)
+
+int firmware_main(void);
+
+typedef struct stimulus {
+    uint64_t time; // us
+    char key;      // 0 for a button press
+} stimulus_t;
+
+static stimulus_t stimuli[MAX_STIMULI];
+static uint32_t stimulusCount = 0U;
+
+static sim_ds1307_t rtc;
+static sim_max32664_t hub;
+static sim_ssd1306_t oled;
+
+static const char *snapshotDir = NULL;
+static uint64_t screens[MAX_SCREENS]; // hashes of the screens already saved
+static uint32_t screenCount = 0U;
+
+static void console_out(const uint8_t *data, uint16_t size, void *ctx) {
+    (void)ctx;
+    (void)fwrite(data, 1U, size, stdout);
+}
+
+static void button_release(void *ctx) {
+    (void)ctx;
+    sim_gpio_drive(GPIOC, GPIO_PIN_13, GPIO_PIN_RESET);
+}
+
+static void apply_stimulus(void *ctx) {
+    const stimulus_t *s = (const stimulus_t *)ctx;
+    if (s->key == '\0') {
+        sim_gpio_drive(GPIOC, GPIO_PIN_13, GPIO_PIN_SET);
+        sim_schedule(sim_now() + PRESS_US, button_release, NULL);
+    } else {
+        sim_uart_inject((uint8_t)s->key);
+    }
+}
+
+/* FNV-1a, enough to tell screens apart */
+static uint64_t image_hash(const uint8_t *image, uint32_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint32_t i = 0U; i < size; i++) {
+        hash = (hash ^ image[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void save_screen(sim_ssd1306_t *display, const sim_ssd1306_frame_t *frame, void *ctx) {
+    static uint8_t image[SIM_SSD1306_WIDTH * SIM_SSD1306_HEIGHT];
+    char path[512];
+    (void)frame;
+    (void)ctx;
+
+    sim_ssd1306_render(display, image);
+    uint64_t hash = image_hash(image, sizeof(image));
+    for (uint32_t i = 0U; i < screenCount; i++) {
+        if (screens[i] == hash) {
+            return;
+        }
+    }
+    if (screenCount >= MAX_SCREENS) {
+        (void)fprintf(stderr, "too many screens\n");
+        return;
+    }
+    screens[screenCount] = hash;
+
+    (void)snprintf(path, sizeof(path), "%s/screen_%02lu.ppm", snapshotDir, (unsigned long)screenCount);
+    screenCount++;
+    FILE *file = fopen(path, "wb");
+    if ((file == NULL) || (sim_ssd1306_write_ppm(display, file, 1U) != 0)) {
+        (void)fprintf(stderr, "cannot write %s\n", path);
+        exit(1);
+    }
+    (void)fclose(file);
+}
+
+static void add_stimulus(uint64_t timeMs, char key) {
+    if (stimulusCount >= MAX_STIMULI) {
+        (void)fprintf(stderr, "too many stimuli\n");
+        exit(2);
+    }
+    stimuli[stimulusCount].time = timeMs * 1000U;
+    stimuli[stimulusCount].key = key;
+    stimulusCount++;
+}
+
+static void usage(const char *name) {
+    (void)fprintf(stderr,
+                  "usage: %s [--duration ms] [--press ms] [--key ms:c] [--finger ms[:ms]] [--rate hz] [--hr bpm10] "
+                  "[--glitch ms] [--confidence pct] [--breath br10] [--accel] [--motion ms:ms] [--desat ms:ms] "
+                  "[--snapshots dir] [--replay capture] [--warm] [--quiet]\n",
+                  name);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint64_t durationMs = 10000U;
+    uint8_t warm = 0U;
+    uint8_t quiet = 0U;
+    const char *replay = NULL;
+    sim_max32664_config_t hubConfig = sim_max32664_defaults();
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if ((strcmp(arg, "--duration") == 0) && (value != NULL)) {
+            durationMs = strtoull(value, NULL, 10);
+            i++;
+        } else if ((strcmp(arg, "--press") == 0) && (value != NULL)) {
+            add_stimulus(strtoull(value, NULL, 10), '\0');
+            i++;
+        } else if ((strcmp(arg, "--key") == 0) && (value != NULL)) {
+            const char *colon = strchr(value, ':');
+            if ((colon == NULL) || (colon[1] == '\0')) {
+                usage(argv[0]);
+            }
+            add_stimulus(strtoull(value, NULL, 10), colon[1]);
+            i++;
+        } else if ((strcmp(arg, "--finger") == 0) && (value != NULL)) {
+            char *end = NULL;
+            hubConfig.fingerOnUs = strtoull(value, &end, 10) * 1000U;
+            if (*end == ':') {
+                hubConfig.fingerOffUs = strtoull(end + 1, NULL, 10) * 1000U;
+            }
+            i++;
+        } else if ((strcmp(arg, "--rate") == 0) && (value != NULL)) {
+            hubConfig.sampleRateHz = (uint32_t)strtoul(value, NULL, 10);
+            i++;
+        } else if ((strcmp(arg, "--hr") == 0) && (value != NULL)) {
+            hubConfig.heartRate = (uint16_t)strtoul(value, NULL, 10);
+            i++;
+        } else if ((strcmp(arg, "--glitch") == 0) && (value != NULL)) {
+            hubConfig.glitchPeriodUs = strtoull(value, NULL, 10) * 1000U;
+            i++;
+        } else if ((strcmp(arg, "--confidence") == 0) && (value != NULL)) {
+            hubConfig.confidence = (uint8_t)strtoul(value, NULL, 10);
+            i++;
+        } else if ((strcmp(arg, "--breath") == 0) && (value != NULL)) {
+            hubConfig.respiration = (uint16_t)strtoul(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--accel") == 0) {
+            hubConfig.accelerometer = 1U;
+        } else if ((strcmp(arg, "--motion") == 0) && (value != NULL)) {
+            char *end = NULL;
+            hubConfig.motionOnUs = strtoull(value, &end, 10) * 1000U;
+            if (*end != ':') {
+                usage(argv[0]);
+            }
+            hubConfig.motionOffUs = strtoull(end + 1, NULL, 10) * 1000U;
+            i++;
+        } else if ((strcmp(arg, "--desat") == 0) && (value != NULL)) {
+            char *end = NULL;
+            hubConfig.desatOnUs = strtoull(value, &end, 10) * 1000U;
+            if (*end != ':') {
+                usage(argv[0]);
+            }
+            hubConfig.desatOffUs = strtoull(end + 1, NULL, 10) * 1000U;
+            i++;
+        } else if ((strcmp(arg, "--snapshots") == 0) && (value != NULL)) {
+            snapshotDir = value;
+            i++;
+        } else if ((strcmp(arg, "--replay") == 0) && (value != NULL)) {
+            replay = value;
+            i++;
+        } else if (strcmp(arg, "--warm") == 0) {
+            warm = 1U;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            quiet = 1U;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    sim_reset(warm ? 0U : 1U);
+    if (!quiet) {
+        sim_uart_sink(console_out, NULL);
+    }
+    sim_ds1307_init(&rtc, 0U, 0U, 12U, 1U, 1U, 1U, 24U);
+    sim_max32664_init(&hub, &hubConfig);
+    if (warm) {
+        // the hub kept the configuration of the previous run
+        sim_max32664_preconfigure(&hub, MODE_ONE);
+    }
+    sim_ssd1306_init(&oled);
+    if (snapshotDir != NULL) {
+        sim_ssd1306_on_frame(&oled, save_screen, NULL);
+    }
+    if (replay != NULL) {
+        FILE *capture = fopen(replay, "rb");
+        if ((capture == NULL) || (sim_replay_load(capture) != 0)) {
+            (void)fprintf(stderr, "cannot replay %s\n", replay);
+            return 1;
+        }
+        (void)fclose(capture);
+        sim_replay_attach();
+    }
+    for (uint32_t i = 0U; i < stimulusCount; i++) {
+        sim_schedule(stimuli[i].time, apply_stimulus, &stimuli[i]);
+    }
+
+    sim_run(firmware_main, durationMs * 1000U);
+
+    const sim_stats_t *stats = sim_stats();
+    (void)fprintf(stdout, "\n");
+    (void)fprintf(stderr,
+                  "sim: %llu ms, i2c %lu transfers %lu bytes %lu nacks, uart %lu bytes, %lu irqs\n",
+                  (unsigned long long)(sim_now() / 1000U), (unsigned long)stats->i2cTransfers,
+                  (unsigned long)stats->i2cBytes, (unsigned long)stats->i2cNacks, (unsigned long)stats->uartBytes,
+                  (unsigned long)stats->irqs);
+    (void)fprintf(stderr,
+                  "hub: %lu commands, %lu busy, %lu overrun, %lu samples, %lu dropped, %lu read, "
+                  "latency mean %llu us max %llu us\n",
+                  (unsigned long)hub.stats.commands, (unsigned long)hub.stats.busy, (unsigned long)hub.stats.overrun,
+                  (unsigned long)hub.stats.samples, (unsigned long)hub.stats.dropped, (unsigned long)hub.stats.read,
+                  (unsigned long long)((hub.stats.read > 0U) ? (hub.stats.latencySum / hub.stats.read) : 0U),
+                  (unsigned long long)hub.stats.latencyMax);
+    const sim_ssd1306_stats_t *os = &oled.stats;
+    uint32_t frames = (os->frames > 0U) ? os->frames : 1U;
+    (void)fprintf(stderr,
+                  "oled: %lu frames, per frame %llu transfers %llu bus bytes (%llu command, %llu data, "
+                  "%llu ignored) %llu us\n",
+                  (unsigned long)os->frames, (unsigned long long)(os->transfers / frames),
+                  (unsigned long long)(os->busBytes / frames), (unsigned long long)(os->commandBytes / frames),
+                  (unsigned long long)(os->dataBytes / frames), (unsigned long long)(os->ignored / frames),
+                  (unsigned long long)(os->busyTime / frames));
+    if (replay != NULL) {
+        const sim_replay_stats_t *rs = sim_replay_stats();
+        (void)fprintf(stderr, "replay: %lu transfers, %lu mismatches, %lu live\n", (unsigned long)rs->transfers,
+                      (unsigned long)rs->mismatches, (unsigned long)rs->live);
+    }
+    return 0;
+}
@@ -0,0 +1,769 @@
+#include "sim_max32664.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "max32664.h"
+
+#define HUB_ADDRESS (WRITE_ADDRESS)
+
+#define RESET_PORT GPIOC
+#define RESET_PIN GPIO_PIN_0
+#define MFIO_PORT GPIOC
+#define MFIO_PIN GPIO_PIN_1
+
+#define LED_BYTES (MAX30101_LED_ARRAY)
+#define ACCEL_BYTES (ACCEL_ARRAY)
+
+// hub status byte, DataRdyInt
+#define HUB_STATUS_DATA_READY (0x08U)
+
+// detection: object reported for this long before the finger is recognised
+#define OBJECT_DETECT_US (1000000U)
+// confidence ramps up to its final value over this time
+#define CONFIDENCE_RAMP_US (5000000U)
+#define CONFIDENCE_FINAL (95U)
+
+// signal levels, ADC counts
+#define IR_DC (120000.0)
+#define IR_AC (1500.0)
+#define RED_DC (90000.0)
+#define AMBIENT (2000.0)
+#define NOISE_COUNTS (20U)
+
+// respiration: the baseline and the pulse amplitude swing by these shares
+// over each breath, as the intrathoracic pressure moves the venous blood
+#define BREATH_WANDER (0.004)
+#define BREATH_AM (0.1)
+
+// slow variations of the vital signs, period in us and amplitude in 0.1 units
+#define HR_SWING_PERIOD_US (20000000.0)
+#define HR_SWING (30.0)
+#define OXY_SWING_PERIOD_US (45000000.0)
+#define OXY_SWING (5.0)
+
+// algorithm glitch, as on motion: heart rate and SpO2 off for a short time,
+// 0.1 units
+#define GLITCH_US (200000U)
+#define GLITCH_HR (400.0)
+#define GLITCH_OXY (150.0)
+
+// motion: the hand shakes at this rate, the accelerometer swings on X and Y,
+// the PPG takes the shake as an artifact and the algorithm locks onto it
+#define GRAVITY_MG (1000.0)
+#define ACCEL_NOISE_MG (5U)
+#define MOTION_HZ (2.0)
+#define MOTION_MG (500.0)
+#define MOTION_COUNTS (3000.0)
+#define MOTION_OXY (40.0)
+
+// desaturation: the SpO2 drops by this much, 0.1 %, in the PPG and the algorithm
+#define DESAT_OXY (60.0)
+
+#define PI (3.14159265358979323846)
+#define SYSTOLIC_PHASE (0x40000000U)
+
+/* Sample layout ------------------------------------------------------------*/
+
+static uint8_t algo_bytes(const sim_max32664_t *hub) {
+    return (hub->algoMode == MODE_TWO) ? (MAXFAST_ARRAY_SIZE + MAXFAST_EXTENDED_DATA) : MAXFAST_ARRAY_SIZE;
+}
+
+static uint8_t has_counter(uint8_t mode) {
+    return (mode == SENSOR_COUNTER_BYTE) || (mode == ALGO_COUNTER_BYTE) || (mode == SENSOR_ALGO_COUNTER);
+}
+
+static uint8_t has_sensor(uint8_t mode) {
+    return (mode == SENSOR_DATA) || (mode == SENSOR_AND_ALGORITHM) || (mode == SENSOR_COUNTER_BYTE) ||
+           (mode == SENSOR_ALGO_COUNTER);
+}
+
+static uint8_t has_algo(uint8_t mode) {
+    return (mode == ALGO_DATA) || (mode == SENSOR_AND_ALGORITHM) || (mode == ALGO_COUNTER_BYTE) ||
+           (mode == SENSOR_ALGO_COUNTER);
+}
+
+static uint8_t has_accel(const sim_max32664_t *hub) {
+    return (hub->config.accelerometer != 0U) && (hub->accelEnabled != 0U) && has_sensor(hub->outputMode);
+}
+
+static uint8_t sample_size(const sim_max32664_t *hub) {
+    uint8_t mode = hub->outputMode;
+    uint8_t size = 0U;
+
+    if (has_counter(mode)) {
+        size += 1U;
+    }
+    if (has_sensor(mode)) {
+        size += LED_BYTES;
+    }
+    if (has_accel(hub)) {
+        size += ACCEL_BYTES;
+    }
+    if (has_algo(mode)) {
+        size += algo_bytes(hub);
+    }
+    return size;
+}
+
+/* Signal generator ---------------------------------------------------------*/
+
+static uint32_t noise_next(sim_max32664_t *hub) {
+    // LCG: deterministic runs, same constants as Numerical Recipes
+    hub->noise = (hub->noise * 1664525U) + 1013904223U;
+    return hub->noise >> 16;
+}
+
+static double noise_counts(sim_max32664_t *hub) {
+    return (double)(noise_next(hub) % ((2U * NOISE_COUNTS) + 1U)) - (double)NOISE_COUNTS;
+}
+
+/* Pulse shape over one beat: systolic peak followed by the dicrotic notch */
+static double pulse_shape(uint32_t phase) {
+    double x = (double)phase / 4294967296.0;
+    return sin(2.0 * PI * x) + (0.3 * sin((4.0 * PI * x) - (PI / 2.0)));
+}
+
+static void put24(uint8_t *dst, double value) {
+    uint32_t v = (value <= 0.0) ? 0U : (uint32_t)value;
+    if (v > 0xFFFFFFU) {
+        v = 0xFFFFFFU;
+    }
+    dst[0] = (uint8_t)(v >> 16);
+    dst[1] = (uint8_t)(v >> 8);
+    dst[2] = (uint8_t)v;
+}
+
+static void put16(uint8_t *dst, uint16_t value) {
+    dst[0] = (uint8_t)(value >> 8);
+    dst[1] = (uint8_t)value;
+}
+
+static void put_accel(sim_max32664_t *hub, uint8_t *dst, double mg) {
+    double noise = (double)(noise_next(hub) % ((2U * ACCEL_NOISE_MG) + 1U)) - (double)ACCEL_NOISE_MG;
+    put16(dst, (uint16_t)(int16_t)lround(mg + noise));
+}
+
+/*
+ * Ratio of ratios the calibration maps to the SpO2: the smaller root of
+ * a R^2 + b R + c = SpO2, as on the descending side of the usual curves
+ */
+static double ratio_of_ratios(const sim_max32664_t *hub, double oxygen) {
+    double a = (double)hub->coef[0] / 100000.0;
+    double b = (double)hub->coef[1] / 100000.0;
+    double c = (double)hub->coef[2] / 100000.0;
+
+    if (fabs(a) < 1e-9) {
+        return (oxygen - c) / b;
+    }
+    double discriminant = (b * b) - (4.0 * a * (c - oxygen));
+    return (-b - sqrt((discriminant > 0.0) ? discriminant : 0.0)) / (2.0 * a);
+}
+
+static void generate(sim_max32664_t *hub, uint8_t *sample) {
+    const sim_max32664_config_t *cfg = &hub->config;
+    uint64_t now = sim_now();
+    uint8_t fingerOn = (now >= cfg->fingerOnUs) && (now < cfg->fingerOffUs);
+    uint64_t onFor = fingerOn ? (now - cfg->fingerOnUs) : 0U;
+
+    double hr = (double)cfg->heartRate + (HR_SWING * sin(2.0 * PI * (double)now / HR_SWING_PERIOD_US));
+    double oxy = (double)cfg->oxygen + (OXY_SWING * sin(2.0 * PI * (double)now / OXY_SWING_PERIOD_US));
+    if ((now >= cfg->desatOnUs) && (now < cfg->desatOffUs)) {
+        oxy -= DESAT_OXY;
+    }
+    // the glitches are in the algorithm output only, not in the PPG signal
+    uint8_t glitch = (cfg->glitchPeriodUs != 0U) && ((now % cfg->glitchPeriodUs) < GLITCH_US);
+    uint8_t moving = (now >= cfg->motionOnUs) && (now < cfg->motionOffUs);
+    double shake = moving ? sin(2.0 * PI * MOTION_HZ * (double)now / 1000000.0) : 0.0;
+
+    double r = ratio_of_ratios(hub, oxy / 10.0);
+    hub->oxygen = oxy;
+    hub->heartRate = hr;
+
+    // beat phase advance for one sample; the shape peaks at a quarter of a beat
+    uint32_t step = (uint32_t)((hr / 600.0) * 4294967296.0 / (double)cfg->sampleRateHz);
+    uint32_t toPeak = SYSTOLIC_PHASE - hub->phase;
+    if ((toPeak != 0U) && (toPeak <= step)) {
+        double periodUs = 1000000.0 / (double)cfg->sampleRateHz;
+        hub->peakUs[hub->peaks & (SIM_MAX32664_PEAKS - 1U)] =
+            (double)now - periodUs + (periodUs * (double)toPeak / (double)step);
+        hub->peaks++;
+    }
+    hub->phase += step;
+    hub->sampleIndex++;
+    hub->breathPhase += ((double)cfg->respiration / 600.0) / (double)cfg->sampleRateHz;
+
+    uint8_t *p = sample;
+    if (has_counter(hub->outputMode)) {
+        *p = hub->counter;
+        p++;
+    }
+    hub->counter++;
+
+    if (has_sensor(hub->outputMode)) {
+        double ir = AMBIENT;
+        double red = AMBIENT;
+        if (fingerOn) {
+            double breath = sin(2.0 * PI * hub->breathPhase);
+            double dc = 1.0 + (BREATH_WANDER * breath);
+            double shape = pulse_shape(hub->phase) * (1.0 + (BREATH_AM * breath));
+            ir = (IR_DC * dc) + (IR_AC * shape);
+            hub->perfusion = (IR_AC * hub->shapeRange * (1.0 + (BREATH_AM * breath)) * 10000.0) / (IR_DC * dc);
+            red = (RED_DC * dc) + (r * (IR_AC / IR_DC) * RED_DC * shape);
+            // venous blood and tissue moving: the same share on both LEDs
+            ir += MOTION_COUNTS * shake;
+            red += MOTION_COUNTS * (RED_DC / IR_DC) * shake;
+        }
+        put24(&p[0], ir + noise_counts(hub));
+        put24(&p[3], red + noise_counts(hub));
+        (void)memset(&p[6], 0, 6U); // green and fourth LED, not fitted
+        p += LED_BYTES;
+    }
+
+    if (has_accel(hub)) {
+        put_accel(hub, &p[0], MOTION_MG * shake);
+        put_accel(hub, &p[2], MOTION_MG * shake);
+        put_accel(hub, &p[4], GRAVITY_MG);
+        p += ACCEL_BYTES;
+    }
+
+    if (has_algo(hub->outputMode)) {
+        uint8_t status = 0U;
+        uint16_t hrOut = 0U;
+        uint16_t oxyOut = 0U;
+        uint8_t confidence = 0U;
+        uint16_t rOut = 0U;
+
+        if (fingerOn && (onFor < OBJECT_DETECT_US)) {
+            status = 2U;
+        } else if (fingerOn) {
+            uint64_t settled = onFor - OBJECT_DETECT_US;
+            status = 3U;
+            hrOut = (uint16_t)(glitch ? (hr + GLITCH_HR) : hr);
+            oxyOut = (uint16_t)(glitch ? (oxy - GLITCH_OXY) : oxy);
+            if (moving) {
+                hrOut = (uint16_t)(MOTION_HZ * 600.0);
+                oxyOut = (uint16_t)(oxy - MOTION_OXY);
+            }
+            rOut = (uint16_t)(r * 10.0);
+            confidence = (settled >= CONFIDENCE_RAMP_US)
+                             ? cfg->confidence
+                             : (uint8_t)((settled * cfg->confidence) / CONFIDENCE_RAMP_US);
+        }
+
+        put16(&p[0], hrOut);
+        p[2] = confidence;
+        put16(&p[3], oxyOut);
+        p[5] = status;
+        if (hub->algoMode == MODE_TWO) {
+            put16(&p[6], rOut);
+            p[8] = 0U; // extended status: success
+            p[9] = 0U;
+            p[10] = 0U;
+        }
+    }
+}
+
+/* FIFO ---------------------------------------------------------------------*/
+
+static uint8_t producing(const sim_max32664_t *hub) {
+    if ((hub->inReset != 0U) || (hub->booting != 0U) || (hub->deviceMode != APP_MODE)) {
+        return 0U;
+    }
+    if ((hub->sensorEnabled == 0U) || (sample_size(hub) == 0U)) {
+        return 0U;
+    }
+    // algorithm reports need the algorithm running
+    return (has_algo(hub->outputMode) == 0U) || (hub->algoMode != 0U);
+}
+
+static void fifo_clear(sim_max32664_t *hub) {
+    hub->fifoHead = 0U;
+    hub->fifoCount = 0U;
+}
+
+static void fifo_push(sim_max32664_t *hub) {
+    uint32_t depth = hub->config.fifoDepth;
+    if (hub->fifoCount == depth) {
+        hub->fifoHead = (hub->fifoHead + 1U) % depth;
+        hub->fifoCount--;
+        hub->stats.dropped++;
+    }
+    uint32_t slot = (hub->fifoHead + hub->fifoCount) % depth;
+    generate(hub, hub->fifo[slot]);
+    hub->fifoTime[slot] = sim_now();
+    hub->fifoCount++;
+    hub->stats.samples++;
+}
+
+static void sample_tick(void *ctx) {
+    sim_max32664_t *hub = (sim_max32664_t *)ctx;
+    if (producing(hub)) {
+        fifo_push(hub);
+    }
+    sim_schedule(sim_now() + (1000000U / hub->config.sampleRateHz), sample_tick, hub);
+}
+
+/* Reads samples from the FIFO, a partial sample still consumes it */
+static void fifo_read(sim_max32664_t *hub, uint8_t *data, uint16_t size) {
+    uint8_t sampleSize = sample_size(hub);
+    uint16_t offset = 0U;
+
+    while ((offset < size) && (hub->fifoCount > 0U) && (sampleSize > 0U)) {
+        uint32_t slot = hub->fifoHead;
+        uint16_t n = ((size - offset) < sampleSize) ? (uint16_t)(size - offset) : sampleSize;
+        uint64_t age = sim_now() - hub->fifoTime[slot];
+
+        (void)memcpy(&data[offset], hub->fifo[slot], n);
+        offset += n;
+        hub->fifoHead = (hub->fifoHead + 1U) % hub->config.fifoDepth;
+        hub->fifoCount--;
+
+        hub->stats.read++;
+        hub->stats.latencySum += age;
+        if (age > hub->stats.latencyMax) {
+            hub->stats.latencyMax = age;
+        }
+    }
+    (void)memset(&data[offset], 0, size - offset);
+}
+
+/* Commands -----------------------------------------------------------------*/
+
+static void respond(sim_max32664_t *hub, uint8_t status, const uint8_t *payload, uint16_t size) {
+    hub->response[0] = status;
+    if (size > (SIM_MAX32664_RESPONSE_MAX - 1U)) {
+        size = SIM_MAX32664_RESPONSE_MAX - 1U;
+    }
+    if (size > 0U) {
+        (void)memcpy(&hub->response[1], payload, size);
+    }
+    hub->responseSize = (uint16_t)(size + 1U);
+}
+
+static void respond_byte(sim_max32664_t *hub, uint8_t value) {
+    respond(hub, SB_SUCCESS, &value, 1U);
+}
+
+/* Commands with a single parameter byte after family and index */
+static uint8_t param(const sim_max32664_t *hub, uint8_t *value) {
+    if (hub->commandSize < 3U) {
+        return 0U;
+    }
+    *value = hub->command[2];
+    return 1U;
+}
+
+static void execute_app(sim_max32664_t *hub) {
+    uint8_t family = hub->command[0];
+    uint8_t index = (hub->commandSize > 1U) ? hub->command[1] : 0U;
+    uint8_t value = 0U;
+
+    switch (family) {
+    case HUB_STATUS:
+        respond_byte(hub, (hub->fifoCount >= hub->fifoThreshold) && (hub->fifoCount > 0U) ? HUB_STATUS_DATA_READY : 0U);
+        break;
+    case READ_DEVICE_MODE:
+        respond_byte(hub, hub->deviceMode);
+        break;
+    case OUTPUT_MODE:
+        if (!param(hub, &value)) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if (index == SET_FORMAT) {
+            if (value > SENSOR_ALGO_COUNTER) {
+                respond(hub, SB_ILLEGAL_CONF, NULL, 0U);
+            } else {
+                hub->outputMode = value;
+                fifo_clear(hub);
+                respond(hub, SB_SUCCESS, NULL, 0U);
+            }
+        } else if (index == WRITE_SET_THRESHOLD) {
+            hub->fifoThreshold = value;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        break;
+    case READ_OUTPUT_MODE:
+        if (index == SET_FORMAT) {
+            respond_byte(hub, hub->outputMode);
+        } else if (index == WRITE_SET_THRESHOLD) {
+            respond_byte(hub, hub->fifoThreshold);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        break;
+    case READ_DATA_OUTPUT:
+        if (index == NUM_SAMPLES) {
+            respond_byte(hub, (hub->fifoCount > 0xFFU) ? 0xFFU : (uint8_t)hub->fifoCount);
+        } else if (index == READ_DATA) {
+            // the payload is taken from the FIFO when the host reads it
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        break;
+    case WRITE_REGISTER:
+        if (hub->commandSize < 4U) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if (index == WRITE_MAX30101) {
+            hub->afe[hub->command[2]] = hub->command[3];
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        }
+        break;
+    case READ_REGISTER:
+        if (!param(hub, &value)) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if (index == READ_MAX30101) {
+            respond_byte(hub, hub->afe[value]);
+        } else {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        }
+        break;
+    case READ_ATTRIBUTES_AFE:
+        if (index == RETRIEVE_AFE_MAX30101) {
+            const uint8_t attributes[2] = {1U, 36U}; // one byte words, 36 registers
+            respond(hub, SB_SUCCESS, attributes, 2U);
+        } else if ((index == RETRIEVE_AFE_ACCELEROMETER) && (hub->config.accelerometer != 0U)) {
+            const uint8_t attributes[2] = {1U, 64U};
+            respond(hub, SB_SUCCESS, attributes, 2U);
+        } else {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        }
+        break;
+    case ENABLE_SENSOR:
+        if (!param(hub, &value) || (value > ENABLE)) {
+            respond(hub, SB_ILLEGAL_CONF, NULL, 0U);
+        } else if (index == ENABLE_MAX30101) {
+            hub->sensorEnabled = value;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if ((index == ENABLE_ACCELEROMETER) && (hub->config.accelerometer != 0U)) {
+            hub->accelEnabled = value;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if (index == ENABLE_ACCELEROMETER) {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        break;
+    case READ_SENSOR_MODE:
+        if (index == READ_ENABLE_MAX30101) {
+            respond_byte(hub, hub->sensorEnabled);
+        } else if (index == READ_ENABLE_ACCELEROMETER) {
+            respond_byte(hub, hub->accelEnabled);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        break;
+    case CHANGE_ALGORITHM_CONFIG:
+        if (hub->commandSize < 4U) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if ((index == SET_TARG_PERC) && (hub->command[2] <= AGC_NUM_SAMP_ID)) {
+            hub->agc[hub->command[2]] = hub->command[3];
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if ((index == SET_PULSE_OX_COEF) && (hub->command[2] == MAXIMFAST_COEF_ID) &&
+                   (hub->commandSize >= 15U)) {
+            for (uint32_t i = 0U; i < 3U; i++) {
+                const uint8_t *b = &hub->command[3U + (4U * i)];
+                hub->coef[i] = (int32_t)(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3]);
+            }
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        }
+        break;
+    case READ_ALGORITHM_CONFIG:
+        if (!param(hub, &value)) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if ((index == READ_AGC_PERCENTAGE) && (value <= READ_AGC_NUM_SAMPLES_ID)) {
+            respond_byte(hub, hub->agc[value]);
+        } else if ((index == READ_MAX_FAST_COEF) && (value == READ_MAX_FAST_COEF_ID)) {
+            uint8_t payload[12];
+            for (uint32_t i = 0U; i < 3U; i++) {
+                uint32_t c = (uint32_t)hub->coef[i];
+                payload[4U * i] = (uint8_t)(c >> 24);
+                payload[(4U * i) + 1U] = (uint8_t)(c >> 16);
+                payload[(4U * i) + 2U] = (uint8_t)(c >> 8);
+                payload[(4U * i) + 3U] = (uint8_t)c;
+            }
+            respond(hub, SB_SUCCESS, payload, sizeof(payload));
+        } else {
+            respond(hub, SB_NOTIMPL_FUNC, NULL, 0U);
+        }
+        break;
+    case ENABLE_ALGORITHM:
+        if (!param(hub, &value)) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if ((index == ENABLE_AGC_ALGO) && (value <= ENABLE)) {
+            hub->agcEnabled = value;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if ((index == ENABLE_WHRM_ALGO) && (value <= MODE_TWO)) {
+            if (value != hub->algoMode) {
+                fifo_clear(hub);
+            }
+            hub->algoMode = value;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else {
+            respond(hub, SB_ILLEGAL_CONF, NULL, 0U);
+        }
+        break;
+    default:
+        respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        break;
+    }
+}
+
+static void boot_done(void *ctx);
+
+static void execute(void *ctx) {
+    sim_max32664_t *hub = (sim_max32664_t *)ctx;
+    uint8_t family = hub->command[0];
+    uint8_t index = (hub->commandSize > 1U) ? hub->command[1] : 0U;
+
+    hub->busy = 0U;
+
+    // commands understood in both modes
+    switch (family) {
+    case SET_DEVICE_MODE:
+        if ((index != 0x00U) || (hub->commandSize < 3U)) {
+            respond(hub, SB_ERR_NUM_FB, NULL, 0U);
+        } else if (hub->command[2] == EXIT_BOOTLOADER) {
+            hub->deviceMode = APP_MODE;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if (hub->command[2] == ENTER_BOOTLOADER) {
+            hub->deviceMode = BOOTLOADER_MODE;
+            respond(hub, SB_SUCCESS, NULL, 0U);
+        } else if (hub->command[2] == EXIT_RESET) {
+            // soft reset: configuration lost, back in application mode after booting
+            respond(hub, SB_SUCCESS, NULL, 0U);
+            hub->booting = 1U;
+            sim_schedule(sim_now() + hub->config.appBootUs, boot_done, hub);
+        } else {
+            respond(hub, SB_ILLEGAL_CONF, NULL, 0U);
+        }
+        return;
+    case READ_DEVICE_MODE:
+        respond_byte(hub, hub->deviceMode);
+        return;
+    case IDENTITY:
+        if (index == READ_MCU_TYPE) {
+            respond_byte(hub, 0x01U); // MAX32664
+        } else if ((index == READ_SENSOR_HUB_VERS) || (index == READ_ALGO_VERS)) {
+            const uint8_t version[3] = {10U, 1U, 0U};
+            respond(hub, SB_SUCCESS, version, 3U);
+        } else {
+            respond(hub, SB_ILLEGAL_FB_CB, NULL, 0U);
+        }
+        return;
+    case BOOTLOADER_FLASH:
+    case BOOTLOADER_INFO:
+        respond(hub, (hub->deviceMode == BOOTLOADER_MODE) ? SB_NOTIMPL_FUNC : SB_ERR_MODE, NULL, 0U);
+        return;
+    default:
+        break;
+    }
+
+    if (hub->deviceMode != APP_MODE) {
+        respond(hub, SB_ERR_MODE, NULL, 0U);
+        return;
+    }
+    execute_app(hub);
+}
+
+static uint32_t processing_time(const sim_max32664_t *hub) {
+    uint8_t family = hub->command[0];
+    if ((family == ENABLE_SENSOR) || (family == ENABLE_ALGORITHM)) {
+        return hub->config.enableDelayUs;
+    }
+    return hub->config.cmdDelayUs;
+}
+
+/* Power and mode -----------------------------------------------------------*/
+
+static void clear_configuration(sim_max32664_t *hub) {
+    hub->outputMode = PAUSE;
+    hub->fifoThreshold = 0x01U;
+    hub->sensorEnabled = 0U;
+    hub->accelEnabled = 0U;
+    hub->agcEnabled = 0U;
+    hub->algoMode = 0U;
+    hub->agc[0] = 60U; // AGC target, %
+    hub->agc[1] = 5U;  // step size, %
+    hub->agc[2] = 15U; // sensitivity, %
+    hub->agc[3] = 25U; // samples averaged
+    hub->coef[0] = 159584;
+    hub->coef[1] = -3465966;
+    hub->coef[2] = 11268987;
+    (void)memset(hub->afe, 0, sizeof(hub->afe));
+    hub->afe[CONFIGURATION_REGISTER] = 0x27U; // 100 sps, 411 us
+    hub->busy = 0U;
+    hub->responseSize = 0U;
+    hub->commandSize = 0U;
+    fifo_clear(hub);
+}
+
+static void boot_done(void *ctx) {
+    sim_max32664_t *hub = (sim_max32664_t *)ctx;
+    hub->booting = 0U;
+}
+
+static void pin_written(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState level, void *ctx) {
+    sim_max32664_t *hub = (sim_max32664_t *)ctx;
+
+    if ((port != RESET_PORT) || (pin != RESET_PIN)) {
+        return;
+    }
+    uint8_t high = (level == GPIO_PIN_SET) ? 1U : 0U;
+    if (high == hub->resetLevel) {
+        return;
+    }
+    hub->resetLevel = high;
+
+    sim_cancel(boot_done, hub);
+    sim_cancel(execute, hub);
+    if (high == 0U) {
+        hub->inReset = 1U;
+        hub->booting = 0U;
+        clear_configuration(hub);
+        return;
+    }
+
+    // MFIO sampled on the rising edge of RSTN selects the mode
+    hub->inReset = 0U;
+    hub->booting = 1U;
+    if (HAL_GPIO_ReadPin(MFIO_PORT, MFIO_PIN) == GPIO_PIN_SET) {
+        hub->deviceMode = APP_MODE;
+        sim_schedule(sim_now() + hub->config.appBootUs, boot_done, hub);
+    } else {
+        hub->deviceMode = BOOTLOADER_MODE;
+        sim_schedule(sim_now() + hub->config.bootloaderBootUs, boot_done, hub);
+    }
+}
+
+/* I2C ----------------------------------------------------------------------*/
+
+static uint8_t answering(const sim_max32664_t *hub) {
+    return (hub->inReset == 0U) && (hub->booting == 0U);
+}
+
+static HAL_StatusTypeDef hub_write(sim_i2c_device_t *dev, const uint8_t *data, uint16_t size) {
+    sim_max32664_t *hub = (sim_max32664_t *)dev;
+
+    if (!answering(hub)) {
+        return HAL_ERROR;
+    }
+    if (size == 0U) {
+        return HAL_OK;
+    }
+    if (hub->busy != 0U) {
+        // the previous command is dropped, as the hub restarts its parser
+        sim_cancel(execute, hub);
+        hub->stats.overrun++;
+    }
+
+    hub->commandSize = (size > SIM_MAX32664_COMMAND_MAX) ? SIM_MAX32664_COMMAND_MAX : size;
+    (void)memcpy(hub->command, data, hub->commandSize);
+    hub->busy = 1U;
+    hub->responseSize = 0U;
+    hub->stats.commands++;
+    sim_schedule(sim_now() + processing_time(hub), execute, hub);
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef hub_read(sim_i2c_device_t *dev, uint8_t *data, uint16_t size) {
+    sim_max32664_t *hub = (sim_max32664_t *)dev;
+
+    if (!answering(hub)) {
+        return HAL_ERROR;
+    }
+    if (size == 0U) {
+        return HAL_OK;
+    }
+    (void)memset(data, 0, size);
+
+    if (hub->busy != 0U) {
+        data[0] = SB_DEV_BUSY;
+        hub->stats.busy++;
+        return HAL_OK;
+    }
+    if (hub->responseSize == 0U) {
+        data[0] = SB_ERR_UNKNOWN;
+        return HAL_OK;
+    }
+
+    data[0] = hub->response[0];
+    if ((hub->command[0] == READ_DATA_OUTPUT) && (hub->command[1] == READ_DATA) && (hub->response[0] == SB_SUCCESS)) {
+        fifo_read(hub, &data[1], (uint16_t)(size - 1U));
+        return HAL_OK;
+    }
+    for (uint16_t i = 1U; (i < size) && (i < hub->responseSize); i++) {
+        data[i] = hub->response[i];
+    }
+    return HAL_OK;
+}
+
+/* Public -------------------------------------------------------------------*/
+
+sim_max32664_config_t sim_max32664_defaults(void) {
+    sim_max32664_config_t config;
+    config.sampleRateHz = 100U;
+    config.fifoDepth = 32U;
+    config.cmdDelayUs = 2000U;
+    config.enableDelayUs = 40000U;
+    config.appBootUs = 1000000U;
+    config.bootloaderBootUs = 50000U;
+    config.fingerOnUs = UINT64_MAX;
+    config.fingerOffUs = UINT64_MAX;
+    config.heartRate = 720U;
+    config.oxygen = 975U;
+    config.confidence = CONFIDENCE_FINAL;
+    config.respiration = 150U;
+    config.accelerometer = 0U;
+    config.motionOnUs = UINT64_MAX;
+    config.motionOffUs = UINT64_MAX;
+    config.desatOnUs = UINT64_MAX;
+    config.desatOffUs = UINT64_MAX;
+    return config;
+}
+
+void sim_max32664_init(sim_max32664_t *hub, const sim_max32664_config_t *config) {
+    (void)memset(hub, 0, sizeof(*hub));
+    hub->dev.address = HUB_ADDRESS;
+    hub->dev.write = hub_write;
+    hub->dev.read = hub_read;
+    hub->config = *config;
+    if (hub->config.sampleRateHz == 0U) {
+        hub->config.sampleRateHz = 100U;
+    }
+    if ((hub->config.fifoDepth == 0U) || (hub->config.fifoDepth > SIM_MAX32664_FIFO_SIZE)) {
+        hub->config.fifoDepth = SIM_MAX32664_FIFO_SIZE;
+    }
+
+    hub->deviceMode = APP_MODE;
+    hub->resetLevel = 1U;
+    hub->noise = 1U;
+    clear_configuration(hub);
+
+    double highest = -2.0;
+    double lowest = 2.0;
+    for (uint32_t i = 0U; i < 4096U; i++) {
+        double shape = pulse_shape(i << 20);
+        highest = (shape > highest) ? shape : highest;
+        lowest = (shape < lowest) ? shape : lowest;
+    }
+    hub->shapeRange = highest - lowest;
+
+    sim_i2c_attach(&hub->dev);
+    sim_gpio_watch(pin_written, hub);
+    sim_schedule(sim_now() + (1000000U / hub->config.sampleRateHz), sample_tick, hub);
+}
+
+void sim_max32664_preconfigure(sim_max32664_t *hub, uint8_t mode) {
+    hub->outputMode = ALGO_DATA;
+    hub->fifoThreshold = 0x01U;
+    hub->agcEnabled = 1U;
+    hub->sensorEnabled = 1U;
+    hub->algoMode = mode;
+}
@@ -0,0 +1,280 @@
+#include "sim_replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2crec.h"
+
+#define REPLAY_DEVICES (8U)
+#define LINE_MAX_CHARS (4096U)
+
+typedef struct replay_op {
+    uint32_t timestamp; // of the recorded transfer, us
+    uint8_t write;      // 1 write, 0 read
+    uint8_t fail;       // NACKed
+    uint16_t size;
+    uint8_t *data;
+} replay_op_t;
+
+typedef struct replay_device {
+    sim_i2c_device_t dev;
+    sim_i2c_device_t *model; // device answering behind, NULL if none
+    replay_op_t *ops;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t next;
+} replay_device_t;
+
+static replay_device_t devices[REPLAY_DEVICES];
+static uint32_t deviceCount = 0U;
+static sim_replay_stats_t stats;
+
+static replay_device_t *device_for(uint8_t address) {
+    for (uint32_t i = 0U; i < deviceCount; i++) {
+        if (devices[i].dev.address == address) {
+            return &devices[i];
+        }
+    }
+    if (deviceCount >= REPLAY_DEVICES) {
+        return NULL;
+    }
+    replay_device_t *d = &devices[deviceCount++];
+    (void)memset(d, 0, sizeof(*d));
+    d->dev.address = address;
+    return d;
+}
+
+static int add_op(uint8_t address, uint32_t timestamp, uint8_t write, uint8_t fail, const uint8_t *data,
+                  uint16_t size) {
+    replay_device_t *d = device_for(address);
+    if (d == NULL) {
+        return -1;
+    }
+    if (d->count == d->capacity) {
+        d->capacity = (d->capacity == 0U) ? 256U : (d->capacity * 2U);
+        d->ops = realloc(d->ops, d->capacity * sizeof(replay_op_t));
+        if (d->ops == NULL) {
+            return -1;
+        }
+    }
+    replay_op_t *op = &d->ops[d->count++];
+    op->timestamp = timestamp;
+    op->write = write;
+    op->fail = fail;
+    op->size = size;
+    op->data = NULL;
+    if (size > 0U) {
+        op->data = malloc(size);
+        if (op->data == NULL) {
+            return -1;
+        }
+        (void)memcpy(op->data, data, size);
+    }
+    return 0;
+}
+
+static int hex_value(char c) {
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/* Splits a transfer of the transcript in the transfers the HAL puts on the bus */
+static int parse_transfer(const char *line) {
+    static uint8_t bytes[LINE_MAX_CHARS / 2U];
+    unsigned long timestamp;
+    unsigned op, address, memAddress, memAddressSize, status;
+    char hex[LINE_MAX_CHARS];
+
+    if (sscanf(line, "%lu %u %u %u %u %u %4095s", &timestamp, &op, &address, &memAddress, &memAddressSize,
+               &status, hex) != 7) {
+        return -1;
+    }
+
+    uint16_t size = 0U;
+    if (strcmp(hex, "-") != 0) {
+        size_t length = strlen(hex);
+        if ((length % 2U) != 0U) {
+            return -1;
+        }
+        for (size_t i = 0U; i < length; i += 2U) {
+            int high = hex_value(hex[i]);
+            int low = hex_value(hex[i + 1U]);
+            if ((high < 0) || (low < 0)) {
+                return -1;
+            }
+            bytes[size++] = (uint8_t)((high << 4) | low);
+        }
+    }
+
+    uint8_t dev = (uint8_t)(address & 0xFEU);
+    uint8_t fail = (status != (unsigned)HAL_OK) ? 1U : 0U;
+    uint8_t header[2];
+    uint16_t headerSize = 0U;
+    if (memAddressSize == I2C_MEMADD_SIZE_16BIT) {
+        header[headerSize++] = (uint8_t)(memAddress >> 8);
+    }
+    header[headerSize++] = (uint8_t)memAddress;
+
+    switch (op) {
+    case I2CREC_TRANSMIT:
+        return add_op(dev, (uint32_t)timestamp, 1U, fail, bytes, size);
+    case I2CREC_RECEIVE:
+        return add_op(dev, (uint32_t)timestamp, 0U, fail, bytes, size);
+    case I2CREC_MEM_WRITE: {
+        static uint8_t joined[2U + (LINE_MAX_CHARS / 2U)];
+        (void)memcpy(joined, header, headerSize);
+        (void)memcpy(&joined[headerSize], bytes, size);
+        return add_op(dev, (uint32_t)timestamp, 1U, fail, joined, (uint16_t)(headerSize + size));
+    }
+    case I2CREC_MEM_READ:
+        // a failed read is replayed as a NACK of the register address
+        if (add_op(dev, (uint32_t)timestamp, 1U, fail, header, headerSize) != 0) {
+            return -1;
+        }
+        return (fail != 0U) ? 0 : add_op(dev, (uint32_t)timestamp, 0U, 0U, bytes, size);
+    case I2CREC_READY:
+        // answered by the presence of the device
+        return (device_for(dev) != NULL) ? 0 : -1;
+    default:
+        return -1;
+    }
+}
+
+static void strip(char *line) {
+    size_t length = strlen(line);
+    while ((length > 0U) && ((line[length - 1U] == '\n') || (line[length - 1U] == '\r'))) {
+        line[--length] = '\0';
+    }
+}
+
+int sim_replay_load(FILE *capture) {
+    static char line[LINE_MAX_CHARS];
+    long header = -1;
+    long dump = -1;
+    unsigned long transfers = 0U;
+    unsigned long lost = 0U;
+
+    // the last dump with both its header and its end line
+    while (fgets(line, sizeof(line), capture) != NULL) {
+        long start = ftell(capture) - (long)strlen(line);
+        strip(line);
+        if (strcmp(line, "i2crec end") == 0) {
+            dump = header;
+        } else if (sscanf(line, "i2crec %lu %lu", &transfers, &lost) == 2) {
+            header = start;
+        } else {
+            // console output around the dumps
+        }
+    }
+    if (dump < 0) {
+        (void)fprintf(stderr, "replay: no complete i2crec dump\n");
+        return -1;
+    }
+
+    (void)fseek(capture, dump, SEEK_SET);
+    (void)fgets(line, sizeof(line), capture);
+    strip(line);
+    (void)sscanf(line, "i2crec %lu %lu", &transfers, &lost);
+    if (lost != 0U) {
+        (void)fprintf(stderr, "replay: the transcript lost its first %lu transfers\n", lost);
+        return -1;
+    }
+
+    deviceCount = 0U;
+    for (unsigned long i = 0U; i < transfers; i++) {
+        if (fgets(line, sizeof(line), capture) == NULL) {
+            (void)fprintf(stderr, "replay: transcript truncated\n");
+            return -1;
+        }
+        strip(line);
+        if (parse_transfer(line) != 0) {
+            (void)fprintf(stderr, "replay: bad transfer \"%s\"\n", line);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void report(const replay_device_t *d, const replay_op_t *op, const char *what) {
+    // only the first one, the following usually derive from it
+    if (stats.mismatches == 1U) {
+        (void)fprintf(stderr, "replay: device 0x%02x transfer %lu (recorded at %lu us, now %llu us): %s\n",
+                      d->dev.address, (unsigned long)d->next, (unsigned long)op->timestamp,
+                      (unsigned long long)sim_now(), what);
+    }
+}
+
+static HAL_StatusTypeDef replay_write(sim_i2c_device_t *dev, const uint8_t *data, uint16_t size) {
+    replay_device_t *d = (replay_device_t *)dev;
+
+    if (d->next >= d->count) {
+        stats.live += 1U;
+        return ((d->model != NULL) && (d->model->write != NULL)) ? d->model->write(d->model, data, size) : HAL_ERROR;
+    }
+
+    const replay_op_t *op = &d->ops[d->next];
+    stats.transfers += 1U;
+    if ((op->write == 0U) || (op->size != size) || ((size > 0U) && (memcmp(op->data, data, size) != 0))) {
+        stats.mismatches += 1U;
+        report(d, op, (op->write == 0U) ? "write instead of a read" : "written bytes differ");
+    }
+    d->next++;
+    if (op->fail != 0U) {
+        return HAL_ERROR;
+    }
+    if ((d->model != NULL) && (d->model->write != NULL)) {
+        (void)d->model->write(d->model, data, size);
+    }
+    return HAL_OK;
+}
+
+static HAL_StatusTypeDef replay_read(sim_i2c_device_t *dev, uint8_t *data, uint16_t size) {
+    replay_device_t *d = (replay_device_t *)dev;
+
+    if (d->next >= d->count) {
+        stats.live += 1U;
+        return ((d->model != NULL) && (d->model->read != NULL)) ? d->model->read(d->model, data, size) : HAL_ERROR;
+    }
+
+    const replay_op_t *op = &d->ops[d->next];
+    stats.transfers += 1U;
+    if ((op->write != 0U) || (op->size != size)) {
+        stats.mismatches += 1U;
+        report(d, op, (op->write != 0U) ? "read instead of a write" : "read size differs");
+    }
+    d->next++;
+    if (op->fail != 0U) {
+        return HAL_ERROR;
+    }
+    // the model reads too, to keep its state in step, its answer is discarded
+    if ((d->model != NULL) && (d->model->read != NULL)) {
+        (void)d->model->read(d->model, data, size);
+    }
+    uint16_t n = (op->size < size) ? op->size : size;
+    (void)memset(data, 0, size);
+    if ((op->write == 0U) && (n > 0U)) {
+        (void)memcpy(data, op->data, n);
+    }
+    return HAL_OK;
+}
+
+void sim_replay_attach(void) {
+    (void)memset(&stats, 0, sizeof(stats));
+    for (uint32_t i = 0U; i < deviceCount; i++) {
+        replay_device_t *d = &devices[i];
+        d->model = sim_i2c_find(d->dev.address);
+        d->dev.write = replay_write;
+        d->dev.read = replay_read;
+        d->next = 0U;
+        sim_i2c_attach(&d->dev);
+    }
+}
+
+const sim_replay_stats_t *sim_replay_stats(void) {
+    return &stats;
+}
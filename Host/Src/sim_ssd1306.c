@@ -0,0 +1,376 @@
+#include "sim_ssd1306.h"
+
+#include <string.h>
+
+#define SSD1306_ADDRESS (0x78U)
+
+#define CONTROL_CO (0x80U)
+#define CONTROL_DC (0x40U)
+
+#define MODE_HORIZONTAL (0U)
+#define MODE_VERTICAL (1U)
+#define MODE_PAGE (2U)
+
+// intensity of a lit pixel at contrast 0 and 255
+#define LEVEL_MIN (55U)
+#define LEVEL_MAX (255U)
+
+/* Frames between two scroll steps, indexed by the interval parameter */
+static const uint16_t scrollFrames[8] = {5U, 64U, 128U, 256U, 3U, 4U, 25U, 2U};
+
+static void reset_state(sim_ssd1306_t *oled) {
+    (void)memset(oled->gddram, 0, sizeof(oled->gddram));
+    oled->paramCount = 0U;
+    oled->paramExpected = 0U;
+
+    oled->displayOn = 0U;
+    oled->entireOn = 0U;
+    oled->inverse = 0U;
+    oled->contrast = 0x7FU;
+    oled->segmentRemap = 0U;
+    oled->comRemap = 0U;
+    oled->startLine = 0U;
+    oled->offset = 0U;
+    oled->multiplex = 63U;
+    oled->clockDivide = 0x80U;
+    oled->precharge = 0x22U;
+    oled->chargePump = 0U;
+
+    oled->addressingMode = MODE_PAGE;
+    oled->column = 0U;
+    oled->page = 0U;
+    oled->columnStart = 0U;
+    oled->columnEnd = (uint8_t)(SIM_SSD1306_WIDTH - 1U);
+    oled->pageStart = 0U;
+    oled->pageEnd = (uint8_t)(SIM_SSD1306_PAGES - 1U);
+
+    oled->scrollActive = 0U;
+    oled->scrollAreaTop = 0U;
+    oled->scrollAreaRows = (uint8_t)SIM_SSD1306_HEIGHT;
+}
+
+/*
+ * Frame rate: Fosc / (D * K * MUX), with D the clock divide ratio and K the
+ * pre-charge phases plus 50 DCLKs. Fosc is roughly linear in the D5h
+ * frequency setting, 175 kHz + 25 kHz per step (datasheet typical curve).
+ */
+static uint32_t frame_period_us(const sim_ssd1306_t *oled) {
+    uint32_t fosc = 175000U + (25000U * (uint32_t)(oled->clockDivide >> 4));
+    uint32_t divide = (uint32_t)(oled->clockDivide & 0x0FU) + 1U;
+    uint32_t phases = (uint32_t)(oled->precharge & 0x0FU) + (uint32_t)(oled->precharge >> 4) + 50U;
+    uint32_t mux = (uint32_t)oled->multiplex + 1U;
+    return (uint32_t)(((uint64_t)divide * phases * mux * 1000000U) / fosc);
+}
+
+static void execute(sim_ssd1306_t *oled) {
+    const uint8_t *p = oled->params;
+
+    switch (oled->command) {
+    case 0x20U:
+        if ((p[0] & 0x03U) != 0x03U) {
+            oled->addressingMode = p[0] & 0x03U;
+        }
+        break;
+    case 0x21U:
+        oled->columnStart = p[0] & 0x7FU;
+        oled->columnEnd = p[1] & 0x7FU;
+        oled->column = oled->columnStart;
+        break;
+    case 0x22U:
+        oled->pageStart = p[0] & 0x07U;
+        oled->pageEnd = p[1] & 0x07U;
+        oled->page = oled->pageStart;
+        break;
+    case 0x26U:
+    case 0x27U:
+    case 0x29U:
+    case 0x2AU:
+        oled->scrollCommand = oled->command;
+        oled->scrollStartPage = p[1] & 0x07U;
+        oled->scrollInterval = p[2] & 0x07U;
+        oled->scrollEndPage = p[3] & 0x07U;
+        oled->scrollVerticalOffset = ((oled->command == 0x29U) || (oled->command == 0x2AU)) ? (p[4] & 0x3FU) : 0U;
+        break;
+    case 0x81U:
+        oled->contrast = p[0];
+        break;
+    case 0x8DU:
+        oled->chargePump = ((p[0] & 0x04U) != 0U) ? 1U : 0U;
+        break;
+    case 0xA3U:
+        oled->scrollAreaTop = p[0] & 0x3FU;
+        oled->scrollAreaRows = p[1] & 0x7FU;
+        break;
+    case 0xA8U:
+        if ((p[0] & 0x3FU) >= 15U) {
+            oled->multiplex = p[0] & 0x3FU;
+        }
+        break;
+    case 0xD3U:
+        oled->offset = p[0] & 0x3FU;
+        break;
+    case 0xD5U:
+        oled->clockDivide = p[0];
+        break;
+    case 0xD9U:
+        oled->precharge = p[0];
+        break;
+    default:
+        // 0xDA COM pins and 0xDB VCOMH deselect level do not change the image
+        break;
+    }
+}
+
+/* Number of parameter bytes following a command opcode */
+static uint8_t param_count(uint8_t command) {
+    switch (command) {
+    case 0x20U:
+    case 0x81U:
+    case 0x8DU:
+    case 0xA8U:
+    case 0xD3U:
+    case 0xD5U:
+    case 0xD9U:
+    case 0xDAU:
+    case 0xDBU:
+        return 1U;
+    case 0x21U:
+    case 0x22U:
+    case 0xA3U:
+        return 2U;
+    case 0x29U:
+    case 0x2AU:
+        return 5U;
+    case 0x26U:
+    case 0x27U:
+        return 6U;
+    default:
+        return 0U;
+    }
+}
+
+static void command_byte(sim_ssd1306_t *oled, uint8_t byte) {
+    oled->frame.commandBytes += 1U;
+
+    if (oled->paramExpected > 0U) {
+        oled->params[oled->paramCount++] = byte;
+        if (oled->paramCount == oled->paramExpected) {
+            oled->paramExpected = 0U;
+            execute(oled);
+        }
+        return;
+    }
+
+    oled->command = byte;
+    oled->paramCount = 0U;
+    oled->paramExpected = param_count(byte);
+    if (oled->paramExpected > 0U) {
+        return;
+    }
+
+    if (byte <= 0x1FU) {
+        if (oled->addressingMode != MODE_PAGE) {
+            oled->frame.ignored += 1U;
+        } else if (byte <= 0x0FU) {
+            oled->column = (uint8_t)((oled->column & 0x70U) | byte);
+        } else {
+            oled->column = (uint8_t)((oled->column & 0x0FU) | ((byte & 0x07U) << 4));
+        }
+    } else if ((byte >= 0xB0U) && (byte <= 0xB7U)) {
+        if (oled->addressingMode != MODE_PAGE) {
+            oled->frame.ignored += 1U;
+        } else {
+            oled->page = byte & 0x07U;
+        }
+    } else if ((byte >= 0x40U) && (byte <= 0x7FU)) {
+        oled->startLine = byte & 0x3FU;
+    } else if ((byte & 0xFEU) == 0xA0U) {
+        oled->segmentRemap = byte & 0x01U;
+    } else if ((byte & 0xFEU) == 0xA4U) {
+        oled->entireOn = byte & 0x01U;
+    } else if ((byte & 0xFEU) == 0xA6U) {
+        oled->inverse = byte & 0x01U;
+    } else if ((byte & 0xFEU) == 0xAEU) {
+        oled->displayOn = byte & 0x01U;
+    } else if ((byte & 0xF7U) == 0xC0U) {
+        oled->comRemap = ((byte & 0x08U) != 0U) ? 1U : 0U;
+    } else if (byte == 0x2EU) {
+        oled->scrollActive = 0U;
+    } else if (byte == 0x2FU) {
+        oled->scrollActive = 1U;
+        oled->scrollSince = sim_now();
+    } else {
+        // 0xE3 NOP and unknown opcodes
+    }
+}
+
+static void data_byte(sim_ssd1306_t *oled, uint8_t byte) {
+    // a data byte aborts a command waiting for its parameters
+    oled->paramExpected = 0U;
+    oled->frame.dataBytes += 1U;
+
+    if ((oled->page < SIM_SSD1306_PAGES) && (oled->column < SIM_SSD1306_WIDTH)) {
+        oled->gddram[oled->page][oled->column] = byte;
+    }
+
+    if (oled->addressingMode == MODE_VERTICAL) {
+        if (oled->page >= oled->pageEnd) {
+            oled->page = oled->pageStart;
+            oled->column = (oled->column >= oled->columnEnd) ? oled->columnStart : (uint8_t)(oled->column + 1U);
+        } else {
+            oled->page++;
+        }
+    } else if (oled->column >= oled->columnEnd) {
+        oled->column = oled->columnStart;
+        if (oled->addressingMode == MODE_HORIZONTAL) {
+            oled->page = (oled->page >= oled->pageEnd) ? oled->pageStart : (uint8_t)(oled->page + 1U);
+        }
+    } else {
+        oled->column++;
+    }
+}
+
+static void frame_close(void *ctx) {
+    sim_ssd1306_t *oled = (sim_ssd1306_t *)ctx;
+    const sim_ssd1306_frame_t *f = &oled->frame;
+
+    oled->frameOpen = 0U;
+    oled->stats.frames += 1U;
+    oled->stats.transfers += f->transfers;
+    oled->stats.commandBytes += f->commandBytes;
+    oled->stats.ignored += f->ignored;
+    oled->stats.dataBytes += f->dataBytes;
+    oled->stats.busBytes += f->busBytes;
+    oled->stats.busyTime += f->end - f->start;
+    if (oled->onFrame != NULL) {
+        oled->onFrame(oled, f, oled->onFrameCtx);
+    }
+}
+
+/*
+ * A transfer is a sequence of control byte + payload. With Co set the control
+ * byte applies to the next byte only, otherwise to the rest of the transfer.
+ */
+static HAL_StatusTypeDef oled_write(sim_i2c_device_t *dev, const uint8_t *data, uint16_t size) {
+    sim_ssd1306_t *oled = (sim_ssd1306_t *)dev;
+
+    if (oled->frameOpen == 0U) {
+        (void)memset(&oled->frame, 0, sizeof(oled->frame));
+        oled->frame.start = sim_now();
+        oled->frameOpen = 1U;
+    }
+    oled->frame.transfers += 1U;
+    oled->frame.busBytes += 1U + (uint32_t)size;
+    oled->frame.end = sim_i2c_transfer_end();
+    sim_cancel(frame_close, oled);
+    sim_schedule(oled->frame.end + SIM_SSD1306_FRAME_GAP_US, frame_close, oled);
+
+    uint16_t i = 0U;
+    while (i < size) {
+        uint8_t control = data[i++];
+        uint16_t last = ((control & CONTROL_CO) != 0U) ? (uint16_t)(i + 1U) : size;
+        if (last > size) {
+            last = size;
+        }
+        for (; i < last; i++) {
+            if ((control & CONTROL_DC) != 0U) {
+                data_byte(oled, data[i]);
+            } else {
+                command_byte(oled, data[i]);
+            }
+        }
+    }
+    return HAL_OK;
+}
+
+void sim_ssd1306_init(sim_ssd1306_t *oled) {
+    (void)memset(oled, 0, sizeof(*oled));
+    reset_state(oled);
+    oled->dev.address = SSD1306_ADDRESS;
+    oled->dev.write = oled_write;
+    oled->dev.read = NULL;
+    sim_i2c_attach(&oled->dev);
+}
+
+void sim_ssd1306_on_frame(sim_ssd1306_t *oled, sim_ssd1306_frame_fn fn, void *ctx) {
+    oled->onFrame = fn;
+    oled->onFrameCtx = ctx;
+}
+
+/* GDDRAM row and column shown at a panel position once scrolling is applied */
+static void scroll(const sim_ssd1306_t *oled, uint32_t *row, uint32_t *column) {
+    uint64_t frames = (sim_now() - oled->scrollSince) / frame_period_us(oled);
+    uint32_t steps = (uint32_t)(frames / scrollFrames[oled->scrollInterval]);
+    uint8_t left = ((oled->scrollCommand == 0x27U) || (oled->scrollCommand == 0x2AU)) ? 1U : 0U;
+
+    if ((oled->scrollVerticalOffset != 0U) && (oled->scrollAreaRows != 0U) && (*row >= oled->scrollAreaTop) &&
+        (*row < ((uint32_t)oled->scrollAreaTop + oled->scrollAreaRows))) {
+        uint32_t shift = (uint32_t)(((uint64_t)steps * oled->scrollVerticalOffset) % oled->scrollAreaRows);
+        *row = oled->scrollAreaTop + ((*row - oled->scrollAreaTop + shift) % oled->scrollAreaRows);
+    }
+
+    uint32_t page = *row / 8U;
+    if ((page >= oled->scrollStartPage) && (page <= oled->scrollEndPage)) {
+        uint32_t shift = steps % SIM_SSD1306_WIDTH;
+        *column = (left != 0U) ? ((*column + shift) % SIM_SSD1306_WIDTH)
+                               : ((*column + SIM_SSD1306_WIDTH - shift) % SIM_SSD1306_WIDTH);
+    }
+}
+
+/*
+ * With segment remap (A1h) and reverse COM scan (C8h), as ssd1306.c sets them,
+ * GDDRAM column 0 of page 0 is the top left corner of the panel.
+ */
+void sim_ssd1306_render(const sim_ssd1306_t *oled, uint8_t *image) {
+    uint32_t rows = (uint32_t)oled->multiplex + 1U;
+    uint8_t level = (uint8_t)(LEVEL_MIN + (((LEVEL_MAX - LEVEL_MIN) * (uint32_t)oled->contrast) / 255U));
+
+    for (uint32_t y = 0U; y < SIM_SSD1306_HEIGHT; y++) {
+        for (uint32_t x = 0U; x < SIM_SSD1306_WIDTH; x++) {
+            uint8_t *pixel = &image[(y * SIM_SSD1306_WIDTH) + x];
+            if ((oled->displayOn == 0U) || (y >= rows)) {
+                *pixel = 0U;
+                continue;
+            }
+
+            uint32_t com = (oled->comRemap != 0U) ? y : (rows - 1U - y);
+            uint32_t row = (com + oled->startLine + oled->offset) % SIM_SSD1306_HEIGHT;
+            uint32_t column = (oled->segmentRemap != 0U) ? x : (SIM_SSD1306_WIDTH - 1U - x);
+            if (oled->scrollActive != 0U) {
+                scroll(oled, &row, &column);
+            }
+
+            uint8_t on = (uint8_t)((oled->gddram[row / 8U][column] >> (row % 8U)) & 1U);
+            if (oled->entireOn != 0U) {
+                on = 1U;
+            }
+            on ^= oled->inverse;
+            *pixel = (on != 0U) ? level : 0U;
+        }
+    }
+}
+
+int sim_ssd1306_write_ppm(const sim_ssd1306_t *oled, FILE *file, uint32_t scale) {
+    static uint8_t image[SIM_SSD1306_WIDTH * SIM_SSD1306_HEIGHT];
+
+    if (scale == 0U) {
+        scale = 1U;
+    }
+    sim_ssd1306_render(oled, image);
+
+    if (fprintf(file, "P6\n%lu %lu\n255\n", (unsigned long)(SIM_SSD1306_WIDTH * scale),
+                (unsigned long)(SIM_SSD1306_HEIGHT * scale)) < 0) {
+        return -1;
+    }
+    for (uint32_t y = 0U; y < (SIM_SSD1306_HEIGHT * scale); y++) {
+        for (uint32_t x = 0U; x < (SIM_SSD1306_WIDTH * scale); x++) {
+            uint8_t level = image[((y / scale) * SIM_SSD1306_WIDTH) + (x / scale)];
+            // white panel
+            const uint8_t rgb[3] = {level, level, level};
+            if (fwrite(rgb, 1U, sizeof(rgb), file) != sizeof(rgb)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
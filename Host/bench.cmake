@@ -0,0 +1,81 @@
+# Benchmark regression check, run with cmake -P:
+#   -DBENCH=<project_work_bench> | -DRESULT=<results.json>
+#   -DBASELINE=<baseline.json> [-DOUT=<results.json>] [-DUPDATE=ON]
+# Runs the benchmarks (or reads results obtained elsewhere, e.g. converted
+# from a target profile dump by Tools/prof2bench.py) and compares every
+# metric of the baseline with a tolerance of tolerance_percent, in the
+# direction given by its "better" field. UPDATE=ON writes the results as the
+# new baseline, keeping its tolerance.
+
+if(BENCH)
+    if(NOT OUT)
+        set(OUT ${CMAKE_CURRENT_BINARY_DIR}/bench.json)
+    endif()
+    execute_process(COMMAND ${BENCH} --output ${OUT} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${BENCH} failed: ${result}")
+    endif()
+    set(RESULT ${OUT})
+endif()
+
+file(READ ${RESULT} results)
+file(READ ${BASELINE} baseline)
+string(JSON tolerance ERROR_VARIABLE missing GET "${baseline}" tolerance_percent)
+if(missing)
+    set(tolerance 5)
+endif()
+
+if(UPDATE)
+    # same layout as the benchmark output, one metric per line
+    set(lines "")
+    string(JSON count LENGTH "${results}" metrics)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+        string(JSON name MEMBER "${results}" metrics ${i})
+        string(JSON metric GET "${results}" metrics ${name})
+        string(JSON value GET "${metric}" value)
+        string(JSON better GET "${metric}" better)
+        list(APPEND lines "    \"${name}\": {\"value\": ${value}, \"better\": \"${better}\"}")
+    endforeach()
+    list(JOIN lines ",\n" text)
+    file(WRITE ${BASELINE} "{\n  \"tolerance_percent\": ${tolerance},\n  \"metrics\": {\n${text}\n  }\n}\n")
+    message(STATUS "updated ${BASELINE}")
+    return()
+endif()
+
+set(failures "")
+string(JSON count LENGTH "${baseline}" metrics)
+math(EXPR last "${count} - 1")
+foreach(i RANGE ${last})
+    string(JSON name MEMBER "${baseline}" metrics ${i})
+    string(JSON expected GET "${baseline}" metrics ${name} value)
+    string(JSON better GET "${baseline}" metrics ${name} better)
+    string(JSON value ERROR_VARIABLE missing GET "${results}" metrics ${name} value)
+    if(missing)
+        message(STATUS "${name}: not measured")
+        continue()
+    endif()
+
+    math(EXPR scaled "${value} * 100")
+    math(EXPR upper "${expected} * (100 + ${tolerance})")
+    math(EXPR lower "${expected} * (100 - ${tolerance})")
+    if(better STREQUAL "lower")
+        if(scaled GREATER upper)
+            list(APPEND failures "${name}: ${value}, baseline ${expected}")
+        elseif(scaled LESS lower)
+            message(STATUS "${name}: ${value}, improved on baseline ${expected}")
+        endif()
+    else()
+        if(scaled LESS lower)
+            list(APPEND failures "${name}: ${value}, baseline ${expected}")
+        elseif(scaled GREATER upper)
+            message(STATUS "${name}: ${value}, improved on baseline ${expected}")
+        endif()
+    endif()
+endforeach()
+
+if(failures)
+    list(JOIN failures "\n  " text)
+    message(FATAL_ERROR "regressions beyond ${tolerance}%:\n  ${text}")
+endif()
+message(STATUS "${count} metrics within ${tolerance}% of ${BASELINE}")
@@ -0,0 +1,37 @@
+# Golden screen test, run with cmake -P:
+#   -DSIM=<runner> -DARGS="<runner options>" -DOUT=<dir> -DGOLDEN=<dir> [-DUPDATE=ON]
+# Runs the simulator saving every distinct screen in OUT and compares them,
+# byte for byte, with the PPM files in GOLDEN. UPDATE=ON replaces the golden
+# files with the new screens instead.
+
+file(REMOVE_RECURSE ${OUT})
+file(MAKE_DIRECTORY ${OUT})
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+execute_process(COMMAND ${SIM} ${args} --quiet --snapshots ${OUT} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${SIM} failed: ${result}")
+endif()
+
+file(GLOB screens RELATIVE ${OUT} ${OUT}/*.ppm)
+if(UPDATE)
+    file(REMOVE_RECURSE ${GOLDEN})
+    file(MAKE_DIRECTORY ${GOLDEN})
+    foreach(screen ${screens})
+        file(COPY ${OUT}/${screen} DESTINATION ${GOLDEN})
+    endforeach()
+    message(STATUS "updated ${GOLDEN}: ${screens}")
+    return()
+endif()
+
+file(GLOB expected RELATIVE ${GOLDEN} ${GOLDEN}/*.ppm)
+if(NOT screens STREQUAL expected)
+    message(FATAL_ERROR "screens [${screens}] differ from golden [${expected}]")
+endif()
+foreach(screen ${screens})
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUT}/${screen} ${GOLDEN}/${screen}
+                    RESULT_VARIABLE different)
+    if(different)
+        message(FATAL_ERROR "${screen} differs from ${GOLDEN}/${screen}")
+    endif()
+endforeach()
+message(STATUS "${screens} match")
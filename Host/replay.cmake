@@ -0,0 +1,36 @@
+# Replay test, run with cmake -P:
+#   -DSIM=<runner> -DARGS="<runner options>" -DREPLAY_ARGS="<options>" -DOUT=<dir>
+# Records a session whose ARGS end with a transcript dump (--key ms:i), then
+# replays the transcript in a run with REPLAY_ARGS added, which changes the
+# device models so that only the transcript can reproduce the session. The
+# console output up to the end of the dump must be the same, byte for byte.
+
+file(MAKE_DIRECTORY ${OUT})
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+separate_arguments(replayArgs UNIX_COMMAND "${REPLAY_ARGS}")
+
+execute_process(COMMAND ${SIM} ${args} OUTPUT_FILE ${OUT}/record.txt RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "recording failed: ${result}")
+endif()
+execute_process(COMMAND ${SIM} ${args} ${replayArgs} --replay ${OUT}/record.txt
+                OUTPUT_FILE ${OUT}/replay.txt ERROR_VARIABLE summary RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "replay failed: ${result}\n${summary}")
+endif()
+if(NOT summary MATCHES "replay: [0-9]+ transfers, 0 mismatches")
+    message(FATAL_ERROR "replay diverged:\n${summary}")
+endif()
+
+foreach(run record replay)
+    file(READ ${OUT}/${run}.txt text)
+    string(FIND "${text}" "i2crec end" end)
+    if(end LESS 0)
+        message(FATAL_ERROR "${run}: no transcript dump")
+    endif()
+    string(SUBSTRING "${text}" 0 ${end} ${run})
+endforeach()
+if(NOT record STREQUAL replay)
+    message(FATAL_ERROR "console output differs, see ${OUT}/record.txt and ${OUT}/replay.txt")
+endif()
+message(STATUS "${summary}")
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Convert a profiling dump captured from USART2 to benchmark results.
+
+The dump is printed by DEBUG builds on the 'p' console command (see
+Core/Inc/prof.h). The mean duration of the regions measured on the DWT cycle
+counter becomes the benchmark metric of the same name as the host benchmarks
+(Host/Src/bench_main.c), in microseconds:
+
+    python3 Tools/prof2bench.py capture.log -o target.json
+    cmake -DRESULT=target.json -DBASELINE=target_baseline.json -P Host/bench.cmake
+
+Target results are compared with a baseline recorded on the target (add
+-DUPDATE=ON to record it), not with the host one.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# profiled region -> benchmark metric
+METRICS = {
+    "oled_update": "display_refresh_us",
+    "report": "report_us",
+    "read_bpm": "read_bpm_us",
+}
+
+HEADER = re.compile(r"^Profile \[cycles @ (\d+) Hz\]$")
+REGION = re.compile(r"^(\w+) n: (\d+)(?:, min: (\d+), mean: (\d+), max: (\d+))?$")
+
+
+def parse_dump(lines):
+    """Returns (clock, {region: mean cycles}) of the last dump in the capture."""
+    clock = None
+    regions = {}
+    for raw in lines:
+        line = raw.strip()
+        header = HEADER.match(line)
+        if header:
+            clock = int(header.group(1))
+            regions = {}
+            continue
+        region = REGION.match(line)
+        if region and clock is not None and region.group(4) is not None:
+            regions[region.group(1)] = int(region.group(4))
+    if clock is None:
+        raise ValueError("no profiling dump found")
+    return clock, regions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="serial capture holding a profiling dump, - for stdin")
+    parser.add_argument("-o", "--output", help="output JSON file, stdout by default")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.capture == "-" else open(args.capture, encoding="ascii", errors="replace")
+    with source:
+        clock, regions = parse_dump(source)
+
+    metrics = {}
+    for region, name in METRICS.items():
+        if region in regions:
+            metrics[name] = {"value": regions[region] * 1000000 // clock, "better": "lower"}
+    document = {"metrics": metrics}
+
+    if args.output:
+        with open(args.output, "w", encoding="ascii") as output:
+            json.dump(document, output, indent=1)
+    else:
+        json.dump(document, sys.stdout, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Convert an event trace dump captured from USART2 to the Chrome trace format.
+
+The dump is printed by the firmware on the 't' console command (see
+Core/Inc/trace.h). Save the serial output to a file, then
+
+    python3 Tools/trace2chrome.py capture.log -o trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev. When the
+capture holds several dumps the last one is converted.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+TRACE_I2C_BEGIN = 1
+TRACE_I2C_END = 2
+TRACE_STATE = 3
+TRACE_FIFO = 4
+TRACE_UART_BEGIN = 5
+TRACE_UART_END = 6
+TRACE_SAMPLE = 7
+TRACE_REPORT_BEGIN = 8
+TRACE_REPORT_END = 9
+TRACE_ALARM = 10
+
+# 8-bit I2C addresses of the devices on I2C1
+DEVICES = {
+    0xD0: "ds1307",
+    0x78: "ssd1306",
+    0xAA: "max32664",
+    0xAB: "max32664",
+}
+
+STATES = ["MS_IDLE", "MS_WAIT", "MS_MEASURE", "MS_END", "MS_ERROR", "MS_EXERCISE"]
+
+HAL_STATUS = ["HAL_OK", "HAL_ERROR", "HAL_BUSY", "HAL_TIMEOUT"]
+
+# indexed by alarm_channel_id_t
+ALARMS = ["ALARM_LOW_OXY", "ALARM_HIGH_HR"]
+
+HEADER = re.compile(r"^trace (\d+) (\d+)$")
+EVENT = re.compile(r"^(\d+) (\d+) (\d+) (\d+)$")
+
+
+def parse_dump(lines):
+    """Returns (events, lost) of the last complete dump in the capture."""
+    dumps = []
+    current = None
+    for raw in lines:
+        line = raw.strip()
+        header = HEADER.match(line)
+        if header:
+            current = {"lost": int(header.group(2)), "events": []}
+            continue
+        if current is None:
+            continue
+        if line == "trace end":
+            dumps.append(current)
+            current = None
+            continue
+        event = EVENT.match(line)
+        if event:
+            current["events"].append(tuple(int(v) for v in event.groups()))
+    if not dumps:
+        raise ValueError("no complete trace dump found")
+    return dumps[-1]["events"], dumps[-1]["lost"]
+
+
+def unwrap(events):
+    """Extends the 32-bit microsecond timestamps across the wrap-around."""
+    result = []
+    offset = 0
+    previous = None
+    for timestamp, kind, arg, value in events:
+        if previous is not None and timestamp + offset < previous - (1 << 31):
+            offset += 1 << 32
+        previous = timestamp + offset
+        result.append((previous, kind, arg, value))
+    result.sort(key=lambda e: e[0])
+    return result
+
+
+def device_name(address):
+    return DEVICES.get(address, "0x%02X" % address)
+
+
+def state_name(state):
+    return STATES[state] if state < len(STATES) else "state %d" % state
+
+
+def alarm_name(channel):
+    return ALARMS[channel] if channel < len(ALARMS) else "alarm %d" % channel
+
+
+def convert(events):
+    trace = []
+    open_i2c = {}
+    open_uart = []
+    open_report = None
+    last_state = None
+    end = events[-1][0] if events else 0
+
+    def span(name, tid, begin, finish, args=None):
+        event = {"name": name, "ph": "X", "pid": 1, "tid": tid, "ts": begin, "dur": max(finish - begin, 0)}
+        if args:
+            event["args"] = args
+        trace.append(event)
+
+    for timestamp, kind, arg, value in events:
+        if kind == TRACE_I2C_BEGIN:
+            open_i2c.setdefault(arg, []).append((timestamp, value))
+        elif kind == TRACE_I2C_END:
+            pending = open_i2c.get(arg)
+            if pending:
+                begin, size = pending.pop()
+                status = HAL_STATUS[value] if value < len(HAL_STATUS) else str(value)
+                span(device_name(arg), "i2c " + device_name(arg), begin, timestamp,
+                     {"bytes": size, "status": status})
+        elif kind == TRACE_STATE:
+            if last_state is not None:
+                span(state_name(last_state[1]), "state", last_state[0], timestamp)
+            last_state = (timestamp, arg)
+        elif kind == TRACE_FIFO:
+            trace.append({"name": "hub fifo", "ph": "C", "pid": 1, "ts": timestamp, "args": {"samples": value}})
+        elif kind == TRACE_UART_BEGIN:
+            open_uart.append((timestamp, value))
+        elif kind == TRACE_UART_END:
+            if open_uart:
+                begin, size = open_uart.pop()
+                span("tx", "uart", begin, timestamp, {"bytes": size})
+        elif kind == TRACE_SAMPLE:
+            trace.append({"name": "sample" if arg else "rejected", "ph": "i", "s": "t", "pid": 1, "tid": "samples",
+                          "ts": timestamp, "args": {"heart_rate": value / 10}})
+        elif kind == TRACE_REPORT_BEGIN:
+            open_report = timestamp
+        elif kind == TRACE_REPORT_END:
+            if open_report is not None:
+                span("report", "report", open_report, timestamp, {"samples": value, "outcome": state_name(arg)})
+                open_report = None
+        elif kind == TRACE_ALARM:
+            trace.append({"name": "alarm raised" if arg & 0x80 else "alarm cleared", "ph": "i", "s": "t", "pid": 1,
+                          "tid": "alarms", "ts": timestamp,
+                          "args": {"channel": alarm_name(arg & 0x7F), "latency_us": value}})
+
+    # transfers and states still running when the dump was taken
+    for address, pending in open_i2c.items():
+        for begin, size in pending:
+            span(device_name(address), "i2c " + device_name(address), begin, end, {"bytes": size, "status": "open"})
+    if last_state is not None:
+        span(state_name(last_state[1]), "state", last_state[0], end)
+
+    return trace
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="serial capture holding a trace dump, - for stdin")
+    parser.add_argument("-o", "--output", help="output JSON file, stdout by default")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.capture == "-" else open(args.capture, encoding="ascii", errors="replace")
+    with source:
+        events, lost = parse_dump(source)
+
+    document = {
+        "traceEvents": convert(unwrap(events)),
+        "displayTimeUnit": "ms",
+        "otherData": {"events": len(events), "lost": lost},
+    }
+
+    if args.output:
+        with open(args.output, "w", encoding="ascii") as output:
+            json.dump(document, output, indent=1)
+    else:
+        json.dump(document, sys.stdout, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
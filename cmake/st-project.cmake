@@ -74,21 +74,43 @@ target_sources(
     ${TARGET_NAME} PRIVATE
     "Core\\Src\\strfmt.c"
     "Core\\Src\\adc.c"
+    "Core\\Src\\acf.c"
+    "Core\\Src\\alarm.c"
+    "Core\\Src\\beat.c"
+    "Core\\Src\\console.c"
     "Core\\Src\\dma.c"
+    "Core\\Src\\ds1307nv.c"
     "Core\\Src\\ds1307rtc.c"
     "Core\\Src\\gpio.c"
+    "Core\\Src\\hampel.c"
+    "Core\\Src\\hrv.c"
     "Core\\Src\\i2c.c"
+    "Core\\Src\\i2cbus.c"
+    "Core\\Src\\i2crec.c"
     "Core\\Src\\main.c"
     "Core\\Src\\max32664.c"
+    "Core\\Src\\motion.c"
+    "Core\\Src\\power.c"
+    "Core\\Src\\ppg.c"
+    "Core\\Src\\prof.c"
+    "Core\\Src\\resp.c"
+    "Core\\Src\\rtc.c"
+    "Core\\Src\\sched.c"
+    "Core\\Src\\spo2.c"
     "Core\\Src\\ssd1306_fonts.c"
     "Core\\Src\\ssd1306.c"
+    "Core\\Src\\stats.c"
     "Core\\Src\\stm32f4xx_hal_msp.c"
     "Core\\Src\\stm32f4xx_it.c"
     "Core\\Src\\syscalls.c"
+    "Core\\Src\\sysclk.c"
     "Core\\Src\\sysmem.c"
     "Core\\Src\\system_stm32f4xx.c"
     "Core\\Src\\tim.c"
+    "Core\\Src\\trace.c"
+    "Core\\Src\\tracker.c"
     "Core\\Src\\usart.c"
+    "Core\\Src\\usclock.c"
     "Core\\Startup\\startup_stm32f401retx.s"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_adc_ex.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_adc.c"
@@ -106,6 +128,8 @@ target_sources(
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_pwr.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_rcc_ex.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_rcc.c"
+    "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_rtc_ex.c"
+    "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_rtc.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_tim_ex.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_tim.c"
     "Drivers\\STM32F4xx_HAL_Driver\\Src\\stm32f4xx_hal_uart.c"